@@ -7,7 +7,7 @@ License: GPLv2+
 URL: http://www.gitorious.org/+maemo-tools-developers/maemo-tools/sp-smaps
 Source: %{name}-%{version}.tar.gz
 BuildRoot: %{_tmppath}/%{name}-%{version}-%{release}-build
-BuildRequires: libsysperf-devel, python
+BuildRequires: libsysperf-devel, zlib-devel, python
 
 %description
  Contains /proc/pid/smaps snapshot and data visualization utilities.
@@ -0,0 +1,727 @@
+/* This program generates synthetic /proc trees for sp_smaps_snapshot.
+ * This file is part of sp-smaps.
+ *
+ * Copyright (C) 2004-2007,2009,2011 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * Include files
+ * ========================================================================= */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <libsysperf/msg.h>
+#include <libsysperf/argvec.h>
+
+/* ========================================================================= *
+ * Configuration
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * Tool Version
+ * ------------------------------------------------------------------------- */
+
+#define TOOL_NAME "sp_smaps_fakeproc"
+#include "release.h"
+
+/* ------------------------------------------------------------------------- *
+ * Runtime Manual
+ * ------------------------------------------------------------------------- */
+
+static const manual_t app_man[]=
+{
+  MAN_ADD("NAME",
+          TOOL_NAME"  --  create synthetic /proc tree for scale testing\n"
+          )
+  MAN_ADD("SYNOPSIS",
+          ""TOOL_NAME" [options] -o <directory>\n"
+          )
+  MAN_ADD("DESCRIPTION",
+          "This tool generates a directory tree that looks like /proc\n"
+          "as far as sp_smaps_snapshot is concerned: for every process\n"
+          "there is a pid directory with cmdline, status, exe and smaps\n"
+          "entries.\n"
+          "\n"
+          "Libraries are picked from a shared pool so that a few of them\n"
+          "are mapped by almost every process while most are used only\n"
+          "by some, like on a real system. Kernel threads with empty\n"
+          "smaps data are created as children of kthreadd.\n"
+          "\n"
+          "The output is deterministic for given parameters, which makes\n"
+          "it usable for benchmarking and regression testing both the\n"
+          "capture and the post processing tools without needing a\n"
+          "machine that actually runs thousands of processes.\n"
+          )
+  MAN_ADD("OPTIONS", 0)
+
+  MAN_ADD("EXAMPLES",
+          "% "TOOL_NAME" -o fake.proc -n 100000 -m 60\n"
+          "% sp_smaps_snapshot -P fake.proc -o fake.cap\n"
+          "\n"
+          "  Creates 100000 processes with 60 mappings each and then\n"
+          "  takes a snapshot of them.\n"
+          )
+  MAN_ADD("COPYRIGHT",
+          "Copyright (C) 2004-2007,2009,2011 Nokia Corporation.\n\n"
+          "This is free software.  You may redistribute copies of it under the\n"
+          "terms of the GNU General Public License v2 included with the software.\n"
+          "There is NO WARRANTY, to the extent permitted by law.\n"
+          )
+  MAN_ADD("SEE ALSO",
+          "sp_smaps_snapshot (1), sp_smaps_filter (1)\n"
+          "\n"
+          )
+  MAN_END
+};
+
+/* ------------------------------------------------------------------------- *
+ * Commandline Arguments
+ * ------------------------------------------------------------------------- */
+
+enum
+{
+  opt_noswitch = -1,
+  opt_help,
+  opt_vers,
+
+  opt_verbose,
+  opt_quiet,
+  opt_silent,
+
+  opt_output,
+  opt_processes,
+  opt_mappings,
+  opt_libraries,
+  opt_kthreads,
+  opt_threads,
+  opt_seed,
+};
+
+static const option_t app_opt[] =
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * usage, version & verbosity
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_help,
+          "h", "help", 0,
+          "This help text\n"),
+
+  OPT_ADD(opt_vers,
+          "V", "version", 0,
+          "Tool version\n"),
+
+  OPT_ADD(opt_verbose,
+          "v", "verbose", 0,
+          "Enable diagnostic messages\n"),
+
+  OPT_ADD(opt_quiet,
+          "q", "quiet", 0,
+          "Disable warning messages\n"),
+
+  OPT_ADD(opt_silent,
+          "s", "silent", 0,
+          "Disable all messages\n"),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * application options
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_output,
+          "o", "output", "<directory>",
+          "Directory to create the process tree in.\n" ),
+
+  OPT_ADD(opt_processes,
+          "n", "processes", "<count>",
+          "Number of user space processes (default: 100).\n" ),
+
+  OPT_ADD(opt_mappings,
+          "m", "mappings", "<count>",
+          "Mappings per process (default: 50).\n" ),
+
+  OPT_ADD(opt_libraries,
+          "l", "libraries", "<count>",
+          "Size of the shared library pool (default: 200).\n" ),
+
+  OPT_ADD(opt_kthreads,
+          "k", "kthreads", "<count>",
+          "Number of kernel threads (default: 20).\n" ),
+
+  OPT_ADD(opt_threads,
+          "t", "threads", "<count>",
+          "Extra threads in every fourth user space process, listed\n"
+          "as pid directories of their own (default: 0).\n" ),
+
+  OPT_ADD(opt_seed,
+          "S", "seed", "<number>",
+          "Random number generator seed (default: 1).\n" ),
+
+  OPT_END
+};
+
+/* ------------------------------------------------------------------------- *
+ * Generator parameters
+ * ------------------------------------------------------------------------- */
+
+static const char *outdir    = 0;
+static int         processes = 100;
+static int         mappings  = 50;
+static int         libraries = 200;
+static int         kthreads  = 20;
+static int         threads   = 0;
+static unsigned    seed      = 1;
+
+static char       *lib_used  = 0; // [libraries], per process scratch
+
+/* ========================================================================= *
+ * Utility functions
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * rnd  --  xorshift prng, same sequence on every platform
+ * ------------------------------------------------------------------------- */
+
+static unsigned rnd_state = 1;
+
+static unsigned rnd(void)
+{
+  unsigned x = rnd_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return rnd_state = x;
+}
+
+static unsigned rnd_range(unsigned lo, unsigned hi)
+{
+  return lo + rnd() % (hi - lo + 1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * rnd_library  --  zipf like library popularity, index 0 is most popular
+ * ------------------------------------------------------------------------- */
+
+static int rnd_library(void)
+{
+  /* cubing uniform variate skews picks towards start of the pool:
+   * half of them hit the first 1/8 of the libraries */
+  double u = (rnd() % 1000000) / 1000000.0;
+  int    i = (int)(libraries * u * u * u);
+  return (i < libraries) ? i : libraries - 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * create_file  --  open file below process directory for writing
+ * ------------------------------------------------------------------------- */
+
+static FILE *create_file(const char *piddir, const char *name)
+{
+  char  path[PATH_MAX];
+  FILE *file;
+
+  snprintf(path, sizeof path, "%s/%s", piddir, name);
+  if( (file = fopen(path, "w")) == 0 )
+  {
+    msg_fatal("%s: %s\n", path, strerror(errno));
+  }
+  return file;
+}
+
+/* ------------------------------------------------------------------------- *
+ * create_dir  --  create directory unless it already exists
+ * ------------------------------------------------------------------------- */
+
+static void create_dir(const char *path)
+{
+  if( mkdir(path, 0777) == -1 && errno != EEXIST )
+  {
+    msg_fatal("%s: %s\n", path, strerror(errno));
+  }
+}
+
+/* ========================================================================= *
+ * Synthetic smaps data
+ * ========================================================================= */
+
+typedef struct fakemap_t fakemap_t;
+
+/* ------------------------------------------------------------------------- *
+ * fakemap_t  --  values for one generated mapping
+ * ------------------------------------------------------------------------- */
+
+struct fakemap_t
+{
+  const char *prot;
+  const char *path;
+  unsigned    size;
+  unsigned    shared_clean;
+  unsigned    shared_dirty;
+  unsigned    private_clean;
+  unsigned    private_dirty;
+  unsigned    sharers;
+  unsigned    swap;
+};
+
+/* ------------------------------------------------------------------------- *
+ * fakemap_emit  --  write one smaps entry, update process totals
+ * ------------------------------------------------------------------------- */
+
+static void fakemap_emit(FILE *file, unsigned *addr, const fakemap_t *m,
+                         unsigned *vmsize, unsigned *vmrss)
+{
+  /* page granularity for everything except pss */
+  unsigned size = (m->size + 3) & ~3u;
+  unsigned scln = m->shared_clean  & ~3u;
+  unsigned sdty = m->shared_dirty  & ~3u;
+  unsigned pcln = m->private_clean & ~3u;
+  unsigned pdty = m->private_dirty & ~3u;
+  unsigned swap = m->swap          & ~3u;
+
+  unsigned head = *addr;
+  unsigned tail = head + size * 1024;
+  unsigned rss  = scln + sdty + pcln + pdty;
+  unsigned pss  = pcln + pdty + (scln + sdty) / m->sharers;
+  unsigned anon = (*m->path == '/') ? pdty : rss;
+
+  fprintf(file, "%08x-%08x %s %08x %s %-10u %s\n",
+          head, tail, m->prot, 0,
+          (*m->path == '/') ? "08:01" : "00:00",
+          (*m->path == '/') ? 100000 + (unsigned)strlen(m->path) : 0,
+          m->path);
+
+  fprintf(file, "Size:           %8u kB\n", size);
+  fprintf(file, "Rss:            %8u kB\n", rss);
+  fprintf(file, "Pss:            %8u kB\n", pss);
+  fprintf(file, "Shared_Clean:   %8u kB\n", scln);
+  fprintf(file, "Shared_Dirty:   %8u kB\n", sdty);
+  fprintf(file, "Private_Clean:  %8u kB\n", pcln);
+  fprintf(file, "Private_Dirty:  %8u kB\n", pdty);
+  fprintf(file, "Referenced:     %8u kB\n", rss);
+  fprintf(file, "Anonymous:      %8u kB\n", anon);
+  fprintf(file, "Swap:           %8u kB\n", swap);
+  fprintf(file, "KernelPageSize: %8u kB\n", 4);
+  fprintf(file, "MMUPageSize:    %8u kB\n", 4);
+  fprintf(file, "Locked:         %8u kB\n", 0);
+
+  /* leave one page gap between mappings */
+  *addr = tail + 4096;
+  *vmsize += size;
+  *vmrss  += rss;
+}
+
+/* ------------------------------------------------------------------------- *
+ * library_path  --  name for library in the shared pool
+ * ------------------------------------------------------------------------- */
+
+static const char *library_path(int lib)
+{
+  static const char *const well_known[] =
+  {
+    "/lib/libc-2.13.so",
+    "/lib/ld-2.13.so",
+    "/lib/libpthread-2.13.so",
+    "/lib/libm-2.13.so",
+    "/lib/libdl-2.13.so",
+    "/usr/lib/libglib-2.0.so.0.2800.6",
+    "/usr/lib/libgobject-2.0.so.0.2800.6",
+    "/usr/lib/libdbus-1.so.3.5.4",
+    "/usr/lib/locale/locale-archive",
+    "/usr/share/fonts/.cache/fontconfig.cache",
+  };
+  static char temp[64];
+
+  if( lib < (int)(sizeof well_known / sizeof *well_known) )
+  {
+    return well_known[lib];
+  }
+  snprintf(temp, sizeof temp, "/usr/lib/libfake%04d.so.%d", lib, lib % 3);
+  return temp;
+}
+
+/* ------------------------------------------------------------------------- *
+ * emit_smaps  --  write smaps file for one user space process
+ * ------------------------------------------------------------------------- */
+
+static void emit_smaps(FILE *file, const char *exe,
+                       unsigned *vmsize, unsigned *vmrss)
+{
+  unsigned  addr = 0x00008000;
+  fakemap_t m;
+  int       left = mappings;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * executable: code + data
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memset(&m, 0, sizeof m);
+  m.path = exe, m.sharers = 1;
+
+  m.prot = "r-xp", m.size = rnd_range(8, 2048);
+  m.private_clean = m.size / 2;
+  fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+  m.prot = "rw-p", m.size = rnd_range(4, 64);
+  m.private_clean = 0, m.private_dirty = m.size / 2;
+  fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * heap
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memset(&m, 0, sizeof m);
+  m.path = "[heap]", m.prot = "rw-p", m.sharers = 1;
+  m.size = rnd_range(132, 65536);
+  m.private_dirty = m.size * rnd_range(10, 90) / 100;
+  fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * libraries: code, relro & data each
+   * - - - - - - - - - - - - - - - - - - - */
+
+  addr = 0x40000000;
+
+  memset(lib_used, 0, libraries);
+
+  for( int lib = 0, tries = 0; left > 8 && tries < 4 * libraries;
+       lib = rnd_library(), ++tries )
+  {
+    if( lib_used[lib] ) continue;
+    lib_used[lib] = 1;
+
+    const char *path = library_path(lib);
+    unsigned    users = processes / (lib + 1) + 1;
+
+    memset(&m, 0, sizeof m);
+    m.path = path, m.sharers = users;
+
+    m.prot = "r-xp", m.size = rnd_range(8, 4096);
+    m.shared_clean  = m.size * rnd_range(20, 80) / 100;
+    m.private_clean = (users == 1) ? m.shared_clean : 0;
+    if( users == 1 ) m.shared_clean = 0;
+    fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+    m.prot = "r--p", m.size = 4;
+    m.shared_clean = 0, m.private_clean = 0, m.private_dirty = 4;
+    fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+    m.prot = "rw-p", m.size = rnd_range(4, 64);
+    m.private_dirty = m.size * rnd_range(0, 100) / 100;
+    m.swap = (rnd() % 8) ? 0 : m.size - m.private_dirty;
+    fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * anonymous mappings
+   * - - - - - - - - - - - - - - - - - - - */
+
+  while( left > 2 )
+  {
+    memset(&m, 0, sizeof m);
+    m.path = "", m.prot = (rnd() % 4) ? "rw-p" : "---p", m.sharers = 1;
+    m.size = rnd_range(4, 8192);
+    if( *m.prot == 'r' )
+    {
+      m.private_dirty = m.size * rnd_range(0, 100) / 100;
+    }
+    fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * stack & vdso
+   * - - - - - - - - - - - - - - - - - - - */
+
+  addr = 0xbe800000;
+
+  memset(&m, 0, sizeof m);
+  m.path = "[stack]", m.prot = "rw-p", m.sharers = 1;
+  m.size = 132, m.private_dirty = rnd_range(8, 132);
+  fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+
+  memset(&m, 0, sizeof m);
+  m.path = "[vdso]", m.prot = "r-xp", m.sharers = processes;
+  m.size = 4;
+  fakemap_emit(file, &addr, &m, vmsize, vmrss), --left;
+}
+
+/* ------------------------------------------------------------------------- *
+ * emit_task  --  create /proc/pid like directory
+ *
+ * Non-leader threads (pid != tgid) share the leader's cmdline, exe and
+ * memory figures; their smaps is left empty as the capture tool does
+ * not read it for them.
+ * ------------------------------------------------------------------------- */
+
+static void emit_task(int pid, int tgid, int ppid, const char *name,
+                      int kthread, int threads,
+                      unsigned *vmsize, unsigned *vmrss)
+{
+  char      piddir[PATH_MAX];
+  char      exe[PATH_MAX];
+  char      path[PATH_MAX + sizeof "/exe"];
+  FILE     *file;
+
+  snprintf(piddir, sizeof piddir, "%s/%d", outdir, pid);
+  create_dir(piddir);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * smaps first, status needs the totals
+   * - - - - - - - - - - - - - - - - - - - */
+
+  snprintf(exe, sizeof exe, "/usr/bin/%s", name);
+
+  file = create_file(piddir, "smaps");
+  if( !kthread && pid == tgid )
+  {
+    emit_smaps(file, exe, vmsize, vmrss);
+  }
+  fclose(file);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * cmdline: nul separated argv
+   * - - - - - - - - - - - - - - - - - - - */
+
+  file = create_file(piddir, "cmdline");
+  if( !kthread )
+  {
+    fprintf(file, "%s%c--instance=%d%c", exe, 0, tgid, 0);
+  }
+  fclose(file);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * exe: dangling symlink is enough
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( !kthread )
+  {
+    snprintf(path, sizeof path, "%s/exe", piddir);
+    unlink(path);
+    if( symlink(exe, path) == -1 )
+    {
+      msg_warning("%s: %s\n", path, strerror(errno));
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * status
+   * - - - - - - - - - - - - - - - - - - - */
+
+  file = create_file(piddir, "status");
+  fprintf(file, "Name:\t%.15s\n", name);
+  fprintf(file, "State:\tS (sleeping)\n");
+  fprintf(file, "Tgid:\t%d\n", tgid);
+  fprintf(file, "Pid:\t%d\n", pid);
+  fprintf(file, "PPid:\t%d\n", ppid);
+  fprintf(file, "TracerPid:\t0\n");
+  fprintf(file, "Uid:\t%d\t%d\t%d\t%d\n", 0, 0, 0, 0);
+  fprintf(file, "Gid:\t%d\t%d\t%d\t%d\n", 0, 0, 0, 0);
+  fprintf(file, "FDSize:\t%d\n", kthread ? 64 : 256);
+  if( !kthread )
+  {
+    fprintf(file, "VmPeak:\t%8u kB\n", *vmsize + *vmsize / 8);
+    fprintf(file, "VmSize:\t%8u kB\n", *vmsize);
+    fprintf(file, "VmLck:\t%8u kB\n", 0);
+    fprintf(file, "VmHWM:\t%8u kB\n", *vmrss + *vmrss / 8);
+    fprintf(file, "VmRSS:\t%8u kB\n", *vmrss);
+    fprintf(file, "VmData:\t%8u kB\n", *vmsize / 2);
+    fprintf(file, "VmStk:\t%8u kB\n", 132);
+    fprintf(file, "VmExe:\t%8u kB\n", *vmsize / 16);
+    fprintf(file, "VmLib:\t%8u kB\n", *vmsize / 4);
+    fprintf(file, "VmPTE:\t%8u kB\n", *vmsize / 1024 + 4);
+  }
+  fprintf(file, "Threads:\t%d\n", threads);
+  fclose(file);
+}
+
+/* ------------------------------------------------------------------------- *
+ * emit_process  --  create thread group leader and its threads
+ * ------------------------------------------------------------------------- */
+
+static void emit_process(int pid, int ppid, const char *name, int kthread,
+                         int threads)
+{
+  unsigned vmsize = 0, vmrss = 0;
+
+  emit_task(pid, pid, ppid, name, kthread, 1 + threads, &vmsize, &vmrss);
+
+  for( int i = 1; i <= threads; ++i )
+  {
+    emit_task(pid + i, pid, ppid, name, kthread, 1 + threads, &vmsize, &vmrss);
+  }
+}
+
+/* ========================================================================= *
+ * Process tree generation
+ * ========================================================================= */
+
+static void generate_all(void)
+{
+  static const char *const names[] =
+  {
+    "dbus-daemon", "Xorg", "pulseaudio", "bash", "sshd", "java",
+    "python", "postgres", "nginx", "chrome", "systemd-udevd", "cron",
+  };
+  const int nnames = sizeof names / sizeof *names;
+
+  char  name[64];
+  int  *pids = calloc(processes * (1 + threads) + 1, sizeof *pids);
+  int   npid = 1;
+  int   pid  = 100;
+
+  create_dir(outdir);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * init, kthreadd & kernel threads
+   * - - - - - - - - - - - - - - - - - - - */
+
+  emit_process(1, 0, "init", 0, 0);
+  emit_process(2, 0, "kthreadd", 1, 0);
+
+  for( int i = 0; i < kthreads; ++i )
+  {
+    snprintf(name, sizeof name, "kworker/%d:%d", i / 4, i % 4);
+    emit_process(3 + i, 2, name, 1, 0);
+  }
+  if( pid < 3 + kthreads ) pid = 3 + kthreads;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * user space: parent is init or some
+   * earlier process -> realistic depth;
+   * with --threads every fourth process
+   * is multithreaded and the threads can
+   * fork children too
+   * - - - - - - - - - - - - - - - - - - - */
+
+  pids[0] = 1;
+
+  for( int i = 0; i < processes; ++i )
+  {
+    int ppid = (rnd() % 4) ? pids[rnd() % npid] : 1;
+    int nthr = (threads && rnd() % 4 == 0) ? threads : 0;
+
+    pid += rnd_range(1, 3);
+
+    snprintf(name, sizeof name, "%s-%d", names[rnd() % nnames], i);
+    emit_process(pid, ppid, name, 0, nthr);
+
+    for( int k = 0; k <= nthr; ++k )
+    {
+      pids[npid++] = pid + k;
+    }
+    pid += nthr;
+
+    if( (i + 1) % 10000 == 0 )
+    {
+      msg_progress("%d processes created\n", i + 1);
+    }
+  }
+
+  free(pids);
+}
+
+/* ========================================================================= *
+ * Main Entry Point
+ * ========================================================================= */
+
+int main(int ac, char **av)
+{
+  argvec_t *args = argvec_create(ac, av, app_opt, app_man);
+
+  while( !argvec_done(args) )
+  {
+    int       tag  = 0;
+    char     *par  = 0;
+
+    if( !argvec_next(args, &tag, &par) )
+    {
+      msg_error("(use --help for usage)\n");
+      exit(1);
+    }
+
+    switch( tag )
+    {
+    case opt_help:
+      argvec_usage(args);
+      exit(EXIT_SUCCESS);
+
+    case opt_vers:
+      printf("%s\n", TOOL_VERS);
+      exit(EXIT_SUCCESS);
+
+    case opt_verbose:
+      msg_incverbosity();
+      break;
+    case opt_quiet:
+      msg_decverbosity();
+      break;
+    case opt_silent:
+      msg_setsilent();
+      break;
+
+    case opt_output:
+      outdir = par;
+      break;
+    case opt_processes:
+      processes = strtol(par, 0, 0);
+      break;
+    case opt_mappings:
+      mappings = strtol(par, 0, 0);
+      break;
+    case opt_libraries:
+      libraries = strtol(par, 0, 0);
+      break;
+    case opt_kthreads:
+      kthreads = strtol(par, 0, 0);
+      break;
+    case opt_threads:
+      threads = strtol(par, 0, 0);
+      break;
+    case opt_seed:
+      seed = strtoul(par, 0, 0);
+      break;
+    }
+  }
+
+  argvec_delete(args);
+
+  if( outdir == 0 )
+  {
+    msg_fatal("output directory must be specified\n");
+  }
+  if( processes < 0 || mappings < 16 || libraries < 1 || kthreads < 0 ||
+      threads < 0 )
+  {
+    msg_fatal("invalid parameters (at least 16 mappings needed)\n");
+  }
+
+  rnd_state = seed ? seed : 1;
+  lib_used  = calloc(libraries, 1);
+  generate_all();
+  free(lib_used);
+
+  return EXIT_SUCCESS;
+}
@@ -55,10 +55,19 @@
 #include <assert.h>
 #include <math.h>
 #include <errno.h>
+#include <regex.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <pthread.h>
+
+#include <zlib.h>
 
 #include <libsysperf/csv_table.h>
 #include <libsysperf/array.h>
@@ -68,6 +77,7 @@
 #include <libsysperf/str_array.h>
 
 #include "symtab.h"
+#include "spsmaps.h"
 
 #if 0
 # define INLINE static inline
@@ -148,6 +158,20 @@ static const manual_t app_man[]=
           "% "TOOL_NAME" -m diff *.cap -o diff.pid.html -tapp\n"
           "  difference report in html details to pid.level\n"
           "                            appcolumn output trimmed\n"
+          "\n"
+          "% "TOOL_NAME" -L unix:/tmp/smaps.sock -c 2 -m diff -o diff.sys.csv\n"
+          "  receives two captures streamed with sp_smaps_snapshot\n"
+          "  -o unix:/tmp/smaps.sock and writes difference report\n"
+          "\n"
+          "% "TOOL_NAME" -S unix:/tmp/smaps.srv &\n"
+          "% "TOOL_NAME" -C unix:/tmp/smaps.srv -m analyze a.cap\n"
+          "  same output as without -C, processed by the resident\n"
+          "  server started on the first line\n"
+          "\n"
+          "% "TOOL_NAME" -m analyze -n '^browser' big.cap\n"
+          "  analyzes only the matching processes; the sections\n"
+          "  are located via index file big.cap.idx, which is\n"
+          "  created on first use\n"
           )
 
   MAN_ADD("NOTES",
@@ -187,12 +211,24 @@ enum
 
   opt_input,
   opt_output,
+  opt_no_cache,
+  opt_jobs,
+  opt_gzip,
 
   opt_filtmode,
 
   opt_difflevel,
   opt_trimlevel,
 
+  opt_listen,
+  opt_count,
+
+  opt_server,
+  opt_connect,
+
+  opt_select_pid,
+  opt_select_name,
+
 };
 static const option_t app_opt[] =
 {
@@ -232,6 +268,26 @@ static const option_t app_opt[] =
           "o", "output", "<destination path>",
           "Override default output path.\n" ),
 
+  OPT_ADD(opt_no_cache,
+          "N", "no-cache", 0,
+          "Always parse capture files. By default the prepared data\n"
+          "is stored to <capture>.cache and used on later runs until\n"
+          "the capture file changes.\n" ),
+
+  OPT_ADD(opt_jobs,
+          "j", "jobs", "<count>",
+          "Process up to given number of capture files in parallel.\n"
+          "Each file is loaded, processed and released on its own,\n"
+          "so memory use grows with the job count, not with the\n"
+          "number of files. In diff mode only loading is parallel.\n" ),
+
+  OPT_ADD(opt_gzip,
+          "z", "gzip", 0,
+          "Write analyze report pages gzip compressed, as <page>.gz.\n"
+          "Links between the pages still refer to the .html names,\n"
+          "so the report should be served by a web server that maps\n"
+          "them to the .gz files with gzip content encoding.\n" ),
+
   OPT_ADD(opt_filtmode,
           "m", "mode", "<filter mode>",
           "One of:\n"
@@ -262,6 +318,58 @@ static const option_t app_opt[] =
           "  3 = command, pid, type\n"
           "  4 = command, pid, type, path\n"),
 
+  /* - - - - - - - - - - - - - - - - - - - *
+   * streaming input
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_listen,
+          "L", "listen", "<address>",
+          "Receive captures streamed by sp_smaps_snapshot instead\n"
+          "of reading files. The address is unix:<socket path> or\n"
+          "tcp:[host]:<port>. Each connection is one capture, it\n"
+          "is parsed as the data arrives and running totals are\n"
+          "printed after each capture.\n" ),
+
+  OPT_ADD(opt_count,
+          "c", "count", "<captures>",
+          "With --listen: stop after given number of captures and\n"
+          "process them according to the filter mode. Without this\n"
+          "captures are only summarized and then discarded.\n"
+          "With --server: exit after given number of requests.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * resident server
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_server,
+          "S", "server", "<address>",
+          "Stay resident and process requests sent with --connect.\n"
+          "Only unix:<path> addresses are accepted; the socket is\n"
+          "made private to the user and requests from other users\n"
+          "are refused. Interned strings and path sort keys are\n"
+          "kept between requests, so repeated analysis of similar\n"
+          "captures does not start from a cold state.\n" ),
+
+  OPT_ADD(opt_connect,
+          "C", "connect", "<address>",
+          "Send the request to a --server instead of processing it\n"
+          "locally. Input '-' streams capture data from stdin, an\n"
+          "output path must then be given.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * process selection
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_select_pid,
+          "i", "pid", "<pid[,pid...]>",
+          "Load only the given processes from capture files. Can be\n"
+          "used several times.\n" ),
+
+  OPT_ADD(opt_select_name,
+          "n", "name", "<regex>",
+          "Load only processes whose name matches the extended\n"
+          "regular expression from capture files.\n" ),
+
   /* - - - - - - - - - - - - - - - - - - - *
    * Sentinel
    * - - - - - - - - - - - - - - - - - - - */
@@ -269,11 +377,9 @@ static const option_t app_opt[] =
   OPT_END
 };
 
-#include <argz.h>
-
 static const char *abbr_title(const char *title)
 {
-  static char buf[512];
+  static __thread char buf[512];
   size_t tlen = strlen(title);
   if( tlen < TITLE_MAX_LEN )
   {
@@ -288,100 +394,6 @@ static const char *abbr_title(const char *title)
   }
 }
 
-typedef struct unknown_t unknown_t;
-
-/* ------------------------------------------------------------------------- *
- * unknown_t
- * ------------------------------------------------------------------------- */
-
-struct unknown_t
-{
-  char  *un_data;
-  size_t un_size;
-};
-
-#define UNKNOWN_INIT { 0, 0 }
-
-/* ========================================================================= *
- * unknown_t  --  methods
- * ========================================================================= */
-
-/* ------------------------------------------------------------------------- *
- * unknown_ctor
- * ------------------------------------------------------------------------- */
-
-void
-unknown_ctor(unknown_t *self)
-{
-  self->un_data = 0;
-  self->un_size = 0;
-}
-
-/* ------------------------------------------------------------------------- *
- * unknown_dtor
- * ------------------------------------------------------------------------- */
-
-void
-unknown_dtor(unknown_t *self)
-{
-  free(self->un_data);
-}
-
-/* ------------------------------------------------------------------------- *
- * unknown_create
- * ------------------------------------------------------------------------- */
-
-unknown_t *
-unknown_create(void)
-{
-  unknown_t *self = calloc(1, sizeof *self);
-  unknown_ctor(self);
-  return self;
-}
-
-/* ------------------------------------------------------------------------- *
- * unknown_delete
- * ------------------------------------------------------------------------- */
-
-void
-unknown_delete(unknown_t *self)
-{
-  if( self != 0 )
-  {
-    unknown_dtor(self);
-    free(self);
-  }
-}
-
-/* ------------------------------------------------------------------------- *
- * unknown_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-unknown_delete_cb(void *self)
-{
-  unknown_delete(self);
-}
-
-/* ------------------------------------------------------------------------- *
- * unknown_add
- * ------------------------------------------------------------------------- */
-
-int
-unknown_add(unknown_t *self, const char *txt)
-{
-  char *entry = 0;
-  while( (entry = argz_next(self->un_data, self->un_size, entry)) != 0 )
-  {
-    if( !strcmp(entry, txt) )
-    {
-      return 0;
-    }
-  }
-  argz_add(&self->un_data, &self->un_size, txt);
-  return 1;
-}
-
 /* ========================================================================= *
  * utilities
  * ========================================================================= */
@@ -401,37 +413,13 @@ INLINE int path_isdir(const char *path)
   return 0;
 }
 
-INLINE char *path_basename(const char *path)
-{
-  char *r = strrchr(path, '/');
-  return r ? (r+1) : (char *)path;
-}
-
 INLINE char *path_extension(const char *path)
 {
-  char *b = path_basename(path);
+  char *b = smaps_path_basename(path);
   char *e = strrchr(b, '.');
   return e ? e : strchr(b,0);
 }
 
-INLINE int path_compare(const char *p1, const char *p2)
-{
-  int r;
-
-  r = (*p1 != '[') - (*p2 != '[');
-  if (r) return r;
-
-  r = (strstr(p1,".cache")!=0) - (strstr(p2,".cache")!=0);
-
-  if( r == 0 )
-  {
-    r = strcasecmp(path_basename(p1), path_basename(p2));
-  }
-
-  return r ? r : strcasecmp(p1, p2);
-// QUARANTINE   return strcmp(path_basename(p1), path_basename(p2));
-}
-
 // QUARANTINE INLINE unsigned umax(unsigned a, unsigned b)
 // QUARANTINE {
 // QUARANTINE   return (a>b)?a:b;
@@ -461,49 +449,8 @@ INLINE double pow2(double a)
 // QUARANTINE   return (a>b)?a:b;
 // QUARANTINE }
 
-INLINE void pusum(unsigned *a, unsigned b)
-{
-  *a += b;
-}
-INLINE void pumax(unsigned *a, unsigned b)
-{
-  if( *a < b ) *a=b;
-}
-
 /* Pass additional data to qsort() comparison function. */
-static void *qsort_cmp_data;
-
-/* ------------------------------------------------------------------------- *
- * array_find_lower  --  bsearch lower bound from sorted array_t
- * ------------------------------------------------------------------------- */
-
-int
-array_find_lower(array_t *self, int lo, int hi, int (*fn)(const void*))
-{
-  while( lo < hi )
-  {
-    int i = (lo + hi) / 2;
-    int r = fn(self->data[i]);
-    if( r >= 0 ) { hi = i+0; } else { lo = i+1; }
-  }
-  return lo;
-}
-
-/* ------------------------------------------------------------------------- *
- * array_find_upper  --  bsearch upper bound from sorted array_t
- * ------------------------------------------------------------------------- */
-
-int
-array_find_upper(array_t *self, int lo, int hi, int (*fn)(const void*))
-{
-  while( lo < hi )
-  {
-    int i = (lo + hi) / 2;
-    int r = fn(self->data[i]);
-    if( r > 0 ) { hi = i+0; } else { lo = i+1; }
-  }
-  return lo;
-}
+static __thread void *qsort_cmp_data;
 
 /* ------------------------------------------------------------------------- *
  * uval  --  return number as string or "-" for zero values
@@ -511,357 +458,280 @@ array_find_upper(array_t *self, int lo, int hi, int (*fn)(const void*))
 
 const char *uval(unsigned n)
 {
-  static char temp[512];
+  static __thread char temp[512];
   snprintf(temp, sizeof temp, "%u", n);
   return n ? temp : "-";
 }
 
-/* ------------------------------------------------------------------------- *
- * array_move  --  TODO: this should be in libsysperf
- * ------------------------------------------------------------------------- */
+/* ========================================================================= *
+ * Custom Objects
+ * ========================================================================= */
 
-INLINE void
-array_move(array_t *self, array_t *from)
-{
-  array_minsize(self, self->size + from->size);
-  for( size_t i = 0; i < from->size; ++i )
-  {
-    self->data[self->size++] = from->data[i];
-  }
-  from->size = 0;
-}
+typedef struct smapsfilt_t smapsfilt_t;
 
 /* ------------------------------------------------------------------------- *
- * xstrfmt  --  sprintf to dynamically allocated buffer
+ * page_t  --  html page buffered in memory and written out only if the
+ *             content differs from what is already on disk
+ *
+ * Compressed pages are deflated while they are generated and written to
+ * <path>.gz, so that only the compressed copy is ever held in memory.
  * ------------------------------------------------------------------------- */
 
-STATIC char *
-xstrfmt(char **pstr, const char *fmt, ...)
+typedef struct page_t
 {
-  char *res = 0;
-  char tmp[256];
-  va_list va;
-  int nc;
-
-  va_start(va, fmt);
-  nc = vsnprintf(tmp, sizeof tmp, fmt, va);
-  va_end(va);
-
-  if( nc >= 0 )
-  {
-    if( nc < sizeof tmp )
-    {
-      res = strdup(tmp);
-    }
-    else
-    {
-      res = malloc(nc + 1);
-      va_start(va, fmt);
-      vsnprintf(res, nc+1, fmt, va);
-      va_end(va);
-    }
-  }
-
-  free(*pstr);
-  return *pstr = res;
-}
-
-/* ------------------------------------------------------------------------- *
- * slice  --  split string at separator char
- * ------------------------------------------------------------------------- */
+  char     *page_path;
+  char     *page_data;
+  size_t    page_size;
+  size_t    page_room;  // allocated size of page_data, compressed pages
+  int       page_gzip;
+  z_stream  page_zstrm;
+  FILE     *page_file;
+} page_t;
 
-STATIC char *
-slice(char **ppos, int sep)
+static int
+page_unchanged(const page_t *self)
 {
-  char *pos = *ppos;
+  int           same = 0;
+  FILE         *file = 0;
+  size_t        done = 0;
+  struct stat   st;
+  char          buf[1<<16];
+  size_t        n;
 
-  while( (*pos > 0) && (*pos <= 32) )
+  if( stat(self->page_path, &st) != 0 || !S_ISREG(st.st_mode) ||
+      (size_t)st.st_size != self->page_size )
   {
-    ++pos;
+    goto cleanup;
   }
-  char *res = pos;
 
-  if( sep < 0 )
+  if( (file = fopen(self->page_path, "r")) == 0 )
   {
-    for( ; *pos; ++pos )
-    {
-      if( *(unsigned char *)pos <= 32 )
-      {
-        *pos++ = 0; break;
-      }
-    }
+    goto cleanup;
   }
-  else
+
+  while( (n = fread(buf, 1, sizeof buf, file)) != 0 )
   {
-    for( ; *pos; ++pos )
+    if( n > self->page_size - done ||
+        memcmp(buf, self->page_data + done, n) )
     {
-      if( *(unsigned char *)pos == sep )
-      {
-        *pos++ = 0; break;
-      }
+      goto cleanup;
     }
+    done += n;
   }
 
-  *ppos = pos;
-  return res;
-}
+  same = !ferror(file) && done == self->page_size;
 
-/* ========================================================================= *
- * Custom Objects
- * ========================================================================= */
+  cleanup:
+
+  if( file != 0 ) fclose(file);
 
-typedef struct analyze_t analyze_t;
+  return same;
+}
 
 /* - - - - - - - - - - - - - - - - - - - *
- * container classes
+ * gzip compression, wrapped in a stdio
+ * stream so that the emitters can keep
+ * using fprintf()
  * - - - - - - - - - - - - - - - - - - - */
 
-typedef struct smapsfilt_t smapsfilt_t;
-typedef struct smapssnap_t smapssnap_t;
-typedef struct smapsproc_t smapsproc_t;
-typedef struct smapsmapp_t smapsmapp_t;
+static int
+page_deflate(page_t *self, const char *data, size_t size, int flush)
+{
+  z_stream *zs = &self->page_zstrm;
+  int       rc = Z_OK;
 
-/* - - - - - - - - - - - - - - - - - - - *
- * rawdata classes
- * - - - - - - - - - - - - - - - - - - - */
+  zs->next_in  = (Bytef *)data;
+  zs->avail_in = size;
 
-typedef struct pidinfo_t pidinfo_t; // Name,Pid,PPid, ...
-typedef struct mapinfo_t mapinfo_t; // head,tail,prot, ...
-typedef struct meminfo_t meminfo_t; // Size,RSS,Shared_Clean, ...
+  do
+  {
+    if( self->page_room - self->page_size < (4<<10) )
+    {
+      size_t room = self->page_room ? self->page_room * 2 : (64<<10);
+      char  *data = realloc(self->page_data, room);
 
-/* ------------------------------------------------------------------------- *
- * meminfo_t
- * ------------------------------------------------------------------------- */
+      if( data == 0 )
+      {
+        return -1;
+      }
+      self->page_data = data;
+      self->page_room = room;
+    }
 
-struct meminfo_t
-{
-  unsigned Size;
-  unsigned Rss;
-  unsigned Shared_Clean;
-  unsigned Shared_Dirty;
-  unsigned Private_Clean;
-  unsigned Private_Dirty;
-  unsigned Pss;
-  unsigned Swap;
-  unsigned Referenced;
-  unsigned Anonymous;
-  unsigned Locked;
-};
+    zs->next_out  = (Bytef *)self->page_data + self->page_size;
+    zs->avail_out = self->page_room - self->page_size;
 
-void       meminfo_ctor              (meminfo_t *self);
-void       meminfo_dtor              (meminfo_t *self);
-void       meminfo_accumulate_appdata(meminfo_t *self, const meminfo_t *that);
-void       meminfo_accumulate_libdata(meminfo_t *self, const meminfo_t *that);
-void       meminfo_parse             (meminfo_t *self, char *line);
+    if( (rc = deflate(zs, flush)) == Z_STREAM_ERROR )
+    {
+      return -1;
+    }
 
-meminfo_t *meminfo_create            (void);
-void       meminfo_delete            (meminfo_t *self);
-void       meminfo_delete_cb         (void *self);
+    self->page_size = self->page_room - zs->avail_out;
+  } while( zs->avail_in != 0 || (flush == Z_FINISH && rc != Z_STREAM_END) );
 
-/* ------------------------------------------------------------------------- *
- * meminfo_total
- * ------------------------------------------------------------------------- */
+  return 0;
+}
 
-INLINE unsigned
-meminfo_total(const meminfo_t *self)
+static ssize_t
+page_write_cb(void *cookie, const char *buf, size_t size)
 {
-  return (self->Shared_Clean  +
-          self->Shared_Dirty  +
-          self->Private_Clean +
-          self->Private_Dirty);
+  return page_deflate(cookie, buf, size, Z_NO_FLUSH) ? 0 : (ssize_t)size;
 }
 
-/* ------------------------------------------------------------------------- *
- * mapinfo_t
- * ------------------------------------------------------------------------- */
-
-struct mapinfo_t
+static int
+page_close_cb(void *cookie)
 {
-  unsigned   head;
-  unsigned   tail;
-  char      *prot;
-  unsigned   offs;
-  char      *node;
-  unsigned   flgs;
-  char      *path;
-  char      *type;
-};
-
-void       mapinfo_ctor     (mapinfo_t *self);
-void       mapinfo_dtor     (mapinfo_t *self);
-
-mapinfo_t *mapinfo_create   (void);
-void       mapinfo_delete   (mapinfo_t *self);
-void       mapinfo_delete_cb(void *self);
+  page_t *self  = cookie;
+  int     error = page_deflate(self, "", 0, Z_FINISH);
 
-/* ------------------------------------------------------------------------- *
- * pidinfo_t
- * ------------------------------------------------------------------------- */
+  deflateEnd(&self->page_zstrm);
+  return error ? EOF : 0;
+}
 
-struct pidinfo_t
+static FILE *
+page_gzip_stream(page_t *self)
 {
-  char    *Name;
-  int      Pid;
-  int      PPid;
-  int      Threads;
-  unsigned VmPeak;
-  unsigned VmSize;
-  unsigned VmLck;
-  unsigned VmHWM;
-  unsigned VmRSS;
-  unsigned VmData;
-  unsigned VmStk;
-  unsigned VmExe;
-  unsigned VmLib;
-  unsigned VmPTE;
-};
+  cookie_io_functions_t io =
+  {
+    .write = page_write_cb,
+    .close = page_close_cb,
+  };
 
-void       pidinfo_ctor     (pidinfo_t *self);
-void       pidinfo_dtor     (pidinfo_t *self);
-void       pidinfo_parse    (pidinfo_t *self, char *line);
+  FILE *file = 0;
 
-pidinfo_t *pidinfo_create   (void);
-void       pidinfo_delete   (pidinfo_t *self);
-void       pidinfo_delete_cb(void *self);
+  /* gzip wrapper, header without time stamp: same input, same output */
+  if( deflateInit2(&self->page_zstrm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+  {
+    return 0;
+  }
 
-/* ------------------------------------------------------------------------- *
- * smapsmapp_t
- * ------------------------------------------------------------------------- */
+  if( (file = fopencookie(self, "w", io)) == 0 )
+  {
+    deflateEnd(&self->page_zstrm);
+  }
+  return file;
+}
 
-struct smapsmapp_t
+static FILE *
+page_open(page_t *self, const char *path, int gzip)
 {
-  int       smapsmapp_uid; // create -> load order enumeration
-
-  mapinfo_t smapsmapp_map;
-  meminfo_t smapsmapp_mem;
+  memset(self, 0, sizeof *self);
 
-  int       smapsmapp_AID;
-  int       smapsmapp_PID;
-  int       smapsmapp_LID;
-  int       smapsmapp_TID;
-  int       smapsmapp_EID;
-};
+  self->page_gzip = gzip;
 
-void         smapsmapp_ctor     (smapsmapp_t *self);
-void         smapsmapp_dtor     (smapsmapp_t *self);
+  if( !gzip )
+  {
+    self->page_path = strdup(path);
+    self->page_file = open_memstream(&self->page_data, &self->page_size);
+  }
+  else
+  {
+    asprintf(&self->page_path, "%s.gz", path);
+    self->page_file = page_gzip_stream(self);
+  }
 
-smapsmapp_t *smapsmapp_create   (void);
-void         smapsmapp_delete   (smapsmapp_t *self);
-void         smapsmapp_delete_cb(void *self);
+  if( self->page_file == 0 )
+  {
+    perror(path);
+    free(self->page_path), self->page_path = 0;
+  }
+  return self->page_file;
+}
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_t
- * ------------------------------------------------------------------------- */
+static void
+page_abort(page_t *self)
+{
+  if( self->page_file != 0 )
+  {
+    fclose(self->page_file), self->page_file = 0;
+  }
+  free(self->page_data), self->page_data = 0;
+  free(self->page_path), self->page_path = 0;
+}
 
-struct smapsproc_t
+static int
+page_close(page_t *self)
 {
-  int          smapsproc_uid;
+  int   error = -1;
+  FILE *file  = 0;
+  char *other = 0;
 
-  int          smapsproc_AID;
-  int          smapsproc_PID;
+  if( fclose(self->page_file) != 0 )
+  {
+    self->page_file = 0;
+    perror(self->page_path); goto cleanup;
+  }
+  self->page_file = 0;
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * smaps data & hierarchy
+   * a stale copy in the other format
+   * would shadow this one on servers that
+   * pick <page>.gz when it exists
    * - - - - - - - - - - - - - - - - - - - */
 
-  pidinfo_t    smapsproc_pid;
-  array_t      smapsproc_mapplist; // -> smapsmapp_t *
+  if( self->page_gzip )
+  {
+    other = strndup(self->page_path, strlen(self->page_path) - 3);
+  }
+  else
+  {
+    asprintf(&other, "%s.gz", self->page_path);
+  }
+  if( other != 0 && unlink(other) != 0 && errno != ENOENT )
+  {
+    perror(other);
+  }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * process hierarchy info
-   *
-   * Note: Owenership of childprocess data
-   *       remains with smapssnap_t!
+   * leave pages that did not change alone
+   * so that rerunning the analysis does
+   * not touch every file in the report
    * - - - - - - - - - - - - - - - - - - - */
 
-  smapsproc_t *smapsproc_parent;
-  array_t      smapsproc_children; // -> smapsproc_t *
-};
+  if( page_unchanged(self) )
+  {
+    error = 0; goto cleanup;
+  }
 
-void         smapsproc_ctor     (smapsproc_t *self);
-void         smapsproc_dtor     (smapsproc_t *self);
+  if( (file = fopen(self->page_path, "w")) == 0 )
+  {
+    perror(self->page_path); goto cleanup;
+  }
 
-smapsproc_t *smapsproc_create   (void);
-void         smapsproc_delete   (smapsproc_t *self);
-void         smapsproc_delete_cb(void *self);
+  if( fwrite(self->page_data, 1, self->page_size, file) != self->page_size )
+  {
+    perror(self->page_path); goto cleanup;
+  }
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_t
- * ------------------------------------------------------------------------- */
+  if( fclose(file) != 0 )
+  {
+    file = 0;
+    perror(self->page_path); goto cleanup;
+  }
+  file = 0;
 
-struct smapssnap_t
-{
-  char       *smapssnap_source;
-  int         smapssnap_format;
-  array_t     smapssnap_proclist; // -> smapsproc_t *
-  smapsproc_t smapssnap_rootproc;
-};
+  error = 0;
 
-enum {
-  SNAPFORMAT_OLD, // head /proc/[1-9]*/smaps > snapshot.cap
-  SNAPFORMAT_NEW, // sp_smaps_snapshot -o snapshot.cap
-};
+  cleanup:
 
-void         smapssnap_ctor     (smapssnap_t *self);
-void         smapssnap_dtor     (smapssnap_t *self);
+  if( file != 0 ) fclose(file);
 
-smapssnap_t *smapssnap_create   (void);
-void         smapssnap_delete   (smapssnap_t *self);
-void         smapssnap_delete_cb(void *self);
+  free(other);
+  page_abort(self);
 
-/* ------------------------------------------------------------------------- *
- * analyze_t  --  temporary book keeping structure for smaps snapshot analysis
- * ------------------------------------------------------------------------- */
-
-struct analyze_t
-{
-  // smaps data for all processes will be collected here
-
-  array_t  *mapp_tab;
-
-  // enumeration tables
-
-  symtab_t *appl_tab;  // application names
-  symtab_t *type_tab;  // mapping types: code, data, anon, ...
-  symtab_t *path_tab;  // mapping paths
-  symtab_t *summ_tab;  // app instance + mapping path
-
-  int ntypes;          // enumeration counts
-  int nappls;
-  int npaths;
-  int groups;
-
-  const char **stype;  // enumeration -> string lookup tables
-  const char **sappl;
-  const char **spath;
-
-  int *grp_app;        // group enum -> appid / libid lookup tables
-  int *grp_lib;
-
-  // memory usage accumulation tables
+  return error;
+}
 
-  meminfo_t *grp_mem; // [groups * ntypes];
-  meminfo_t *app_mem; // [nappls * ntypes];
-  meminfo_t *lib_mem; // [npaths * ntypes];
-  meminfo_t *sysest;  // [ntypes]
-  meminfo_t *sysmax;  // [ntypes]
-  meminfo_t *appmax;  // [ntypes]
-};
+/* ------------------------------------------------------------------------- *
+ * analyze_t  --  html output, see spsmaps.h for the rest
+ * ------------------------------------------------------------------------- */
 
-void       analyze_ctor                  (analyze_t *self);
-void       analyze_dtor                  (analyze_t *self);
-analyze_t *analyze_create                (void);
-void       analyze_delete                (analyze_t *self);
-void       analyze_delete_cb             (void *self);
-void       analyze_enumerate_data        (analyze_t *self, smapssnap_t *snap);
-void       analyze_accumulate_data       (analyze_t *self);
-void       analyze_get_apprange          (analyze_t *self, int lo, int hi, int *plo, int *phi, int aid);
-void       analyze_get_librange          (analyze_t *self, int lo, int hi, int *plo, int *phi, int lid);
-int        analyze_emit_lib_html         (analyze_t *self, smapssnap_t *snap, const char *work);
-int        analyze_emit_app_html         (analyze_t *self, smapssnap_t *snap, const char *work);
+int        analyze_emit_lib_html         (analyze_t *self, smapssnap_t *snap, const char *work, int gzip);
+int        analyze_emit_app_html         (analyze_t *self, smapssnap_t *snap, const char *work, int gzip);
 void       analyze_emit_smaps_table      (analyze_t *self, FILE *file, meminfo_t *v);
 void       analyze_emit_process_hierarchy(analyze_t *self, FILE *file, smapsproc_t *proc, const char *work, int recursion_depth);
-int        analyze_emit_main_page        (analyze_t *self, smapssnap_t *snap, const char *path);
+int        analyze_emit_main_page        (analyze_t *self, smapssnap_t *snap, const char *path, int gzip);
 
 /* ------------------------------------------------------------------------- *
  * smapsfilt_t
@@ -883,6 +753,20 @@ struct smapsfilt_t
   int         smapsfilt_trimlevel;
   str_array_t smapsfilt_inputs;
   char       *smapsfilt_output;
+  int         smapsfilt_cache;   // use & write <capture>.cache files
+  int         smapsfilt_jobs;    // inputs processed in parallel
+  int         smapsfilt_gzip;    // write analyze pages as .html.gz
+
+  char       *smapsfilt_listen;  // socket address for streamed captures
+  int         smapsfilt_count;   // captures to receive, 0 = unlimited
+
+  char       *smapsfilt_server;  // socket address to serve requests at
+  char       *smapsfilt_connect; // socket address of a server to use
+
+  int        *smapsfilt_pidtab;  // selected pids, sorted
+  int         smapsfilt_pidcnt;
+  char       *smapsfilt_name;    // selected name regex, as given
+  regex_t     smapsfilt_regex;
 
   array_t smapsfilt_snaplist; // -> smapssnap_t *
 };
@@ -894,1221 +778,1152 @@ smapsfilt_t *smapsfilt_create   (void);
 void         smapsfilt_delete   (smapsfilt_t *self);
 void         smapsfilt_delete_cb(void *self);
 
-/* ========================================================================= *
- * meminfo_t  --  methods
- * ========================================================================= */
+//#include "scrap.txt"
 
-/* ------------------------------------------------------------------------- *
- * meminfo_ctor
- * ------------------------------------------------------------------------- */
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-void
-meminfo_ctor(meminfo_t *self)
+enum emit_type {
+  EMIT_TYPE_LIBRARY,
+  EMIT_TYPE_APPLICATION,
+  EMIT_TYPE_OBJECT,
+};
+
+INLINE meminfo_t *
+analyze_mem(analyze_t *self, int a, int b, enum emit_type type)
 {
-  memset(self, 0, sizeof(*self));
+  if( type == EMIT_TYPE_LIBRARY)
+    return analyze_lib_mem(self, a, b);
+  if( type == EMIT_TYPE_APPLICATION)
+    return analyze_app_mem(self, a, b);
+  assert( 0 );
+  return NULL;
 }
 
-/* ------------------------------------------------------------------------- *
- * meminfo_dtor
- * ------------------------------------------------------------------------- */
-
-void
-meminfo_dtor(meminfo_t *self)
+static void
+analyze_html_header(FILE *file, const char *title, const char *work)
 {
+  fprintf(file, "<html>\n");
+  fprintf(file, "<head>\n");
+  fprintf(file, "<title>%s</title>\n", title);
+  fprintf(file, "<link rel=\"stylesheet\" type=\"text/css\" href=\"%s/tablesorter.css\" />\n", work);
+  fprintf(file, "<style type='text/css'>\n");
+  fprintf(file, "  table.tablesorter thead tr .header"
+                "  { background-image: url(%s/bg.gif);"
+                "    background-repeat: no-repeat;"
+                "    background-position: center right; }\n", work);
+  fprintf(file, "  table.tablesorter thead tr .headerSortUp"
+                "  { background-image: url(%s/asc.gif); }\n", work);
+  fprintf(file, "  table.tablesorter thead tr .headerSortDown"
+                "  { background-image: url(%s/desc.gif); }\n", work);
+  fprintf(file, "</style>\n");
+  fprintf(file, "</head>\n");
+  fprintf(file, "<body>\n");
+  fprintf(file, "<script src=\"%s/jquery.min.js\"></script>\n", work);
+  fprintf(file, "<script src=\"%s/jquery.metadata.js\"></script>\n", work);
+  fprintf(file, "<script src=\"%s/jquery.tablesorter.js\"></script>\n", work);
+  fprintf(file, "<script src=\"%s/expander.js\"></script>\n", work);
+  fprintf(file, "<script>$(document).ready(function() "
+                "{ $(\".tablesorter\").tablesorter(); } );</script>\n");
 }
 
+#define TP " bgcolor=\"#ffffbf\" "
+#define LT " bgcolor=\"#bfffff\" "
+#define D1 " bgcolor=\"#f4f4f4\" "
+#define D2 " bgcolor=\"#ffffff\" "
+
+static const char *const emit_type_titles[] = {
+  [EMIT_TYPE_LIBRARY]         = "Library",
+  [EMIT_TYPE_APPLICATION]     = "Application",
+  [EMIT_TYPE_OBJECT]          = "Object",
+};
+
 /* ------------------------------------------------------------------------- *
- * meminfo_parse
+ * analyze_emit_page_table
  * ------------------------------------------------------------------------- */
 
-void
-meminfo_parse(meminfo_t *self, char *line)
+static void
+analyze_emit_page_table(analyze_t *self, FILE *file, const meminfo_t *mtab, const pidinfo_t *pidinfo)
 {
-  char *key = slice(&line, ':');
-  char *val = slice(&line,  -1);
-
-  if( !strcmp(key, "Size") )
-  {
-    self->Size  = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Rss") )
-  {
-    self->Rss   = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Shared_Clean") )
-  {
-    self->Shared_Clean  = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Shared_Dirty") )
-  {
-    self->Shared_Dirty  = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Private_Clean") )
-  {
-    self->Private_Clean = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Private_Dirty") )
-  {
-    self->Private_Dirty = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Pss") )
-  {
-    self->Pss   = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Swap") )
-  {
-    self->Swap   = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Referenced") )
-  {
-    self->Referenced   = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Anonymous") )
-  {
-    self->Anonymous = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "Locked") )
+  fprintf(file, "<table border=1>\n");
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th rowspan=2>\n");
+  fprintf(file, "<th"TP"colspan=2>%s\n", "Dirty");
+  fprintf(file, "<th"TP"colspan=2>%s\n", "Clean");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Resident");
+  if (pidinfo)
   {
-    self->Locked = strtoul(val, 0, 10);
+    fprintf(file, "<th"TP"rowspan=2>%s\n",
+        "<abbr title='VmHWM field of /proc/pid/status'>Resident Peak</abbr>");
   }
-  else if( !strcmp(key, "KernelPageSize")
-        || !strcmp(key, "MMUPageSize")
-      )
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Size");
+  if (pidinfo)
   {
+    fprintf(file, "<th"TP"rowspan=2>%s\n",
+        "<abbr title='VmPeak field of /proc/pid/status'>Size Peak</abbr>");
   }
-  else
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Pss");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Swap");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Referenced");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Anonymous");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Locked");
+
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP">%s\n", "Private");
+  fprintf(file, "<th"TP">%s\n", "Shared");
+  fprintf(file, "<th"TP">%s\n", "Private");
+  fprintf(file, "<th"TP">%s\n", "Shared");
+
+  for( int t = 0; t < self->ntypes; ++t )
   {
-    static unknown_t unkn = UNKNOWN_INIT;
-    if( unknown_add(&unkn, key) )
+    const meminfo_t *m = &mtab[t];
+    const char *bg = ((t/3)&1) ? D1 : D2;
+
+    fprintf(file, "<tr>\n");
+    fprintf(file, "<th"LT" align=left>%s\n", self->stype[t]);
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Rss));
+    if (pidinfo)
     {
-      fprintf(stderr, "%s: Unknown key: '%s' = '%s'\n", __FUNCTION__, key, val);
+      fprintf(file, "<td %s align=right>%s\n", bg,
+          uval(t==0 ? pidinfo->VmHWM : 0));
+    }
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Size));
+    if (pidinfo)
+    {
+      fprintf(file, "<td %s align=right>%s\n", bg,
+          uval(t==0 ? pidinfo->VmPeak : 0));
     }
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Pss));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Swap));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Referenced));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Anonymous));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Locked));
   }
-}
-
-static int
-meminfo_all_zeroes(const meminfo_t *self)
-{
-  return self->Size == 0
-    && self->Rss == 0
-    && self->Shared_Clean == 0
-    && self->Shared_Dirty == 0
-    && self->Private_Clean == 0
-    && self->Private_Dirty == 0
-    && self->Pss == 0
-    && self->Swap == 0
-    && self->Referenced == 0
-    && self->Anonymous == 0
-    && self->Locked == 0
-    ;
+  fprintf(file, "</table>\n");
 }
 
 /* ------------------------------------------------------------------------- *
- * meminfo_accumulate_appdata
+ * analyze_emit_xref_header
  * ------------------------------------------------------------------------- */
 
-void
-meminfo_accumulate_appdata(meminfo_t *self, const meminfo_t *that)
+static void
+analyze_emit_xref_header(const analyze_t *self, FILE *file, enum emit_type type)
 {
-  pusum(&self->Size,          that->Size);
-  pusum(&self->Rss,           that->Rss);
-  pusum(&self->Shared_Clean,  that->Shared_Clean);
-  pusum(&self->Shared_Dirty,  that->Shared_Dirty);
-  pusum(&self->Private_Clean, that->Private_Clean);
-  pusum(&self->Private_Dirty, that->Private_Dirty);
-  pusum(&self->Pss,           that->Pss);
-  pusum(&self->Swap,          that->Swap);
-  pusum(&self->Referenced,    that->Referenced);
-  pusum(&self->Anonymous,     that->Anonymous);
-  pusum(&self->Locked,        that->Locked);
+  fprintf(file, "<thead>\n");
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP">%s\n", emit_type_titles[type]);
+  fprintf(file, "<th"TP">%s\n", "Type");
+  fprintf(file, "<th"TP">%s\n", "Prot");
+  fprintf(file, "<th"TP">%s\n", "Size");
+  fprintf(file, "<th"TP">%s\n", "Rss");
+  fprintf(file, "<th"TP">%s\n", "Dirty<br>Private");
+  fprintf(file, "<th"TP">%s\n", "Dirty<br>Shared");
+  fprintf(file, "<th"TP">%s\n", "Clean<br>Private");
+  fprintf(file, "<th"TP">%s\n", "Clean<br>Shared");
+  fprintf(file, "<th"TP">%s\n", "Pss");
+  fprintf(file, "<th"TP">%s\n", "Swap");
+  fprintf(file, "<th"TP">%s\n", "Anonymous");
+  fprintf(file, "<th"TP">%s\n", "Locked");
 }
 
 /* ------------------------------------------------------------------------- *
- * meminfo_accumulate_libdata
+ * analyze_emit_lib_html
  * ------------------------------------------------------------------------- */
 
-void
-meminfo_accumulate_libdata(meminfo_t *self, const meminfo_t *that)
+int
+analyze_emit_lib_html(analyze_t *self, smapssnap_t *snap, const char *work, int gzip)
 {
-  pumax(&self->Size,          that->Size);
-  pumax(&self->Rss,           that->Rss);
-  pumax(&self->Shared_Clean,  that->Shared_Clean);
-  pumax(&self->Shared_Dirty,  that->Shared_Dirty);
-  pusum(&self->Private_Clean, that->Private_Clean);
-  pusum(&self->Private_Dirty, that->Private_Dirty);
-  pusum(&self->Pss,           that->Pss);
-  pumax(&self->Swap,          that->Swap);
-  pumax(&self->Referenced,    that->Referenced);
-  pusum(&self->Anonymous,     that->Anonymous);
-  pusum(&self->Locked,        that->Locked);
-}
+  int   error = -1;
+  FILE *file  = 0;
+  page_t page;
 
-/* ------------------------------------------------------------------------- *
- * meminfo_accumulate_maxdata
- * ------------------------------------------------------------------------- */
+  char  temp[512];
 
-void
-meminfo_accumulate_maxdata(meminfo_t *self, const meminfo_t *that)
-{
-  pumax(&self->Size,          that->Size);
-  pumax(&self->Rss,           that->Rss);
-  pumax(&self->Shared_Clean,  that->Shared_Clean);
-  pumax(&self->Shared_Dirty,  that->Shared_Dirty);
-  pumax(&self->Private_Clean, that->Private_Clean);
-  pumax(&self->Private_Dirty, that->Private_Dirty);
-  pumax(&self->Pss,           that->Pss);
-  pumax(&self->Swap,          that->Swap);
-  pumax(&self->Referenced,    that->Referenced);
-  pumax(&self->Anonymous,     that->Anonymous);
-  pumax(&self->Locked,        that->Locked);
-}
+  /* - - - - - - - - - - - - - - - - - - - *
+   * write html page for each library
+   * - - - - - - - - - - - - - - - - - - - */
 
-/* ------------------------------------------------------------------------- *
- * meminfo_create
- * ------------------------------------------------------------------------- */
+  for( int l = 0; l < self->npaths; ++l )
+  {
+    smapsmapp_t *m; int a;
 
-meminfo_t *
-meminfo_create(void)
-{
-  meminfo_t *self = calloc(1, sizeof *self);
-  meminfo_ctor(self);
-  return self;
-}
+    /* - - - - - - - - - - - - - - - - - - - *
+     * open output file
+     * - - - - - - - - - - - - - - - - - - - */
 
-/* ------------------------------------------------------------------------- *
- * meminfo_delete
- * ------------------------------------------------------------------------- */
+    snprintf(temp, sizeof temp, "%s/lib%03d.html", work, l);
+    //printf(">> %s\n", temp);
 
-void
-meminfo_delete(meminfo_t *self)
-{
-  if( self != 0 )
-  {
-    meminfo_dtor(self);
-    free(self);
-  }
-}
+    if( (file = page_open(&page, temp, gzip)) == 0 )
+    {
+      goto cleanup;
+    }
 
-/* ------------------------------------------------------------------------- *
- * meminfo_delete_cb
- * ------------------------------------------------------------------------- */
+    analyze_html_header(file, smaps_path_basename(self->spath[l]), ".");
 
-void
-meminfo_delete_cb(void *self)
-{
-  meminfo_delete(self);
-}
+    /* - - - - - - - - - - - - - - - - - - - *
+     * summary table
+     * - - - - - - - - - - - - - - - - - - - */
 
-/* ========================================================================= *
- * mapinfo_t  --  methods
- * ========================================================================= */
+    fprintf(file, "<h1>%s: %s</h1>\n", emit_type_titles[EMIT_TYPE_LIBRARY], self->spath[l]);
+    analyze_emit_page_table(self, file, analyze_lib_mem(self, l, 0), NULL);
 
-/* ------------------------------------------------------------------------- *
- * mapinfo_ctor
- * ------------------------------------------------------------------------- */
+    /* - - - - - - - - - - - - - - - - - - - *
+     * application xref
+     * - - - - - - - - - - - - - - - - - - - */
 
-void
-mapinfo_ctor(mapinfo_t *self)
-{
-  self->head    = 0;
-  self->tail    = 0;
-  self->prot    = 0;
-  self->offs    = 0;
-  self->node    = 0;
-  self->flgs    = 0;
-  self->path    = 0;
-  self->type    = 0;
-}
+    fprintf(file, "<h1>%s XREF</h1>\n", emit_type_titles[EMIT_TYPE_APPLICATION]);
+    /* Sort initially by 9th column (PSS) in descending order */
+    fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[9,0]] }\">\n");
+    analyze_emit_xref_header(self, file, EMIT_TYPE_APPLICATION);
+    fprintf(file, "<tbody>\n");
 
-/* ------------------------------------------------------------------------- *
- * mapinfo_dtor
- * ------------------------------------------------------------------------- */
+    int           cnt;
+    smapsmapp_t **xref = analyze_lib_xref(self, l, &cnt);
 
-void
-mapinfo_dtor(mapinfo_t *self)
-{
-  free(self->prot);
-  free(self->node);
-  free(self->path);
-  free(self->type);
-}
+    for( int i = 0; i < cnt; ++i )
+    {
+      m = xref[i];
+      a = m->smapsmapp_AID;
 
-/* ------------------------------------------------------------------------- *
- * mapinfo_create
- * ------------------------------------------------------------------------- */
+      fprintf(file,
+              "<tr>\n"
+              "<th"LT"align=left>"
+              "<a href=\"app%03d.html\">%s</a>\n",
+              a, abbr_title(smaps_path_basename(self->sappl[a])));
+
+      fprintf(file, "<td align=left>%s\n", m->smapsmapp_map.type);
+      fprintf(file, "<td align=left style='font-family: monospace;'>%s\n", m->smapsmapp_map.prot);
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Size));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Rss));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Dirty));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Dirty));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Clean));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Clean));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Pss));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Swap));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Anonymous));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Locked));
+    }
 
-mapinfo_t *
-mapinfo_create(void)
-{
-  mapinfo_t *self = calloc(1, sizeof *self);
-  mapinfo_ctor(self);
-  return self;
-}
+    fprintf(file, "</table>\n");
 
-/* ------------------------------------------------------------------------- *
- * mapinfo_delete
- * ------------------------------------------------------------------------- */
+    /* - - - - - - - - - - - - - - - - - - - *
+     * html footer
+     * - - - - - - - - - - - - - - - - - - - */
 
-void
-mapinfo_delete(mapinfo_t *self)
-{
-  if( self != 0 )
+    fprintf(file, "</body>\n");
+    fprintf(file, "</html>\n");
+
+    file = 0;
+    if( page_close(&page) != 0 )
+    {
+      goto cleanup;
+    }
+  }
+  error = 0;
+  cleanup:
+
+  if( file != 0 )
   {
-    mapinfo_dtor(self);
-    free(self);
+    page_abort(&page);
   }
+
+  return error;
 }
 
 /* ------------------------------------------------------------------------- *
- * mapinfo_delete_cb
+ * analyze_emit_app_html
  * ------------------------------------------------------------------------- */
 
-void
-mapinfo_delete_cb(void *self)
+int
+analyze_emit_app_html(analyze_t *self, smapssnap_t *snap, const char *work, int gzip)
 {
-  mapinfo_delete(self);
-}
+  int error = -1;
+  char temp[512];
+  FILE *file = 0;
+  page_t page;
 
-/* ========================================================================= *
- * pidinfo_t  --  methods
- * ========================================================================= */
+  /* - - - - - - - - - - - - - - - - - - - *
+   * write html page for each application
+   * - - - - - - - - - - - - - - - - - - - */
 
-/* ------------------------------------------------------------------------- *
- * pidinfo_ctor
- * ------------------------------------------------------------------------- */
+  for( int a = 0; a < self->nappls; ++a )
+  {
+    smapsmapp_t *m; int l;
 
-void
-pidinfo_ctor(pidinfo_t *self)
-{
-  memset(self, 0, sizeof(*self));
-  self->Name = strdup("<noname>");
+    /* - - - - - - - - - - - - - - - - - - - *
+     * open file
+     * - - - - - - - - - - - - - - - - - - - */
+
+    snprintf(temp, sizeof temp, "%s/app%03d.html", work, a);
+    //printf(">> %s\n", temp);
+    if( (file = page_open(&page, temp, gzip)) == 0 )
+    {
+      goto cleanup;
+    }
+
+    analyze_html_header(file, self->sappl[a], ".");
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * summary table
+     * - - - - - - - - - - - - - - - - - - - */
+
+    fprintf(file, "<h1>%s: %s</h1>\n", emit_type_titles[EMIT_TYPE_APPLICATION], self->sappl[a]);
+    analyze_emit_page_table(self, file, analyze_app_mem(self, a, 0),
+        &analyze_app_proc(self, a)->smapsproc_pid);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * library xref
+     * - - - - - - - - - - - - - - - - - - - */
+
+    fprintf(file, "<h1>%s XREF</h1>\n", "Mapping");
+    /* Sort initially by 9th column (PSS) in descending order */
+    fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[9,0]] }\">\n");
+    analyze_emit_xref_header(self, file, EMIT_TYPE_OBJECT);
+    fprintf(file, "<tbody>\n");
+
+    int           cnt;
+    smapsmapp_t **xref = analyze_app_xref(self, a, &cnt);
+
+    for( int i = 0; i < cnt; ++i )
+    {
+      m = xref[i];
+      l = m->smapsmapp_LID;
+
+      fprintf(file,
+              "<tr>\n"
+              "<th"LT"align=left>"
+              "<a href=\"lib%03d.html\">%s</a>\n",
+              l, abbr_title(smaps_path_basename(self->spath[l])));
+
+      fprintf(file, "<td align=left>%s\n", m->smapsmapp_map.type);
+      fprintf(file, "<td align=left style='font-family: monospace;'>%s\n", m->smapsmapp_map.prot);
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Size));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Rss));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Dirty));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Dirty));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Clean));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Clean));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Pss));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Swap));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Anonymous));
+      fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Locked));
+    }
+
+    fprintf(file, "</table>\n");
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * html footer
+     * - - - - - - - - - - - - - - - - - - - */
+
+    fprintf(file, "</body>\n");
+    fprintf(file, "</html>\n");
+    file = 0;
+    if( page_close(&page) != 0 )
+    {
+      goto cleanup;
+    }
+  }
+
+  error = 0;
+  cleanup:
+
+  if( file != 0 )
+  {
+    page_abort(&page);
+  }
+
+  return error;
 }
 
 /* ------------------------------------------------------------------------- *
- * pidinfo_dtor
+ * analyze_emit_smaps_table
  * ------------------------------------------------------------------------- */
 
 void
-pidinfo_dtor(pidinfo_t *self)
+analyze_emit_smaps_table(analyze_t *self, FILE *file, meminfo_t *v)
 {
-  free(self->Name);
+  fprintf(file, "<table border=1>\n");
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Class");
+  fprintf(file, "<th"TP"colspan=2>%s\n", "Dirty");
+  fprintf(file, "<th"TP"colspan=2>%s\n", "Clean");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Resident");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Size");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Pss");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Swap");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Referenced");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Anonymous");
+  fprintf(file, "<th"TP"rowspan=2>%s\n", "Locked");
+
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP">%s\n", "Private");
+  fprintf(file, "<th"TP">%s\n", "Shared");
+  fprintf(file, "<th"TP">%s\n", "Private");
+  fprintf(file, "<th"TP">%s\n", "Shared");
+
+  for( int t = 0; t < self->ntypes; ++t )
+  {
+    meminfo_t *m = &v[t];//&app_mem[a][t];
+    const char *bg = ((t/3)&1) ? D1 : D2;
+
+    fprintf(file, "<tr>\n");
+    fprintf(file, "<th"LT" align=left>%s\n", self->stype[t]);
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Rss));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Size));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Pss));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Swap));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Referenced));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Anonymous));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Locked));
+  }
+
+  fprintf(file, "</table>\n");
 }
 
 /* ------------------------------------------------------------------------- *
- * pidinfo_parse
+ * analyze_emit_table_header
  * ------------------------------------------------------------------------- */
 
-void
-pidinfo_parse(pidinfo_t *self, char *line)
-{
-  char *key = slice(&line, ':');
-  char *val = slice(&line,  -1);
+#define VM_COLUMN_COUNT 5
+static const char *const virtual_memory_column_titles[][VM_COLUMN_COUNT] = {
+  [EMIT_TYPE_LIBRARY] = {
+    "<abbr title=\"Largest value\"><i>RSS</i></abbr>",
+    "<abbr title=\"Largest value\"><i>Size</i></abbr>",
+    "<abbr title=\"Sum of values\">PSS</abbr> ",
+    "<abbr title=\"Largest value\"><i>Swap</i></abbr>",
+    "<abbr title=\"Sum of values\">Locked</abbr>",
+  },
+  [EMIT_TYPE_APPLICATION] = {
+    "RSS",
+    "Size",
+    "PSS ",
+    "Swap",
+    "Locked",
+  },
+};
 
-  if( !strcmp(key, "Name") )
-  {
-    while( *val == '-' ) ++val;
-    xstrset(&self->Name, val);
-  }
-  else if( !strcmp(key, "Pid") )
-  {
-    self->Pid   = strtol(val, 0, 10);
-  }
-  else if( !strcmp(key, "PPid") )
-  {
-    self->PPid  = strtol(val, 0, 10);
-  }
-  else if( !strcmp(key, "Threads") )
-  {
-    self->Threads       = strtol(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmPeak") )
-  {
-    self->VmPeak        = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmSize") )
-  {
-    self->VmSize        = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmLck") )
-  {
-    self->VmLck = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmHWM") )
-  {
-    self->VmHWM = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmRSS") )
-  {
-    self->VmRSS = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmData") )
-  {
-    self->VmData        = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmStk") )
-  {
-    self->VmStk = strtoul(val, 0, 10);
-  }
-  else if( !strcmp(key, "VmExe") )
+static void
+analyze_emit_table_header(const analyze_t *self, FILE *file, enum emit_type type)
+{
+  fprintf(file, "<thead>\n");
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP" rowspan=3>%s\n", emit_type_titles[type]);
+  fprintf(file, "<th"TP" colspan=4>%s\n", "RSS / Status");
+  fprintf(file, "<th"TP" rowspan=2 colspan=%d>%s\n", VM_COLUMN_COUNT, "Virtual<br>Memory");
+  if( type == EMIT_TYPE_APPLICATION )
   {
-    self->VmExe = strtoul(val, 0, 10);
+    fprintf(file, "<th"TP" colspan=%d>%s\n", self->ntypes-1, "RSS / Class");
+    fprintf(file, "<th"TP" colspan=%d>%s\n", self->ntypes-1, "Size / Class");
   }
-  else if( !strcmp(key, "VmLib") )
+  fprintf(file, "<tr>\n");
+  fprintf(file, "<th"TP" colspan=2>%s\n", "Dirty");
+  fprintf(file, "<th"TP" colspan=2>%s\n", "Clean");
+  if( type == EMIT_TYPE_APPLICATION )
   {
-    self->VmLib = strtoul(val, 0, 10);
+    for( int i = 1; i < self->ntypes; ++i )
+    {
+      fprintf(file, "<th"TP" rowspan=2>%s\n", self->stype[i]);
+    }
+    for( int i = 1; i < self->ntypes; ++i )
+    {
+      fprintf(file, "<th"TP" rowspan=2>%s\n", self->stype[i]);
+    }
   }
-  else if( !strcmp(key, "VmPTE") )
+  fprintf(file, "<tr>\n");
+  if( type == EMIT_TYPE_LIBRARY )
   {
-    self->VmPTE = strtoul(val, 0, 10);
+    fprintf(file, "<th"TP"><abbr title=\"Sum of values\">Private</abbr>\n");
+    fprintf(file, "<th"TP"><abbr title=\"Largest value\"><i>Shared</i></abbr>\n");
+    fprintf(file, "<th"TP"><abbr title=\"Sum of values\">Private</abbr>\n");
+    fprintf(file, "<th"TP"><abbr title=\"Largest value\"><i>Shared</i></abbr>\n");
   }
-  else if( !strcmp(key, "State")
-        || !strcmp(key, "Tgid")
-        || !strcmp(key, "TracerPid")
-        || !strcmp(key, "Uid")
-        || !strcmp(key, "Gid")
-        || !strcmp(key, "FDSize")
-        || !strcmp(key, "Groups")
-        || !strcmp(key, "SigQ")
-        || !strcmp(key, "SigPnd")
-        || !strcmp(key, "ShdPnd")
-        || !strcmp(key, "SigBlk")
-        || !strcmp(key, "SigCgt")
-        || !strcmp(key, "SigIgn")
-        || !strcmp(key, "CapInh")
-        || !strcmp(key, "CapPrm")
-        || !strcmp(key, "CapEff")
-        || !strcmp(key, "CapBnd")
-        || !strcmp(key, "voluntary_ctxt_switches")
-        || !strcmp(key, "nonvoluntary_ctxt_switches")
-      )
+  else if( type == EMIT_TYPE_APPLICATION )
   {
+    fprintf(file, "<th"TP">Private\n");
+    fprintf(file, "<th"TP">Shared\n");
+    fprintf(file, "<th"TP">Private\n");
+    fprintf(file, "<th"TP">Shared\n");
   }
-  else
+  for( int i=0; i < sizeof(virtual_memory_column_titles[0])/sizeof(char *); ++i )
   {
-    static unknown_t unkn = UNKNOWN_INIT;
-    if( unknown_add(&unkn, key) )
-    {
-      fprintf(stderr, "%s: Unknown key: '%s' = '%s'\n", __FUNCTION__, key, val);
-    }
+    fprintf(file, "<th"TP">%s\n", virtual_memory_column_titles[type][i]);
   }
 }
 
 /* ------------------------------------------------------------------------- *
- * pidinfo_create
+ * analyze_emit_process_hierarchy  --  dump clickable process tree
  * ------------------------------------------------------------------------- */
 
-pidinfo_t *
-pidinfo_create(void)
+static void
+analyze_emit_hierarchy_open(FILE *file, const smapsproc_t *proc, int depth)
 {
-  pidinfo_t *self = calloc(1, sizeof *self);
-  pidinfo_ctor(self);
-  return self;
+  fprintf(file, "<ul id='children_of_%d' %s>\n",
+	proc->smapsproc_AID,
+	depth == 1 ? "style='display:none;'" : "");
 }
 
-/* ------------------------------------------------------------------------- *
- * pidinfo_delete
- * ------------------------------------------------------------------------- */
-
 void
-pidinfo_delete(pidinfo_t *self)
+analyze_emit_process_hierarchy(analyze_t *self, FILE *file, smapsproc_t *proc,
+                               const char *work, int recursion_depth)
 {
-  if( self != 0 )
+  /* - - - - - - - - - - - - - - - - - - - *
+   * walk the tree with an explicit stack;
+   * only processes that have children get
+   * pushed, each one opening a list
+   * - - - - - - - - - - - - - - - - - - - */
+
+  typedef struct { smapsproc_t *proc; int next; } frame_t;
+
+  int      size  = 64;
+  int      depth = 0;
+  frame_t *stack = 0;
+
+  if( proc->smapsproc_children.size == 0 )
   {
-    pidinfo_dtor(self);
-    free(self);
+    return;
   }
-}
 
-/* ------------------------------------------------------------------------- *
- * pidinfo_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-pidinfo_delete_cb(void *self)
-{
-  pidinfo_delete(self);
-}
+  stack = malloc(size * sizeof *stack);
+  stack[depth++] = (frame_t){ proc, 0 };
+  analyze_emit_hierarchy_open(file, proc, recursion_depth);
 
-/* ========================================================================= *
- * smapsmapp_t  --  methods
- * ========================================================================= */
+  while( depth > 0 )
+  {
+    frame_t *top = &stack[depth-1];
+    int      lev = recursion_depth + depth - 1;
 
-/* ------------------------------------------------------------------------- *
- * smapsmapp_ctor
- * ------------------------------------------------------------------------- */
+    if( top->next == top->proc->smapsproc_children.size )
+    {
+      fprintf(file, "</ul>\n");
+      --depth;
+      continue;
+    }
 
-void
-smapsmapp_ctor(smapsmapp_t *self)
-{
-  static int uid = 0;
-  self->smapsmapp_uid = uid++;
+    smapsproc_t *sub = top->proc->smapsproc_children.data[top->next++];
 
-  self->smapsmapp_AID = -1;
-  self->smapsmapp_PID = -1;
-  self->smapsmapp_LID = -1;
-  self->smapsmapp_TID = -1;
-  self->smapsmapp_EID = -1;
+    fprintf(file, "<li><a href=\"%s/app%03d.html\">%s (%d)</a>\n",
+            work,
+            sub->smapsproc_AID,
+            sub->smapsproc_pid.Name,
+            sub->smapsproc_pid.Pid);
 
-  mapinfo_ctor(&self->smapsmapp_map);
-  meminfo_ctor(&self->smapsmapp_mem);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsmapp_dtor
- * ------------------------------------------------------------------------- */
-
-void
-smapsmapp_dtor(smapsmapp_t *self)
-{
-  mapinfo_dtor(&self->smapsmapp_map);
-  meminfo_dtor(&self->smapsmapp_mem);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsmapp_create
- * ------------------------------------------------------------------------- */
-
-smapsmapp_t *
-smapsmapp_create(void)
-{
-  smapsmapp_t *self = calloc(1, sizeof *self);
-  smapsmapp_ctor(self);
-  return self;
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsmapp_delete
- * ------------------------------------------------------------------------- */
+    if (lev == 0)
+    {
+      fprintf(file, "<span style=\"text-decoration: underline; "
+	  "cursor: pointer;\" "
+	  "onClick=\"toggleBlockText('children_of_%d', "
+	  "this, '(expand)','(collapse)');\">(expand)</span>\n",
+	  sub->smapsproc_AID);
+    }
 
-void
-smapsmapp_delete(smapsmapp_t *self)
-{
-  if( self != 0 )
-  {
-    smapsmapp_dtor(self);
-    free(self);
+    if( sub->smapsproc_children.size )
+    {
+      if( depth == size )
+      {
+        size *= 2;
+        stack = realloc(stack, size * sizeof *stack);
+      }
+      stack[depth++] = (frame_t){ sub, 0 };
+      analyze_emit_hierarchy_open(file, sub, lev + 1);
+    }
   }
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsmapp_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-smapsmapp_delete_cb(void *self)
-{
-  smapsmapp_delete(self);
-}
-
-/* ========================================================================= *
- * smapsproc_t  --  methods
- * ========================================================================= */
-
-/* ------------------------------------------------------------------------- *
- * smapsproc_ctor
- * ------------------------------------------------------------------------- */
-
-void
-smapsproc_ctor(smapsproc_t *self)
-{
-  static int uid = 0;
-  self->smapsproc_uid = uid++;
-
-  self->smapsproc_AID = -1;
-  self->smapsproc_PID = -1;
-
-  pidinfo_ctor(&self->smapsproc_pid);
-  array_ctor(&self->smapsproc_mapplist, smapsmapp_delete_cb);
 
-  self->smapsproc_parent = 0;
-  array_ctor(&self->smapsproc_children, 0);
+  free(stack);
 }
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_dtor
- * ------------------------------------------------------------------------- */
-
-void
-smapsproc_dtor(smapsproc_t *self)
+static int
+analyze_emit_application_table_cmp(const void *a1, const void *a2)
 {
-  pidinfo_dtor(&self->smapsproc_pid);
-  array_dtor(&self->smapsproc_mapplist);
-  array_dtor(&self->smapsproc_children);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsproc_are_same
- * ------------------------------------------------------------------------- */
+  analyze_t *self = qsort_cmp_data;
+  const meminfo_t *m1 = analyze_app_mem(self, *(const int *)a1, 0);
+  const meminfo_t *m2 = analyze_app_mem(self, *(const int *)a2, 0);
 
-int
-smapsproc_are_same(smapsproc_t *self, smapsproc_t *that)
-{
-  if( strcmp(self->smapsproc_pid.Name, that->smapsproc_pid.Name) ) return 0;
-
-#if 01
-# define cp(v) if( self->smapsproc_pid.v != that->smapsproc_pid.v ) return 0;
-  cp(VmPeak)
-  cp(VmSize)
-  cp(VmLck)
-  cp(VmHWM)
-  cp(VmRSS)
-  cp(VmData)
-  cp(VmStk)
-  cp(VmExe)
-  cp(VmLib)
-  cp(VmPTE)
-# undef cp
-#endif
+  int r;
+  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
+  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
+  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
+  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
 
-  return 1;
+  return m2->Size - m1->Size;
 }
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_adopt_children
- * ------------------------------------------------------------------------- */
-
-void
-smapsproc_adopt_children(smapsproc_t *self, smapsproc_t *that)
+static int
+analyze_emit_library_table_cmp(const void *a1, const void *a2)
 {
-  /* - - - - - - - - - - - - - - - - - - - *
-   * fix parent pointers
-   * - - - - - - - - - - - - - - - - - - - */
-
-  for( size_t i = 0; i < that->smapsproc_children.size; ++i )
-  {
-    smapsproc_t *child = that->smapsproc_children.data[i];
-    child->smapsproc_parent = self;
-    child->smapsproc_pid.PPid = self->smapsproc_pid.Pid;
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * move children to new parent
-   * - - - - - - - - - - - - - - - - - - - */
+  analyze_t *self = qsort_cmp_data;
+  const meminfo_t *m1 = analyze_lib_mem(self, *(const int *)a1, 0);
+  const meminfo_t *m2 = analyze_lib_mem(self, *(const int *)a2, 0);
+  int r;
+  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
+  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
+  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
+  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
 
-  array_move(&self->smapsproc_children, &that->smapsproc_children);
+  return m2->Size - m1->Size;
 }
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_collapse_threads
- * ------------------------------------------------------------------------- */
-
-void
-smapsproc_collapse_threads(smapsproc_t *self)
+static void
+analyze_emit_table(analyze_t *self, FILE *file, const char *work, enum emit_type type)
 {
-  /* - - - - - - - - - - - - - - - - - - - *
-   * recurse depth first
-   * - - - - - - - - - - - - - - - - - - - */
+  int omitted_lines = 0;
+  int items = 0;
+  if( type == EMIT_TYPE_LIBRARY )
+    items = self->npaths;
+  else if( type == EMIT_TYPE_APPLICATION )
+    items = self->nappls;
+  int lut[items];
 
-  for( int i = 0; i < self->smapsproc_children.size; ++i )
+  for( int i = 0; i < items; ++i )
   {
-    smapsproc_t *that = self->smapsproc_children.data[i];
-    smapsproc_collapse_threads(that);
+    lut[i] = i;
   }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * heuristic: children that are similar
-   * enough to parent are actually threads
-   * - - - - - - - - - - - - - - - - - - - */
+  qsort_cmp_data = self;
+  if( type == EMIT_TYPE_LIBRARY )
+    qsort(lut, items, sizeof *lut, analyze_emit_library_table_cmp);
+  else if( type == EMIT_TYPE_APPLICATION )
+    qsort(lut, items, sizeof *lut, analyze_emit_application_table_cmp);
 
-  for( int i = 0; i < self->smapsproc_children.size; ++i )
+  /* Sort initially by 7th column (PSS) in descending order */
+  fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[7,0]] }\">\n");
+  analyze_emit_table_header(self, file, type);
+  fprintf(file, "<tbody>\n");
+  for( int i = 0; i < items; ++i )
   {
-    smapsproc_t *that = self->smapsproc_children.data[i];
+    int a = lut[i];
+    const char *title = NULL;
+    const char *bg = ((i/3)&1) ? D1 : D2;
+    meminfo_t *s = analyze_mem(self, a, 0, type);
 
-    if( smapsproc_are_same(self, that) )
+    /* One-page mappings are not interesting, prune them from the Object Values
+     * table.
+     */
+    if (type == EMIT_TYPE_LIBRARY && s->Size <= 4)
+    {
+      ++omitted_lines;
+      continue;
+    }
+    else if (type == EMIT_TYPE_APPLICATION && meminfo_all_zeroes(s))
     {
-      fprintf(stderr, "REPARENT: %d\n", that->smapsproc_pid.Pid);
+      ++omitted_lines;
+      continue;
+    }
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * adopt grandchildren
-       * - - - - - - - - - - - - - - - - - - - */
+    fprintf(file, "<tr>\n");
+    fprintf(file, "<th bgcolor=\"#bfffff\" align=left>");
 
-      smapsproc_adopt_children(self, that);
+    if( type == EMIT_TYPE_LIBRARY )
+    {
+      title = smaps_path_basename(self->spath[a]);
+      fprintf(file, "<a href=\"%s/lib%03d.html\">%s</a>\n",
+          work, a, abbr_title(title));
+    }
+    else if( type == EMIT_TYPE_APPLICATION )
+    {
+      title = self->sappl[a];
+      fprintf(file, "<a href=\"%s/app%03d.html\">%s</a>\n",
+          work, a, abbr_title(title));
+    }
+    else
+    {
+      abort();
+    }
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * disassosiate parent & child
-       * - - - - - - - - - - - - - - - - - - - */
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Private_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Shared_Dirty));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Private_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Shared_Clean));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Rss));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Size));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Pss));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Swap));
+    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Locked));
 
-      self->smapsproc_children.data[i] = 0;
-      self->smapsproc_pid.Threads += that->smapsproc_pid.Threads;
-      that->smapsproc_parent = 0;
+    if (type == EMIT_TYPE_APPLICATION)
+    {
+      for( int t = 1; t < self->ntypes; ++t )
+      {
+	meminfo_t *s = analyze_mem(self, a, t, type);
+	fprintf(file, "<td %s align=right>%s\n", bg, uval(meminfo_total(s)));
+      }
+      for( int t = 1; t < self->ntypes; ++t )
+      {
+	meminfo_t *s = analyze_mem(self, a, t, type);
+	fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Size));
+      }
+    }
+  }
+  fprintf(file, "</table>\n");
+  if (omitted_lines)
+  {
+    if (type == EMIT_TYPE_LIBRARY)
+    {
+      fprintf(file,
+	"<b>Note:</b> removed %d entries from the table with <i>Size</i> of "
+	"at most 4 kilobytes.\n",
+	omitted_lines);
+    }
+    else if (type == EMIT_TYPE_APPLICATION)
+    {
+      fprintf(file,
+        "<b style='color:red'>Note:</b> removed %d applications from the table "
+        "that have all entries set to zero. This may indicate that the smaps "
+        "capture is incomplete.\n",
+	omitted_lines);
+    }
+    else
+    {
+      abort();
     }
   }
-  array_compact(&self->smapsproc_children);
-
 }
 
 /* ------------------------------------------------------------------------- *
- * smapsproc_add_mapping
+ * analyze_emit_main_page
  * ------------------------------------------------------------------------- */
 
-smapsmapp_t  *
-smapsproc_add_mapping(smapsproc_t *self,
-                      unsigned head,
-                      unsigned tail,
-                      const char *prot,
-                      unsigned offs,
-                      const char *node,
-                      unsigned flgs,
-                      const char *path)
+static int
+file_copy(const char *src, const char *dst)
 {
-
-  smapsmapp_t *mapp = smapsmapp_create();
-
-  mapp->smapsmapp_map.head = head;
-  mapp->smapsmapp_map.tail = tail;
-  mapp->smapsmapp_map.offs = offs;
-  mapp->smapsmapp_map.flgs = flgs;
-
-  if( path == 0 || *path == 0 )
+  char buf[4096];
+  int ret;
+  FILE *fin, *fout;
+  size_t got, wrote;
+  fin = NULL;
+  fout = NULL;
+  ret = -1;
+  fin = fopen(src, "r");
+  if (!fin)
   {
-    path = "[anon]";
+    fprintf(stderr, "ERROR: unable to open '%s' for reading: %s\n",
+        src, strerror(errno));
+    goto out;
   }
-
-  xstrset(&mapp->smapsmapp_map.prot, prot);
-  xstrset(&mapp->smapsmapp_map.node, node);
-  xstrset(&mapp->smapsmapp_map.path, path);
-
-  if( *path == '[' )
+  fout = fopen(dst, "w");
+  if (!fout)
   {
-    char temp[32];
-    ++path;
-    snprintf(temp, sizeof temp, "%.*s", (int)strcspn(path,"]"), path);
-    xstrset(&mapp->smapsmapp_map.type, temp);
+    fprintf(stderr, "ERROR: unable to open '%s' for writing: %s\n",
+        dst, strerror(errno));
+    goto out;
   }
-  else
+  while (!feof(fin))
+  {
+    if (ferror(fin) || ferror(fout))
+      goto out;
+    got = fread(buf, 1, sizeof(buf), fin);
+    while (got)
+    {
+      wrote = fwrite(buf, 1, got, fout);
+      if (ferror(fout))
+        goto out;
+      got -= wrote;
+    }
+  }
+  ret = 0;
+out:
+  if (fin)
+    fclose(fin);
+  if (fout)
   {
-    xstrset(&mapp->smapsmapp_map.type, strchr(prot, 'x') ? "code" : "data");
+    fclose(fout);
+    if (ret < 0)
+    {
+      unlink(dst);
+    }
   }
-
-  array_add(&self->smapsproc_mapplist, mapp);
-  return mapp;
+  return ret;
 }
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_create
- * ------------------------------------------------------------------------- */
-
-smapsproc_t *
-smapsproc_create(void)
+static int
+file_uptodate(const char *src, const char *dst)
 {
-  smapsproc_t *self = calloc(1, sizeof *self);
-  smapsproc_ctor(self);
-  return self;
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsproc_delete
- * ------------------------------------------------------------------------- */
+  struct stat s, d;
 
-void
-smapsproc_delete(smapsproc_t *self)
-{
-  if( self != 0 )
+  if( stat(src, &s) != 0 || stat(dst, &d) != 0 )
   {
-    smapsproc_dtor(self);
-    free(self);
+    return 0;
   }
+  return S_ISREG(d.st_mode) && d.st_size == s.st_size && d.st_mtime >= s.st_mtime;
 }
 
-/* ------------------------------------------------------------------------- *
- * smapsproc_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-smapsproc_delete_cb(void *self)
-{
-  smapsproc_delete(self);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsproc_compare_pid_cb
- * ------------------------------------------------------------------------- */
-
-int smapsproc_compare_pid_cb(const void *a1, const void *a2)
-{
-  const smapsproc_t *p1 = *(const smapsproc_t **)a1;
-  const smapsproc_t *p2 = *(const smapsproc_t **)a2;
-  return p1->smapsproc_pid.Pid - p2->smapsproc_pid.Pid;
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsproc_compare_name_pid_cb
- * ------------------------------------------------------------------------- */
-
-int smapsproc_compare_name_pid_cb(const void *a1, const void *a2)
-{
-  const smapsproc_t *p1 = *(const smapsproc_t **)a1;
-  const smapsproc_t *p2 = *(const smapsproc_t **)a2;
-  int r = strcasecmp(p1->smapsproc_pid.Name, p2->smapsproc_pid.Name);
-  return r ? r : (p1->smapsproc_pid.Pid - p2->smapsproc_pid.Pid);
-}
-
-/* ========================================================================= *
- * smapssnap_t  --  methods
- * ========================================================================= */
-
-/* ------------------------------------------------------------------------- *
- * smapssnap_ctor
- * ------------------------------------------------------------------------- */
-
-void
-smapssnap_ctor(smapssnap_t *self)
+static int
+copy_to_workdir(const char *workdir, const char *fn)
 {
-  self->smapssnap_source = strdup("<unset>");
-  self->smapssnap_format = SNAPFORMAT_OLD;
-
-  array_ctor(&self->smapssnap_proclist, smapsproc_delete_cb);
-  smapsproc_ctor(&self->smapssnap_rootproc);
+  char src[512];
+  char dst[512];
+  snprintf(src, sizeof(src), "/usr/share/sp-smaps-visualize/%s", fn);
+  src[sizeof(src)-1] = 0;
+  snprintf(dst, sizeof(dst), "%s/%s", workdir, fn);
+  dst[sizeof(dst)-1] = 0;
+  if (file_uptodate(src, dst))
+    return 0;
+  return file_copy(src, dst);
 }
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_dtor
- * ------------------------------------------------------------------------- */
-
-void
-smapssnap_dtor(smapssnap_t *self)
+static const char *const html_resources[] =
 {
-  free(self->smapssnap_source);
-  array_dtor(&self->smapssnap_proclist);
-  smapsproc_dtor(&self->smapssnap_rootproc);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapssnap_get_source
- * ------------------------------------------------------------------------- */
+  "jquery.metadata.js",
+  "jquery.min.js",
+  "jquery.tablesorter.js",
+  "tablesorter.css",
+  "expander.js",
+  "asc.gif",
+  "desc.gif",
+  "bg.gif",
+};
 
-const char *
-smapssnap_get_source(smapssnap_t *self)
+static int
+create_javascript_files(const char *workdir)
 {
-  return self->smapssnap_source;
+  size_t i;
+  int ret;
+  for (i=0; i < sizeof(html_resources)/sizeof(*html_resources); ++i)
+  {
+    ret = copy_to_workdir(workdir, html_resources[i]);
+    if (ret < 0)
+      goto out;
+  }
+out:
+  return ret;
 }
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_set_source
- * ------------------------------------------------------------------------- */
-
-void
-smapssnap_set_source(smapssnap_t *self, const char *path)
+static void
+analyze_prune_kthreads(smapssnap_t *snap)
 {
-  xstrset(&self->smapssnap_source, path);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapssnap_create_hierarchy
- * ------------------------------------------------------------------------- */
-
-/* - - - - - - - - - - - - - - - - - - - *
- * binsearch utility function
- * - - - - - - - - - - - - - - - - - - - */
+  smapsproc_t *root     = &snap->smapssnap_rootproc;
+  array_t     *list     = &snap->smapssnap_proclist;
+  smapsproc_t *kthreadd = 0;
+  size_t       keep     = 0;
 
-static smapsproc_t *
-proc_find(smapssnap_t *self, int pid)
-{
-  int lo = 0, hi = self->smapssnap_proclist.size;
-  while( lo < hi )
+  for( size_t i = 0; i < root->smapsproc_children.size; ++i )
   {
-    int i = (lo + hi) / 2;
-    smapsproc_t *p = self->smapssnap_proclist.data[i];
+    smapsproc_t *proc = root->smapsproc_children.data[i];
+    const char  *name = proc ? proc->smapsproc_pid.Name : 0;
 
-    if( p->smapsproc_pid.Pid > pid ) { hi = i+0; continue; }
-    if( p->smapsproc_pid.Pid < pid ) { lo = i+1; continue; }
-    return p;
+    if( name && strcmp(name, "kthreadd") == 0 )
+    {
+      kthreadd = array_rem(&root->smapsproc_children, i);
+      break;
+    }
   }
-  return 0;
-}
-
-void
-smapssnap_create_hierarchy(smapssnap_t *self)
-{
-  /* - - - - - - - - - - - - - - - - - - - *
-   * sort processes by PID
-   * - - - - - - - - - - - - - - - - - - - */
 
-  array_sort(&self->smapssnap_proclist, smapsproc_compare_pid_cb);
+  if( kthreadd == 0 )
+  {
+    return;
+  }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * find parent for every process
+   * drop kthreadd and its children from
+   * the process list in one compaction
+   * pass, keeping the order of the rest
    * - - - - - - - - - - - - - - - - - - - */
 
-  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
+  for( size_t i = 0; i < list->size; ++i )
   {
-    smapsproc_t *cur = self->smapssnap_proclist.data[i];
-    smapsproc_t *par = proc_find(self, cur->smapsproc_pid.PPid);
+    smapsproc_t *proc = list->data[i];
 
-    assert( cur->smapsproc_parent == 0 );
-
-    if( par == 0 || par == cur )
+    if( proc == kthreadd )
     {
-      if( cur->smapsproc_pid.PPid != 0 )
-      {
-        fprintf(stderr, "PPID %d not found\n", cur->smapsproc_pid.PPid);
-      }
-      par = &self->smapssnap_rootproc;
+      continue;
     }
-
-    cur->smapsproc_parent = par;
-    array_add(&par->smapsproc_children, cur);
+    if( proc != 0 && proc->smapsproc_parent == kthreadd )
+    {
+      smapsproc_delete(proc);
+      continue;
+    }
+    list->data[keep++] = proc;
   }
-}
+  list->size = keep;
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_collapse_threads
- * ------------------------------------------------------------------------- */
+  array_clear(&kthreadd->smapsproc_children);
+  smapsproc_delete(kthreadd);
+}
 
-void
-smapssnap_collapse_threads(smapssnap_t *self)
+int
+analyze_emit_main_page(analyze_t *self, smapssnap_t *snap, const char *path, int gzip)
 {
-  smapsproc_collapse_threads(&self->smapssnap_rootproc);
-
-  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
-  {
-    smapsproc_t *cur = self->smapssnap_proclist.data[i];
+  int       error = -1;
+  FILE     *file  = 0;
+  page_t    page;
 
-    if( cur->smapsproc_parent == 0 )
-    {
-      self->smapssnap_proclist.data[i] = 0;
-      smapsproc_delete(cur);
-    }
-  }
-  array_compact(&self->smapssnap_proclist);
-}
+  char      work[512];
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_add_process
- * ------------------------------------------------------------------------- */
+  /* - - - - - - - - - - - - - - - - - - - *
+   * make sure we have directory for
+   * library & application specific pages
+   * - - - - - - - - - - - - - - - - - - - */
 
-smapsproc_t *
-smapssnap_add_process(smapssnap_t *self, int pid)
-{
-  smapsproc_t *proc;
+  snprintf(work, sizeof work - 4, "%s", path);
+  strcpy(path_extension(work), ".dir");
 
-  for( int i = self->smapssnap_proclist.size; i-- > 0; )
+  if( !path_isdir(work) )
   {
-    proc = self->smapssnap_proclist.data[i];
-    if( proc->smapsproc_pid.Pid == pid )
+    if( mkdir(work, 0777) != 0 )
     {
-      return proc;
+      perror(work); goto cleanup;
     }
   }
-  proc = smapsproc_create();
-  proc->smapsproc_pid.Pid = pid;
-  array_add(&self->smapssnap_proclist, proc);
-  return proc;
-}
-
-/* ------------------------------------------------------------------------- *
- * smapssnap_load_cap
- * ------------------------------------------------------------------------- */
 
-static int
-hexterm(const char *s)
-{
-  while( isxdigit(*s) )
+  if( create_javascript_files(work) < 0 )
   {
-    ++s;
+    goto cleanup;
   }
-  return *s;
-}
-
-int
-smapssnap_load_cap(smapssnap_t *self, const char *path)
-{
-  int          error = -1;
-  FILE        *file  = 0;
-  smapsproc_t *proc  = 0;
-  smapsmapp_t *mapp  = 0;
-  char        *data  = 0;
-  size_t       size  = 0;
 
-  smapssnap_set_source(self, path);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * open output file
+   * - - - - - - - - - - - - - - - - - - - */
 
-  if( (file = fopen(path, "r")) == 0 )
+  if( (file = page_open(&page, path, gzip)) == 0 )
   {
-    perror(path); goto cleanup;
+    goto cleanup;
   }
 
-  while( getline(&data, &size, file) >= 0 )
-  {
-    data[strcspn(data, "\r\n")] = 0;
-
-    if( *data == 0 )
-    {
-      // ignore empty lines
-    }
-    else if( !strncmp(data, "==>", 3) )
-    {
-      // ==> /proc/1/smaps <==
+  analyze_html_header(file, smapssnap_get_source(snap), work);
 
-      proc = 0;
-      mapp = 0;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * memory usage tables
+   * - - - - - - - - - - - - - - - - - - - */
 
-      char *backup = strdup(data); // save a copy for good error messages
-      char *pos = data;
+  fprintf(file, "<a href=\"#system_estimates\">System Estimates</a> | ");
+  fprintf(file, "<a href=\"#process_hierarchy\">Process Hierarchy</a> | ");
+  fprintf(file, "<a href=\"#application_values\">Application Values</a> | ");
+  fprintf(file, "<a href=\"#object_values\">Object Values</a>\n");
 
-      while( *pos && strcmp(slice(&pos, '/'), "proc") ) { }
-      int pid = strtol(slice(&pos, '/'), 0, 10);
-      if( pid > 0 && !strcmp(slice(&pos, -1), "smaps") )
-      {
-        proc = smapssnap_add_process(self, pid);
-      }
-      else
-      {
-        fprintf(stderr, "%s(): ignoring: %s\n", __FUNCTION__, backup);
-      }
+  fprintf(file, "<a name=\"system_estimates\"><h1>System Estimates</h1></a>\n");
 
-      free(backup);
-    }
-    else if( *data == '#' )
-    {
-      // #Name: init__2_
-      // #Pid: 1
-      // #PPid: 0
-      // #Threads: 1
+  fprintf(file, "<h2>System: Memory Use Estimate</h2>\n");
+  analyze_emit_smaps_table(self, file, self->sysest);
+  fprintf(file, "<p>Private and Size are accurate, the rest are minimums.\n");
 
-      if (proc)
-      {
-        pidinfo_parse(&proc->smapsproc_pid, data+1);
-        self->smapssnap_format = SNAPFORMAT_NEW;
-      }
-    }
-    else if( hexterm(data) == '-' )
-    {
-      // 08048000-08051000 r-xp 00000000 03:03 2060370    /sbin/init
+  fprintf(file, "<h2>System: Memory Use App Totals</h2>\n");
+  analyze_emit_smaps_table(self, file, self->sysmax);
+  fprintf(file, "<p>Private is accurate, the rest are maximums.\n");
 
-      if (proc)
-      {
-        char *pos = data;
-        unsigned head = strtoul(slice(&pos, '-'), 0, 16);
-        unsigned tail = strtoul(slice(&pos,  -1), 0, 16);
-        char    *prot = slice(&pos,  -1);
-        unsigned offs = strtoul(slice(&pos,  -1), 0, 16);
-        char    *node = slice(&pos,  -1);
-        unsigned flgs = strtoul(slice(&pos,  -1), 0, 10);
-        char    *path = slice(&pos,  0);
-
-        mapp = smapsproc_add_mapping(proc, head, tail, prot,
-                                     offs, node, flgs, path);
-      }
-    }
-    else
-    {
-      // Size:                36 kB
-      // Rss:                 36 kB
-      // Shared_Clean:         0 kB
-      // Shared_Dirty:         0 kB
-      // Private_Clean:       36 kB
-      // Private_Dirty:        0 kB
-
-      if (mapp)
-      {
-        meminfo_parse(&mapp->smapsmapp_mem, data);
-      }
-    }
-  }
+  fprintf(file, "<h2>System: Memory Use App Maximums</h2>\n");
+  analyze_emit_smaps_table(self, file, self->appmax);
+  fprintf(file, "<p>No process has values larger than the ones listed above.\n");
 
-  error = 0;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * process hierarchy tree
+   * - - - - - - - - - - - - - - - - - - - */
 
-  cleanup:
+  fprintf(file, "<a name=\"process_hierarchy\"><h1>Process Hierarchy</h1></a>\n");
+  analyze_emit_process_hierarchy(self, file, &snap->smapssnap_rootproc, work, 0);
 
-  free(data);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * application table
+   * - - - - - - - - - - - - - - - - - - - */
 
-  if( file ) fclose(file);
+  fprintf(file, "<a name=\"application_values\"><h1>Application Values</h1></a>\n");
+  analyze_emit_table(self, file, work, EMIT_TYPE_APPLICATION);
 
-  return error;
-}
+  /* - - - - - - - - - - - - - - - - - - - *
+   * library table
+   * - - - - - - - - - - - - - - - - - - - */
 
-/* ------------------------------------------------------------------------- *
- * smapssnap_save_cap
- * ------------------------------------------------------------------------- */
+  fprintf(file, "<a name=\"object_values\"><h1>Object Values</h1></a>\n");
+  analyze_emit_table(self, file, work, EMIT_TYPE_LIBRARY);
 
-int
-smapssnap_save_cap(smapssnap_t *self, const char *path)
-{
-  int          error = -1;
-  FILE        *file  = 0;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * html trailer
+   * - - - - - - - - - - - - - - - - - - - */
 
-  if( (file = fopen(path, "w")) == 0 )
+  fprintf(file, "</body>\n");
+  fprintf(file, "</html>\n");
+  file = 0;
+  if( page_close(&page) != 0 )
   {
-    perror(path); goto cleanup;
+    goto cleanup;
   }
 
-  array_sort(&self->smapssnap_proclist, smapsproc_compare_pid_cb);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * application pages
+   * - - - - - - - - - - - - - - - - - - - */
 
-  for( int p = 0; p < self->smapssnap_proclist.size; ++p )
+  if( analyze_emit_app_html(self, snap, work, gzip) )
   {
-    const smapsproc_t *proc = self->smapssnap_proclist.data[p];
-    const pidinfo_t   *pi = &proc->smapsproc_pid;
-
-    fprintf(file, "==> /proc/%d/smaps <==\n", pi->Pid);
-
-#define Ps(v) fprintf(file, "#%s: %s\n", #v, pi->v)
-#define Pi(v) fprintf(file, "#%s: %d\n", #v, pi->v)
-#define Pu(v) fprintf(file, "#%s: %u\n", #v, pi->v)
-
-    Ps(Name);
-    Pi(Pid);
-    Pi(PPid);
-    Pi(Threads);
+    goto cleanup;
+  }
 
-    if( pi->VmPeak
-     || pi->VmSize
-     || pi->VmLck
-     || pi->VmHWM
-     || pi->VmRSS
-     || pi->VmData
-     || pi->VmStk
-     || pi->VmExe
-     || pi->VmLib
-     || pi->VmPTE
-     )
-    {
-      Pu(VmPeak);
-      Pu(VmSize);
-      Pu(VmLck);
-      Pu(VmHWM);
-      Pu(VmRSS);
-      Pu(VmData);
-      Pu(VmStk);
-      Pu(VmExe);
-      Pu(VmLib);
-      Pu(VmPTE);
-    }
-#undef Pu
-#undef Pi
-#undef Ps
+  /* - - - - - - - - - - - - - - - - - - - *
+   * library pages
+   * - - - - - - - - - - - - - - - - - - - */
 
-    for( int m = 0; m < proc->smapsproc_mapplist.size; ++m )
-    {
-      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[m];
-      const mapinfo_t   *map  = &mapp->smapsmapp_map;
-      const meminfo_t   *mem  = &mapp->smapsmapp_mem;
-
-      fprintf(file, "%08x-%08x %s %08x %s %-10u %s\n",
-              map->head, map->tail, map->prot,
-              map->offs, map->node, map->flgs,
-              map->path);
-
-#define Pu(v) fprintf(file, "%-14s %8u kB\n", #v":", mem->v)
-
-      Pu(Size);
-      Pu(Rss);
-      Pu(Shared_Clean);
-      Pu(Shared_Dirty);
-      Pu(Private_Clean);
-      Pu(Private_Dirty);
-      Pu(Pss);
-      Pu(Swap);
-      Pu(Referenced);
-      Pu(Anonymous);
-      Pu(Locked);
-
-#undef Pu
-    }
-    fprintf(file, "\n");
+  if( analyze_emit_lib_html(self, snap, work, gzip) )
+  {
+    goto cleanup;
   }
 
-  error = 0;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * success
+   * - - - - - - - - - - - - - - - - - - - */
 
-  cleanup:
+  error = 0;
 
-  if( file ) fclose(file);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * cleanup & return
+   * - - - - - - - - - - - - - - - - - - - */
+
+  cleanup:
 
+  if( file )
+  {
+    page_abort(&page);
+  }
   return error;
 }
 
 /* ------------------------------------------------------------------------- *
- * smapssnap_save_csv
+ * analyze_emit_appval_table
  * ------------------------------------------------------------------------- */
 
-int
-smapssnap_save_csv(smapssnap_t *self, const char *path)
+static int
+analyze_emit_appval_table_cmp(const void *a1, const void *a2)
 {
-  int   error = -1;
-  FILE *file  = 0;
+  analyze_t *self = qsort_cmp_data;
 
-  if( (file = fopen(path, "w")) == 0 )
+  typedef struct { int id; smapsproc_t *pt; } lut_t;
+  const lut_t *l1 = a1;
+  const lut_t *l2 = a2;
+
+  const meminfo_t *m1 = analyze_app_mem(self, l1->id, 0);
+  const meminfo_t *m2 = analyze_app_mem(self, l2->id, 0);
+
+  int r;
+  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
+  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
+  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
+  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
+
+  if( (r = m2->Size - m1->Size) != 0 ) return r;
+
+  return l1->pt->smapsproc_AID - l2->pt->smapsproc_AID;
+}
+
+void
+analyze_emit_appval_table(analyze_t *self, smapssnap_t *snap, FILE *file)
+{
+  typedef struct { int id; smapsproc_t *pt; } lut_t;
+  lut_t lut[self->nappls];
+
+  for( int i = 0; i < self->nappls; ++i )
   {
-    perror(path); goto cleanup;
+    lut[i].id = i;
+    lut[i].pt = 0;
   }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * arrange data by process name & pid
-   * - - - - - - - - - - - - - - - - - - - */
+  for( int i = 0; i < snap->smapssnap_proclist.size; ++i )
+  {
+    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
+    int a = proc->smapsproc_AID;
+    assert( 0 <= a && a < self->nappls );
+
+    assert( lut[a].id == a );
+    assert( lut[a].pt == 0 );
+    lut[a].pt = proc;
+  }
+  for( int i = 0; i < self->nappls; ++i )
+  {
+    assert( lut[i].pt != 0 );
+  }
+
+  qsort_cmp_data = self;
+  qsort(lut, self->nappls, sizeof *lut, analyze_emit_appval_table_cmp);
+
+  fprintf(file, "generator = %s %s\n", TOOL_NAME, TOOL_VERS);
+  fprintf(file, "\n");
+  fprintf(file, "name,pid,ppid,threads,pri,sha,cln,rss,size,rss,pss,swap,referenced");
+  for( int t = 1; t < self->ntypes; ++t )
+  {
+    fprintf(file, ",%s", self->stype[t]);
+  }
+  fprintf(file, "\n");
+
+  for( int i = 0; i < self->nappls; ++i )
+  {
+    int a = lut[i].id;
+    smapsproc_t *proc = lut[i].pt;
+
+    fprintf(file, "%s", proc->smapsproc_pid.Name);
+    fprintf(file, ",%d", proc->smapsproc_pid.Pid);
+    fprintf(file, ",%d", proc->smapsproc_pid.PPid);
+    fprintf(file, ",%d", proc->smapsproc_pid.Threads);
+
+    meminfo_t *s = analyze_app_mem(self, a, 0);
+
+    fprintf(file, ",%u", s->Private_Dirty);
+    fprintf(file, ",%u", s->Shared_Dirty);
+    fprintf(file, ",%u", s->Private_Clean + s->Shared_Clean);
+    fprintf(file, ",%u", s->Rss);
+    fprintf(file, ",%u", s->Size);
+    fprintf(file, ",%u", s->Pss);
+    fprintf(file, ",%u", s->Swap);
+    fprintf(file, ",%u", s->Referenced);
+
+    for( int t = 1; t < self->ntypes; ++t )
+    {
+      meminfo_t *s = analyze_app_mem(self, a, t);
+      fprintf(file, ",%u", meminfo_total(s));
+    }
+    fprintf(file, "\n");
+  }
+}
 
-  array_sort(&self->smapssnap_proclist, smapsproc_compare_pid_cb);
+/* ------------------------------------------------------------------------- *
+ * analyze_emit_appvals
+ * ------------------------------------------------------------------------- */
 
-// QUARANTINE   array_sort(&self->snapshot_process_list,
-// QUARANTINE        smapsproc_compare_name_pid_cb);
+int
+analyze_emit_appvals(analyze_t *self, smapssnap_t *snap, const char *path)
+{
+  int       error = -1;
+  FILE     *file  = 0;
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * output csv header
+   * open output file
    * - - - - - - - - - - - - - - - - - - - */
 
-  fprintf(file, "generator=%s %s\n", "PROGNAME", "PROGVERS");
-  fprintf(file, "\n");
+  if( (file = fopen(path, "w")) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * output csv labels
+   * html header
    * - - - - - - - - - - - - - - - - - - - */
 
-  fprintf(file,
-          "name,pid,ppid,threads,"
-          "head,tail,prot,offs,node,flag,path,"
-          "size,rss,shacln,shadty,pricln,pridty,"
-          "pss,swap,referenced,anonymous,locked,"
-          "pri,sha,cln\n");
+// QUARANTINE   fprintf(file, "<html>\n");
+// QUARANTINE   fprintf(file, "<head>\n");
+// QUARANTINE   fprintf(file, "<title>%s</title>\n", smapssnap_get_source(snap));
+// QUARANTINE   fprintf(file, "</head>\n");
+// QUARANTINE   fprintf(file, "<body>\n");
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * output csv table
+   * application table
    * - - - - - - - - - - - - - - - - - - - */
 
-  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
-  {
-    const smapsproc_t *proc = self->smapssnap_proclist.data[i];
-    const pidinfo_t   *pid  = &proc->smapsproc_pid;
-
-    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
-    {
-      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
-      const mapinfo_t   *map  = &mapp->smapsmapp_map;
-      const meminfo_t   *mem  = &mapp->smapsmapp_mem;
-
-      fprintf(file, "%s,%d,%d,%d,",
-              pid->Name,
-              pid->Pid,
-              pid->PPid,
-              pid->Threads);
-
-      fprintf(file, "%u,%u,%s,%u,%s,%u,%s,",
-              map->head, map->tail, map->prot,
-              map->offs, map->node, map->flgs,
-              map->path);
-
-      fprintf(file, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
-              mem->Size,
-              mem->Rss,
-              mem->Shared_Clean,
-              mem->Shared_Dirty,
-              mem->Private_Clean,
-              mem->Private_Dirty,
-              mem->Pss,
-              mem->Swap,
-              mem->Referenced,
-              mem->Anonymous,
-              mem->Locked);
-
-      fprintf(file, "%u,%u,%u\n",
-              mem->Private_Dirty,
-              mem->Shared_Dirty,
-              mem->Private_Clean + mem->Shared_Clean);
-    }
-  }
+// QUARANTINE   fprintf(file, "<h1>Application Values</h1>\n");
+  analyze_emit_appval_table(self, snap, file);
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * terminate csv table
+   * html trailer
    * - - - - - - - - - - - - - - - - - - - */
 
-  fprintf(file, "\n");
+// QUARANTINE   fprintf(file, "</body>\n");
+// QUARANTINE   fprintf(file, "</html>\n");
+// QUARANTINE   fclose(file); file = 0;
 
   /* - - - - - - - - - - - - - - - - - - - *
    * success
@@ -2126,2826 +1941,2266 @@ smapssnap_save_csv(smapssnap_t *self, const char *path)
   {
     fclose(file);
   }
-
   return error;
 }
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+/* ========================================================================= *
+ * smapsfilt_t  --  methods
+ * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * smapssnap_save_html
+ * smapsfilt_ctor
  * ------------------------------------------------------------------------- */
 
-// QUARANTINE int
-// QUARANTINE smapssnap_save_html(smapssnap_t *self, const char *path)
-// QUARANTINE {
-// QUARANTINE   int       error = -1;
-// QUARANTINE   analyze_t *az   = analyze_create();
-// QUARANTINE
-// QUARANTINE   /* - - - - - - - - - - - - - - - - - - - *
-// QUARANTINE    * enumerate & accumulate data
-// QUARANTINE    * - - - - - - - - - - - - - - - - - - - */
-// QUARANTINE
-// QUARANTINE   analyze_enumerate_data(az, self);
-// QUARANTINE
-// QUARANTINE   analyze_accumulate_data(az);
-// QUARANTINE
-// QUARANTINE   /* - - - - - - - - - - - - - - - - - - - *
-// QUARANTINE    * output html pages
-// QUARANTINE    * - - - - - - - - - - - - - - - - - - - */
-// QUARANTINE
-// QUARANTINE   error = analyze_emit_main_page(az, self, path);
-// QUARANTINE
-// QUARANTINE
-// QUARANTINE   analyze_delete(az);
-// QUARANTINE   return error;
-// QUARANTINE }
+void
+smapsfilt_ctor(smapsfilt_t *self)
+{
+  self->smapsfilt_filtmode  = FM_ANALYZE;
+  self->smapsfilt_difflevel = -1;
+  self->smapsfilt_trimlevel = 0;
+
+  self->smapsfilt_output = 0;
+  self->smapsfilt_cache  = 1;
+  self->smapsfilt_jobs   = 1;
+  self->smapsfilt_gzip   = 0;
+  self->smapsfilt_listen = 0;
+  self->smapsfilt_count  = 0;
+  self->smapsfilt_server  = 0;
+  self->smapsfilt_connect = 0;
+  self->smapsfilt_pidtab  = 0;
+  self->smapsfilt_pidcnt  = 0;
+  self->smapsfilt_name    = 0;
+  str_array_ctor(&self->smapsfilt_inputs);
+  array_ctor(&self->smapsfilt_snaplist, smapssnap_delete_cb);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsfilt_dtor(smapsfilt_t *self)
+{
+  str_array_dtor(&self->smapsfilt_inputs);
+  array_dtor(&self->smapsfilt_snaplist);
+  free(self->smapsfilt_output);
+  free(self->smapsfilt_listen);
+  free(self->smapsfilt_server);
+  free(self->smapsfilt_connect);
+  free(self->smapsfilt_pidtab);
+  if( self->smapsfilt_name ) regfree(&self->smapsfilt_regex);
+  free(self->smapsfilt_name);
+}
 
 /* ------------------------------------------------------------------------- *
- * smapssnap_create
+ * smapsfilt_create
  * ------------------------------------------------------------------------- */
 
-smapssnap_t *
-smapssnap_create(void)
+smapsfilt_t *
+smapsfilt_create(void)
 {
-  smapssnap_t *self = calloc(1, sizeof *self);
-  smapssnap_ctor(self);
+  smapsfilt_t *self = calloc(1, sizeof *self);
+  smapsfilt_ctor(self);
   return self;
 }
 
 /* ------------------------------------------------------------------------- *
- * smapssnap_delete
+ * smapsfilt_delete
  * ------------------------------------------------------------------------- */
 
 void
-smapssnap_delete(smapssnap_t *self)
+smapsfilt_delete(smapsfilt_t *self)
 {
   if( self != 0 )
   {
-    smapssnap_dtor(self);
+    smapsfilt_dtor(self);
     free(self);
   }
 }
 
 /* ------------------------------------------------------------------------- *
- * smapssnap_delete_cb
+ * smapsfilt_delete_cb
  * ------------------------------------------------------------------------- */
 
 void
-smapssnap_delete_cb(void *self)
+smapsfilt_delete_cb(void *self)
 {
-  smapssnap_delete(self);
+  smapsfilt_delete(self);
 }
 
-//#include "scrap.txt"
+typedef struct diffkey_t diffkey_t;
+typedef struct diffval_t diffval_t;
 
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/* ------------------------------------------------------------------------- *
+ * diffval_t
+ * ------------------------------------------------------------------------- */
 
-enum emit_type {
-  EMIT_TYPE_LIBRARY,
-  EMIT_TYPE_APPLICATION,
-  EMIT_TYPE_OBJECT,
+struct diffval_t
+{
+  double pri;
+  double sha;
+  double cln;
 };
 
-/* ========================================================================= *
- * analyze_t  --  methods
- * ========================================================================= */
-
 /* ------------------------------------------------------------------------- *
- * analyze_ctor
+ * diffkey_t
  * ------------------------------------------------------------------------- */
 
-void
-analyze_ctor(analyze_t *self)
+struct diffkey_t
 {
-  self->mapp_tab = array_create(0); /* ownership of data not taken */
-
-  self->appl_tab = symtab_create();
-  self->type_tab = symtab_create();
-  self->path_tab = symtab_create();
-  self->summ_tab = symtab_create();
-
-  self->ntypes = 0;
-  self->nappls = 0;
-  self->npaths = 0;
-  self->groups = 0;
-
-  self->stype  = 0;
-  self->sappl  = 0;
-  self->spath  = 0;
+  int       appl;
+  int       inst;
+  int       type;
+  int       path;
+  int       cnt;
 
-  self->grp_app = 0;
-  self->grp_lib = 0;
+  //diffval_t val[0];
+};
 
-}
+/* ========================================================================= *
+ * diffval_t  --  methods
+ * ========================================================================= */
 
 /* ------------------------------------------------------------------------- *
- * analyze_dtor
+ * diffval_ctor
  * ------------------------------------------------------------------------- */
 
 void
-analyze_dtor(analyze_t *self)
+diffval_ctor(diffval_t *self)
 {
-  array_delete(self->mapp_tab);
-
-  symtab_delete(self->appl_tab);
-  symtab_delete(self->type_tab);
-  symtab_delete(self->path_tab);
-  symtab_delete(self->summ_tab);
-
-  free(self->stype);
-  free(self->sappl);
-  free(self->spath);
-
-  free(self->grp_app);
-  free(self->grp_lib);
-
-  free(self->app_mem);
-  free(self->grp_mem);
-  free(self->lib_mem);
-  free(self->sysest);
-  free(self->sysmax);
-  free(self->appmax);
-
+  self->pri = 0;
+  self->sha = 0;
+  self->cln = 0;
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_grp_mem
+ * diffval_dtor
  * ------------------------------------------------------------------------- */
 
-INLINE meminfo_t *
-analyze_grp_mem(analyze_t *self, int gid, int tid)
+void
+diffval_dtor(diffval_t *self)
 {
-  assert( 0 <= gid && gid < self->groups );
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->grp_mem[tid + gid * self->ntypes];
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_lib_mem
+ * diffval_add
  * ------------------------------------------------------------------------- */
 
-INLINE meminfo_t *
-analyze_lib_mem(analyze_t *self, int lid, int tid)
+void
+diffval_add(diffval_t *self, const diffval_t *that)
 {
-  assert( 0 <= lid && lid < self->npaths );
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->lib_mem[tid + lid * self->ntypes];
+  self->pri += that->pri;
+  self->sha += that->sha;
+  self->cln += that->cln;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_app_mem
- * ------------------------------------------------------------------------- */
+/* ========================================================================= *
+ * diffkey_t  --  methods
+ * ========================================================================= */
 
-INLINE meminfo_t *
-analyze_app_mem(analyze_t *self, int aid, int tid)
+INLINE diffval_t *diffkey_val(diffkey_t *self, int cap)
 {
-  assert( 0 <= aid && aid < self->nappls );
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->app_mem[tid + aid * self->ntypes];
+  assert( 0 <= cap && cap < self->cnt );
+  return &((diffval_t *)(self+1))[cap];
+
 }
 
-INLINE meminfo_t *
-analyze_mem(analyze_t *self, int a, int b, enum emit_type type)
+INLINE int diffkey_compare(const diffkey_t *k1, const diffkey_t *k2)
 {
-  if( type == EMIT_TYPE_LIBRARY)
-    return analyze_lib_mem(self, a, b);
-  if( type == EMIT_TYPE_APPLICATION)
-    return analyze_app_mem(self, a, b);
-  assert( 0 );
-  return NULL;
+  int r = 0;
+  if( (r = k1->appl - k2->appl) ) return r;
+  if( (r = k1->inst - k2->inst) ) return r;
+  if( (r = k1->type - k2->type) ) return r;
+  if( (r = k1->path - k2->path) ) return r;
+  return 0;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_sysest
- * ------------------------------------------------------------------------- */
-
-INLINE meminfo_t *
-analyze_sysest(analyze_t *self, int tid)
+double diffkey_rank(diffkey_t *self, diffval_t *res)
 {
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->sysest[tid];
-}
+  double pri = 0, sha = 0, cln = 0;
 
-/* ------------------------------------------------------------------------- *
- * analyze_sysmax
- * ------------------------------------------------------------------------- */
+  for( int i = 0; i < self->cnt; ++i )
+  {
+    diffval_t *val = diffkey_val(self, i);
+    pri += val->pri;
+    sha += val->sha;
+    cln += val->cln;
+  }
 
-INLINE meminfo_t *
-analyze_sysmax(analyze_t *self, int tid)
-{
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->sysmax[tid];
-}
+  pri /= self->cnt;
+  sha /= self->cnt;
+  cln /= self->cnt;
 
-/* ------------------------------------------------------------------------- *
- * analyze_appmax
- * ------------------------------------------------------------------------- */
+  res->pri = 0;
+  res->sha = 0;
+  res->cln = 0;
 
-INLINE meminfo_t *
-analyze_appmax(analyze_t *self, int tid)
-{
-  assert( 0 <= tid && tid < self->ntypes );
-  return &self->appmax[tid];
+  for( int i = 0; i < self->cnt; ++i )
+  {
+    diffval_t *val = diffkey_val(self, i);
+    res->pri += pow2(val->pri - pri);
+    res->sha += pow2(val->sha - sha);
+    res->cln += pow2(val->cln - cln);
+  }
+
+  res->pri = sqrt(res->pri / self->cnt);
+  res->sha = sqrt(res->sha / self->cnt);
+  res->cln = sqrt(res->cln / self->cnt);
+
+  return fmax3(res->pri, res->sha, res->cln);
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_create
+ * diffkey_create
  * ------------------------------------------------------------------------- */
 
-analyze_t *
-analyze_create(void)
+diffkey_t *
+diffkey_create(const diffkey_t *templ)
 {
-  analyze_t *self = calloc(1, sizeof *self);
-  analyze_ctor(self);
+  size_t     size = sizeof(diffkey_t) + templ->cnt * sizeof(diffval_t);
+  diffkey_t *self = calloc(1, size);
+
+  *self = *templ;
+
+// QUARANTINE   self->appl = -1;
+// QUARANTINE   self->inst = -1;
+// QUARANTINE   self->type = -1;
+// QUARANTINE   self->path = -1;
+// QUARANTINE   self->cnt = ncaps;
+
+  for( int i = 0; i < self->cnt; ++i )
+  {
+    diffval_ctor(diffkey_val(self, i));
+  }
   return self;
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_delete
+ * diffkey_delete
  * ------------------------------------------------------------------------- */
 
 void
-analyze_delete(analyze_t *self)
+diffkey_delete(diffkey_t *self)
 {
   if( self != 0 )
   {
-    analyze_dtor(self);
+    for( int i = 0; i < self->cnt; ++i )
+    {
+      diffval_dtor(diffkey_val(self, i));
+    }
     free(self);
   }
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_delete_cb
+ * diffkey_delete_cb
  * ------------------------------------------------------------------------- */
 
 void
-analyze_delete_cb(void *self)
+diffkey_delete_cb(void *self)
 {
-  analyze_delete(self);
+  diffkey_delete(self);
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_enumerate_data
- * ------------------------------------------------------------------------- */
+/* - - - - - - - - - - - - - - - - - - - *
+ * sort operator for process data
+ * - - - - - - - - - - - - - - - - - - - */
 
-static int
-local_compare_path(const void *a1, const void *a2)
+static unsigned
+key_app(const void *rec)
 {
-  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
-  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
-  return path_compare(m1->smapsmapp_map.path, m2->smapsmapp_map.path);
+  return ((const smapsproc_t *)rec)->smapsproc_AID;
 }
 
-void
-analyze_enumerate_data(analyze_t *self, smapssnap_t *snap)
+static unsigned
+key_pid(const void *rec)
 {
-  char temp[512];
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * sort process list by: app name & pid
-   * - - - - - - - - - - - - - - - - - - - */
-
-  array_sort(&snap->smapssnap_proclist, smapsproc_compare_name_pid_cb);
+  return ((const smapsproc_t *)rec)->smapsproc_PID;
+}
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * Enumerate:
-   * - application names
-   * - application instances
-   * - mapping types
-   *
-   * Collect all smaps data to one array
-   * while at it.
-   * - - - - - - - - - - - - - - - - - - - */
+static const smaps_radixkey_t keys_app_pid[] = { key_app, key_pid };
 
-  symtab_enumerate(self->type_tab, "total");
-  symtab_enumerate(self->type_tab, "code");
-  symtab_enumerate(self->type_tab, "data");
-  symtab_enumerate(self->type_tab, "heap");
-  symtab_enumerate(self->type_tab, "anon");
-  symtab_enumerate(self->type_tab, "stack");
+static void
+diff_ins(const diffkey_t *key, const diffval_t *val, int cap,
+         int diff_cnt, int diff_max, diffkey_t **diff_tab)
+{
+  for( int lo = 0, hi = diff_cnt;; )
+  {
+    if( lo == hi )
+    {
+      if( diff_cnt == diff_max )
+      {
+        diff_tab = realloc(diff_tab, (diff_max *= 2) * sizeof *diff_tab);
+      }
+      memmove(&diff_tab[lo+1], &diff_tab[lo+0],
+              (diff_cnt - lo) * sizeof *diff_tab);
+      diff_cnt += 1;
+      diff_tab[lo] = diffkey_create(key);
+      diffval_add(diffkey_val(diff_tab[lo],cap), val);
+      break;
+    }
+    int i = (lo + hi) / 2;
+    int r = diffkey_compare(diff_tab[i], key);
+    if( r < 0 ) { lo = i + 1; continue; }
+    if( r > 0 ) { hi = i + 0; continue; }
+    diffval_add(diffkey_val(diff_tab[i],cap), val);
+    break;
+  }
+}
 
-  for( size_t i = 0; i < snap->smapssnap_proclist.size; ++i )
+static void
+diff_emit_entry(diffkey_t *k, const char *name,
+                double rank, const double *data,
+                char ***out_row, int *out_cnt, int out_dta,
+                const char **appl_str, const char **type_str,
+                const char **path_str)
+{
+  char **out = calloc(out_dta, sizeof *out);
+  if( k->appl >= 0 ) smaps_xstrfmt(&out[0], "%s", appl_str[k->appl]);
+  if( k->inst >= 0 ) smaps_xstrfmt(&out[1], "%d", k->inst);
+  if( k->type >= 0 ) smaps_xstrfmt(&out[2], "%s", type_str[k->type]);
+  if( k->path >= 0 ) smaps_xstrfmt(&out[3], "%s", path_str[k->path]);
+  smaps_xstrfmt(&out[4],"%s", name);
+  for( int j = 0; j < k->cnt; ++j )
   {
-    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
+    smaps_xstrfmt(&out[5+j], "%g", data[j]);
+  }
+  smaps_xstrfmt(&out[5+k->cnt], "%.1f\n", rank);
+  out_row[*out_cnt++] = out;
+}
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * application <- app name
-     * - - - - - - - - - - - - - - - - - - - */
+int
+smapsfilt_diff(smapsfilt_t *self, const char *path,
+               int diff_lev, int html_diff, int trim_cols)
+{
+  int error = -1;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * difference data handling
+   * - - - - - - - - - - - - - - - - - - - */
 
-    // QUARANTINE     proc->smapsproc_AID = symtab_enumerate(self->appl_tab, proc->smapsproc_pid.Name);
+  int         diff_cnt = 0;
+  int         diff_max = 256;
+  diffkey_t **diff_tab = calloc(diff_max, sizeof *diff_tab);
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * app instance <- app name + PID
-     * - - - - - - - - - - - - - - - - - - - */
+  symtab_t *appl_tab = symtab_create();
+  symtab_t *type_tab = symtab_create();
+  symtab_t *path_tab = symtab_create();
 
-    snprintf(temp, sizeof temp, "%s (%d)",
-             proc->smapsproc_pid.Name,
-             proc->smapsproc_pid.Pid);
+  /* - - - - - - - - - - - - - - - - - - - *
+   * initialize symbol tables
+   * - - - - - - - - - - - - - - - - - - - */
 
-    proc->smapsproc_PID = symtab_enumerate(self->appl_tab, temp);
+  symtab_enumerate(type_tab, "code");
+  symtab_enumerate(type_tab, "data");
+  symtab_enumerate(type_tab, "heap");
+  symtab_enumerate(type_tab, "anon");
+  symtab_enumerate(type_tab, "stack");
 
-    // FIXME: use PID, not AID
-    proc->smapsproc_AID = proc->smapsproc_PID;
+  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+  {
+    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
 
-    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
     {
-      smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
+      symtab_enumerate(appl_tab, proc->smapsproc_pid.Name);
 
-      mapp->smapsmapp_AID = proc->smapsproc_AID;
-      mapp->smapsmapp_PID = proc->smapsproc_PID;
-      mapp->smapsmapp_TID = symtab_enumerate(self->type_tab, mapp->smapsmapp_map.type);
-      array_add(self->mapp_tab, mapp);
+      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
+      {
+        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
+        symtab_enumerate(path_tab, mapp->smapsmapp_map.path);
+      }
     }
   }
+  symtab_renum(appl_tab);
+  symtab_renum(path_tab);
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * sort smaps data by file path
+   * enumerate data, normalize pids to
+   * application instances while at it
    * - - - - - - - - - - - - - - - - - - - */
 
-  array_sort(self->mapp_tab, local_compare_path);
+  #define P(x) fprintf(stderr, "%s: %g\n", #x, (double)(x));
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * Enumerate:
-   * - mapping paths
-   * - application instance + path pairs
-   * - - - - - - - - - - - - - - - - - - - */
+  int inst_cnt = 0;
 
-  for( size_t k = 0; k < self->mapp_tab->size; ++k )
+  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
   {
-    smapsmapp_t *mapp = self->mapp_tab->data[k];
+    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * mapping path
-     * - - - - - - - - - - - - - - - - - - - */
+// QUARANTINE     P(snap->smapssnap_proclist.size);
 
-    mapp->smapsmapp_LID = symtab_enumerate(self->path_tab, mapp->smapsmapp_map.path);
+    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
+    {
+      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
+      proc->smapsproc_PID = proc->smapsproc_pid.Pid;
+      proc->smapsproc_AID = symtab_enumerate(appl_tab,
+                                             proc->smapsproc_pid.Name);
+    }
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * application + mapping path
-     * - - - - - - - - - - - - - - - - - - - */
+    smaps_radix_sort(snap->smapssnap_proclist.data,
+                     snap->smapssnap_proclist.size, keys_app_pid, 2);
 
-    snprintf(temp, sizeof temp, "app%03d::lib%03d",
-             mapp->smapsmapp_AID,
-             mapp->smapsmapp_LID);
-    mapp->smapsmapp_EID = symtab_enumerate(self->summ_tab, temp);
+    int aid = -1, pid = -1, cnt = 0;
+    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
+    {
+      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
+      if( aid != proc->smapsproc_AID )
+      {
+        aid = proc->smapsproc_AID, pid = proc->smapsproc_PID, cnt = 0;
+      }
+      else if( pid != proc->smapsproc_PID )
+      {
+        pid = proc->smapsproc_PID, ++cnt;
+        if( inst_cnt < cnt ) inst_cnt = cnt;
+      }
+      proc->smapsproc_PID = cnt;
+      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
+      {
+        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
+        mapp->smapsmapp_AID = proc->smapsproc_AID;
+        mapp->smapsmapp_PID = proc->smapsproc_PID;
+        mapp->smapsmapp_TID = symtab_enumerate(type_tab,
+                                               mapp->smapsmapp_map.type);
+        mapp->smapsmapp_LID = symtab_enumerate(path_tab,
+                                               mapp->smapsmapp_map.path);
+      }
+    }
   }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * reverse lookup tables for enums
+   * reverse lookup tables
    * - - - - - - - - - - - - - - - - - - - */
 
-  self->ntypes = self->type_tab->symtab_count;
-  self->nappls = self->appl_tab->symtab_count;
-  self->npaths = self->path_tab->symtab_count;
-  self->groups = self->summ_tab->symtab_count;
+  int appl_cnt = appl_tab->symtab_count;
+  int type_cnt = type_tab->symtab_count;
+  int path_cnt = path_tab->symtab_count;
 
-  self->stype  = calloc(self->ntypes, sizeof *self->stype);
-  self->sappl  = calloc(self->nappls, sizeof *self->sappl);
-  self->spath  = calloc(self->npaths, sizeof *self->spath);
+  const char *appl_str[appl_cnt];
+  const char *type_str[type_cnt];
+  const char *path_str[path_cnt];
 
-  for( int i = 0; i < self->ntypes; ++i )
+  for( int i = 0; i < appl_cnt; ++i )
   {
-    symbol_t *s = &self->type_tab->symtab_entry[i];
-    self->stype[s->symbol_val] = s->symbol_key;
+    //appl_str[i] = appl_tab->symtab_entry[i].symbol_key;
+
+    symbol_t *s = &appl_tab->symtab_entry[i];
+    appl_str[s->symbol_val] = s->symbol_key;
   }
-  for( int i = 0; i < self->nappls; ++i )
+  for( int i = 0; i < type_cnt; ++i )
   {
-    symbol_t *s = &self->appl_tab->symtab_entry[i];
-    self->sappl[s->symbol_val] = s->symbol_key;
+    //type_str[i] = type_tab->symtab_entry[i].symbol_key;
+    symbol_t *s = &type_tab->symtab_entry[i];
+    type_str[s->symbol_val] = s->symbol_key;
   }
-  for( int i = 0; i < self->npaths; ++i )
+  for( int i = 0; i < path_cnt; ++i )
   {
-    symbol_t *s = &self->path_tab->symtab_entry[i];
-    self->spath[s->symbol_val] = s->symbol_key;
+    //path_str[i] = path_tab->symtab_entry[i].symbol_key;
+    symbol_t *s = &path_tab->symtab_entry[i];
+    path_str[s->symbol_val] = s->symbol_key;
   }
 
+// QUARANTINE   P(appl_cnt);
+// QUARANTINE   P(inst_cnt);
+// QUARANTINE   P(type_cnt);
+// QUARANTINE   P(path_cnt);
+
   /* - - - - - - - - - - - - - - - - - - - *
-   * group -> appl and/or path mapping
+   * accumulate stats
    * - - - - - - - - - - - - - - - - - - - */
 
-  self->grp_app = calloc(self->groups, sizeof *self->grp_app);
-  self->grp_lib = calloc(self->groups, sizeof *self->grp_lib);
-
-  for( int g = 0; g < self->groups; ++g )
-  {
-    self->grp_app[g] = self->grp_lib[g] = -1;
-  }
-
-  for( size_t k = 0; k < self->mapp_tab->size; ++k )
-  {
-    smapsmapp_t *mapp = self->mapp_tab->data[k];
-    int g = mapp->smapsmapp_EID;
-    int a = mapp->smapsmapp_AID;
-    int p = mapp->smapsmapp_LID;
+  diffkey_t key;
+  diffval_t val;
 
-    // QUARANTINE     printf("G:%d -> A:%d, L:%d\n", g, a, p);
-
-    assert( self->grp_app[g] == -1 || self->grp_app[g] == a );
-    assert( self->grp_lib[g] == -1 || self->grp_lib[g] == p );
-
-    self->grp_app[g] = a;
-    self->grp_lib[g] = p;
-  }
+  key.appl = -1;
+  key.inst = -1;
+  key.type = -1;
+  key.path = -1;
+  key.cnt  = self->smapsfilt_snaplist.size;
 
-  for( int g = 0; g < self->groups; ++g )
+  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
   {
-    assert( self->grp_app[g] != -1 );
-    assert( self->grp_lib[g] != -1 );
-  }
-}
+    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
+    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
+    {
+      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
+      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
+      {
+        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
 
-/* ------------------------------------------------------------------------- *
- * analyze_accumulate_data
- * ------------------------------------------------------------------------- */
+        switch( diff_lev )
+        {
+        default:
+        case 4: key.path = mapp->smapsmapp_LID;
+        case 3: key.type = mapp->smapsmapp_TID;
+        case 2: key.inst = mapp->smapsmapp_PID;
+        case 1: key.appl = mapp->smapsmapp_AID;
+        case 0: break;
+        }
+        val.pri = mapp->smapsmapp_mem.Private_Dirty;
+        val.sha = mapp->smapsmapp_mem.Shared_Dirty;
+        val.cln = (mapp->smapsmapp_mem.Shared_Clean +
+                   mapp->smapsmapp_mem.Private_Clean);
+        diff_ins(&key, &val, i, diff_cnt, diff_max, diff_tab);
+      }
+    }
+  }
 
-void
-analyze_accumulate_data(analyze_t *self)
-{
   /* - - - - - - - - - - - - - - - - - - - *
-   * allocate accumulation tables
+   * output results
    * - - - - - - - - - - - - - - - - - - - */
 
-  self->grp_mem = calloc(self->groups * self->ntypes, sizeof *self->grp_mem);
-  self->app_mem = calloc(self->nappls * self->ntypes, sizeof *self->app_mem);
-  self->lib_mem = calloc(self->npaths * self->ntypes, sizeof *self->lib_mem);
-
-  self->sysest  = calloc(self->ntypes, sizeof *self->sysest);
-  self->sysmax  = calloc(self->ntypes, sizeof *self->sysmax);
-  self->appmax  = calloc(self->ntypes, sizeof *self->appmax);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * accumulate raw smaps data by
-   * process + map path by type grouping
-   * - - - - - - - - - - - - - - - - - - - */
+  double min_rank = 4;
 
-  for( size_t k = 0; k < self->mapp_tab->size; ++k )
-  {
-    smapsmapp_t *mapp = self->mapp_tab->data[k];
+  FILE *file = 0;
 
-    meminfo_t   *srce = &mapp->smapsmapp_mem;
+  char ***out_row = calloc(diff_cnt * 3, sizeof *out_row);
+  int    out_cnt = 0;
+  int    out_dta = 4 + 1 + self->smapsfilt_snaplist.size + 1;
 
-    meminfo_t   *dest = analyze_grp_mem(self,
-                                        mapp->smapsmapp_EID,
-                                        mapp->smapsmapp_TID);
+  if( trim_cols > 4 ) trim_cols = 4;
 
-    meminfo_accumulate_appdata(dest, srce);
+  if( (file = fopen(path, "w")) == 0 )
+  {
+    perror(path); goto cleanup;
   }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * accumulate grouped smaps data to
-   * application instance & library
-   * - - - - - - - - - - - - - - - - - - - */
+  for( size_t i = 0; i < diff_cnt; ++i )
+  {
+    diffkey_t *k = diff_tab[i];
+    if( diffkey_rank(k, &val) >= min_rank )
+    {
+      double d[k->cnt];
+      if( val.pri >= min_rank )
+      {
+        for( int j = 0; j < k->cnt; ++j ) {
+          d[j] = diffkey_val(k, j)->pri;
+        }
+	diff_emit_entry(k, "pri", val.pri, d, out_row, &out_cnt, out_dta,
+                        appl_str, type_str, path_str);
+      }
+      if( val.sha >= min_rank )
+      {
+        for( int j = 0; j < k->cnt; ++j ) {
+          d[j] = diffkey_val(k, j)->sha;
+        }
+	diff_emit_entry(k, "sha", val.sha, d, out_row, &out_cnt, out_dta,
+                        appl_str, type_str, path_str);
+      }
+      if( val.cln >= min_rank )
+      {
+        for( int j = 0; j < k->cnt; ++j ) {
+          d[j] = diffkey_val(k, j)->cln;
+        }
+	diff_emit_entry(k, "cln", val.cln, d, out_row, &out_cnt, out_dta,
+                        appl_str, type_str, path_str);
+      }
+    }
+    diffkey_delete(diff_tab[i]);
+  }
 
-  for( int g = 0; g < self->groups; ++g )
+  /* diff_emit_table(): */
   {
-    int a = self->grp_app[g];
-    int p = self->grp_lib[g];
+    if( trim_cols > 0 )
+    {
+      int N[out_cnt];
+      for( int i = 1; i < out_cnt; ++i )
+      {
+        N[i] = 0;
+        for( int k = 0; k <= trim_cols; ++k )
+        {
+          N[i] = k;
+          if( out_row[i-0][k] == 0 ) break;
+          if( out_row[i-1][k] == 0 ) break;
+          if( strcmp(out_row[i-0][k], out_row[i-1][k]) ) break;
+        }
+      }
+      for( int i = 1; i < out_cnt; ++i )
+      {
+        for( int k = 0; k < N[i]; ++k )
+        {
+          if( html_diff )
+          {
+            free(out_row[i][k]);
+            out_row[i][k] = 0;
+          }
+          else
+          {
+            out_row[i][k][0] = 0;
+          }
+        }
+      }
+    }
 
-    // Note: t=0 -> "total"
-    for( int t = 1; t < self->ntypes; ++t )
+    if( html_diff )
     {
-      meminfo_t   *srce = analyze_grp_mem(self, g, t);
-      meminfo_t   *dest;
+      /* - - - - - - - - - - - - - - - - - - - *
+       * header
+       * - - - - - - - - - - - - - - - - - - - */
+
+      fprintf(file,
+              "<html><head><title>SMAPS DIFF</title></head><body>\n"
+              "<h1>SMAPS DIFF</h1>\n"
+              "<p>\n");
+
+      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+      {
+        smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
+        fprintf(file, "CAP%d = %s<br>\n", i+1, snap->smapssnap_source);
+      }
+
+      fprintf(file,
+              "<table border=1>\n"
+              "<tr>\n");
+
+      if( diff_lev >= 1 ) fprintf(file, "<th>Cmd");
+      if( diff_lev >= 2 ) fprintf(file, "<th>Pid");
+      if( diff_lev >= 3 ) fprintf(file, "<th>Type");
+      if( diff_lev >= 4 ) fprintf(file, "<th>Path");
+      fprintf(file, "<th>Value");
+      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+      {
+        fprintf(file, "<th>CAP%d", i+1);
+      }
+      fprintf(file, "<th>RANK\n");
 
       /* - - - - - - - - - - - - - - - - - - - *
-       * process+library/type -> process/type
+       * table data
        * - - - - - - - - - - - - - - - - - - - */
 
-      dest = analyze_app_mem(self, a, t);
-      meminfo_accumulate_appdata(dest, srce);
+      for( int i = 0; i < out_cnt; ++i )
+      {
+        fprintf(file, "<tr>\n");
+        for( int k = 0; k < out_dta; ++k )
+        {
+          if( out_row[i][k] != 0 )
+          {
+            int j;
+            int r = (k == 1) || (k >= 5);
+            for( j = i+1; j < out_cnt; ++j )
+            {
+              if( out_row[j][k] ) break;
+            }
+            if( (j -= i) > 1 )
+            {
+              fprintf(file, "<td%s valign=top rowspan=%d>%s",
+                      r ? " align=right" : "", j, out_row[i][k]);
+            }
+            else
+            {
+              fprintf(file, "<td%s>%s",
+                      r ? " align=right" : "", out_row[i][k]);
+            }
+          }
+        }
+      }
 
       /* - - - - - - - - - - - - - - - - - - - *
-       * process+library/type -> library/type
+       * trailer
        * - - - - - - - - - - - - - - - - - - - */
 
-      dest = analyze_lib_mem(self, p, t);
-      meminfo_accumulate_libdata(dest, srce);
-     }
-  }
+      fprintf(file,
+              "</table>\n"
+              "</body>\n"
+              "</html>\n");
+    }
+    else
+    {
+      /* - - - - - - - - - - - - - - - - - - - *
+       * header
+       * - - - - - - - - - - - - - - - - - - - */
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * application instance totals
-   * - - - - - - - - - - - - - - - - - - - */
+      fprintf(file, "generator = %s %s\n", TOOL_NAME, TOOL_VERS);
+      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+      {
+        smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
+        fprintf(file, "CAP%d = %s\n", i+1, snap->smapssnap_source);
+      }
+      fprintf(file, "\n");
 
-  for( int i = 0; i < self->nappls; ++i )
-  {
-    meminfo_t *dest = analyze_app_mem(self, i, 0);
+      if( diff_lev >= 1 ) fprintf(file, "Cmd,");
+      if( diff_lev >= 2 ) fprintf(file, "Pid,");
+      if( diff_lev >= 3 ) fprintf(file, "Type,");
+      if( diff_lev >= 4 ) fprintf(file, "Path,");
+      fprintf(file, "Value,");
+      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+      {
+        fprintf(file, "CAP%d,", i+1);
+      }
+      fprintf(file, "RANK\n");
 
-    for( int t = 1; t < self->ntypes; ++t )
-    {
-      meminfo_t *srce = analyze_app_mem(self, i, t);
-      meminfo_accumulate_appdata(dest, srce);
-    }
-  }
+      /* - - - - - - - - - - - - - - - - - - - *
+       * table
+       * - - - - - - - - - - - - - - - - - - - */
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * library path totals
-   * - - - - - - - - - - - - - - - - - - - */
+      for( int i = 0; i < out_cnt; ++i )
+      {
+        for( int n=0, k = 0; k < out_dta; ++k )
+        {
+          if( out_row[i][k] != 0 )
+          {
+            fprintf(file, "%s%s", n++ ? "," : "", out_row[i][k]);
+          }
+        }
+      }
 
-  for( int i = 0; i < self->npaths; ++i )
-  {
-    meminfo_t *dest = analyze_lib_mem(self, i, 0);
+      /* - - - - - - - - - - - - - - - - - - - *
+       * trailer
+       * - - - - - - - - - - - - - - - - - - - */
 
-    for( int t = 1; t < self->ntypes; ++t )
-    {
-      meminfo_t *srce = analyze_lib_mem(self, i, t);
-      meminfo_accumulate_appdata(dest, srce);
+      fprintf(file, "\n");
     }
   }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * application data -> appl estimates
-   * - - - - - - - - - - - - - - - - - - - */
+  error = 0;
 
-  for( int i = 0; i < self->nappls; ++i )
-  {
-    for( int t = 1; t < self->ntypes; ++t )
-    {
-      meminfo_t *dest, *srce;
+  cleanup:
 
-      srce = analyze_app_mem(self, i, t);
+  symtab_delete(appl_tab);
+  symtab_delete(type_tab);
+  symtab_delete(path_tab);
+  free(diff_tab);
 
-      dest = analyze_appmax(self, t);
-      meminfo_accumulate_maxdata(dest, srce);
+  if( file != 0 ) fclose(file);
 
-      dest = analyze_sysmax(self, t);
-      meminfo_accumulate_appdata(dest, srce);
-    }
-  }
+  return error;
+}
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * library data -> system estimates
-   * - - - - - - - - - - - - - - - - - - - */
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_handle_arguments
+ * ------------------------------------------------------------------------- */
+
+int parse_level(const char *text)
+{
+  int level = 2;
 
-  for( int i = 0; i < self->npaths; ++i )
+  if( !strcmp(text, "sys") )
   {
-    for( int t = 1; t < self->ntypes; ++t )
-    {
-      meminfo_t *dest = analyze_sysest(self, t);
-      meminfo_t *srce = analyze_lib_mem(self, i, t);
-      meminfo_accumulate_appdata(dest, srce);
-    }
+    level = 0;
   }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * system estimate totals
-   * - - - - - - - - - - - - - - - - - - - */
-
-  for( int t = 1; t < self->ntypes; ++t )
+  else if( !strcmp(text, "app") )
   {
-    meminfo_t *dest, *srce;
-
-    srce = analyze_sysest(self, t);
-    dest = analyze_sysest(self, 0);
-    meminfo_accumulate_appdata(dest, srce);
-
-    srce = analyze_sysmax(self, t);
-    dest = analyze_sysmax(self, 0);
-    meminfo_accumulate_appdata(dest, srce);
-
-    srce = analyze_appmax(self, t);
-    dest = analyze_appmax(self, 0);
-    meminfo_accumulate_appdata(dest, srce);
+    level = 1;
   }
-}
-
-static void
-analyze_html_header(FILE *file, const char *title, const char *work)
-{
-  fprintf(file, "<html>\n");
-  fprintf(file, "<head>\n");
-  fprintf(file, "<title>%s</title>\n", title);
-  fprintf(file, "<link rel=\"stylesheet\" type=\"text/css\" href=\"%s/tablesorter.css\" />\n", work);
-  fprintf(file, "<style type='text/css'>\n");
-  fprintf(file, "  table.tablesorter thead tr .header"
-                "  { background-image: url(%s/bg.gif);"
-                "    background-repeat: no-repeat;"
-                "    background-position: center right; }\n", work);
-  fprintf(file, "  table.tablesorter thead tr .headerSortUp"
-                "  { background-image: url(%s/asc.gif); }\n", work);
-  fprintf(file, "  table.tablesorter thead tr .headerSortDown"
-                "  { background-image: url(%s/desc.gif); }\n", work);
-  fprintf(file, "</style>\n");
-  fprintf(file, "</head>\n");
-  fprintf(file, "<body>\n");
-  fprintf(file, "<script src=\"%s/jquery.min.js\"></script>\n", work);
-  fprintf(file, "<script src=\"%s/jquery.metadata.js\"></script>\n", work);
-  fprintf(file, "<script src=\"%s/jquery.tablesorter.js\"></script>\n", work);
-  fprintf(file, "<script src=\"%s/expander.js\"></script>\n", work);
-  fprintf(file, "<script>$(document).ready(function() "
-                "{ $(\".tablesorter\").tablesorter(); } );</script>\n");
-}
-
-#define TP " bgcolor=\"#ffffbf\" "
-#define LT " bgcolor=\"#bfffff\" "
-#define D1 " bgcolor=\"#f4f4f4\" "
-#define D2 " bgcolor=\"#ffffff\" "
-
-static const char *const emit_type_titles[] = {
-  [EMIT_TYPE_LIBRARY]         = "Library",
-  [EMIT_TYPE_APPLICATION]     = "Application",
-  [EMIT_TYPE_OBJECT]          = "Object",
-};
-
-/* ------------------------------------------------------------------------- *
- * analyze_emit_page_table
- * ------------------------------------------------------------------------- */
-
-static void
-analyze_emit_page_table(analyze_t *self, FILE *file, const meminfo_t *mtab, const pidinfo_t *pidinfo)
-{
-  fprintf(file, "<table border=1>\n");
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th rowspan=2>\n");
-  fprintf(file, "<th"TP"colspan=2>%s\n", "Dirty");
-  fprintf(file, "<th"TP"colspan=2>%s\n", "Clean");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Resident");
-  if (pidinfo)
+  else if( !strcmp(text, "pid") )
   {
-    fprintf(file, "<th"TP"rowspan=2>%s\n",
-        "<abbr title='VmHWM field of /proc/pid/status'>Resident Peak</abbr>");
+    level = 2;
   }
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Size");
-  if (pidinfo)
+  else if( !strcmp(text, "sec") )
   {
-    fprintf(file, "<th"TP"rowspan=2>%s\n",
-        "<abbr title='VmPeak field of /proc/pid/status'>Size Peak</abbr>");
+    level = 3;
   }
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Pss");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Swap");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Referenced");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Anonymous");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Locked");
-
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP">%s\n", "Private");
-  fprintf(file, "<th"TP">%s\n", "Shared");
-  fprintf(file, "<th"TP">%s\n", "Private");
-  fprintf(file, "<th"TP">%s\n", "Shared");
-
-  for( int t = 0; t < self->ntypes; ++t )
+  else if( !strcmp(text, "obj") )
   {
-    const meminfo_t *m = &mtab[t];
-    const char *bg = ((t/3)&1) ? D1 : D2;
-
-    fprintf(file, "<tr>\n");
-    fprintf(file, "<th"LT" align=left>%s\n", self->stype[t]);
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Rss));
-    if (pidinfo)
-    {
-      fprintf(file, "<td %s align=right>%s\n", bg,
-          uval(t==0 ? pidinfo->VmHWM : 0));
-    }
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Size));
-    if (pidinfo)
+    level = 4;
+  }
+  else
+  {
+    char *e = 0;
+    int   n = strtol(text, &e, 0);
+    if( e > text && *e == 0 )
     {
-      fprintf(file, "<td %s align=right>%s\n", bg,
-          uval(t==0 ? pidinfo->VmPeak : 0));
+      level = n;
     }
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Pss));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Swap));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Referenced));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Anonymous));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Locked));
   }
-  fprintf(file, "</table>\n");
+
+  return level;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_emit_xref_header
- * ------------------------------------------------------------------------- */
+/* - - - - - - - - - - - - - - - - - - - *
+ * fields: capture data the mode uses,
+ * the loader skips everything else
+ * - - - - - - - - - - - - - - - - - - - */
 
-static void
-analyze_emit_xref_header(const analyze_t *self, FILE *file, enum emit_type type)
+#define FIELDS_APPVALS (SMAPSFIELD_SIZE          |\
+                        SMAPSFIELD_RSS           |\
+                        SMAPSFIELD_PSS           |\
+                        SMAPSFIELD_SWAP          |\
+                        SMAPSFIELD_REFERENCED    |\
+                        SMAPSFIELD_SHARED_CLEAN  |\
+                        SMAPSFIELD_SHARED_DIRTY  |\
+                        SMAPSFIELD_PRIVATE_CLEAN |\
+                        SMAPSFIELD_PRIVATE_DIRTY)
+
+#define FIELDS_DIFF    (SMAPSFIELD_SHARED_CLEAN  |\
+                        SMAPSFIELD_SHARED_DIRTY  |\
+                        SMAPSFIELD_PRIVATE_CLEAN |\
+                        SMAPSFIELD_PRIVATE_DIRTY)
+
+static const struct
+{
+  const char *name; int mode; unsigned fields;
+} filtmode_lut[] =
+{
+  {"flatten",   FM_FLATTEN,   SMAPSFIELD_ALL },
+  {"normalize", FM_NORMALIZE, SMAPSFIELD_ALL },
+  {"analyze",   FM_ANALYZE,   SMAPSFIELD_MEMORY },
+  {"appvals",   FM_APPVALS,   FIELDS_APPVALS },
+  {"diff",      FM_DIFF,      FIELDS_DIFF },
+};
+
+static int
+parse_filtmode(const char *text)
 {
-  fprintf(file, "<thead>\n");
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP">%s\n", emit_type_titles[type]);
-  fprintf(file, "<th"TP">%s\n", "Type");
-  fprintf(file, "<th"TP">%s\n", "Prot");
-  fprintf(file, "<th"TP">%s\n", "Size");
-  fprintf(file, "<th"TP">%s\n", "Rss");
-  fprintf(file, "<th"TP">%s\n", "Dirty<br>Private");
-  fprintf(file, "<th"TP">%s\n", "Dirty<br>Shared");
-  fprintf(file, "<th"TP">%s\n", "Clean<br>Private");
-  fprintf(file, "<th"TP">%s\n", "Clean<br>Shared");
-  fprintf(file, "<th"TP">%s\n", "Pss");
-  fprintf(file, "<th"TP">%s\n", "Swap");
-  fprintf(file, "<th"TP">%s\n", "Anonymous");
-  fprintf(file, "<th"TP">%s\n", "Locked");
+  for( size_t i = 0; i < sizeof filtmode_lut / sizeof *filtmode_lut; ++i )
+  {
+    if( !strcmp(filtmode_lut[i].name, text) )
+    {
+      return filtmode_lut[i].mode;
+    }
+  }
+  return -1;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_get_apprange
- * ------------------------------------------------------------------------- */
-
-static int cmp_app_aid;
-static int
-cmp_app(const void *p)
+static const char *
+filtmode_name(int mode)
 {
-  const smapsmapp_t *m = p;
-  return m->smapsmapp_AID - cmp_app_aid;
+  for( size_t i = 0; i < sizeof filtmode_lut / sizeof *filtmode_lut; ++i )
+  {
+    if( filtmode_lut[i].mode == mode )
+    {
+      return filtmode_lut[i].name;
+    }
+  }
+  return "analyze";
 }
 
-void
-analyze_get_apprange(analyze_t *self,int lo, int hi, int *plo, int *phi, int aid)
+static unsigned
+filtmode_fields(int mode)
 {
-  cmp_app_aid = aid;
-  *plo = array_find_lower(self->mapp_tab, lo, hi, cmp_app);
-  *phi = array_find_upper(self->mapp_tab, lo, hi, cmp_app);
+  for( size_t i = 0; i < sizeof filtmode_lut / sizeof *filtmode_lut; ++i )
+  {
+    if( filtmode_lut[i].mode == mode )
+    {
+      return filtmode_lut[i].fields;
+    }
+  }
+  return SMAPSFIELD_ALL;
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_get_librange
+ * process selection
  * ------------------------------------------------------------------------- */
 
-static int cmp_lib_lid;
 static int
-cmp_lib(const void *p)
-{
-  const smapsmapp_t *m = p;
-  return m->smapsmapp_LID - cmp_lib_lid;
-}
-
-void
-analyze_get_librange(analyze_t *self,int lo, int hi, int *plo, int *phi, int lid)
+smapsfilt_pid_cb(const void *a1, const void *a2)
 {
-  cmp_lib_lid = lid;
-  *plo = array_find_lower(self->mapp_tab, lo, hi, cmp_lib);
-  *phi = array_find_upper(self->mapp_tab, lo, hi, cmp_lib);
+  return *(const int *)a1 - *(const int *)a2;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_emit_lib_html
- * ------------------------------------------------------------------------- */
-
 static int
-local_lib_app_compare(const void *a1, const void *a2)
+smapsfilt_select_pids(smapsfilt_t *self, const char *list)
 {
-  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
-  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
-
-  int r;
+  char *end = 0;
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * primary sorting: must be LID then AID
-   * for the range searching below to work!
-   * - - - - - - - - - - - - - - - - - - - */
+  while( *list )
+  {
+    int pid = strtol(list, &end, 10);
 
-  if( (r = m1->smapsmapp_LID - m2->smapsmapp_LID) != 0 ) return r;
-  if( (r = m1->smapsmapp_AID - m2->smapsmapp_AID) != 0 ) return r;
+    if( end == list || pid <= 0 )
+    {
+      return -1;
+    }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * secondary sorting: convenience order
-   * - - - - - - - - - - - - - - - - - - - */
+    self->smapsfilt_pidtab = realloc(self->smapsfilt_pidtab,
+                                     (self->smapsfilt_pidcnt + 1) *
+                                     sizeof *self->smapsfilt_pidtab);
+    self->smapsfilt_pidtab[self->smapsfilt_pidcnt++] = pid;
 
-  if( (r = m1->smapsmapp_TID - m2->smapsmapp_TID) != 0 ) return r;
-  if( (r = m2->smapsmapp_mem.Rss - m1->smapsmapp_mem.Rss) ) return r;
+    list = end;
+    while( *list == ',' || *list == ' ' ) ++list;
+  }
 
+  qsort(self->smapsfilt_pidtab, self->smapsfilt_pidcnt,
+        sizeof *self->smapsfilt_pidtab, smapsfilt_pid_cb);
   return 0;
 }
 
-int
-analyze_emit_lib_html(analyze_t *self, smapssnap_t *snap, const char *work)
+static int
+smapsfilt_select_name(smapsfilt_t *self, const char *expr, char **perr)
 {
-  int   error = -1;
-  FILE *file  = 0;
+  char err[256];
+  int  rc;
 
-  char  temp[512];
+  if( self->smapsfilt_name )
+  {
+    regfree(&self->smapsfilt_regex);
+    free(self->smapsfilt_name), self->smapsfilt_name = 0;
+  }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * sort smaps data to bsearchable order
-   * - - - - - - - - - - - - - - - - - - - */
+  if( (rc = regcomp(&self->smapsfilt_regex, expr,
+                    REG_EXTENDED|REG_NOSUB)) != 0 )
+  {
+    regerror(rc, &self->smapsfilt_regex, err, sizeof err);
+    smaps_xstrfmt(perr, "invalid regex '%s': %s", expr, err);
+    return -1;
+  }
+  self->smapsfilt_name = strdup(expr);
+  return 0;
+}
 
-  array_sort(self->mapp_tab, local_lib_app_compare);
+static int
+smapsfilt_select_cb(void *user, int pid, const char *name)
+{
+  smapsfilt_t *self = user;
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * write html page for each library
-   * - - - - - - - - - - - - - - - - - - - */
+  if( self->smapsfilt_pidcnt != 0
+      && !bsearch(&pid, self->smapsfilt_pidtab, self->smapsfilt_pidcnt,
+                  sizeof *self->smapsfilt_pidtab, smapsfilt_pid_cb) )
+  {
+    return 0;
+  }
 
-  for( int l = 0; l < self->npaths; ++l )
+  if( self->smapsfilt_name != 0
+      && regexec(&self->smapsfilt_regex, name, 0, 0, 0) != 0 )
   {
-    smapsmapp_t *m; int t,a;
+    return 0;
+  }
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * open output file
-     * - - - - - - - - - - - - - - - - - - - */
+  return 1;
+}
 
-    snprintf(temp, sizeof temp, "%s/lib%03d.html", work, l);
-    //printf(">> %s\n", temp);
+static void
+smapsfilt_handle_arguments(smapsfilt_t *self, int ac, char **av)
+{
+  argvec_t *args = argvec_create(ac, av, app_opt, app_man);
+  const char *name = basename(av[0]);
+  char *error = 0;
+
+  if (!strcmp(name, "sp_smaps_flatten")) {
+	  self->smapsfilt_filtmode = FM_FLATTEN;
+  } else if (!strcmp(name, "sp_smaps_normalize")) {
+	  self->smapsfilt_filtmode = FM_NORMALIZE;
+  } else if (!strcmp(name, "sp_smaps_analyze")) {
+	  self->smapsfilt_filtmode = FM_ANALYZE;
+  } else if (!strcmp(name, "sp_smaps_appvals")) {
+	  self->smapsfilt_filtmode = FM_APPVALS;
+  } else if (!strcmp(name, "sp_smaps_diff")) {
+	  self->smapsfilt_filtmode = FM_DIFF;
+  }
+  
+  while( !argvec_done(args) )
+  {
+    int       tag  = 0;
+    char     *par  = 0;
 
-    if( (file = fopen(temp, "w")) == 0 )
+    if( !argvec_next(args, &tag, &par) )
     {
-      goto cleanup;
+      msg_error("(use --help for usage)\n");
+      exit(1);
     }
 
-    analyze_html_header(file, path_basename(self->spath[l]), ".");
+    switch( tag )
+    {
+    case opt_help:
+      argvec_usage(args);
+      exit(EXIT_SUCCESS);
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * summary table
-     * - - - - - - - - - - - - - - - - - - - */
+    case opt_vers:
+      printf("%s\n", TOOL_VERS);
+      exit(EXIT_SUCCESS);
 
-    fprintf(file, "<h1>%s: %s</h1>\n", emit_type_titles[EMIT_TYPE_LIBRARY], self->spath[l]);
-    analyze_emit_page_table(self, file, analyze_lib_mem(self, l, 0), NULL);
+    case opt_verbose:
+      msg_incverbosity();
+      break;
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * application xref
-     * - - - - - - - - - - - - - - - - - - - */
+    case opt_quiet:
+      msg_decverbosity();
+      break;
 
-    fprintf(file, "<h1>%s XREF</h1>\n", emit_type_titles[EMIT_TYPE_APPLICATION]);
-    /* Sort initially by 9th column (PSS) in descending order */
-    fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[9,0]] }\">\n");
-    analyze_emit_xref_header(self, file, EMIT_TYPE_APPLICATION);
-    fprintf(file, "<tbody>\n");
+    case opt_silent:
+      msg_setsilent();
+      break;
 
-    int alo,ahi, blo,bhi;
+    case opt_input:
+    case opt_noswitch:
+      str_array_add(&self->smapsfilt_inputs, par);
+      break;
 
-    analyze_get_librange(self, 0, self->mapp_tab->size, &alo, &ahi, l);
+    case opt_output:
+      cstring_set(&self->smapsfilt_output, par);
+      break;
 
-    for( ; alo < ahi; alo = bhi )
-    {
-      m = self->mapp_tab->data[alo];
-      a = m->smapsmapp_AID;
+    case opt_no_cache:
+      self->smapsfilt_cache = 0;
+      break;
+
+    case opt_jobs:
+      if( (self->smapsfilt_jobs = strtol(par, 0, 0)) < 1 )
+      {
+        msg_fatal("invalid job count: '%s'\n", par);
+      }
+      break;
 
-      analyze_get_apprange(self, alo,ahi,&blo,&bhi,a);
+    case opt_gzip:
+      self->smapsfilt_gzip = 1;
+      break;
 
-      for( size_t i = blo; i < bhi; ++i )
+    case opt_filtmode:
+      if( (self->smapsfilt_filtmode = parse_filtmode(par)) < 0 )
       {
-        m = self->mapp_tab->data[i];
-        t = m->smapsmapp_TID;
-
-        fprintf(file,
-                "<tr>\n"
-                "<th"LT"align=left>"
-                "<a href=\"app%03d.html\">%s</a>\n",
-                a, abbr_title(path_basename(self->sappl[a])));
-
-        fprintf(file, "<td align=left>%s\n", m->smapsmapp_map.type);
-        fprintf(file, "<td align=left style='font-family: monospace;'>%s\n", m->smapsmapp_map.prot);
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Size));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Rss));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Dirty));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Dirty));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Clean));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Clean));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Pss));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Swap));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Anonymous));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Locked));
+        msg_fatal("unknown mode '%s'\n", par);
       }
-    }
+      break;
 
-    fprintf(file, "</table>\n");
+    case opt_difflevel:
+      self->smapsfilt_difflevel = parse_level(par);
+      break;
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * html footer
-     * - - - - - - - - - - - - - - - - - - - */
+    case opt_trimlevel:
+      self->smapsfilt_trimlevel = parse_level(par);
+      break;
 
-    fprintf(file, "</body>\n");
-    fprintf(file, "</html>\n");
+    case opt_listen:
+      cstring_set(&self->smapsfilt_listen, par);
+      break;
 
-    fclose(file); file = 0;
-  }
-  error = 0;
-  cleanup:
+    case opt_count:
+      self->smapsfilt_count = strtol(par, 0, 0);
+      break;
 
-  if( file != 0 )
-  {
-    fclose(file);
+    case opt_server:
+      cstring_set(&self->smapsfilt_server, par);
+      break;
+
+    case opt_connect:
+      cstring_set(&self->smapsfilt_connect, par);
+      break;
+
+    case opt_select_pid:
+      if( smapsfilt_select_pids(self, par) == -1 )
+      {
+        msg_fatal("invalid pid list: '%s'\n", par);
+      }
+      break;
+
+    case opt_select_name:
+      if( smapsfilt_select_name(self, par, &error) == -1 )
+      {
+        msg_fatal("%s\n", error);
+      }
+      break;
+    default:
+      abort();
+    }
   }
 
-  return error;
+  argvec_delete(args);
+  free(error);
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_emit_app_html
+ * smapsfilt_load_input  --  load & prepare one capture file
  * ------------------------------------------------------------------------- */
 
-static const pidinfo_t *
-pidinfo_from_smapssnap(const smapssnap_t *snap, const char *sappl)
+static smapssnap_t *
+smapsfilt_load_input(smapsfilt_t *self, const char *path)
 {
-  char temp[512];
-  size_t i;
-  for (i=0; i < array_size(&snap->smapssnap_proclist); ++i)
+  int error;
+  int prepared = 0;
+  int select = (self->smapsfilt_pidcnt != 0 || self->smapsfilt_name != 0);
+
+  smapssnap_t *snap = smapssnap_create();
+
+  smapssnap_set_fields(snap, filtmode_fields(self->smapsfilt_filtmode));
+
+  if( select )
   {
-    smapsproc_t *proc = array_get(&snap->smapssnap_proclist, i);
-    if (!proc)
-      continue;
-    snprintf(temp, sizeof temp, "%s (%d)",
-             proc->smapsproc_pid.Name,
-             proc->smapsproc_pid.Pid);
-    if (strcmp(temp, sappl) == 0)
-      return &proc->smapsproc_pid;
+    error = smapssnap_load_select(snap, path, smapsfilt_select_cb, self);
+  }
+  else if( self->smapsfilt_cache )
+  {
+    error = smapssnap_load_cached(snap, path);
+    prepared = 1;
+  }
+  else
+  {
+    error = smapssnap_load_cap(snap, path);
+  }
+  if( error )
+  {
+    smapssnap_delete(snap);
+    return 0;
   }
-  return NULL;
-}
 
-static int
-local_app_lib_compare(const void *a1, const void *a2)
-{
-  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
-  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
+// QUARANTINE     smapssnap_save_cap(snap, "out1.cap");
+// QUARANTINE     smapssnap_save_csv(snap, "out1.csv");
 
-  int r;
+  if( !prepared ) smapssnap_prepare(snap);
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * primary sorting: must be AID then LID
-   * for the range searching below to work!
-   * - - - - - - - - - - - - - - - - - - - */
+// QUARANTINE     smapssnap_save_cap(snap, "out2.cap");
+// QUARANTINE     smapssnap_save_csv(snap, "out2.csv");
+// QUARANTINE     smapssnap_save_html(snap, "out2.html");
 
-  if( (r = m1->smapsmapp_AID - m2->smapsmapp_AID) != 0 ) return r;
-  if( (r = m1->smapsmapp_LID - m2->smapsmapp_LID) != 0 ) return r;
+  return snap;
+}
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * secondary sorting: convenience order
-   * - - - - - - - - - - - - - - - - - - - */
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_run_jobs  --  call func for every input on a pool of threads
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  smapsfilt_t *filt;
+  void       (*func)(smapsfilt_t *self, int index, void *data);
+  void        *data;
+  int          next;  // next input to process
+} smapsfilt_jobs_t;
 
-  if( (r = m1->smapsmapp_TID - m2->smapsmapp_TID) != 0 ) return r;
-  if( (r = m2->smapsmapp_mem.Rss - m1->smapsmapp_mem.Rss) ) return r;
+static void *
+smapsfilt_jobs_worker(void *aptr)
+{
+  smapsfilt_jobs_t *jobs  = aptr;
+  int               count = jobs->filt->smapsfilt_inputs.size;
+  int               index;
 
+  while( (index = __sync_fetch_and_add(&jobs->next, 1)) < count )
+  {
+    jobs->func(jobs->filt, index, jobs->data);
+  }
   return 0;
 }
 
-int
-analyze_emit_app_html(analyze_t *self, smapssnap_t *snap, const char *work)
+static void
+smapsfilt_run_jobs(smapsfilt_t *self,
+                   void (*func)(smapsfilt_t *self, int index, void *data),
+                   void *data)
 {
-  int error = -1;
-  char temp[512];
-  FILE *file = 0;
+  smapsfilt_jobs_t jobs  = { self, func, data, 0 };
+  int              count = self->smapsfilt_jobs;
+  int              nthreads = 0;
+  pthread_t       *tids  = 0;
+
+  if( count > self->smapsfilt_inputs.size )
+  {
+    count = self->smapsfilt_inputs.size;
+  }
 
   /* - - - - - - - - - - - - - - - - - - - *
-   * sort smaps data to bsearchable order
+   * the calling thread is one of the jobs
    * - - - - - - - - - - - - - - - - - - - */
 
-  array_sort(self->mapp_tab, local_app_lib_compare);
+  if( count > 1 )
+  {
+    tids = calloc(count - 1, sizeof *tids);
+  }
 
-  /* - - - - - - - - - - - - - - - - - - - *
-   * write html page for each application
-   * - - - - - - - - - - - - - - - - - - - */
+  while( nthreads < count - 1 )
+  {
+    if( pthread_create(&tids[nthreads], 0, smapsfilt_jobs_worker, &jobs) != 0 )
+    {
+      msg_warning("failed to start job thread: %s\n", strerror(errno));
+      break;
+    }
+    ++nthreads;
+  }
 
-  for( int a = 0; a < self->nappls; ++a )
+  smapsfilt_jobs_worker(&jobs);
+
+  while( nthreads > 0 )
   {
-    smapsmapp_t *m; int t,l;
+    pthread_join(tids[--nthreads], 0);
+  }
+  free(tids);
+}
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * open file
-     * - - - - - - - - - - - - - - - - - - - */
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_load_inputs  --  load all capture files, in given order
+ * ------------------------------------------------------------------------- */
 
-    snprintf(temp, sizeof temp, "%s/app%03d.html", work, a);
-    //printf(">> %s\n", temp);
-    if( (file = fopen(temp, "w")) == 0 )
+static void
+smapsfilt_load_job(smapsfilt_t *self, int index, void *data)
+{
+  smapssnap_t **slot = data;
+  slot[index] = smapsfilt_load_input(self, self->smapsfilt_inputs.data[index]);
+}
+
+static void
+smapsfilt_load_inputs(smapsfilt_t *self)
+{
+  smapssnap_t **slot = calloc(self->smapsfilt_inputs.size + 1, sizeof *slot);
+
+  smapsfilt_run_jobs(self, smapsfilt_load_job, slot);
+
+  for( int i = 0; i < self->smapsfilt_inputs.size; ++i )
+  {
+    if( slot[i] != 0 )
     {
-      goto cleanup;
+      array_add(&self->smapsfilt_snaplist, slot[i]);
     }
+  }
+  free(slot);
+}
 
-    analyze_html_header(file, self->sappl[a], ".");
-
-    /* - - - - - - - - - - - - - - - - - - - *
-     * summary table
-     * - - - - - - - - - - - - - - - - - - - */
+/* ========================================================================= *
+ * Streamed Captures
+ * ========================================================================= */
 
-    fprintf(file, "<h1>%s: %s</h1>\n", emit_type_titles[EMIT_TYPE_APPLICATION], self->sappl[a]);
-    analyze_emit_page_table(self, file, analyze_app_mem(self, a, 0),
-        pidinfo_from_smapssnap(snap, self->sappl[a]));
+/* ------------------------------------------------------------------------- *
+ * listen_socket  --  bind & listen unix:<path> or tcp:[host]:<port>
+ * ------------------------------------------------------------------------- */
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * library xref
-     * - - - - - - - - - - - - - - - - - - - */
+static int
+listen_socket(const char *addr)
+{
+  int fd = -1;
+  int on = 1;
 
-    fprintf(file, "<h1>%s XREF</h1>\n", "Mapping");
-    /* Sort initially by 9th column (PSS) in descending order */
-    fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[9,0]] }\">\n");
-    analyze_emit_xref_header(self, file, EMIT_TYPE_OBJECT);
-    fprintf(file, "<tbody>\n");
+  if( !strncmp(addr, "unix:", 5) )
+  {
+    struct sockaddr_un sa;
 
-    int alo,ahi, blo,bhi;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof sa.sun_path, "%s", addr + 5);
 
-    analyze_get_apprange(self, 0, self->mapp_tab->size, &alo, &ahi, a);
+    /* stale socket from previous run */
+    unlink(sa.sun_path);
 
-    for( ; alo < ahi; alo = bhi )
+    if( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 )
     {
-      m = self->mapp_tab->data[alo];
-      l = m->smapsmapp_LID;
+      if( bind(fd, (struct sockaddr *)&sa, sizeof sa) == -1 )
+      {
+        close(fd), fd = -1;
+      }
+    }
+  }
+  else if( !strncmp(addr, "tcp:", 4) )
+  {
+    struct addrinfo  hints, *res = 0, *ai;
+    char            *host = strdup(addr + 4);
+    char            *port = strrchr(host, ':');
 
-      analyze_get_librange(self, alo,ahi,&blo,&bhi,l);
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
 
-      for( size_t i = blo; i < bhi; ++i )
+    if( port != 0 )
+    {
+      *port++ = 0;
+
+      int rc = getaddrinfo(*host ? host : 0, port, &hints, &res);
+      if( rc != 0 )
       {
-        m = self->mapp_tab->data[i];
-        t = m->smapsmapp_TID;
-
-        fprintf(file,
-                "<tr>\n"
-                "<th"LT"align=left>"
-                "<a href=\"lib%03d.html\">%s</a>\n",
-                l, abbr_title(path_basename(self->spath[l])));
-
-        fprintf(file, "<td align=left>%s\n", m->smapsmapp_map.type);
-        fprintf(file, "<td align=left style='font-family: monospace;'>%s\n", m->smapsmapp_map.prot);
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Size));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Rss));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Dirty));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Dirty));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Private_Clean));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Shared_Clean));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Pss));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Swap));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Anonymous));
-        fprintf(file, "<td align=right>%s\n", uval(m->smapsmapp_mem.Locked));
+        msg_error("%s: %s\n", addr, gai_strerror(rc));
       }
     }
 
-    fprintf(file, "</table>\n");
+    for( ai = res; ai != 0; ai = ai->ai_next )
+    {
+      if( (fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) == -1 )
+      {
+        continue;
+      }
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+      if( bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 )
+      {
+        break;
+      }
+      close(fd), fd = -1;
+    }
 
-    /* - - - - - - - - - - - - - - - - - - - *
-     * html footer
-     * - - - - - - - - - - - - - - - - - - - */
+    if( res ) freeaddrinfo(res);
+    free(host);
+  }
+  else
+  {
+    msg_fatal("%s: address must be unix:<path> or tcp:[host]:<port>\n", addr);
+  }
 
-    fprintf(file, "</body>\n");
-    fprintf(file, "</html>\n");
-    fclose(file); file = 0;
+  if( fd != -1 && listen(fd, 4) == -1 )
+  {
+    close(fd), fd = -1;
   }
+  return fd;
+}
 
-  error = 0;
-  cleanup:
+/* ------------------------------------------------------------------------- *
+ * rolling_t  --  running totals over streamed captures
+ * ------------------------------------------------------------------------- */
 
-  if( file != 0 )
+typedef struct rolling_t
+{
+  int       captures;
+  unsigned  pss_prev;
+  unsigned  pss_min;
+  unsigned  pss_max;
+  double    pss_sum;
+} rolling_t;
+
+static void
+rolling_update(rolling_t *self, smapssnap_t *snap)
+{
+  meminfo_t sum;
+  int       maps = 0;
+
+  meminfo_ctor(&sum);
+
+  for( size_t i = 0; i < snap->smapssnap_proclist.size; ++i )
   {
-    fclose(file);
+    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
+
+    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    {
+      smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+      meminfo_accumulate_appdata(&sum, &mapp->smapsmapp_mem);
+      ++maps;
+    }
   }
 
-  return error;
+  if( self->captures++ == 0 )
+  {
+    self->pss_min  = self->pss_max = self->pss_prev = sum.Pss;
+  }
+  if( self->pss_min > sum.Pss ) self->pss_min = sum.Pss;
+  if( self->pss_max < sum.Pss ) self->pss_max = sum.Pss;
+  self->pss_sum += sum.Pss;
+
+  printf("%s: %zu processes, %d mappings, "
+         "Size %u kB, Rss %u kB, Pss %u kB (%+d kB), Swap %u kB; "
+         "Pss min/avg/max %u/%.0f/%u kB over %d captures\n",
+         snap->smapssnap_source,
+         snap->smapssnap_proclist.size, maps,
+         sum.Size, sum.Rss, sum.Pss, (int)(sum.Pss - self->pss_prev), sum.Swap,
+         self->pss_min, self->pss_sum / self->captures, self->pss_max,
+         self->captures);
+  fflush(stdout);
+
+  self->pss_prev = sum.Pss;
+  meminfo_dtor(&sum);
 }
 
 /* ------------------------------------------------------------------------- *
- * analyze_emit_smaps_table
+ * smapsfilt_listen_inputs  --  receive captures from sp_smaps_snapshot
  * ------------------------------------------------------------------------- */
 
-void
-analyze_emit_smaps_table(analyze_t *self, FILE *file, meminfo_t *v)
+static void
+smapsfilt_listen_inputs(smapsfilt_t *self)
 {
-  fprintf(file, "<table border=1>\n");
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Class");
-  fprintf(file, "<th"TP"colspan=2>%s\n", "Dirty");
-  fprintf(file, "<th"TP"colspan=2>%s\n", "Clean");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Resident");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Size");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Pss");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Swap");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Referenced");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Anonymous");
-  fprintf(file, "<th"TP"rowspan=2>%s\n", "Locked");
+  const char *addr = self->smapsfilt_listen;
+  int         lfd  = listen_socket(addr);
+  rolling_t   roll;
+  char       *name = 0;
 
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP">%s\n", "Private");
-  fprintf(file, "<th"TP">%s\n", "Shared");
-  fprintf(file, "<th"TP">%s\n", "Private");
-  fprintf(file, "<th"TP">%s\n", "Shared");
+  memset(&roll, 0, sizeof roll);
 
-  for( int t = 0; t < self->ntypes; ++t )
+  if( lfd == -1 )
   {
-    meminfo_t *m = &v[t];//&app_mem[a][t];
-    const char *bg = ((t/3)&1) ? D1 : D2;
-
-    fprintf(file, "<tr>\n");
-    fprintf(file, "<th"LT" align=left>%s\n", self->stype[t]);
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Private_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Shared_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Rss));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Size));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Pss));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Swap));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Referenced));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Anonymous));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(m->Locked));
+    msg_fatal("%s: %s\n", addr, strerror(errno));
   }
 
-  fprintf(file, "</table>\n");
-}
+  /* peers going away must not kill the listener */
+  signal(SIGPIPE, SIG_IGN);
 
-/* ------------------------------------------------------------------------- *
- * analyze_emit_table_header
- * ------------------------------------------------------------------------- */
+  msg_progress("listening on %s\n", addr);
 
-#define VM_COLUMN_COUNT 5
-static const char *const virtual_memory_column_titles[][VM_COLUMN_COUNT] = {
-  [EMIT_TYPE_LIBRARY] = {
-    "<abbr title=\"Largest value\"><i>RSS</i></abbr>",
-    "<abbr title=\"Largest value\"><i>Size</i></abbr>",
-    "<abbr title=\"Sum of values\">PSS</abbr> ",
-    "<abbr title=\"Largest value\"><i>Swap</i></abbr>",
-    "<abbr title=\"Sum of values\">Locked</abbr>",
-  },
-  [EMIT_TYPE_APPLICATION] = {
-    "RSS",
-    "Size",
-    "PSS ",
-    "Swap",
-    "Locked",
-  },
-};
+  /* - - - - - - - - - - - - - - - - - - - *
+   * one connection = one capture, handled
+   * in arrival order
+   * - - - - - - - - - - - - - - - - - - - */
 
-static void
-analyze_emit_table_header(const analyze_t *self, FILE *file, enum emit_type type)
-{
-  fprintf(file, "<thead>\n");
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP" rowspan=3>%s\n", emit_type_titles[type]);
-  fprintf(file, "<th"TP" colspan=4>%s\n", "RSS / Status");
-  fprintf(file, "<th"TP" rowspan=2 colspan=%d>%s\n", VM_COLUMN_COUNT, "Virtual<br>Memory");
-  if( type == EMIT_TYPE_APPLICATION )
-  {
-    fprintf(file, "<th"TP" colspan=%d>%s\n", self->ntypes-1, "RSS / Class");
-    fprintf(file, "<th"TP" colspan=%d>%s\n", self->ntypes-1, "Size / Class");
-  }
-  fprintf(file, "<tr>\n");
-  fprintf(file, "<th"TP" colspan=2>%s\n", "Dirty");
-  fprintf(file, "<th"TP" colspan=2>%s\n", "Clean");
-  if( type == EMIT_TYPE_APPLICATION )
+  while( self->smapsfilt_count == 0
+         || roll.captures < self->smapsfilt_count )
   {
-    for( int i = 1; i < self->ntypes; ++i )
+    int   fd   = accept(lfd, 0, 0);
+    FILE *file = 0;
+
+    if( fd == -1 )
     {
-      fprintf(file, "<th"TP" rowspan=2>%s\n", self->stype[i]);
+      if( errno == EINTR ) continue;
+      msg_fatal("%s: accept: %s\n", addr, strerror(errno));
     }
-    for( int i = 1; i < self->ntypes; ++i )
+
+    if( (file = smaps_gzip_fdopen(fd)) == 0 )
     {
-      fprintf(file, "<th"TP" rowspan=2>%s\n", self->stype[i]);
+      msg_error("%s: unable to set up stream\n", addr);
+      close(fd);
+      continue;
     }
+
+    smapssnap_t *snap = smapssnap_create();
+
+    smaps_xstrfmt(&name, "stream-%03d.cap", roll.captures + 1);
+    smapssnap_set_source(snap, name);
+
+    if( smapssnap_load_stream(snap, file) != 0 )
+    {
+      smapssnap_delete(snap);
+    }
+    else
+    {
+      smapssnap_prepare(snap);
+      rolling_update(&roll, snap);
+
+      if( self->smapsfilt_count != 0 )
+      {
+        array_add(&self->smapsfilt_snaplist, snap);
+      }
+      else
+      {
+        smapssnap_delete(snap);
+      }
+    }
+    fclose(file);
   }
-  fprintf(file, "<tr>\n");
-  if( type == EMIT_TYPE_LIBRARY )
-  {
-    fprintf(file, "<th"TP"><abbr title=\"Sum of values\">Private</abbr>\n");
-    fprintf(file, "<th"TP"><abbr title=\"Largest value\"><i>Shared</i></abbr>\n");
-    fprintf(file, "<th"TP"><abbr title=\"Sum of values\">Private</abbr>\n");
-    fprintf(file, "<th"TP"><abbr title=\"Largest value\"><i>Shared</i></abbr>\n");
-  }
-  else if( type == EMIT_TYPE_APPLICATION )
+
+  free(name);
+  close(lfd);
+
+  if( !strncmp(addr, "unix:", 5) )
   {
-    fprintf(file, "<th"TP">Private\n");
-    fprintf(file, "<th"TP">Shared\n");
-    fprintf(file, "<th"TP">Private\n");
-    fprintf(file, "<th"TP">Shared\n");
+    unlink(addr + 5);
   }
-  for( int i=0; i < sizeof(virtual_memory_column_titles[0])/sizeof(char *); ++i )
+}
+
+char *path_slice_extension(char *path)
+{
+  char *e = path_extension(path);
+  if( *e != 0 )
   {
-    fprintf(file, "<th"TP">%s\n", virtual_memory_column_titles[type][i]);
+    *e++ = 0;
   }
+  return e;
 }
 
-/* ------------------------------------------------------------------------- *
- * analyze_emit_process_hierarchy  --  recursively dump clickable process tree
- * ------------------------------------------------------------------------- */
-
-void
-analyze_emit_process_hierarchy(analyze_t *self, FILE *file, smapsproc_t *proc,
-                               const char *work, int recursion_depth)
+char *path_make_output(const char *def,
+                       const char *src, const char *ext)
 {
-  if( proc->smapsproc_children.size )
+  char *res = 0;
+  if( def == 0 )
   {
-    fprintf(file, "<ul id='children_of_%d' %s>\n",
-	proc->smapsproc_AID,
-	recursion_depth == 1 ? "style='display:none;'" : "");
-    for( int i = 0; i < proc->smapsproc_children.size; ++i )
-    {
-      smapsproc_t *sub = proc->smapsproc_children.data[i];
-
-      fprintf(file, "<li><a href=\"%s/app%03d.html\">%s (%d)</a>\n",
-              work,
-              sub->smapsproc_AID,
-              sub->smapsproc_pid.Name,
-              sub->smapsproc_pid.Pid);
-
-      if (recursion_depth == 0)
-      {
-	fprintf(file, "<span style=\"text-decoration: underline; "
-	    "cursor: pointer;\" "
-	    "onClick=\"toggleBlockText('children_of_%d', "
-	    "this, '(expand)','(collapse)');\">(expand)</span>\n",
-	    sub->smapsproc_AID);
-      }
+    const char *end = path_extension(src);
 
-      analyze_emit_process_hierarchy(self, file, sub, work, recursion_depth+1);
+    if( !strcmp(end, ".gz") )
+    {
+      /* foo.cap.gz -> foo<ext> */
+      char *work = strndup(src, end - src);
+      end = src + (path_extension(work) - work);
+      free(work);
     }
-    fprintf(file, "</ul>\n");
+    smaps_xstrfmt(&res, "%.*s%s", (int)(end - src), src, ext);
+  }
+  else
+  {
+    res = strdup(def);
   }
+  return res;
 }
 
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_analyze_jobs  --  threads left over for analyzing one capture
+ * ------------------------------------------------------------------------- */
+
 static int
-analyze_emit_application_table_cmp(const void *a1, const void *a2)
+smapsfilt_analyze_jobs(const smapsfilt_t *self)
 {
-  analyze_t *self = qsort_cmp_data;
-  const meminfo_t *m1 = analyze_app_mem(self, *(const int *)a1, 0);
-  const meminfo_t *m2 = analyze_app_mem(self, *(const int *)a2, 0);
+  int jobs = self->smapsfilt_jobs;
+  int busy = self->smapsfilt_inputs.size;
 
-  int r;
-  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
-  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
-  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
-  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * jobs not needed for loading inputs in
+   * parallel are shared by the analyses
+   * - - - - - - - - - - - - - - - - - - - */
 
-  return m2->Size - m1->Size;
+  if( busy < 1 || busy > jobs )
+  {
+    busy = jobs;
+  }
+  return jobs / busy;
 }
 
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_emit_snapshot  --  write per capture output of filter mode
+ * ------------------------------------------------------------------------- */
+
 static int
-analyze_emit_library_table_cmp(const void *a1, const void *a2)
+smapsfilt_emit_snapshot(smapsfilt_t *self, smapssnap_t *snap)
 {
-  analyze_t *self = qsort_cmp_data;
-  const meminfo_t *m1 = analyze_lib_mem(self, *(const int *)a1, 0);
-  const meminfo_t *m2 = analyze_lib_mem(self, *(const int *)a2, 0);
-  int r;
-  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
-  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
-  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
-  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
+  char      *dest  = 0;
+  analyze_t *az    = 0;
+  int        error = 0;
 
-  return m2->Size - m1->Size;
-}
+  switch( self->smapsfilt_filtmode )
+  {
+  case FM_FLATTEN:
+    dest = path_make_output(self->smapsfilt_output,
+                            snap->smapssnap_source,
+                            ".flat");
+    error = smapssnap_save_cap(snap, dest);
+    break;
 
-static void
-analyze_emit_table(analyze_t *self, FILE *file, const char *work, enum emit_type type)
-{
-  int omitted_lines = 0;
-  int items = 0;
-  if( type == EMIT_TYPE_LIBRARY )
-    items = self->npaths;
-  else if( type == EMIT_TYPE_APPLICATION )
-    items = self->nappls;
-  int lut[items];
+  case FM_NORMALIZE:
+    dest = path_make_output(self->smapsfilt_output,
+                            snap->smapssnap_source,
+                            ".csv");
+    error = smapssnap_save_csv(snap, dest);
+    break;
 
-  for( int i = 0; i < items; ++i )
-  {
-    lut[i] = i;
-  }
+  case FM_ANALYZE:
+    dest = path_make_output(self->smapsfilt_output,
+                            snap->smapssnap_source,
+                            ".html");
+    /* SMAPS does not provide any data for kernel threads, so remove them to
+     * reduce dummy elements from the analysis report.
+     */
+    analyze_prune_kthreads(snap);
+    az = analyze_create();
+    analyze_set_jobs(az, smapsfilt_analyze_jobs(self));
+    analyze_enumerate_data(az, snap);
+    analyze_accumulate_data(az);
+    analyze_index_data(az);
+    error = analyze_emit_main_page(az, snap, dest,
+                                   self->smapsfilt_gzip);
+    analyze_delete(az);
+    //smapssnap_save_html(snap, dest);
+    break;
 
-  qsort_cmp_data = self;
-  if( type == EMIT_TYPE_LIBRARY )
-    qsort(lut, items, sizeof *lut, analyze_emit_library_table_cmp);
-  else if( type == EMIT_TYPE_APPLICATION )
-    qsort(lut, items, sizeof *lut, analyze_emit_application_table_cmp);
+  case FM_APPVALS:
+    dest = path_make_output(self->smapsfilt_output,
+                            snap->smapssnap_source,
+                            ".apps");
+    az = analyze_create();
+    analyze_set_jobs(az, smapsfilt_analyze_jobs(self));
+    analyze_enumerate_data(az, snap);
+    analyze_accumulate_data(az);
+    error = analyze_emit_appvals(az, snap, dest);
+    analyze_delete(az);
+    break;
 
-  /* Sort initially by 7th column (PSS) in descending order */
-  fprintf(file, "<table border=1 class=\"tablesorter { sortlist: [[7,0]] }\">\n");
-  analyze_emit_table_header(self, file, type);
-  fprintf(file, "<tbody>\n");
-  for( int i = 0; i < items; ++i )
+  default:
+    msg_fatal("unimplemented mode %d\n",self->smapsfilt_filtmode);
+    break;
+  }
+
+  if( error != 0 )
   {
-    int a = lut[i];
-    const char *title = NULL;
-    const char *bg = ((i/3)&1) ? D1 : D2;
-    meminfo_t *s = analyze_mem(self, a, 0, type);
+    msg_error("%s: failed to write output\n", dest);
+  }
+  free(dest);
+  return error;
+}
 
-    /* One-page mappings are not interesting, prune them from the Object Values
-     * table.
-     */
-    if (type == EMIT_TYPE_LIBRARY && s->Size <= 4)
-    {
-      ++omitted_lines;
-      continue;
-    }
-    else if (type == EMIT_TYPE_APPLICATION && meminfo_all_zeroes(s))
-    {
-      ++omitted_lines;
-      continue;
-    }
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_write_outputs  --  write outputs for all loaded captures
+ * ------------------------------------------------------------------------- */
 
-    fprintf(file, "<tr>\n");
-    fprintf(file, "<th bgcolor=\"#bfffff\" align=left>");
+static int
+smapsfilt_write_outputs(smapsfilt_t *self)
+{
+  int error = 0;
 
-    if( type == EMIT_TYPE_LIBRARY )
-    {
-      title = path_basename(self->spath[a]);
-      fprintf(file, "<a href=\"%s/lib%03d.html\">%s</a>\n",
-          work, a, abbr_title(title));
-    }
-    else if( type == EMIT_TYPE_APPLICATION )
-    {
-      title = self->sappl[a];
-      fprintf(file, "<a href=\"%s/app%03d.html\">%s</a>\n",
-          work, a, abbr_title(title));
-    }
-    else
+  switch( self->smapsfilt_filtmode )
+  {
+  case FM_DIFF:
+    if( self->smapsfilt_output == 0 )
     {
-      abort();
+      msg_fatal("output path must be specified for diff\n");
     }
 
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Private_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Shared_Dirty));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Private_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Shared_Clean));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Rss));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Size));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Pss));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Swap));
-    fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Locked));
-
-    if (type == EMIT_TYPE_APPLICATION)
-    {
-      for( int t = 1; t < self->ntypes; ++t )
-      {
-	meminfo_t *s = analyze_mem(self, a, t, type);
-	fprintf(file, "<td %s align=right>%s\n", bg, uval(meminfo_total(s)));
-      }
-      for( int t = 1; t < self->ntypes; ++t )
-      {
-	meminfo_t *s = analyze_mem(self, a, t, type);
-	fprintf(file, "<td %s align=right>%s\n", bg, uval(s->Size));
-      }
-    }
-  }
-  fprintf(file, "</table>\n");
-  if (omitted_lines)
-  {
-    if (type == EMIT_TYPE_LIBRARY)
-    {
-      fprintf(file,
-	"<b>Note:</b> removed %d entries from the table with <i>Size</i> of "
-	"at most 4 kilobytes.\n",
-	omitted_lines);
-    }
-    else if (type == EMIT_TYPE_APPLICATION)
-    {
-      fprintf(file,
-        "<b style='color:red'>Note:</b> removed %d applications from the table "
-        "that have all entries set to zero. This may indicate that the smaps "
-        "capture is incomplete.\n",
-	omitted_lines);
-    }
-    else
-    {
-      abort();
-    }
-  }
-}
-
-/* ------------------------------------------------------------------------- *
- * analyze_emit_main_page
- * ------------------------------------------------------------------------- */
-
-static int
-file_copy(const char *src, const char *dst)
-{
-  char buf[4096];
-  int ret;
-  FILE *fin, *fout;
-  size_t got, wrote;
-  fin = NULL;
-  fout = NULL;
-  ret = -1;
-  fin = fopen(src, "r");
-  if (!fin)
-  {
-    fprintf(stderr, "ERROR: unable to open '%s' for reading: %s\n",
-        src, strerror(errno));
-    goto out;
-  }
-  fout = fopen(dst, "w");
-  if (!fout)
-  {
-    fprintf(stderr, "ERROR: unable to open '%s' for writing: %s\n",
-        dst, strerror(errno));
-    goto out;
-  }
-  while (!feof(fin))
-  {
-    if (ferror(fin) || ferror(fout))
-      goto out;
-    got = fread(buf, 1, sizeof(buf), fin);
-    while (got)
-    {
-      wrote = fwrite(buf, 1, got, fout);
-      if (ferror(fout))
-        goto out;
-      got -= wrote;
-    }
-  }
-  ret = 0;
-out:
-  if (fin)
-    fclose(fin);
-  if (fout)
-  {
-    fclose(fout);
-    if (ret < 0)
-    {
-      unlink(dst);
-    }
-  }
-  return ret;
-}
-
-static int
-copy_to_workdir(const char *workdir, const char *fn)
-{
-  char src[512];
-  char dst[512];
-  snprintf(src, sizeof(src), "/usr/share/sp-smaps-visualize/%s", fn);
-  src[sizeof(src)-1] = 0;
-  snprintf(dst, sizeof(dst), "%s/%s", workdir, fn);
-  dst[sizeof(dst)-1] = 0;
-  return file_copy(src, dst);
-}
-
-static const char *const html_resources[] =
-{
-  "jquery.metadata.js",
-  "jquery.min.js",
-  "jquery.tablesorter.js",
-  "tablesorter.css",
-  "expander.js",
-  "asc.gif",
-  "desc.gif",
-  "bg.gif",
-};
-
-static int
-create_javascript_files(const char *workdir)
-{
-  size_t i;
-  int ret;
-  for (i=0; i < sizeof(html_resources)/sizeof(*html_resources); ++i)
-  {
-    ret = copy_to_workdir(workdir, html_resources[i]);
-    if (ret < 0)
-      goto out;
-  }
-out:
-  return ret;
-}
-
-static void *
-_array_remove_elem(array_t *self, const void *elem)
-{
-  size_t i;
-  for (i=0; i < array_size(self); ++i)
-  {
-    if (array_get(self, i) == elem)
-    {
-      return array_rem(self, i);
-    }
-  }
-  return NULL;
-}
-
-static void
-analyze_prune_kthreads(smapssnap_t *snap)
-{
-  size_t i, j;
-  smapsproc_t *root = &snap->smapssnap_rootproc;
-  for (i=0; i < root->smapsproc_children.size; ++i)
-  {
-    smapsproc_t *kthreadd = array_get(&root->smapsproc_children, i);
-    if (!kthreadd)
-      continue;
-    const char *subname = kthreadd->smapsproc_pid.Name;
-    if (subname && strcmp(subname, "kthreadd") == 0)
-    {
-      const size_t kthread_cnt = array_size(&kthreadd->smapsproc_children);
-      for (j=0; j < kthread_cnt; ++j)
-      {
-	smapsproc_t *kthread = array_get(&kthreadd->smapsproc_children, j);
-	if (!kthread)
-	  continue;
-	_array_remove_elem(&snap->smapssnap_proclist, kthread);
-	smapsproc_delete(kthread);
-      }
-      array_clear(&kthreadd->smapsproc_children);
-      _array_remove_elem(&snap->smapssnap_proclist, kthreadd);
-      _array_remove_elem(&snap->smapssnap_rootproc.smapsproc_children, kthreadd);
-      smapsproc_delete(kthreadd);
-      break;
-    }
-  }
-}
-
-int
-analyze_emit_main_page(analyze_t *self, smapssnap_t *snap, const char *path)
-{
-  int       error = -1;
-  FILE     *file  = 0;
-
-  char      work[512];
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * make sure we have directory for
-   * library & application specific pages
-   * - - - - - - - - - - - - - - - - - - - */
-
-  snprintf(work, sizeof work - 4, "%s", path);
-  strcpy(path_extension(work), ".dir");
-
-  if( !path_isdir(work) )
-  {
-    if( mkdir(work, 0777) != 0 )
-    {
-      perror(work); goto cleanup;
-    }
-  }
-
-  if( create_javascript_files(work) < 0 )
-  {
-    goto cleanup;
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * open output file
-   * - - - - - - - - - - - - - - - - - - - */
-
-  if( (file = fopen(path, "w")) == 0 )
-  {
-    perror(path); goto cleanup;
-  }
-
-  analyze_html_header(file, smapssnap_get_source(snap), work);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * memory usage tables
-   * - - - - - - - - - - - - - - - - - - - */
-
-  fprintf(file, "<a href=\"#system_estimates\">System Estimates</a> | ");
-  fprintf(file, "<a href=\"#process_hierarchy\">Process Hierarchy</a> | ");
-  fprintf(file, "<a href=\"#application_values\">Application Values</a> | ");
-  fprintf(file, "<a href=\"#object_values\">Object Values</a>\n");
-
-  fprintf(file, "<a name=\"system_estimates\"><h1>System Estimates</h1></a>\n");
-
-  fprintf(file, "<h2>System: Memory Use Estimate</h2>\n");
-  analyze_emit_smaps_table(self, file, self->sysest);
-  fprintf(file, "<p>Private and Size are accurate, the rest are minimums.\n");
-
-  fprintf(file, "<h2>System: Memory Use App Totals</h2>\n");
-  analyze_emit_smaps_table(self, file, self->sysmax);
-  fprintf(file, "<p>Private is accurate, the rest are maximums.\n");
-
-  fprintf(file, "<h2>System: Memory Use App Maximums</h2>\n");
-  analyze_emit_smaps_table(self, file, self->appmax);
-  fprintf(file, "<p>No process has values larger than the ones listed above.\n");
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * process hierarchy tree
-   * - - - - - - - - - - - - - - - - - - - */
-
-  fprintf(file, "<a name=\"process_hierarchy\"><h1>Process Hierarchy</h1></a>\n");
-  analyze_emit_process_hierarchy(self, file, &snap->smapssnap_rootproc, work, 0);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * application table
-   * - - - - - - - - - - - - - - - - - - - */
-
-  fprintf(file, "<a name=\"application_values\"><h1>Application Values</h1></a>\n");
-  analyze_emit_table(self, file, work, EMIT_TYPE_APPLICATION);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * library table
-   * - - - - - - - - - - - - - - - - - - - */
-
-  fprintf(file, "<a name=\"object_values\"><h1>Object Values</h1></a>\n");
-  analyze_emit_table(self, file, work, EMIT_TYPE_LIBRARY);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * html trailer
-   * - - - - - - - - - - - - - - - - - - - */
-
-  fprintf(file, "</body>\n");
-  fprintf(file, "</html>\n");
-  fclose(file); file = 0;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * application pages
-   * - - - - - - - - - - - - - - - - - - - */
-
-  if( analyze_emit_app_html(self, snap, work) )
-  {
-    goto cleanup;
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * library pages
-   * - - - - - - - - - - - - - - - - - - - */
-
-  if( analyze_emit_lib_html(self, snap, work) )
-  {
-    goto cleanup;
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * success
-   * - - - - - - - - - - - - - - - - - - - */
-
-  error = 0;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * cleanup & return
-   * - - - - - - - - - - - - - - - - - - - */
-
-  cleanup:
-
-  if( file )
-  {
-    fclose(file);
-  }
-  return error;
-}
-
-/* ------------------------------------------------------------------------- *
- * analyze_emit_appval_table
- * ------------------------------------------------------------------------- */
-
-static int
-analyze_emit_appval_table_cmp(const void *a1, const void *a2)
-{
-  analyze_t *self = qsort_cmp_data;
-
-  typedef struct { int id; smapsproc_t *pt; } lut_t;
-  const lut_t *l1 = a1;
-  const lut_t *l2 = a2;
-
-  const meminfo_t *m1 = analyze_app_mem(self, l1->id, 0);
-  const meminfo_t *m2 = analyze_app_mem(self, l2->id, 0);
-
-  int r;
-  if( (r = m2->Pss           - m1->Pss) != 0 ) return r;
-  if( (r = m2->Private_Dirty - m1->Private_Dirty) != 0 ) return r;
-  if( (r = m2->Shared_Dirty  - m1->Shared_Dirty) != 0 ) return r;
-  if( (r = m2->Rss           - m1->Rss) != 0 ) return r;
-
-  if( (r = m2->Size - m1->Size) != 0 ) return r;
-
-  return l1->pt->smapsproc_AID - l2->pt->smapsproc_AID;
-}
-
-void
-analyze_emit_appval_table(analyze_t *self, smapssnap_t *snap, FILE *file)
-{
-  typedef struct { int id; smapsproc_t *pt; } lut_t;
-  lut_t lut[self->nappls];
-
-  for( int i = 0; i < self->nappls; ++i )
-  {
-    lut[i].id = i;
-    lut[i].pt = 0;
-  }
-
-  for( int i = 0; i < snap->smapssnap_proclist.size; ++i )
-  {
-    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
-    int a = proc->smapsproc_AID;
-    assert( 0 <= a && a < self->nappls );
-
-    assert( lut[a].id == a );
-    assert( lut[a].pt == 0 );
-    lut[a].pt = proc;
-  }
-  for( int i = 0; i < self->nappls; ++i )
-  {
-    assert( lut[i].pt != 0 );
-  }
-
-  qsort_cmp_data = self;
-  qsort(lut, self->nappls, sizeof *lut, analyze_emit_appval_table_cmp);
-
-  fprintf(file, "generator = %s %s\n", TOOL_NAME, TOOL_VERS);
-  fprintf(file, "\n");
-  fprintf(file, "name,pid,ppid,threads,pri,sha,cln,rss,size,rss,pss,swap,referenced");
-  for( int t = 1; t < self->ntypes; ++t )
-  {
-    fprintf(file, ",%s", self->stype[t]);
-  }
-  fprintf(file, "\n");
-
-  for( int i = 0; i < self->nappls; ++i )
-  {
-    int a = lut[i].id;
-    smapsproc_t *proc = lut[i].pt;
-
-    fprintf(file, "%s", proc->smapsproc_pid.Name);
-    fprintf(file, ",%d", proc->smapsproc_pid.Pid);
-    fprintf(file, ",%d", proc->smapsproc_pid.PPid);
-    fprintf(file, ",%d", proc->smapsproc_pid.Threads);
-
-    meminfo_t *s = analyze_app_mem(self, a, 0);
-
-    fprintf(file, ",%u", s->Private_Dirty);
-    fprintf(file, ",%u", s->Shared_Dirty);
-    fprintf(file, ",%u", s->Private_Clean + s->Shared_Clean);
-    fprintf(file, ",%u", s->Rss);
-    fprintf(file, ",%u", s->Size);
-    fprintf(file, ",%u", s->Pss);
-    fprintf(file, ",%u", s->Swap);
-    fprintf(file, ",%u", s->Referenced);
-
-    for( int t = 1; t < self->ntypes; ++t )
-    {
-      meminfo_t *s = analyze_app_mem(self, a, t);
-      fprintf(file, ",%u", meminfo_total(s));
-    }
-    fprintf(file, "\n");
-  }
-}
-
-/* ------------------------------------------------------------------------- *
- * analyze_emit_appvals
- * ------------------------------------------------------------------------- */
-
-int
-analyze_emit_appvals(analyze_t *self, smapssnap_t *snap, const char *path)
-{
-  int       error = -1;
-  FILE     *file  = 0;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * open output file
-   * - - - - - - - - - - - - - - - - - - - */
-
-  if( (file = fopen(path, "w")) == 0 )
-  {
-    perror(path); goto cleanup;
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * html header
-   * - - - - - - - - - - - - - - - - - - - */
-
-// QUARANTINE   fprintf(file, "<html>\n");
-// QUARANTINE   fprintf(file, "<head>\n");
-// QUARANTINE   fprintf(file, "<title>%s</title>\n", smapssnap_get_source(snap));
-// QUARANTINE   fprintf(file, "</head>\n");
-// QUARANTINE   fprintf(file, "<body>\n");
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * application table
-   * - - - - - - - - - - - - - - - - - - - */
-
-// QUARANTINE   fprintf(file, "<h1>Application Values</h1>\n");
-  analyze_emit_appval_table(self, snap, file);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * html trailer
-   * - - - - - - - - - - - - - - - - - - - */
-
-// QUARANTINE   fprintf(file, "</body>\n");
-// QUARANTINE   fprintf(file, "</html>\n");
-// QUARANTINE   fclose(file); file = 0;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * success
-   * - - - - - - - - - - - - - - - - - - - */
-
-  error = 0;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * cleanup & return
-   * - - - - - - - - - - - - - - - - - - - */
-
-  cleanup:
-
-  if( file )
-  {
-    fclose(file);
-  }
-  return error;
-}
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-
-/* ========================================================================= *
- * smapsfilt_t  --  methods
- * ========================================================================= */
-
-/* ------------------------------------------------------------------------- *
- * smapsfilt_ctor
- * ------------------------------------------------------------------------- */
-
-void
-smapsfilt_ctor(smapsfilt_t *self)
-{
-  self->smapsfilt_filtmode  = FM_ANALYZE;
-  self->smapsfilt_difflevel = -1;
-  self->smapsfilt_trimlevel = 0;
-
-  self->smapsfilt_output = 0;
-  str_array_ctor(&self->smapsfilt_inputs);
-  array_ctor(&self->smapsfilt_snaplist, smapssnap_delete_cb);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsfilt_dtor
- * ------------------------------------------------------------------------- */
-
-void
-smapsfilt_dtor(smapsfilt_t *self)
-{
-  str_array_dtor(&self->smapsfilt_inputs);
-  array_dtor(&self->smapsfilt_snaplist);
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsfilt_create
- * ------------------------------------------------------------------------- */
-
-smapsfilt_t *
-smapsfilt_create(void)
-{
-  smapsfilt_t *self = calloc(1, sizeof *self);
-  smapsfilt_ctor(self);
-  return self;
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsfilt_delete
- * ------------------------------------------------------------------------- */
-
-void
-smapsfilt_delete(smapsfilt_t *self)
-{
-  if( self != 0 )
-  {
-    smapsfilt_dtor(self);
-    free(self);
-  }
-}
-
-/* ------------------------------------------------------------------------- *
- * smapsfilt_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-smapsfilt_delete_cb(void *self)
-{
-  smapsfilt_delete(self);
-}
-
-typedef struct diffkey_t diffkey_t;
-typedef struct diffval_t diffval_t;
-
-/* ------------------------------------------------------------------------- *
- * diffval_t
- * ------------------------------------------------------------------------- */
-
-struct diffval_t
-{
-  double pri;
-  double sha;
-  double cln;
-};
-
-/* ------------------------------------------------------------------------- *
- * diffkey_t
- * ------------------------------------------------------------------------- */
-
-struct diffkey_t
-{
-  int       appl;
-  int       inst;
-  int       type;
-  int       path;
-  int       cnt;
-
-  //diffval_t val[0];
-};
-
-/* ========================================================================= *
- * diffval_t  --  methods
- * ========================================================================= */
-
-/* ------------------------------------------------------------------------- *
- * diffval_ctor
- * ------------------------------------------------------------------------- */
-
-void
-diffval_ctor(diffval_t *self)
-{
-  self->pri = 0;
-  self->sha = 0;
-  self->cln = 0;
-}
-
-/* ------------------------------------------------------------------------- *
- * diffval_dtor
- * ------------------------------------------------------------------------- */
-
-void
-diffval_dtor(diffval_t *self)
-{
-}
-
-/* ------------------------------------------------------------------------- *
- * diffval_add
- * ------------------------------------------------------------------------- */
-
-void
-diffval_add(diffval_t *self, const diffval_t *that)
-{
-  self->pri += that->pri;
-  self->sha += that->sha;
-  self->cln += that->cln;
-}
-
-/* ========================================================================= *
- * diffkey_t  --  methods
- * ========================================================================= */
-
-INLINE diffval_t *diffkey_val(diffkey_t *self, int cap)
-{
-  assert( 0 <= cap && cap < self->cnt );
-  return &((diffval_t *)(self+1))[cap];
-
-}
-
-INLINE int diffkey_compare(const diffkey_t *k1, const diffkey_t *k2)
-{
-  int r = 0;
-  if( (r = k1->appl - k2->appl) ) return r;
-  if( (r = k1->inst - k2->inst) ) return r;
-  if( (r = k1->type - k2->type) ) return r;
-  if( (r = k1->path - k2->path) ) return r;
-  return 0;
-}
-
-double diffkey_rank(diffkey_t *self, diffval_t *res)
-{
-  double pri = 0, sha = 0, cln = 0;
-
-  for( int i = 0; i < self->cnt; ++i )
-  {
-    diffval_t *val = diffkey_val(self, i);
-    pri += val->pri;
-    sha += val->sha;
-    cln += val->cln;
-  }
-
-  pri /= self->cnt;
-  sha /= self->cnt;
-  cln /= self->cnt;
-
-  res->pri = 0;
-  res->sha = 0;
-  res->cln = 0;
-
-  for( int i = 0; i < self->cnt; ++i )
-  {
-    diffval_t *val = diffkey_val(self, i);
-    res->pri += pow2(val->pri - pri);
-    res->sha += pow2(val->sha - sha);
-    res->cln += pow2(val->cln - cln);
-  }
-
-  res->pri = sqrt(res->pri / self->cnt);
-  res->sha = sqrt(res->sha / self->cnt);
-  res->cln = sqrt(res->cln / self->cnt);
-
-  return fmax3(res->pri, res->sha, res->cln);
-}
-
-/* ------------------------------------------------------------------------- *
- * diffkey_create
- * ------------------------------------------------------------------------- */
-
-diffkey_t *
-diffkey_create(const diffkey_t *templ)
-{
-  size_t     size = sizeof(diffkey_t) + templ->cnt * sizeof(diffval_t);
-  diffkey_t *self = calloc(1, size);
-
-  *self = *templ;
-
-// QUARANTINE   self->appl = -1;
-// QUARANTINE   self->inst = -1;
-// QUARANTINE   self->type = -1;
-// QUARANTINE   self->path = -1;
-// QUARANTINE   self->cnt = ncaps;
-
-  for( int i = 0; i < self->cnt; ++i )
-  {
-    diffval_ctor(diffkey_val(self, i));
-  }
-  return self;
-}
-
-/* ------------------------------------------------------------------------- *
- * diffkey_delete
- * ------------------------------------------------------------------------- */
-
-void
-diffkey_delete(diffkey_t *self)
-{
-  if( self != 0 )
-  {
-    for( int i = 0; i < self->cnt; ++i )
-    {
-      diffval_dtor(diffkey_val(self, i));
-    }
-    free(self);
-  }
-}
-
-/* ------------------------------------------------------------------------- *
- * diffkey_delete_cb
- * ------------------------------------------------------------------------- */
-
-void
-diffkey_delete_cb(void *self)
-{
-  diffkey_delete(self);
-}
-
-/* - - - - - - - - - - - - - - - - - - - *
- * sort operator for process data
- * - - - - - - - - - - - - - - - - - - - */
-
-static int
-cmp_app_pid(const void *a1, const void *a2)
-{
-  const smapsproc_t *p1 = *(const smapsproc_t **)a1;
-  const smapsproc_t *p2 = *(const smapsproc_t **)a2;
-  int r;
-  if( (r = p1->smapsproc_AID - p2->smapsproc_AID) != 0 ) return r;
-  if( (r = p1->smapsproc_PID - p2->smapsproc_PID) != 0 ) return r;
-  return 0;
-}
-
-static void
-diff_ins(const diffkey_t *key, const diffval_t *val, int cap,
-         int diff_cnt, int diff_max, diffkey_t **diff_tab)
-{
-  for( int lo = 0, hi = diff_cnt;; )
-  {
-    if( lo == hi )
-    {
-      if( diff_cnt == diff_max )
-      {
-        diff_tab = realloc(diff_tab, (diff_max *= 2) * sizeof *diff_tab);
-      }
-      memmove(&diff_tab[lo+1], &diff_tab[lo+0],
-              (diff_cnt - lo) * sizeof *diff_tab);
-      diff_cnt += 1;
-      diff_tab[lo] = diffkey_create(key);
-      diffval_add(diffkey_val(diff_tab[lo],cap), val);
-      break;
-    }
-    int i = (lo + hi) / 2;
-    int r = diffkey_compare(diff_tab[i], key);
-    if( r < 0 ) { lo = i + 1; continue; }
-    if( r > 0 ) { hi = i + 0; continue; }
-    diffval_add(diffkey_val(diff_tab[i],cap), val);
-    break;
-  }
-}
-
-static void
-diff_emit_entry(diffkey_t *k, const char *name,
-                double rank, const double *data,
-                char ***out_row, int *out_cnt, int out_dta,
-                const char **appl_str, const char **type_str,
-                const char **path_str)
-{
-  char **out = calloc(out_dta, sizeof *out);
-  if( k->appl >= 0 ) xstrfmt(&out[0], "%s", appl_str[k->appl]);
-  if( k->inst >= 0 ) xstrfmt(&out[1], "%d", k->inst);
-  if( k->type >= 0 ) xstrfmt(&out[2], "%s", type_str[k->type]);
-  if( k->path >= 0 ) xstrfmt(&out[3], "%s", path_str[k->path]);
-  xstrfmt(&out[4],"%s", name);
-  for( int j = 0; j < k->cnt; ++j )
-  {
-    xstrfmt(&out[5+j], "%g", data[j]);
-  }
-  xstrfmt(&out[5+k->cnt], "%.1f\n", rank);
-  out_row[*out_cnt++] = out;
-}
-
-int
-smapsfilt_diff(smapsfilt_t *self, const char *path,
-               int diff_lev, int html_diff, int trim_cols)
-{
-  int error = -1;
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * difference data handling
-   * - - - - - - - - - - - - - - - - - - - */
-
-  int         diff_cnt = 0;
-  int         diff_max = 256;
-  diffkey_t **diff_tab = calloc(diff_max, sizeof *diff_tab);
-
-  symtab_t *appl_tab = symtab_create();
-  symtab_t *type_tab = symtab_create();
-  symtab_t *path_tab = symtab_create();
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * initialize symbol tables
-   * - - - - - - - - - - - - - - - - - - - */
-
-  symtab_enumerate(type_tab, "code");
-  symtab_enumerate(type_tab, "data");
-  symtab_enumerate(type_tab, "heap");
-  symtab_enumerate(type_tab, "anon");
-  symtab_enumerate(type_tab, "stack");
-
-  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-  {
-    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-
-    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
-    {
-      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
-      symtab_enumerate(appl_tab, proc->smapsproc_pid.Name);
-
-      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
-      {
-        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
-        symtab_enumerate(path_tab, mapp->smapsmapp_map.path);
-      }
-    }
-  }
-  symtab_renum(appl_tab);
-  symtab_renum(path_tab);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * enumerate data, normalize pids to
-   * application instances while at it
-   * - - - - - - - - - - - - - - - - - - - */
-
-  #define P(x) fprintf(stderr, "%s: %g\n", #x, (double)(x));
-
-  int inst_cnt = 0;
-
-  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-  {
-    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-
-// QUARANTINE     P(snap->smapssnap_proclist.size);
-
-    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
-    {
-      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
-      proc->smapsproc_PID = proc->smapsproc_pid.Pid;
-      proc->smapsproc_AID = symtab_enumerate(appl_tab,
-                                             proc->smapsproc_pid.Name);
-    }
-
-    array_sort(&snap->smapssnap_proclist, cmp_app_pid);
-
-    int aid = -1, pid = -1, cnt = 0;
-    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
-    {
-      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
-      if( aid != proc->smapsproc_AID )
-      {
-        aid = proc->smapsproc_AID, pid = proc->smapsproc_PID, cnt = 0;
-      }
-      else if( pid != proc->smapsproc_PID )
-      {
-        pid = proc->smapsproc_PID, ++cnt;
-        if( inst_cnt < cnt ) inst_cnt = cnt;
-      }
-      proc->smapsproc_PID = cnt;
-      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
-      {
-        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
-        mapp->smapsmapp_AID = proc->smapsproc_AID;
-        mapp->smapsmapp_PID = proc->smapsproc_PID;
-        mapp->smapsmapp_TID = symtab_enumerate(type_tab,
-                                               mapp->smapsmapp_map.type);
-        mapp->smapsmapp_LID = symtab_enumerate(path_tab,
-                                               mapp->smapsmapp_map.path);
-      }
-    }
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * reverse lookup tables
-   * - - - - - - - - - - - - - - - - - - - */
-
-  int appl_cnt = appl_tab->symtab_count;
-  int type_cnt = type_tab->symtab_count;
-  int path_cnt = path_tab->symtab_count;
-
-  const char *appl_str[appl_cnt];
-  const char *type_str[type_cnt];
-  const char *path_str[path_cnt];
-
-  for( int i = 0; i < appl_cnt; ++i )
-  {
-    //appl_str[i] = appl_tab->symtab_entry[i].symbol_key;
-
-    symbol_t *s = &appl_tab->symtab_entry[i];
-    appl_str[s->symbol_val] = s->symbol_key;
-  }
-  for( int i = 0; i < type_cnt; ++i )
-  {
-    //type_str[i] = type_tab->symtab_entry[i].symbol_key;
-    symbol_t *s = &type_tab->symtab_entry[i];
-    type_str[s->symbol_val] = s->symbol_key;
-  }
-  for( int i = 0; i < path_cnt; ++i )
-  {
-    //path_str[i] = path_tab->symtab_entry[i].symbol_key;
-    symbol_t *s = &path_tab->symtab_entry[i];
-    path_str[s->symbol_val] = s->symbol_key;
-  }
-
-// QUARANTINE   P(appl_cnt);
-// QUARANTINE   P(inst_cnt);
-// QUARANTINE   P(type_cnt);
-// QUARANTINE   P(path_cnt);
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * accumulate stats
-   * - - - - - - - - - - - - - - - - - - - */
-
-  diffkey_t key;
-  diffval_t val;
-
-  key.appl = -1;
-  key.inst = -1;
-  key.type = -1;
-  key.path = -1;
-  key.cnt  = self->smapsfilt_snaplist.size;
-
-  for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-  {
-    smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-    for( int k = 0; k < snap->smapssnap_proclist.size; ++k )
-    {
-      smapsproc_t *proc = snap->smapssnap_proclist.data[k];
-      for( int j = 0; j < proc->smapsproc_mapplist.size; ++j )
-      {
-        smapsmapp_t *mapp = proc->smapsproc_mapplist.data[j];
-
-        switch( diff_lev )
-        {
-        default:
-        case 4: key.path = mapp->smapsmapp_LID;
-        case 3: key.type = mapp->smapsmapp_TID;
-        case 2: key.inst = mapp->smapsmapp_PID;
-        case 1: key.appl = mapp->smapsmapp_AID;
-        case 0: break;
-        }
-        val.pri = mapp->smapsmapp_mem.Private_Dirty;
-        val.sha = mapp->smapsmapp_mem.Shared_Dirty;
-        val.cln = (mapp->smapsmapp_mem.Shared_Clean +
-                   mapp->smapsmapp_mem.Private_Clean);
-        diff_ins(&key, &val, i, diff_cnt, diff_max, diff_tab);
-      }
-    }
-  }
-
-  /* - - - - - - - - - - - - - - - - - - - *
-   * output results
-   * - - - - - - - - - - - - - - - - - - - */
-
-  double min_rank = 4;
-
-  FILE *file = 0;
-
-  char ***out_row = calloc(diff_cnt * 3, sizeof *out_row);
-  int    out_cnt = 0;
-  int    out_dta = 4 + 1 + self->smapsfilt_snaplist.size + 1;
-
-  if( trim_cols > 4 ) trim_cols = 4;
-
-  if( (file = fopen(path, "w")) == 0 )
-  {
-    perror(path); goto cleanup;
-  }
-
-  for( size_t i = 0; i < diff_cnt; ++i )
-  {
-    diffkey_t *k = diff_tab[i];
-    if( diffkey_rank(k, &val) >= min_rank )
-    {
-      double d[k->cnt];
-      if( val.pri >= min_rank )
-      {
-        for( int j = 0; j < k->cnt; ++j ) {
-          d[j] = diffkey_val(k, j)->pri;
-        }
-	diff_emit_entry(k, "pri", val.pri, d, out_row, &out_cnt, out_dta,
-                        appl_str, type_str, path_str);
-      }
-      if( val.sha >= min_rank )
-      {
-        for( int j = 0; j < k->cnt; ++j ) {
-          d[j] = diffkey_val(k, j)->sha;
-        }
-	diff_emit_entry(k, "sha", val.sha, d, out_row, &out_cnt, out_dta,
-                        appl_str, type_str, path_str);
-      }
-      if( val.cln >= min_rank )
-      {
-        for( int j = 0; j < k->cnt; ++j ) {
-          d[j] = diffkey_val(k, j)->cln;
-        }
-	diff_emit_entry(k, "cln", val.cln, d, out_row, &out_cnt, out_dta,
-                        appl_str, type_str, path_str);
-      }
-    }
-    diffkey_delete(diff_tab[i]);
-  }
-
-  /* diff_emit_table(): */
-  {
-    if( trim_cols > 0 )
-    {
-      int N[out_cnt];
-      for( int i = 1; i < out_cnt; ++i )
-      {
-        N[i] = 0;
-        for( int k = 0; k <= trim_cols; ++k )
-        {
-          N[i] = k;
-          if( out_row[i-0][k] == 0 ) break;
-          if( out_row[i-1][k] == 0 ) break;
-          if( strcmp(out_row[i-0][k], out_row[i-1][k]) ) break;
-        }
-      }
-      for( int i = 1; i < out_cnt; ++i )
-      {
-        for( int k = 0; k < N[i]; ++k )
-        {
-          if( html_diff )
-          {
-            free(out_row[i][k]);
-            out_row[i][k] = 0;
-          }
-          else
-          {
-            out_row[i][k][0] = 0;
-          }
-        }
-      }
-    }
-
-    if( html_diff )
-    {
-      /* - - - - - - - - - - - - - - - - - - - *
-       * header
-       * - - - - - - - - - - - - - - - - - - - */
-
-      fprintf(file,
-              "<html><head><title>SMAPS DIFF</title></head><body>\n"
-              "<h1>SMAPS DIFF</h1>\n"
-              "<p>\n");
-
-      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-      {
-        smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-        fprintf(file, "CAP%d = %s<br>\n", i+1, snap->smapssnap_source);
-      }
-
-      fprintf(file,
-              "<table border=1>\n"
-              "<tr>\n");
-
-      if( diff_lev >= 1 ) fprintf(file, "<th>Cmd");
-      if( diff_lev >= 2 ) fprintf(file, "<th>Pid");
-      if( diff_lev >= 3 ) fprintf(file, "<th>Type");
-      if( diff_lev >= 4 ) fprintf(file, "<th>Path");
-      fprintf(file, "<th>Value");
-      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-      {
-        fprintf(file, "<th>CAP%d", i+1);
-      }
-      fprintf(file, "<th>RANK\n");
-
-      /* - - - - - - - - - - - - - - - - - - - *
-       * table data
-       * - - - - - - - - - - - - - - - - - - - */
-
-      for( int i = 0; i < out_cnt; ++i )
-      {
-        fprintf(file, "<tr>\n");
-        for( int k = 0; k < out_dta; ++k )
-        {
-          if( out_row[i][k] != 0 )
-          {
-            int j;
-            int r = (k == 1) || (k >= 5);
-            for( j = i+1; j < out_cnt; ++j )
-            {
-              if( out_row[j][k] ) break;
-            }
-            if( (j -= i) > 1 )
-            {
-              fprintf(file, "<td%s valign=top rowspan=%d>%s",
-                      r ? " align=right" : "", j, out_row[i][k]);
-            }
-            else
-            {
-              fprintf(file, "<td%s>%s",
-                      r ? " align=right" : "", out_row[i][k]);
-            }
-          }
-        }
-      }
-
-      /* - - - - - - - - - - - - - - - - - - - *
-       * trailer
-       * - - - - - - - - - - - - - - - - - - - */
-
-      fprintf(file,
-              "</table>\n"
-              "</body>\n"
-              "</html>\n");
+    if( self->smapsfilt_snaplist.size < 2 )
+    {
+      msg_warning("diffing less than two captures is pretty meaningless\n");
     }
-    else
+
     {
-      /* - - - - - - - - - - - - - - - - - - - *
-       * header
-       * - - - - - - - - - - - - - - - - - - - */
+      char *work = strdup(self->smapsfilt_output);
+      char *ext  = path_slice_extension(work);
+      int   html = !strcmp(ext, "html");
 
-      fprintf(file, "generator = %s %s\n", TOOL_NAME, TOOL_VERS);
-      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-      {
-        smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-        fprintf(file, "CAP%d = %s\n", i+1, snap->smapssnap_source);
-      }
-      fprintf(file, "\n");
+      int   level = self->smapsfilt_difflevel;
+      int   trim  = self->smapsfilt_trimlevel;
 
-      if( diff_lev >= 1 ) fprintf(file, "Cmd,");
-      if( diff_lev >= 2 ) fprintf(file, "Pid,");
-      if( diff_lev >= 3 ) fprintf(file, "Type,");
-      if( diff_lev >= 4 ) fprintf(file, "Path,");
-      fprintf(file, "Value,");
-      for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+      if( level < 0 )
       {
-        fprintf(file, "CAP%d,", i+1);
+        level = parse_level(path_slice_extension(work));
       }
-      fprintf(file, "RANK\n");
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * table
-       * - - - - - - - - - - - - - - - - - - - */
+      error = smapsfilt_diff(self, self->smapsfilt_output, level, html, trim);
 
-      for( int i = 0; i < out_cnt; ++i )
+      free(work);
+    }
+    break;
+
+  case FM_FLATTEN:
+  case FM_NORMALIZE:
+  case FM_ANALYZE:
+  case FM_APPVALS:
+    if( self->smapsfilt_output != 0 && self->smapsfilt_snaplist.size != 1 )
+    {
+      msg_fatal("forcing output path allowed with one source file only!\n");
+    }
+
+    for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+    {
+      if( smapsfilt_emit_snapshot(self, self->smapsfilt_snaplist.data[i]) )
       {
-        for( int n=0, k = 0; k < out_dta; ++k )
-        {
-          if( out_row[i][k] != 0 )
-          {
-            fprintf(file, "%s%s", n++ ? "," : "", out_row[i][k]);
-          }
-        }
+        error = -1;
       }
+    }
+    break;
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * trailer
-       * - - - - - - - - - - - - - - - - - - - */
+  default:
+    msg_fatal("unimplemented mode %d\n",self->smapsfilt_filtmode);
+    break;
+  }
+  return error;
+}
 
-      fprintf(file, "\n");
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_process_inputs  --  load & write capture files in parallel
+ * ------------------------------------------------------------------------- */
+
+static void
+smapsfilt_process_job(smapsfilt_t *self, int index, void *data)
+{
+  int         *failed = data;
+  smapssnap_t *snap   = smapsfilt_load_input(self,
+                                             self->smapsfilt_inputs.data[index]);
+  if( snap == 0 )
+  {
+    __sync_fetch_and_add(failed, 1);
+  }
+  else
+  {
+    if( smapsfilt_emit_snapshot(self, snap) != 0 )
+    {
+      __sync_fetch_and_add(failed, 1);
     }
+    smapssnap_delete(snap);
   }
+}
 
-  error = 0;
+static int
+smapsfilt_process_inputs(smapsfilt_t *self)
+{
+  int failed = 0;
 
-  cleanup:
+  /* - - - - - - - - - - - - - - - - - - - *
+   * diff needs all captures at once, the
+   * other modes handle them one by one
+   * - - - - - - - - - - - - - - - - - - - */
 
-  symtab_delete(appl_tab);
-  symtab_delete(type_tab);
-  symtab_delete(path_tab);
-  free(diff_tab);
+  if( self->smapsfilt_filtmode == FM_DIFF )
+  {
+    smapsfilt_load_inputs(self);
+    return smapsfilt_write_outputs(self);
+  }
 
-  if( file != 0 ) fclose(file);
+  if( self->smapsfilt_output != 0 && self->smapsfilt_inputs.size != 1 )
+  {
+    msg_fatal("forcing output path allowed with one source file only!\n");
+  }
 
-  return error;
+  smapsfilt_run_jobs(self, smapsfilt_process_job, &failed);
+
+  return failed ? -1 : 0;
 }
 
+/* ========================================================================= *
+ * Resident Server
+ * ========================================================================= */
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * One request per connection, as lines:
+ *
+ *   directory <working directory>
+ *   mode <filter mode>
+ *   output <destination path>
+ *   difflevel <level>
+ *   trimlevel <level>
+ *   input <source path>
+ *
+ * terminated either by "run", or by
+ * "stream" followed by capture data up
+ * to the end of the connection.
+ *
+ * The reply is "ok" or "error <text>".
+ *
+ * The server changes to the requested
+ * directory so that relative paths end
+ * up in the reports exactly as given,
+ * and returns to its own directory once
+ * the request is done.
+ * - - - - - - - - - - - - - - - - - - - */
+
+/* interned strings are dropped between requests once the pool has grown
+ * to SERVE_INTERN_SPAN times its size after the first request on a fresh
+ * pool, but never below SERVE_INTERN_MIN strings */
+#define SERVE_INTERN_SPAN 4
+#define SERVE_INTERN_MIN  (1u<<16)
+
 /* ------------------------------------------------------------------------- *
- * smapsfilt_handle_arguments
+ * connect_socket  --  connect to unix:<path> or tcp:<host>:<port>
  * ------------------------------------------------------------------------- */
 
-int parse_level(const char *text)
+static int
+connect_socket(const char *addr)
 {
-  int level = 2;
+  int fd = -1;
 
-  if( !strcmp(text, "sys") )
-  {
-    level = 0;
-  }
-  else if( !strcmp(text, "app") )
+  if( !strncmp(addr, "unix:", 5) )
   {
-    level = 1;
+    struct sockaddr_un sa;
+
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof sa.sun_path, "%s", addr + 5);
+
+    if( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 )
+    {
+      if( connect(fd, (struct sockaddr *)&sa, sizeof sa) == -1 )
+      {
+        close(fd), fd = -1;
+      }
+    }
   }
-  else if( !strcmp(text, "pid") )
+  else if( !strncmp(addr, "tcp:", 4) )
   {
-    level = 2;
+    struct addrinfo  hints, *res = 0, *ai;
+    char            *host = strdup(addr + 4);
+    char            *port = strrchr(host, ':');
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if( port != 0 )
+    {
+      *port++ = 0;
+
+      int rc = getaddrinfo(*host ? host : 0, port, &hints, &res);
+      if( rc != 0 )
+      {
+        msg_error("%s: %s\n", addr, gai_strerror(rc));
+      }
+    }
+
+    for( ai = res; ai != 0; ai = ai->ai_next )
+    {
+      if( (fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) == -1 )
+      {
+        continue;
+      }
+      if( connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 )
+      {
+        break;
+      }
+      close(fd), fd = -1;
+    }
+
+    if( res ) freeaddrinfo(res);
+    free(host);
   }
-  else if( !strcmp(text, "sec") )
+  else
   {
-    level = 3;
+    msg_fatal("%s: address must be unix:<path> or tcp:[host]:<port>\n", addr);
   }
-  else if( !strcmp(text, "obj") )
+  return fd;
+}
+
+/* ------------------------------------------------------------------------- *
+ * socket_write  --  write all of buffer, retrying on partial writes
+ * ------------------------------------------------------------------------- */
+
+static int
+socket_write(int fd, const void *data, size_t size)
+{
+  const char *pos = data;
+
+  while( size > 0 )
   {
-    level = 4;
+    ssize_t n = write(fd, pos, size);
+    if( n == -1 )
+    {
+      if( errno == EINTR ) continue;
+      return -1;
+    }
+    pos += n, size -= n;
   }
-  else
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * socket_read_line  --  read request line without reading past it
+ * ------------------------------------------------------------------------- */
+
+static int
+socket_read_line(int fd, char *buff, size_t size)
+{
+  size_t used = 0;
+
+  for( ;; )
   {
-    char *e = 0;
-    int   n = strtol(text, &e, 0);
-    if( e > text && *e == 0 )
+    char    ch;
+    ssize_t n = read(fd, &ch, 1);
+
+    if( n == -1 && errno == EINTR ) continue;
+
+    if( n <= 0 )
     {
-      level = n;
+      if( used == 0 ) return -1;
+      break;
+    }
+    if( ch == '\n' )
+    {
+      break;
+    }
+    if( used + 1 < size )
+    {
+      buff[used++] = ch;
     }
   }
-
-  return level;
+  buff[used] = 0;
+  return used;
 }
 
-static void
-smapsfilt_handle_arguments(smapsfilt_t *self, int ac, char **av)
+/* ------------------------------------------------------------------------- *
+ * socket_peer_trusted  --  check that the client runs as us or as root
+ * ------------------------------------------------------------------------- */
+
+static int
+socket_peer_trusted(int fd)
 {
-  argvec_t *args = argvec_create(ac, av, app_opt, app_man);
-  const char *name = basename(av[0]);
+  struct ucred cred;
+  socklen_t    size = sizeof cred;
 
-  if (!strcmp(name, "sp_smaps_flatten")) {
-	  self->smapsfilt_filtmode = FM_FLATTEN;
-  } else if (!strcmp(name, "sp_smaps_normalize")) {
-	  self->smapsfilt_filtmode = FM_NORMALIZE;
-  } else if (!strcmp(name, "sp_smaps_analyze")) {
-	  self->smapsfilt_filtmode = FM_ANALYZE;
-  } else if (!strcmp(name, "sp_smaps_appvals")) {
-	  self->smapsfilt_filtmode = FM_APPVALS;
-  } else if (!strcmp(name, "sp_smaps_diff")) {
-	  self->smapsfilt_filtmode = FM_DIFF;
-  }
-  
-  while( !argvec_done(args) )
+  if( getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) == -1 )
   {
-    int       tag  = 0;
-    char     *par  = 0;
+    return 0;
+  }
+  return cred.uid == geteuid() || cred.uid == 0;
+}
 
-    if( !argvec_next(args, &tag, &par) )
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_serve_request  --  parse, validate and execute one request
+ * ------------------------------------------------------------------------- */
+
+static char *
+smapsfilt_serve_request(int fd, int serial)
+{
+  smapsfilt_t *req    = smapsfilt_create();
+  char        *error  = 0;
+  char        *name   = 0;
+  FILE        *file   = 0;
+  int          stream = 0;
+  int          inputs = 0;
+  char         line[4096];
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * parse request
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( ;; )
+  {
+    if( socket_read_line(fd, line, sizeof line) == -1 )
     {
-      msg_error("(use --help for usage)\n");
-      exit(1);
+      smaps_xstrfmt(&error, "incomplete request");
+      goto cleanup;
     }
 
-    switch( tag )
+    char *arg = line + strcspn(line, " ");
+    if( *arg != 0 ) *arg++ = 0;
+
+    if( !strcmp(line, "run") )
+    {
+      break;
+    }
+    else if( !strcmp(line, "stream") )
+    {
+      stream = 1;
+      break;
+    }
+    else if( !strcmp(line, "directory") )
+    {
+      if( chdir(arg) == -1 )
+      {
+        smaps_xstrfmt(&error, "%s: %s", arg, strerror(errno));
+        goto cleanup;
+      }
+    }
+    else if( !strcmp(line, "mode") )
+    {
+      if( (req->smapsfilt_filtmode = parse_filtmode(arg)) < 0 )
+      {
+        smaps_xstrfmt(&error, "unknown mode '%s'", arg);
+        goto cleanup;
+      }
+    }
+    else if( !strcmp(line, "input") )
+    {
+      str_array_add(&req->smapsfilt_inputs, arg);
+    }
+    else if( !strcmp(line, "output") )
+    {
+      cstring_set(&req->smapsfilt_output, arg);
+    }
+    else if( !strcmp(line, "difflevel") )
+    {
+      req->smapsfilt_difflevel = parse_level(arg);
+    }
+    else if( !strcmp(line, "trimlevel") )
+    {
+      req->smapsfilt_trimlevel = parse_level(arg);
+    }
+    else if( !strcmp(line, "nocache") )
+    {
+      req->smapsfilt_cache = 0;
+    }
+    else if( !strcmp(line, "gzip") )
+    {
+      req->smapsfilt_gzip = 1;
+    }
+    else if( !strcmp(line, "pid") )
+    {
+      if( smapsfilt_select_pids(req, arg) == -1 )
+      {
+        smaps_xstrfmt(&error, "invalid pid list: '%s'", arg);
+        goto cleanup;
+      }
+    }
+    else if( !strcmp(line, "name") )
+    {
+      if( smapsfilt_select_name(req, arg, &error) == -1 )
+      {
+        goto cleanup;
+      }
+    }
+    else
     {
-    case opt_help:
-      argvec_usage(args);
-      exit(EXIT_SUCCESS);
-
-    case opt_vers:
-      printf("%s\n", TOOL_VERS);
-      exit(EXIT_SUCCESS);
-
-    case opt_verbose:
-      msg_incverbosity();
-      break;
+      smaps_xstrfmt(&error, "unknown request '%s'", line);
+      goto cleanup;
+    }
+  }
 
-    case opt_quiet:
-      msg_decverbosity();
-      break;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * reject what would make the output
+   * stage exit the whole server
+   * - - - - - - - - - - - - - - - - - - - */
 
-    case opt_silent:
-      msg_setsilent();
-      break;
+  inputs = req->smapsfilt_inputs.size + stream;
 
-    case opt_input:
-    case opt_noswitch:
-      str_array_add(&self->smapsfilt_inputs, par);
-      break;
+  if( inputs == 0 )
+  {
+    smaps_xstrfmt(&error, "no captures given");
+    goto cleanup;
+  }
 
-    case opt_output:
-      cstring_set(&self->smapsfilt_output, par);
-      break;
+  if( req->smapsfilt_filtmode == FM_DIFF )
+  {
+    if( req->smapsfilt_output == 0 )
+    {
+      smaps_xstrfmt(&error, "output path must be specified for diff");
+      goto cleanup;
+    }
+  }
+  else if( req->smapsfilt_output != 0 && inputs != 1 )
+  {
+    smaps_xstrfmt(&error,
+                  "forcing output path allowed with one source file only");
+    goto cleanup;
+  }
+  else if( req->smapsfilt_output == 0 && stream )
+  {
+    smaps_xstrfmt(&error, "output path must be specified for streamed capture");
+    goto cleanup;
+  }
 
-    case opt_filtmode:
-      {
-        static const struct
-        {
-          const char *name; int mode;
-        } lut[] =
-        {
-          {"flatten",   FM_FLATTEN },
-          {"normalize", FM_NORMALIZE },
-          {"analyze",   FM_ANALYZE },
-          {"appvals",   FM_APPVALS },
-          {"diff",      FM_DIFF },
-        };
-        for( int i = 0; ; ++i )
-        {
-          if( i == sizeof lut / sizeof *lut )
-          {
-            msg_fatal("unknown mode '%s'\n", par);
-          }
-          if( !strcmp(lut[i].name, par) )
-          {
-            self->smapsfilt_filtmode = lut[i].mode;
-            break;
-          }
-        }
-      }
-      break;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * load & process
+   * - - - - - - - - - - - - - - - - - - - */
 
-    case opt_difflevel:
-      self->smapsfilt_difflevel = parse_level(par);
-      break;
+  smapsfilt_load_inputs(req);
 
-    case opt_trimlevel:
-      self->smapsfilt_trimlevel = parse_level(par);
-      break;
-    default:
-      abort();
-    }
+  if( req->smapsfilt_snaplist.size != req->smapsfilt_inputs.size )
+  {
+    smaps_xstrfmt(&error, "failed to load captures");
+    goto cleanup;
   }
 
-  argvec_delete(args);
-}
-
-static void
-smapsfilt_load_inputs(smapsfilt_t *self)
-{
-  int error;
-  for( int i = 0; i < self->smapsfilt_inputs.size; ++i )
+  if( stream )
   {
-    const char *path = self->smapsfilt_inputs.data[i];
+    /* the stream owns the descriptor it is given, the
+     * original is still needed for the reply */
+    int          dfd  = dup(fd);
+    smapssnap_t *snap = 0;
 
-    smapssnap_t *snap = smapssnap_create();
-    error = smapssnap_load_cap(snap, path);
-    if (error) continue;
-    array_add(&self->smapsfilt_snaplist, snap);
+    if( dfd == -1 || (file = smaps_gzip_fdopen(dfd)) == 0 )
+    {
+      if( dfd != -1 ) close(dfd);
+      smaps_xstrfmt(&error, "unable to set up stream");
+      goto cleanup;
+    }
 
-// QUARANTINE     smapssnap_save_cap(snap, "out1.cap");
-// QUARANTINE     smapssnap_save_csv(snap, "out1.csv");
+    snap = smapssnap_create();
+    smaps_xstrfmt(&name, "stream-%03d.cap", serial);
+    smapssnap_set_source(snap, name);
 
-    smapssnap_create_hierarchy(snap);
-    if (snap->smapssnap_format == SNAPFORMAT_OLD) {
-      fprintf(stderr, "Warning: %s: oldstyle capture file, not removing threads.\n", path);
-    } else {
-      smapssnap_collapse_threads(snap);
+    if( smapssnap_load_stream(snap, file) != 0 )
+    {
+      smapssnap_delete(snap);
+      smaps_xstrfmt(&error, "failed to load streamed capture");
+      goto cleanup;
     }
+    smapssnap_prepare(snap);
+    array_add(&req->smapsfilt_snaplist, snap);
+  }
 
-// QUARANTINE     smapssnap_save_cap(snap, "out2.cap");
-// QUARANTINE     smapssnap_save_csv(snap, "out2.csv");
-// QUARANTINE     smapssnap_save_html(snap, "out2.html");
+  if( smapsfilt_write_outputs(req) != 0 )
+  {
+    smaps_xstrfmt(&error, "failed to write output");
+    goto cleanup;
   }
 
+  cleanup:
+
+  if( file != 0 ) fclose(file);
+  smapsfilt_delete(req);
+  free(name);
+
+  return error;
 }
 
-char *path_slice_extension(char *path)
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_serve  --  accept and execute requests until told to stop
+ * ------------------------------------------------------------------------- */
+
+static void
+smapsfilt_serve(smapsfilt_t *self)
 {
-  char *e = path_extension(path);
-  if( *e != 0 )
+  const char *addr  = self->smapsfilt_server;
+  int         lfd   = -1;
+  int         home  = -1;
+  char       *reply = 0;
+  size_t      warm  = 0;  // pool size after first request on a fresh pool
+  size_t      limit = 0;
+
+  /* requests name files to read and write, so they
+   * are taken from local users only */
+  if( strncmp(addr, "unix:", 5) )
   {
-    *e++ = 0;
+    msg_fatal("%s: server address must be unix:<path>\n", addr);
   }
-  return e;
-}
 
-char *path_make_output(const char *def,
-                       const char *src, const char *ext)
-{
-  char *res = 0;
-  if( def == 0 )
+  if( (lfd = listen_socket(addr)) == -1 ||
+      chmod(addr + 5, S_IRUSR | S_IWUSR) == -1 )
   {
-    const char *end = path_extension(src);
-    xstrfmt(&res, "%.*s%s", (int)(end - src), src, ext);
+    msg_fatal("%s: %s\n", addr, strerror(errno));
   }
-  else
+
+  if( (home = open(".", O_RDONLY | O_DIRECTORY)) == -1 )
   {
-    res = strdup(def);
+    msg_fatal("working directory: %s\n", strerror(errno));
   }
-  return res;
-}
 
-static void
-smapsfilt_write_outputs(smapsfilt_t *self)
-{
-  switch( self->smapsfilt_filtmode )
+  signal(SIGPIPE, SIG_IGN);
+
+  msg_progress("serving on %s\n", addr);
+
+  for( int serial = 1;
+       self->smapsfilt_count == 0 || serial <= self->smapsfilt_count;
+       ++serial )
   {
-  case FM_DIFF:
-    if( self->smapsfilt_output == 0 )
+    int   fd    = accept(lfd, 0, 0);
+    char *error = 0;
+
+    if( fd == -1 )
     {
-      msg_fatal("output path must be specified for diff\n");
+      if( errno == EINTR ) { --serial; continue; }
+      msg_fatal("%s: accept: %s\n", addr, strerror(errno));
     }
 
-    if( self->smapsfilt_snaplist.size < 2 )
+    if( !socket_peer_trusted(fd) )
     {
-      msg_warning("diffing less than two captures is pretty meaningless\n");
+      smaps_xstrfmt(&error, "permission denied");
     }
-
+    else
     {
-      char *work = strdup(self->smapsfilt_output);
-      char *ext  = path_slice_extension(work);
-      int   html = !strcmp(ext, "html");
-
-      int   level = self->smapsfilt_difflevel;
-      int   trim  = self->smapsfilt_trimlevel;
+      error = smapsfilt_serve_request(fd, serial);
 
-      if( level < 0 )
+      if( fchdir(home) == -1 )
       {
-        level = parse_level(path_slice_extension(work));
+        msg_fatal("working directory: %s\n", strerror(errno));
       }
 
-      smapsfilt_diff(self, self->smapsfilt_output, level, html, trim);
-
-      free(work);
+      if( warm == 0 )
+      {
+        warm = smaps_intern_count();
+      }
+      if( (limit = warm * SERVE_INTERN_SPAN) < SERVE_INTERN_MIN )
+      {
+        limit = SERVE_INTERN_MIN;
+      }
+      if( smaps_intern_trim(limit) )
+      {
+        warm = 0;
+      }
     }
-    break;
 
-  case FM_FLATTEN:
-    if( self->smapsfilt_output != 0 && self->smapsfilt_snaplist.size != 1 )
+    if( error != 0 )
     {
-      msg_fatal("forcing output path allowed with one source file only!\n");
+      msg_error("request %d: %s\n", serial, error);
+      smaps_xstrfmt(&reply, "error %s\n", error);
     }
-
-    for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+    else
     {
-      smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-      char *dest = path_make_output(self->smapsfilt_output,
-                                    snap->smapssnap_source,
-                                    ".flat");
-      smapssnap_save_cap(snap, dest);
-      free(dest);
+      smaps_xstrfmt(&reply, "ok\n");
     }
-    break;
 
-  case FM_NORMALIZE:
-    if( self->smapsfilt_output != 0 && self->smapsfilt_snaplist.size != 1 )
-    {
-      msg_fatal("forcing output path allowed with one source file only!\n");
-    }
+    socket_write(fd, reply, strlen(reply));
+    close(fd);
+    free(error);
+  }
 
-    for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
-    {
-      smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-      char *dest = path_make_output(self->smapsfilt_output,
-                                    snap->smapssnap_source,
-                                    ".csv");
-      smapssnap_save_csv(snap, dest);
-      free(dest);
-    }
-    break;
+  free(reply);
+  close(home);
+  close(lfd);
 
-  case FM_ANALYZE:
+  if( !strncmp(addr, "unix:", 5) )
+  {
+    unlink(addr + 5);
+  }
+}
 
-    if( self->smapsfilt_output != 0 && self->smapsfilt_snaplist.size != 1 )
-    {
-      msg_fatal("forcing output path allowed with one source file only!\n");
-    }
+/* ------------------------------------------------------------------------- *
+ * smapsfilt_connect_request  --  hand the command line over to a server
+ * ------------------------------------------------------------------------- */
 
-    for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+static int
+smapsfilt_connect_request(smapsfilt_t *self)
+{
+  const char *addr   = self->smapsfilt_connect;
+  char       *req    = 0;
+  char       *cwd    = getcwd(0, 0);
+  int         stream = 0;
+  int         fd     = -1;
+  char        buff[64<<10];
+  ssize_t     n;
+  size_t      used   = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the server switches to our working
+   * directory, so that relative paths end
+   * up in the reports exactly as given
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( cwd == 0 )
+  {
+    msg_fatal("getcwd: %s\n", strerror(errno));
+  }
+
+  smaps_xstrfmt(&req, "directory %s\nmode %s\n", cwd,
+                filtmode_name(self->smapsfilt_filtmode));
+
+  if( self->smapsfilt_difflevel >= 0 )
+  {
+    smaps_xstrfmt(&req, "%sdifflevel %d\n", req, self->smapsfilt_difflevel);
+  }
+  if( self->smapsfilt_trimlevel != 0 )
+  {
+    smaps_xstrfmt(&req, "%strimlevel %d\n", req, self->smapsfilt_trimlevel);
+  }
+  if( self->smapsfilt_output != 0 )
+  {
+    smaps_xstrfmt(&req, "%soutput %s\n", req, self->smapsfilt_output);
+  }
+  if( !self->smapsfilt_cache )
+  {
+    smaps_xstrfmt(&req, "%snocache\n", req);
+  }
+  if( self->smapsfilt_gzip )
+  {
+    smaps_xstrfmt(&req, "%sgzip\n", req);
+  }
+  for( int i = 0; i < self->smapsfilt_pidcnt; ++i )
+  {
+    smaps_xstrfmt(&req, "%spid %d\n", req, self->smapsfilt_pidtab[i]);
+  }
+  if( self->smapsfilt_name != 0 )
+  {
+    smaps_xstrfmt(&req, "%sname %s\n", req, self->smapsfilt_name);
+  }
+
+  for( int i = 0; i < self->smapsfilt_inputs.size; ++i )
+  {
+    const char *path = self->smapsfilt_inputs.data[i];
+
+    if( !strcmp(path, "-") )
     {
-      smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-      char *dest = path_make_output(self->smapsfilt_output,
-                                    snap->smapssnap_source,
-                                    ".html");
-      /* SMAPS does not provide any data for kernel threads, so remove them to
-       * reduce dummy elements from the analysis report.
-       */
-      analyze_prune_kthreads(snap);
-      analyze_t *az   = analyze_create();
-      analyze_enumerate_data(az, snap);
-      analyze_accumulate_data(az);
-      int error = analyze_emit_main_page(az, snap, dest);
-      analyze_delete(az);
-      //smapssnap_save_html(snap, dest);
-      free(dest);
-      assert( error == 0 );
+      stream = 1;
+      continue;
     }
-    break;
+    smaps_xstrfmt(&req, "%sinput %s\n", req, path);
+  }
 
-  case FM_APPVALS:
+  smaps_xstrfmt(&req, "%s%s\n", req, stream ? "stream" : "run");
 
-    if( self->smapsfilt_output != 0 && self->smapsfilt_snaplist.size != 1 )
+  /* - - - - - - - - - - - - - - - - - - - *
+   * send request & capture data
+   * - - - - - - - - - - - - - - - - - - - */
+
+  signal(SIGPIPE, SIG_IGN);
+
+  if( (fd = connect_socket(addr)) == -1 )
+  {
+    msg_fatal("%s: %s\n", addr, strerror(errno));
+  }
+
+  if( socket_write(fd, req, strlen(req)) == -1 )
+  {
+    msg_fatal("%s: %s\n", addr, strerror(errno));
+  }
+
+  if( stream )
+  {
+    while( (n = read(STDIN_FILENO, buff, sizeof buff)) != 0 )
     {
-      msg_fatal("forcing output path allowed with one source file only!\n");
+      if( n == -1 )
+      {
+        if( errno == EINTR ) continue;
+        msg_fatal("stdin: %s\n", strerror(errno));
+      }
+      if( socket_write(fd, buff, n) == -1 )
+      {
+        /* the server may have rejected the request
+         * already, the reply tells what went wrong */
+        break;
+      }
     }
+  }
+  shutdown(fd, SHUT_WR);
 
-    for( int i = 0; i < self->smapsfilt_snaplist.size; ++i )
+  /* - - - - - - - - - - - - - - - - - - - *
+   * wait for the reply
+   * - - - - - - - - - - - - - - - - - - - */
+
+  while( used + 1 < sizeof buff
+         && (n = read(fd, buff + used, sizeof buff - used - 1)) != 0 )
+  {
+    if( n == -1 )
     {
-      smapssnap_t *snap = self->smapsfilt_snaplist.data[i];
-      char *dest = path_make_output(self->smapsfilt_output,
-                                    snap->smapssnap_source,
-                                    ".apps");
-
-      analyze_t *az   = analyze_create();
-      analyze_enumerate_data(az, snap);
-      analyze_accumulate_data(az);
-      int error = analyze_emit_appvals(az, snap, dest);
-      analyze_delete(az);
-      free(dest);
-      assert( error == 0 );
+      if( errno == EINTR ) continue;
+      break;
     }
-    break;
+    used += n;
+  }
+  buff[used] = 0;
+  buff[strcspn(buff, "\n")] = 0;
+  close(fd);
+  free(req);
+  free(cwd);
 
-  default:
-    msg_fatal("unimplemented mode %d\n",self->smapsfilt_filtmode);
-    break;
+  if( strncmp(buff, "ok", 2) )
+  {
+    msg_error("%s: %s\n", addr, *buff ? buff : "no reply");
+    return EXIT_FAILURE;
   }
+  return EXIT_SUCCESS;
 }
 
 /* ========================================================================= *
@@ -4954,12 +4209,33 @@ smapsfilt_write_outputs(smapsfilt_t *self)
 
 int main(int ac, char **av)
 {
+  int          xc  = 0;
   smapsfilt_t *app = smapsfilt_create();
   smapsfilt_handle_arguments(app, ac, av);
-  smapsfilt_load_inputs(app);
-  smapsfilt_write_outputs(app);
+  if( app->smapsfilt_connect != 0 )
+  {
+    xc = smapsfilt_connect_request(app);
+  }
+  else if( app->smapsfilt_server != 0 )
+  {
+    smapsfilt_serve(app);
+  }
+  else
+  {
+    if( app->smapsfilt_listen != 0 )
+    {
+      smapsfilt_listen_inputs(app);
+      smapsfilt_load_inputs(app);
+      if( smapsfilt_write_outputs(app) != 0 ) xc = EXIT_FAILURE;
+    }
+    else
+    {
+      if( smapsfilt_process_inputs(app) != 0 ) xc = EXIT_FAILURE;
+    }
+  }
   smapsfilt_delete(app);
-  return 0;
+  smaps_intern_release();
+  return xc;
 }
 
 /* - - - - - - - - - - - - - - - - - - - *
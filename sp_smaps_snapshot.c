@@ -50,6 +50,12 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netdb.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,8 +64,18 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
 #include <dirent.h>
 #include <sched.h>
+#include <limits.h>
+#include <ctype.h>
+#include <time.h>
+#include <regex.h>
+#include <pwd.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <zlib.h>
 
 #define MSG_DISABLE_PROGRESS 0
 
@@ -114,6 +130,27 @@ static const manual_t app_man[]=
           "\n"
           "  Collects /proc/*/smaps files from all running processes, and writes the\n"
           "  result to 'after_boot.cap'.\n"
+          "\n"
+          "% "TOOL_NAME" -P fake.proc -o fake.cap\n"
+          "\n"
+          "  Collects data from synthetic process tree made with\n"
+          "  sp_smaps_fakeproc instead of the running system.\n"
+          "\n"
+          "% "TOOL_NAME" -e -R 64000000 -D -o /var/tmp/oom.cap\n"
+          "\n"
+          "  Captures a system that is low on memory: memory is locked,\n"
+          "  64MB of disk is reserved for the output and it is written\n"
+          "  bypassing the page cache.\n"
+          "\n"
+          "% "TOOL_NAME" -z -o after_boot.cap.gz\n"
+          "\n"
+          "  Writes gzip compressed capture, which sp_smaps_filter\n"
+          "  can process directly.\n"
+          "\n"
+          "% "TOOL_NAME" -T 1234 -o service.cap\n"
+          "\n"
+          "  Captures only process 1234 and its descendants. Other\n"
+          "  processes are dropped after reading their status file.\n"
           )
   MAN_ADD("COPYRIGHT",
           "Copyright (C) 2004-2007,2009,2011 Nokia Corporation.\n\n"
@@ -143,7 +180,28 @@ enum
   opt_silent,
 
   opt_output,
+  opt_compress,
   opt_realtime,
+  opt_proc_root,
+
+  opt_time_limit,
+  opt_max_mappings,
+  opt_rate_limit,
+  opt_pause,
+
+  opt_jobs,
+  opt_size_hints,
+  opt_window,
+
+  opt_emergency,
+  opt_reserve,
+  opt_direct,
+
+  opt_select_pid,
+  opt_select_tree,
+  opt_select_name,
+  opt_select_cgroup,
+  opt_select_uid,
 };
 
 static const option_t app_opt[] =
@@ -178,12 +236,126 @@ static const option_t app_opt[] =
 
   OPT_ADD(opt_output,
           "o", "output", "<destination path>",
-          "Output file to use instead of stdout.\n" ),
+          "Output file to use instead of stdout. The capture can\n"
+          "also be streamed to sp_smaps_filter --listen by giving\n"
+          "unix:<socket path> or tcp:<host>:<port> as destination.\n" ),
+
+  OPT_ADD(opt_compress,
+          "z", "compress", 0,
+          "Write gzip compressed output. Compression is done in a\n"
+          "separate thread while the capture continues. The\n"
+          "sp_smaps_filter tool reads compressed captures as is.\n" ),
 
   OPT_ADD(opt_realtime,
           "r", "realtime", 0,
           "Use realtime priority (needs to be run as root for this)" ),
 
+  OPT_ADD(opt_proc_root,
+          "P", "proc-root", "<directory>",
+          "Read process data from given directory instead of /proc.\n"
+          "The capture file still refers to /proc/pid/smaps, so that\n"
+          "synthetic process trees made for scale testing can be\n"
+          "processed with sp_smaps_filter as usual.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * capture impact limits
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_time_limit,
+          "t", "time-limit", "<msec>",
+          "Stop reading smaps of a process after given time. Only\n"
+          "complete mappings are written and the truncation is\n"
+          "recorded in the capture.\n" ),
+
+  OPT_ADD(opt_max_mappings,
+          "m", "max-mappings", "<count>",
+          "Capture at most given number of mappings per process.\n"
+          "The truncation is recorded in the capture.\n" ),
+
+  OPT_ADD(opt_rate_limit,
+          "b", "rate-limit", "<bytes/sec>",
+          "Limit the rate of reading data from /proc. The kernel\n"
+          "holds the memory map lock of a process only during each\n"
+          "read call, so throttling between reads keeps the impact\n"
+          "on large processes bounded.\n" ),
+
+  OPT_ADD(opt_pause,
+          "p", "pause", "<msec>",
+          "Sleep given time after capturing each process.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * parallel capture
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_jobs,
+          "j", "jobs", "<count>",
+          "Capture processes using given number of threads. The\n"
+          "processes are handed out largest first, so that one\n"
+          "huge process does not end up dominating the wall clock\n"
+          "time. The output is identical to sequential capture.\n" ),
+
+  OPT_ADD(opt_size_hints,
+          "H", "size-hints", "<capture>",
+          "Use per process data sizes from a previous capture for\n"
+          "scheduling instead of virtual sizes from /proc/pid/statm.\n" ),
+
+  OPT_ADD(opt_window,
+          "w", "window", "<bytes>",
+          "Limit memory used for captured records that wait to be\n"
+          "written in pid order (default: 16 MiB). When the limit\n"
+          "is reached, threads capture only the process output is\n"
+          "waiting for, or wait themselves. At most the limit plus\n"
+          "one record per thread is buffered.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * capturing under memory pressure
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_emergency,
+          "e", "emergency", 0,
+          "Emergency mode for capturing when the system is close to\n"
+          "running out of memory: all memory is locked and buffers\n"
+          "are allocated up front, so that the capture does not\n"
+          "need to page or allocate. Overlong cmdline and status\n"
+          "data is truncated, at most 32768 processes are captured\n"
+          "and --jobs is ignored. Matching --name patterns is\n"
+          "left to the C library and may allocate.\n" ),
+
+  OPT_ADD(opt_reserve,
+          "R", "reserve", "<bytes>",
+          "Reserve given amount of disk space for the output file\n"
+          "before starting the capture.\n" ),
+
+  OPT_ADD(opt_direct,
+          "D", "direct", 0,
+          "Write output file with O_DIRECT, bypassing page cache.\n" ),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * process selection
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_select_pid,
+          "i", "pid", "<pid[,pid...]>",
+          "Capture only the given processes. Can be used several\n"
+          "times.\n" ),
+
+  OPT_ADD(opt_select_tree,
+          "T", "tree", "<pid>",
+          "Capture only the given process and its descendants.\n" ),
+
+  OPT_ADD(opt_select_name,
+          "n", "name", "<regex>",
+          "Capture only processes whose name or command line\n"
+          "matches the extended regular expression.\n" ),
+
+  OPT_ADD(opt_select_cgroup,
+          "c", "cgroup", "<path>",
+          "Capture only processes in the given cgroup or below it.\n" ),
+
+  OPT_ADD(opt_select_uid,
+          "u", "uid", "<uid|user>",
+          "Capture only processes with the given real user id.\n" ),
+
   OPT_END
 };
 
@@ -195,12 +367,86 @@ static const option_t app_opt[] =
                          * /proc/pid/file in one go. Read buffers are taken
                          * from stack so avoid excessive sizes... */
 
+#ifndef SMAPS_CHUNK
+# define SMAPS_CHUNK RXBUFF /* Upper limit for single smaps read, can be made
+                            * smaller for testing entries that are split
+                            * across reads. */
+#endif
+
 #define TXBUFF (64<<10) /* All output - except for the final write - will be
                          * done in this sized blocks -> make it multiple of
                          * file system block size. */
 
+#define CAPTURE_FORMAT 2 /* Version declared in capture header: 2 = framed
+                          * capture with header and trailer sections */
+
+#define ALIGNMENT (4<<10) /* Output buffer alignment needed for O_DIRECT */
+
+#define EMERGENCY_INPUT  (16<<10) /* Fixed size of cmdline and status read
+                                   * buffers in emergency mode */
+
+#define EMERGENCY_FORMAT (64<<10) /* Fixed size of formatting buffer used
+                                   * in emergency mode instead of alloca */
+
+#define EMERGENCY_STACK  (256<<10) /* Amount of stack to prefault */
+
+#define EMERGENCY_PIDS   (32<<10) /* Fixed size of process table in emergency
+                                   * mode, processes past this are skipped */
+
+#define EMERGENCY_PIDLEN 12       /* Room for one pid string in the table */
+
 static const char *outfile = 0;
 
+static const char *proc_root = "/proc";
+
+/* ------------------------------------------------------------------------- *
+ * Capture impact limits, zero = unlimited
+ * ------------------------------------------------------------------------- */
+
+static int      limit_msecs    = 0; /* per process smaps read time */
+static int      limit_mappings = 0; /* per process mapping count */
+static unsigned limit_rate     = 0; /* bytes read per second */
+static int      pause_msecs    = 0; /* sleep between processes */
+
+/* ------------------------------------------------------------------------- *
+ * Parallel capture
+ * ------------------------------------------------------------------------- */
+
+static int         capture_jobs = 1; /* number of capture threads */
+static const char *size_hints   = 0; /* previous capture file */
+static size_t capture_window = 16<<20;  /* bytes of records pending output */
+
+/* ------------------------------------------------------------------------- *
+ * Emergency mode
+ * ------------------------------------------------------------------------- */
+
+static int    emergency_mode = 0;
+static off_t  output_reserve = 0; /* bytes to fallocate for output file */
+static int    output_direct  = 0; /* write output with O_DIRECT */
+
+static char  *emergency_cmdline = 0; /* preallocated read buffers */
+static char  *emergency_status  = 0;
+static char  *emergency_format  = 0; /* preallocated output_fmt buffer */
+static char  *emergency_name    = 0; /* application name of current process */
+
+static struct snapjob_t *emergency_jobs = 0; /* preallocated process table */
+static char  *emergency_pidstr  = 0; /* pid strings for the table */
+static int   *emergency_pidtab  = 0; /* pids / parent pids while scanning */
+static char  *emergency_state   = 0; /* tree selection state */
+static DIR   *emergency_procdir = 0; /* proc root, opened up front */
+
+/* ------------------------------------------------------------------------- *
+ * Process selection, all given criteria must match
+ * ------------------------------------------------------------------------- */
+
+static int        *select_pid_tab = 0;  /* sorted pid list */
+static size_t      select_pid_cnt = 0;
+static int         select_tree    = 0;  /* root of process tree */
+static regex_t     select_name;         /* name / cmdline regex ... */
+static int         select_name_on = 0;  /* ... if compiled */
+static const char *select_cgroup  = 0;  /* cgroup path prefix */
+static long        select_uid     = -1; /* real uid */
+
 /* ========================================================================= *
  * Utility functions
  * ========================================================================= */
@@ -299,6 +545,87 @@ static void write_all_or_exit(int fd, const void *data, size_t size)
   }
 }
 
+/* ------------------------------------------------------------------------- *
+ * monotonic_msecs  --  milliseconds from arbitrary fixed point in time
+ * ------------------------------------------------------------------------- */
+
+static double monotonic_msecs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/* ------------------------------------------------------------------------- *
+ * sleep_msecs  --  sleep given time, restart on signals
+ * ------------------------------------------------------------------------- */
+
+static void sleep_msecs(double msecs)
+{
+  struct timespec ts;
+
+  ts.tv_sec  = (time_t)(msecs / 1e3);
+  ts.tv_nsec = (long)((msecs - ts.tv_sec * 1e3) * 1e6);
+
+  while( nanosleep(&ts, &ts) == -1 && errno == EINTR )
+  {
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * throttle_input  --  token bucket rate limiting for /proc reads
+ * ------------------------------------------------------------------------- */
+
+static void throttle_input(size_t bytes)
+{
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+  static double stamp  = 0; /* time of last refill */
+  static double tokens = 0; /* bytes allowed to read */
+
+  if( limit_rate == 0 )
+  {
+    return;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * shared by all capture threads: the
+   * sleep is done while holding the lock
+   * so that the rate limit is global
+   * - - - - - - - - - - - - - - - - - - - */
+
+  pthread_mutex_lock(&mutex);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * refill: allow bursts of one read buffer
+   * or one second worth of data
+   * - - - - - - - - - - - - - - - - - - - */
+
+  double now   = monotonic_msecs();
+  double burst = (limit_rate > RXBUFF) ? limit_rate : RXBUFF;
+
+  tokens = (stamp == 0) ? burst : tokens + (now - stamp) * limit_rate / 1e3;
+  stamp  = now;
+
+  if( tokens > burst ) tokens = burst;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * consume, sleep off the debt if any
+   * - - - - - - - - - - - - - - - - - - - */
+
+  tokens -= bytes;
+
+  if( tokens < 0 )
+  {
+    double wait = -tokens * 1e3 / limit_rate;
+    sleep_msecs(wait);
+    stamp  += wait;
+    tokens  = 0;
+  }
+
+  pthread_mutex_unlock(&mutex);
+}
+
 /* ========================================================================= *
  * Buffered Output
  * ========================================================================= */
@@ -307,488 +634,2056 @@ static void write_all_or_exit(int fd, const void *data, size_t size)
  * output_buff  --  writes to stdout done via this
  * ------------------------------------------------------------------------- */
 
+static size_t output_space(int force_flush);
+
+/* The output buffer alternates between two banks: while one is being
+ * compressed in the background, the capture fills the other. Without
+ * compression only the first bank is used. */
+
 static int    output_fd = -1;
-static char   output_buff[TXBUFF];
+static char   output_bank[2][TXBUFF] __attribute__((aligned(ALIGNMENT)));
+static char  *output_buff = output_bank[0];
 static size_t output_offs = 0;
+static off_t  output_done = 0;
 
 /* ------------------------------------------------------------------------- *
- * output_space  --  return space available in output buffer
+ * compress_xxx  --  gzip stage on the output flush path
  * ------------------------------------------------------------------------- */
 
-static size_t output_space(int force_flush)
+static int             compress_output  = 0; /* gzip output enabled */
+static int             compress_running = 0; /* compressor thread started */
+
+static pthread_t       compress_tid;
+static pthread_mutex_t compress_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  compress_cond  = PTHREAD_COND_INITIALIZER;
+
+static const char     *compress_data  = 0; /* block handed to compressor */
+static size_t          compress_size  = 0;
+static int             compress_busy  = 0; /* block not yet consumed */
+static int             compress_last  = 0; /* final block: finish stream */
+
+static z_stream        compress_strm;
+static char            compress_temp[TXBUFF];
+
+/* ------------------------------------------------------------------------- *
+ * compress_deflate  --  compress block and write the result
+ * ------------------------------------------------------------------------- */
+
+static void compress_deflate(const char *data, size_t size, int flush)
 {
-  if( output_offs != 0 )
-  {
-    if( output_offs == sizeof output_buff || force_flush )
-    {
-      if( output_fd == -1 )
-      {
-        output_fd = STDOUT_FILENO;
+  compress_strm.next_in  = (Bytef *)data;
+  compress_strm.avail_in = size;
 
-        if( outfile != 0 )
-        {
-          int fd = open(outfile, O_WRONLY|O_CREAT|O_TRUNC, 0666);
-          if( fd == -1 )
-          {
-            msg_error("%s: %s\n(using stdout)", outfile, strerror(errno));
-          }
-          else
-          {
-            output_fd = fd;
-          }
-        }
-      }
+  do
+  {
+    compress_strm.next_out  = (Bytef *)compress_temp;
+    compress_strm.avail_out = sizeof compress_temp;
 
-      write_all_or_exit(output_fd, output_buff, output_offs);
-      output_offs = 0;
+    if( deflate(&compress_strm, flush) == Z_STREAM_ERROR )
+    {
+      msg_fatal("deflate: %s\n", compress_strm.msg ?: "stream error");
     }
-  }
-  return sizeof output_buff - output_offs;
+
+    size_t have = sizeof compress_temp - compress_strm.avail_out;
+    write_all_or_exit(output_fd, compress_temp, have);
+    output_done += have;
+  } while( compress_strm.avail_out == 0 );
 }
 
 /* ------------------------------------------------------------------------- *
- * output_raw  --  queue output
+ * compress_worker  --  compressor thread
  * ------------------------------------------------------------------------- */
 
-static void output_raw(const void *data, size_t size)
+static void *compress_worker(void *aptr)
 {
-  const char *pos = data;
-  const char *end = pos + size;
-
-  while( pos < end )
+  for( ;; )
   {
-    size_t count = end - pos;
-    size_t space = output_space(0);
+    pthread_mutex_lock(&compress_mutex);
+    while( !compress_busy )
+    {
+      pthread_cond_wait(&compress_cond, &compress_mutex);
+    }
+    const char *data = compress_data;
+    size_t      size = compress_size;
+    int         last = compress_last;
+    pthread_mutex_unlock(&compress_mutex);
 
-    if( count > space ) count = space;
+    compress_deflate(data, size, last ? Z_FINISH : Z_NO_FLUSH);
 
-    memcpy(output_buff + output_offs, pos, count);
+    pthread_mutex_lock(&compress_mutex);
+    compress_busy = 0;
+    pthread_cond_broadcast(&compress_cond);
+    pthread_mutex_unlock(&compress_mutex);
 
-    output_offs += count;
-    pos += count;
+    if( last )
+    {
+      break;
+    }
   }
+  return 0;
 }
 
 /* ------------------------------------------------------------------------- *
- * output_fmt  --  queue formatted output
+ * compress_start  --  set up gzip stream and compressor thread
  * ------------------------------------------------------------------------- */
 
-static void output_fmt(const char *fmt, ...)
+static void compress_start(void)
 {
-  char temp[1<<10];
-  char *work = temp;
+  /* windowBits + 16 -> gzip header & trailer */
+  if( deflateInit2(&compress_strm, Z_BEST_SPEED, Z_DEFLATED,
+                   15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+  {
+    msg_fatal("deflateInit: %s\n", compress_strm.msg ?: "failed");
+  }
 
-  va_list va;
-  size_t  n;
+  if( pthread_create(&compress_tid, 0, compress_worker, 0) != 0 )
+  {
+    msg_fatal("unable to create compressor thread\n");
+  }
+  compress_running = 1;
+}
 
-  va_start(va, fmt);
-  n = vsnprintf(work, sizeof temp, fmt, va);
-  va_end(va);
+/* ------------------------------------------------------------------------- *
+ * compress_submit  --  hand block to compressor, wait for previous one
+ * ------------------------------------------------------------------------- */
 
-  if( n > sizeof temp )
+static void compress_submit(const char *data, size_t size, int last)
+{
+  pthread_mutex_lock(&compress_mutex);
+  while( compress_busy )
   {
-    work = alloca(n);
-    va_start(va, fmt);
-    vsnprintf(work, n, fmt, va);
-    va_end(va);
+    pthread_cond_wait(&compress_cond, &compress_mutex);
   }
-
-  output_raw(work, n);
+  compress_data = data;
+  compress_size = size;
+  compress_last = last;
+  compress_busy = 1;
+  pthread_cond_broadcast(&compress_cond);
+  pthread_mutex_unlock(&compress_mutex);
 }
 
 /* ------------------------------------------------------------------------- *
- * output_file  --  queue file contents to output
+ * compress_finish  --  flush gzip trailer and stop compressor thread
  * ------------------------------------------------------------------------- */
 
-static size_t output_file(const char *path)
+static void compress_finish(void)
 {
-  size_t cnt = 0;
-  char temp[RXBUFF];
-  int file = open(path,O_RDONLY);
-
-  if( file == -1 )
+  if( compress_running )
   {
-    msg_error("%s: %s\n", path, strerror(errno));
-    goto cleanup;
+    compress_submit(output_buff, output_offs, 1);
+    output_offs = 0;
+
+    pthread_join(compress_tid, 0);
+    deflateEnd(&compress_strm);
+    compress_running = 0;
   }
+}
 
-  for( ;; )
-  {
-    int rc = read(file, temp, sizeof temp);
+/* ------------------------------------------------------------------------- *
+ * capbuf_t  --  growing buffer for records captured by worker threads
+ * ------------------------------------------------------------------------- */
 
-    if( rc == 0 )
+typedef struct capbuf_t
+{
+  char   *data;
+  size_t  used;
+  size_t  size;
+} capbuf_t;
+
+static void capbuf_append(capbuf_t *self, const void *data, size_t size)
+{
+  if( self->used + size > self->size )
+  {
+    while( self->used + size > self->size )
     {
-      break;
+      self->size = self->size ? (self->size * 2) : TXBUFF;
     }
-
-    if( rc == -1 )
+    if( (self->data = realloc(self->data, self->size)) == 0 )
     {
-      switch( errno )
-      {
-      case EAGAIN:
-      case EINTR:
-        continue;
-
-      default:
-        perror(path);
-        goto cleanup;
-      }
+      msg_fatal("%s\n", strerror(errno));
     }
-
-    output_raw(temp, rc);
-    cnt += rc;
   }
+  memcpy(self->data + self->used, data, size);
+  self->used += size;
+}
 
-  cleanup:
-
-  if( file != -1 ) close(file);
-  return cnt;
+static void capbuf_dtor(capbuf_t *self)
+{
+  free(self->data);
+  self->data = 0;
+  self->used = self->size = 0;
 }
 
+/* When set, output_raw() appends to the given buffer instead of the
+ * output file. Each capture thread has its own. */
+static __thread capbuf_t *capture_to = 0;
+
 /* ------------------------------------------------------------------------- *
- * input_file  --  read file contents, terminate with '\0'
+ * output_connect  --  connect to unix:<path> or tcp:<host>:<port>
  * ------------------------------------------------------------------------- */
 
-static size_t input_file(const char *path, void *pdata, size_t *psize)
+static int output_connect(const char *addr)
 {
+  int fd = -1;
 
-  size_t  done = 0;
-  char   *data = *(char **)pdata;
-  size_t  size = *psize;
-  int     file = -1;
-
-  if( (file = open(path,O_RDONLY)) == -1 )
+  if( !strncmp(addr, "unix:", 5) )
   {
-    msg_error("%s: %s\n", path, strerror(errno));
-    goto cleanup;
-  }
+    struct sockaddr_un sa;
 
-  for( ;; )
-  {
-    if( size - done < 0x1000 )
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof sa.sun_path, "%s", addr + 5);
+
+    if( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 )
     {
-      if( (data = realloc(data, (size += 0x1000))) == 0 )
+      if( connect(fd, (struct sockaddr *)&sa, sizeof sa) == -1 )
       {
-        msg_fatal("%s: %s\n", path, strerror(errno));
+        close(fd), fd = -1;
       }
     }
+  }
+  else
+  {
+    /* tcp:host:port, the port is after the last colon */
+    struct addrinfo  hints, *res = 0, *ai;
+    char            *host = strdup(addr + 4);
+    char            *port = strrchr(host, ':');
 
-    ssize_t rc = read(file, data + done, size - done);
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
 
-    if( rc == -1 )
+    if( port != 0 )
     {
-      switch( errno )
-      {
-      case EAGAIN:
-      case EINTR:
-        continue;
+      *port++ = 0;
 
-      default:
-        msg_error("%s: %s\n", path, strerror(errno));
-        goto cleanup;
+      int rc = getaddrinfo(*host ? host : 0, port, &hints, &res);
+      if( rc != 0 )
+      {
+        msg_error("%s: %s\n", addr, gai_strerror(rc));
       }
     }
+    else
+    {
+      errno = EINVAL;
+    }
 
-    if( rc == 0 )
+    for( ai = res; ai != 0; ai = ai->ai_next )
     {
-      break;
+      if( (fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) == -1 )
+      {
+        continue;
+      }
+      if( connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 )
+      {
+        break;
+      }
+      close(fd), fd = -1;
     }
 
-    done += (size_t)rc;
+    if( res ) freeaddrinfo(res);
+    free(host);
   }
 
-  cleanup:
-
-  if( file != -1 )
+  if( fd != -1 )
   {
-    close(file);
+    /* write errors are reported, not signaled */
+    signal(SIGPIPE, SIG_IGN);
   }
+  return fd;
+}
 
-  if( done == size )
-  {
-    if( (data = realloc(data, (size += 1))) == 0 )
-    {
-      msg_fatal("%s: %s\n", path, strerror(errno));
+/* ------------------------------------------------------------------------- *
+ * output_is_socket  --  output destination is unix: or tcp: address
+ * ------------------------------------------------------------------------- */
+
+static int output_is_socket(const char *path)
+{
+  return !strncmp(path, "unix:", 5) || !strncmp(path, "tcp:", 4);
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_open  --  open output file, reserve space if so requested
+ * ------------------------------------------------------------------------- */
+
+static void output_open(void)
+{
+  if( output_fd != -1 )
+  {
+    return;
+  }
+
+  output_fd = STDOUT_FILENO;
+
+  if( compress_output && output_direct )
+  {
+    /* compressed blocks are not block aligned */
+    msg_warning("O_DIRECT is not used with compressed output\n");
+    output_direct = 0;
+  }
+
+  if( outfile != 0 && output_is_socket(outfile) )
+  {
+    output_direct = 0;
+
+    if( (output_fd = output_connect(outfile)) == -1 )
+    {
+      msg_fatal("%s: %s\n", outfile, strerror(errno));
+    }
+  }
+  else if( outfile != 0 )
+  {
+    int flags = O_WRONLY|O_CREAT|O_TRUNC;
+
+    if( output_direct )
+    {
+      flags |= O_DIRECT;
+    }
+
+    int fd = open(outfile, flags, 0666);
+
+    if( fd == -1 && output_direct )
+    {
+      msg_warning("%s: O_DIRECT: %s\n", outfile, strerror(errno));
+      output_direct = 0;
+      fd = open(outfile, flags & ~O_DIRECT, 0666);
+    }
+
+    if( fd == -1 )
+    {
+      msg_error("%s: %s\n(using stdout)", outfile, strerror(errno));
+    }
+    else
+    {
+      output_fd = fd;
+    }
+  }
+
+  if( output_fd == STDOUT_FILENO )
+  {
+    output_direct = 0;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * allocate disk blocks up front, the
+   * file size is fixed when closing
+   * - - - - - - - - - - - - - - - - - - - */
+
+  struct stat st;
+
+  if( fstat(output_fd, &st) == 0 && !S_ISREG(st.st_mode) )
+  {
+    /* pipes, sockets, ttys */
+    output_reserve = 0;
+  }
+
+  if( output_reserve > 0 )
+  {
+    if( fallocate(output_fd, FALLOC_FL_KEEP_SIZE, 0, output_reserve) == -1 )
+    {
+      msg_warning("%s: fallocate: %s\n", outfile ?: "stdout", strerror(errno));
+    }
+  }
+
+  if( compress_output )
+  {
+    compress_start();
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_close  --  finish output file
+ * ------------------------------------------------------------------------- */
+
+static void output_close(void)
+{
+  if( compress_output )
+  {
+    output_open();
+    compress_finish();
+  }
+  else
+  {
+    output_space(1);
+  }
+
+  if( output_fd != -1 && output_reserve > 0 )
+  {
+    /* release reserved but unused blocks */
+    if( ftruncate(output_fd, output_done) == -1 )
+    {
+      msg_warning("%s: ftruncate: %s\n", outfile ?: "stdout", strerror(errno));
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_space  --  return space available in output buffer
+ * ------------------------------------------------------------------------- */
+
+static size_t output_space(int force_flush)
+{
+  if( output_offs != 0 )
+  {
+    if( output_offs == TXBUFF || force_flush )
+    {
+      output_open();
+
+      /* - - - - - - - - - - - - - - - - - - - *
+       * compressed: hand the buffer over and
+       * continue filling the other bank
+       * - - - - - - - - - - - - - - - - - - - */
+
+      if( compress_running )
+      {
+        compress_submit(output_buff, output_offs, 0);
+        output_buff = (output_buff == output_bank[0]) ? output_bank[1] : output_bank[0];
+        output_offs = 0;
+        return TXBUFF;
+      }
+
+      /* - - - - - - - - - - - - - - - - - - - *
+       * O_DIRECT writes must be block sized,
+       * the final partial one is written via
+       * page cache
+       * - - - - - - - - - - - - - - - - - - - */
+
+      if( output_direct && output_offs % ALIGNMENT )
+      {
+        int flags = fcntl(output_fd, F_GETFL);
+        fcntl(output_fd, F_SETFL, flags & ~O_DIRECT);
+        output_direct = 0;
+      }
+
+      write_all_or_exit(output_fd, output_buff, output_offs);
+      output_done += output_offs;
+      output_offs = 0;
+    }
+  }
+  return TXBUFF - output_offs;
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_raw  --  queue output
+ * ------------------------------------------------------------------------- */
+
+static void output_raw(const void *data, size_t size)
+{
+  const char *pos = data;
+  const char *end = pos + size;
+
+  if( capture_to != 0 )
+  {
+    capbuf_append(capture_to, data, size);
+    return;
+  }
+
+  while( pos < end )
+  {
+    size_t count = end - pos;
+    size_t space = output_space(0);
+
+    if( count > space ) count = space;
+
+    memcpy(output_buff + output_offs, pos, count);
+
+    output_offs += count;
+    pos += count;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_fmt  --  queue formatted output
+ * ------------------------------------------------------------------------- */
+
+static void output_fmt(const char *fmt, ...)
+{
+  char temp[1<<10];
+  char *work = temp;
+
+  va_list va;
+  size_t  n;
+
+  va_start(va, fmt);
+  n = vsnprintf(work, sizeof temp, fmt, va);
+  va_end(va);
+
+  if( n >= sizeof temp )
+  {
+    if( emergency_format != 0 )
+    {
+      /* no allocations in emergency mode, truncate if needed */
+      work = emergency_format;
+      if( n >= EMERGENCY_FORMAT ) n = EMERGENCY_FORMAT - 1;
+    }
+    else
+    {
+      work = alloca(n + 1);
+    }
+    va_start(va, fmt);
+    vsnprintf(work, n + 1, fmt, va);
+    va_end(va);
+  }
+
+  output_raw(work, n);
+}
+
+/* ------------------------------------------------------------------------- *
+ * is_mapping_header  --  "08048000-08051000 r-xp ..." style line
+ * ------------------------------------------------------------------------- */
+
+static int is_mapping_header(const char *pos, const char *end)
+{
+  const char *beg = pos;
+
+  while( pos < end && isxdigit((unsigned char)*pos) )
+  {
+    ++pos;
+  }
+  return pos > beg && pos < end && *pos == '-';
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_smaps  --  queue smaps file contents to output
+ *
+ * Data is passed through one mapping at a time, so that when the
+ * capture is cut short due to the time or mapping count limits, only
+ * complete mapping entries end up in the output. The reason for the
+ * truncation, if any, is returned via ptrunc.
+ * ------------------------------------------------------------------------- */
+
+static size_t output_smaps(const char *path, const char **ptrunc)
+{
+  size_t cnt  = 0;     /* bytes read from file */
+  size_t have = 0;     /* bytes in buffer, not yet output */
+  size_t seen = 0;     /* bytes in buffer already scanned, whole lines */
+  int    skip = 0;     /* buffer starts in the middle of a line */
+  int    maps = 0;     /* mapping headers seen */
+  char   temp[RXBUFF];
+  int    file = open(path,O_RDONLY);
+
+  double deadline = limit_msecs ? monotonic_msecs() + limit_msecs : 0;
+
+  *ptrunc = 0;
+
+  if( file == -1 )
+  {
+    msg_error("%s: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  for( ;; )
+  {
+    size_t room = sizeof temp - have;
+    int    rc   = read(file, temp + have, room < SMAPS_CHUNK ? room : SMAPS_CHUNK);
+
+    if( rc == 0 )
+    {
+      break;
+    }
+
+    if( rc == -1 )
+    {
+      switch( errno )
+      {
+      case EAGAIN:
+      case EINTR:
+        continue;
+
+      default:
+        perror(path);
+        goto cleanup;
+      }
+    }
+
+    cnt += rc;
+    throttle_input(rc);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * scan lines completed by this read,
+     * count mapping headers once as their
+     * line completes and find the start of
+     * the last mapping entry in buffer
+     *
+     * the buffer always starts at the last
+     * header found so far, so lines scanned
+     * earlier do not need to be revisited
+     * - - - - - - - - - - - - - - - - - - - */
+
+    char *pos  = temp + seen;
+    char *end  = temp + have + rc;
+    char *last = temp;
+
+    for( ;; )
+    {
+      char *eol = memchr(pos, '\n', end - pos);
+      if( eol == 0 ) break;
+
+      if( skip )
+      {
+        skip = 0;
+      }
+      else if( is_mapping_header(pos, eol) )
+      {
+        if( limit_mappings && ++maps > limit_mappings )
+        {
+          output_raw(temp, pos - temp);
+          have = 0;
+          *ptrunc = "mappings";
+          goto cleanup;
+        }
+        last = pos;
+      }
+      pos = eol + 1;
+    }
+    seen = pos - temp;
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * output complete entries, retain the
+     * possibly partial last one
+     * - - - - - - - - - - - - - - - - - - - */
+
+    if( last == temp && end == temp + sizeof temp )
+    {
+      /* single entry does not fit in buffer */
+      last = end;
+      skip = (pos < end);
+      seen = 0;
+    }
+    else
+    {
+      seen -= last - temp;
+    }
+
+    output_raw(temp, last - temp);
+    have = end - last;
+    memmove(temp, last, have);
+
+    if( deadline && monotonic_msecs() >= deadline )
+    {
+      *ptrunc = "time";
+      have = 0;
+      break;
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * header on unterminated last line
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( !skip && seen < have && is_mapping_header(temp + seen, temp + have) )
+  {
+    if( limit_mappings && ++maps > limit_mappings )
+    {
+      output_raw(temp, seen);
+      have = 0;
+      *ptrunc = "mappings";
+      goto cleanup;
+    }
+  }
+
+  output_raw(temp, have);
+
+  cleanup:
+
+  if( file != -1 ) close(file);
+  return cnt;
+}
+
+/* ------------------------------------------------------------------------- *
+ * input_file  --  read file contents, terminate with '\0'
+ * ------------------------------------------------------------------------- */
+
+static size_t input_file(const char *path, void *pdata, size_t *psize)
+{
+
+  size_t  done = 0;
+  char   *data = *(char **)pdata;
+  size_t  size = *psize;
+  int     file = -1;
+
+  if( (file = open(path,O_RDONLY)) == -1 )
+  {
+    msg_error("%s: %s\n", path, strerror(errno));
+    goto cleanup;
+  }
+
+  for( ;; )
+  {
+    size_t room = size - done;
+
+    if( emergency_mode )
+    {
+      /* fixed size buffer: truncate, leave room for terminator */
+      if( room <= 1 )
+      {
+        break;
+      }
+      room -= 1;
+    }
+    else if( room < 0x1000 )
+    {
+      if( (data = realloc(data, (size += 0x1000))) == 0 )
+      {
+        msg_fatal("%s: %s\n", path, strerror(errno));
+      }
+      room = size - done;
+    }
+
+    ssize_t rc = read(file, data + done, room);
+
+    if( rc == -1 )
+    {
+      switch( errno )
+      {
+      case EAGAIN:
+      case EINTR:
+        continue;
+
+      default:
+        msg_error("%s: %s\n", path, strerror(errno));
+        goto cleanup;
+      }
+    }
+
+    if( rc == 0 )
+    {
+      break;
+    }
+
+    throttle_input(rc);
+    done += (size_t)rc;
+  }
+
+  cleanup:
+
+  if( file != -1 )
+  {
+    close(file);
+  }
+
+  if( done == size )
+  {
+    if( (data = realloc(data, (size += 1))) == 0 )
+    {
+      msg_fatal("%s: %s\n", path, strerror(errno));
+    }
+  }
+  data[done] = 0;
+
+  *(char **)pdata = data;
+  *psize = size;
+
+  return done;
+}
+
+#define uc(c) ((unsigned char)(c))
+#define wc(c) ((c)>0 && (c)<33)
+#define bc(c) (uc(c)>32)
+
+static char *strip(char *str)
+{
+  char *src = str;
+  char *dst = str;
+
+  while( wc(*src) ) ++src;
+
+  for( ;; )
+  {
+    if( bc(*src) )
+    {
+      *dst++ = *src++;
+      continue;
+    }
+
+    while( wc(*src) ) ++src;
+
+    if( *src == 0 ) break;
+
+    *dst++ = ' ';
+  }
+  *dst = 0;
+  return str;
+}
+
+static char *token(char **ppos, int sep)
+{
+  char *beg = *ppos;
+
+  if( sep < 0 )
+  {
+    while( wc(*beg) ) ++beg;
+  }
+
+  char *end = beg;
+
+  for( ; *end; ++end )
+  {
+    //printf("??? '%c' vs '%c'\n", (sep<0) ? '?' : sep, *end);
+    if( ((sep<0) && wc(*end)) || (uc(*end) == uc(sep)) )
+    {
+      *end++ = 0; break;
+    }
+  }
+  *ppos = end;
+  return strip(beg);
+}
+
+typedef struct proc_pid_status_t {
+  char *Name;
+  char *Tgid;
+  char *Pid;
+  char *PPid;
+  char *Threads;
+  char *FDSize;
+  char *VmPeak;
+  char *VmSize;
+  char *VmLck;
+  char *VmHWM;
+  char *VmRSS;
+  char *VmData;
+  char *VmStk;
+  char *VmExe;
+  char *VmLib;
+  char *VmPTE;
+  char *Uid;
+
+} proc_pid_status_t;
+
+static void
+proc_pid_status_parse(proc_pid_status_t *self, char *data)
+{
+  static char empty[1] = "";
+
+  memset(self, 0, sizeof *self);
+
+  self->Name    = empty;
+  self->Pid     = "0";
+  self->PPid    = "0";
+  self->Threads = "0";
+
+  while( *data )
+  {
+    char *row = token(&data, '\n');
+    char *key = token(&row, ':');
+
+    if( !strcmp(key, "Name") )
+    {
+      self->Name = strip(row);
+    }
+#define X(v) else if( !strcmp(key, #v) ) { self->v = token(&row, -1); }
+    X(Tgid)
+    X(Pid)
+    X(PPid)
+    X(Threads)
+    X(FDSize)
+    X(VmPeak)
+    X(VmSize)
+    X(VmLck)
+    X(VmHWM)
+    X(VmRSS)
+    X(VmData)
+    X(VmStk)
+    X(VmExe)
+    X(VmLib)
+    X(VmPTE)
+    X(Uid)
+#undef X
+  }
+}
+
+/* ========================================================================= *
+ * Snapshot from /proc/pid/smaps information
+ * ========================================================================= */
+
+static char *kthreadd_pid;
+static char  kthreadd_pidbuf[EMERGENCY_PIDLEN];
+
+static int is_kthreadd(const proc_pid_status_t *status)
+{
+  if (status->Name == NULL)
+    return 0;
+  if (status->PPid == NULL)
+    return 0;
+  return strcmp(status->Name, "kthreadd") == 0
+         && strcmp(status->PPid, "0") == 0;
+}
+
+static int is_kernel_thread(const proc_pid_status_t *status)
+{
+  if (kthreadd_pid == NULL)
+    return 0;
+  if (status->PPid == NULL)
+    return 0;
+  return strcmp(status->PPid, kthreadd_pid) == 0;
+}
+
+static int is_thread(const proc_pid_status_t *status)
+{
+  /* tasks other than thread group leader share
+   * the address space -> smaps would be duplicate */
+  if (status->Tgid == NULL || status->Pid == NULL)
+    return 0;
+  return strcmp(status->Tgid, status->Pid) != 0;
+}
+
+static void check_kthreadd(const proc_pid_status_t *status)
+{
+  if (kthreadd_pid)
+    return;
+  if (status->Pid == NULL)
+    return;
+  if (is_kthreadd(status))
+  {
+    snprintf(kthreadd_pidbuf, sizeof kthreadd_pidbuf, "%s", status->Pid);
+    kthreadd_pid = kthreadd_pidbuf;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pid_filter_cb  --  scandir filter for /proc/pid directories
+ * ------------------------------------------------------------------------- */
+
+static int pid_filter_cb(const struct dirent *de)
+{
+  return '1' <= de->d_name[0] && de->d_name[0] <= '9';
+}
+
+/* ------------------------------------------------------------------------- *
+ * pid_compare_cb  --  scandir sort callback for numerical pid order
+ * ------------------------------------------------------------------------- */
+
+static int pid_compare_cb(const struct dirent **d1, const struct dirent **d2)
+{
+  long p1 = strtol((*d1)->d_name, 0, 10);
+  long p2 = strtol((*d2)->d_name, 0, 10);
+  return (p1 > p2) - (p1 < p2);
+}
+
+/* ========================================================================= *
+ * Process Selection
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * select_add_pids  --  parse comma separated pid list option
+ * ------------------------------------------------------------------------- */
+
+static void select_add_pids(const char *list)
+{
+  char *end = 0;
+
+  while( *list )
+  {
+    int pid = strtol(list, &end, 10);
+
+    if( end == list || pid <= 0 )
+    {
+      msg_fatal("invalid pid list: '%s'\n", list);
+    }
+
+    select_pid_tab = realloc(select_pid_tab,
+                             (select_pid_cnt + 1) * sizeof *select_pid_tab);
+    select_pid_tab[select_pid_cnt++] = pid;
+
+    list = end;
+    while( *list == ',' || *list == ' ' ) ++list;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_set_uid  --  parse numeric uid or user name option
+ * ------------------------------------------------------------------------- */
+
+static void select_set_uid(const char *user)
+{
+  char          *end = 0;
+  struct passwd *pw  = 0;
+
+  select_uid = strtol(user, &end, 10);
+
+  if( end == user || *end != 0 )
+  {
+    if( (pw = getpwnam(user)) == 0 )
+    {
+      msg_fatal("unknown user: '%s'\n", user);
+    }
+    select_uid = pw->pw_uid;
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_set_name  --  compile name / cmdline regex option
+ * ------------------------------------------------------------------------- */
+
+static void select_set_name(const char *expr)
+{
+  char err[256];
+  int  rc;
+
+  if( select_name_on )
+  {
+    regfree(&select_name);
+    select_name_on = 0;
+  }
+
+  if( (rc = regcomp(&select_name, expr, REG_EXTENDED|REG_NOSUB)) != 0 )
+  {
+    regerror(rc, &select_name, err, sizeof err);
+    msg_fatal("invalid regex '%s': %s\n", expr, err);
+  }
+  select_name_on = 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_pid_cb  --  qsort / bsearch callback for pid list
+ * ------------------------------------------------------------------------- */
+
+static int select_pid_cb(const void *a1, const void *a2)
+{
+  return *(const int *)a1 - *(const int *)a2;
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_cgroup_match  --  is process in selected cgroup hierarchy
+ * ------------------------------------------------------------------------- */
+
+static int select_cgroup_match(const char *pid)
+{
+  char    path[PATH_MAX];
+  char    text[RXBUFF];
+  int     file;
+  ssize_t n = 0;
+  size_t  len = strlen(select_cgroup);
+
+  snprintf(path, sizeof path, "%s/%s/cgroup", proc_root, pid);
+
+  if( (file = open(path, O_RDONLY)) != -1 )
+  {
+    n = read(file, text, sizeof text - 1);
+    close(file);
+  }
+  text[n > 0 ? n : 0] = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * lines are "hierarchy:controllers:path"
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( char *pos = text; *pos; )
+  {
+    char *row = token(&pos, '\n');
+    char *cg  = strrchr(row, ':');
+
+    if( cg == 0 )
+    {
+      continue;
+    }
+    ++cg;
+
+    if( !strncmp(cg, select_cgroup, len)
+        && (cg[len] == 0 || cg[len] == '/' || select_cgroup[len-1] == '/') )
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_name_match  --  does name or command line match the regex
+ * ------------------------------------------------------------------------- */
+
+static int select_name_match(const char *name, const char *cmdline, size_t size)
+{
+  char temp[RXBUFF];
+
+  if( name && !regexec(&select_name, name, 0, 0, 0) )
+  {
+    return 1;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * arguments are '\0' separated, match
+   * against space separated copy
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( size >= sizeof temp ) size = sizeof temp - 1;
+
+  for( size_t i = 0; i < size; ++i )
+  {
+    temp[i] = cmdline[i] ? cmdline[i] : ' ';
+  }
+  temp[size] = 0;
+
+  return !regexec(&select_name, temp, 0, 0, 0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * select_process  --  check selection criteria available from status
+ *
+ * The name / cmdline regex is checked separately with select_name_match()
+ * so that cmdline needs to be read only for processes that pass these.
+ * ------------------------------------------------------------------------- */
+
+static int select_process(const char *pid, const proc_pid_status_t *status)
+{
+  if( select_pid_cnt != 0 )
+  {
+    int key = strtol(pid, 0, 10);
+    if( !bsearch(&key, select_pid_tab, select_pid_cnt,
+                 sizeof *select_pid_tab, select_pid_cb) )
+    {
+      return 0;
+    }
+  }
+
+  if( select_uid != -1 )
+  {
+    if( status->Uid == 0 || strtol(status->Uid, 0, 10) != select_uid )
+    {
+      return 0;
+    }
+  }
+
+  if( select_cgroup != 0 )
+  {
+    if( !select_cgroup_match(pid) )
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/* ========================================================================= *
+ * Capture jobs
+ * ========================================================================= */
+
+typedef struct snapjob_t snapjob_t;
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_t  --  capture state for one process
+ * ------------------------------------------------------------------------- */
+
+struct snapjob_t
+{
+  const char        *pid;          /* /proc entry name */
+  unsigned long      estimate;     /* expected amount of smaps data */
+
+  char              *status_text;  /* /proc/pid/status, status points here */
+  size_t             status_size;
+  proc_pid_status_t  status;
+
+  char              *name;         /* application name as written */
+  size_t             smaps_bytes;  /* 0 -> warn unless kernel thread */
+
+  int                excluded;     /* 1 = by tree, 2 = after reading status */
+
+  capbuf_t           text;         /* captured record, parallel mode only */
+  int                claimed;      /* taken by a worker */
+  int                done;         /* set by worker when text is ready */
+};
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_capture  --  read process data and queue it for output
+ * ------------------------------------------------------------------------- */
+
+static void snapjob_capture(snapjob_t *self)
+{
+  const char *root = proc_root;
+
+  char   *cmdline_text = 0;
+  size_t  cmdline_size = 0;
+
+  if( emergency_mode )
+  {
+    cmdline_text = emergency_cmdline;
+    cmdline_size = EMERGENCY_INPUT;
+    self->status_text = emergency_status;
+    self->status_size = EMERGENCY_INPUT;
+  }
+
+  char exe[256];
+  char path[PATH_MAX];
+  const char *truncated = 0;
+  char *name = NULL;
+
+  double started = monotonic_msecs();
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * /proc/pid/status -> name, pid, ...
+   * - - - - - - - - - - - - - - - - - - - */
+
+  snprintf(path, sizeof path, "%s/%s/%s", root, self->pid,"status");
+  input_file(path, &self->status_text, &self->status_size);
+  proc_pid_status_parse(&self->status, self->status_text);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * excluded processes are dropped before
+   * anything is written or smaps is read;
+   * cmdline is needed only if the status
+   * based criteria match
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( !select_process(self->pid, &self->status) )
+  {
+    self->excluded = 2;
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * /proc/pid/cmdline -> argv[] data
+   * - - - - - - - - - - - - - - - - - - - */
+
+  snprintf(path, sizeof path, "%s/%s/%s", root, self->pid,"cmdline");
+  size_t cmdline_used = input_file(path, &cmdline_text, &cmdline_size);
+
+  if( select_name_on &&
+      !select_name_match(self->status.Name, cmdline_text, cmdline_used) )
+  {
+    self->excluded = 2;
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * /proc/pid/exe -> link to executable
+   * - - - - - - - - - - - - - - - - - - - */
+
+  snprintf(path, sizeof path, "%s/%s/%s", root, self->pid,"exe");
+  int n = readlink(path, exe, sizeof exe - 1);
+  exe[n>0?n:0] = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * section header always refers to /proc
+   * regardless of where the data is read
+   * - - - - - - - - - - - - - - - - - - - */
+
+  output_fmt("==> /proc/%s/smaps <==\n", self->pid);
+  snprintf(path, sizeof path, "%s/%s/smaps", root, self->pid);
+
+  name = strip(cmdline_text);
+
+  if( name == NULL || *name == 0 )
+  {
+    name = strip(exe);
+  }
+  if( name == NULL || *name == 0 )
+  {
+    name = strip(self->status.Name);
+  }
+  if( name == NULL || *name == 0 )
+  {
+    name = "unknown";
+  }
+
+  output_fmt("#Name: %s\n", name);
+  if( emergency_mode )
+  {
+    snprintf(emergency_name, EMERGENCY_INPUT, "%s", name);
+    self->name = emergency_name;
+  }
+  else
+  {
+    self->name = strdup(name);
+  }
+
+#define X(v) if( self->status.v ) output_fmt("#%s: %s\n",#v,self->status.v);
+  X(Tgid)
+  X(Pid)
+  X(PPid)
+  X(Threads)
+  X(FDSize)
+  X(VmPeak)
+  X(VmSize)
+  X(VmLck)
+  X(VmHWM)
+  X(VmRSS)
+  X(VmData)
+  X(VmStk)
+  X(VmExe)
+  X(VmLib)
+  X(VmPTE)
+#undef X
+
+  output_fmt("#ReadTime: %.3f\n", started);
+
+  /* the loader merges threads with the thread group leader */
+  if( !is_thread(&self->status) )
+  {
+    self->smaps_bytes = output_smaps(path, &truncated);
+  }
+
+  if( truncated )
+  {
+    output_fmt("#Truncated: %s\n", truncated);
+    msg_warning("`%s' truncated (%s limit) for process named '%s'\n",
+                path, truncated, name);
+  }
+
+  output_fmt("#ReadDuration: %.3f\n", monotonic_msecs() - started);
+  output_raw("\n", 1);
+
+  if( pause_msecs > 0 )
+  {
+    sleep_msecs(pause_msecs);
+  }
+
+  cleanup:
+
+  if( cmdline_text != emergency_cmdline )
+  {
+    free(cmdline_text);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_finish  --  post capture checks, done in pid order
+ * ------------------------------------------------------------------------- */
+
+static void snapjob_finish(snapjob_t *self)
+{
+  if( self->excluded == 1 )
+  {
+    /* status not read */
+    return;
+  }
+
+  check_kthreadd(&self->status);
+
+  if (self->smaps_bytes == 0
+      && !self->excluded
+      && !is_thread(&self->status)
+      && !is_kthreadd(&self->status)
+      && !is_kernel_thread(&self->status))
+  {
+    msg_warning("`%s/%s/smaps' is empty for process named '%s'!\n",
+                proc_root, self->pid, self->name);
+  }
+
+  if( self->status_text != emergency_status )
+  {
+    free(self->status_text);
+  }
+  self->status_text = 0;
+  if( self->name != emergency_name )
+  {
+    free(self->name);
+  }
+  self->name = 0;
+  capbuf_dtor(&self->text);
+}
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_estimate  --  guess size of smaps data for scheduling purposes
+ * ------------------------------------------------------------------------- */
+
+static unsigned long snapjob_estimate(const char *pid)
+{
+  unsigned long  pages = 0;
+  char           path[PATH_MAX];
+  char           temp[128];
+  int            file;
+  ssize_t        n;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * size of smaps data grows with number of
+   * mappings, which in turn correlates with
+   * the virtual size of the process -> use
+   * the first field from /proc/pid/statm
+   * - - - - - - - - - - - - - - - - - - - */
+
+  snprintf(path, sizeof path, "%s/%s/statm", proc_root, pid);
+
+  if( (file = open(path, O_RDONLY)) != -1 )
+  {
+    if( (n = read(file, temp, sizeof temp - 1)) > 0 )
+    {
+      temp[n] = 0;
+      pages = strtoul(temp, 0, 10);
     }
+    close(file);
   }
-  data[done] = 0;
+  return pages;
+}
 
-  *(char **)pdata = data;
-  *psize = size;
+/* ------------------------------------------------------------------------- *
+ * load_size_hints  --  smaps section sizes from previous capture
+ * ------------------------------------------------------------------------- */
 
-  return done;
+static void load_size_hints(snapjob_t *jobs, int count, const char *path)
+{
+  FILE          *file = 0;
+  char          *data = 0;
+  size_t         size = 0;
+  ssize_t        n;
+  int            pid  = -1;
+  unsigned long  cnt  = 0;
+
+  if( (file = fopen(path, "r")) == 0 )
+  {
+    msg_warning("%s: %s\n", path, strerror(errno));
+    return;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * jobs are in pid order -> bsearch
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( ;; )
+  {
+    n = getline(&data, &size, file);
+
+    if( n < 0 || !strncmp(data, "==> ", 4) )
+    {
+      for( int lo = 0, hi = count; pid > 0 && lo < hi; )
+      {
+        int i = (lo + hi) / 2;
+        int p = atoi(jobs[i].pid);
+        if( p < pid ) { lo = i + 1; continue; }
+        if( p > pid ) { hi = i + 0; continue; }
+        jobs[i].estimate = cnt;
+        break;
+      }
+      if( n < 0 ) break;
+
+      pid = -1, cnt = 0;
+      if( !strncmp(data, "==> /proc/", 10) )
+      {
+        pid = atoi(data + 10);
+      }
+    }
+    cnt += n;
+  }
+
+  free(data);
+  fclose(file);
 }
 
-#define uc(c) ((unsigned char)(c))
-#define wc(c) ((c)>0 && (c)<33)
-#define bc(c) (uc(c)>32)
+/* ========================================================================= *
+ * Capture Header & Trailer
+ * ========================================================================= */
 
-static char *strip(char *str)
+/* ------------------------------------------------------------------------- *
+ * output_sysfile  --  copy "key: value" style /proc file to header
+ * ------------------------------------------------------------------------- */
+
+static void output_sysfile(const char *file, const char *prefix)
 {
-  char *src = str;
-  char *dst = str;
+  char    path[PATH_MAX];
+  char   *text = 0;
+  size_t  size = 0;
 
-  while( wc(*src) ) ++src;
+  if( emergency_mode )
+  {
+    /* not in use between processes */
+    text = emergency_status;
+    size = EMERGENCY_INPUT;
+  }
+
+  snprintf(path, sizeof path, "%s/%s", proc_root, file);
+
+  /* synthetic /proc trees do not need to have these */
+  if( access(path, R_OK) == 0 )
+  {
+    char *pos = text;
+
+    input_file(path, &text, &size);
+
+    for( pos = text; *pos; )
+    {
+      char *row = token(&pos, '\n');
+      char *key = token(&row, -1);
+
+      /* meminfo: "MemTotal: 123 kB", vmstat: "nr_free_pages 123" */
+      key[strcspn(key, ":")] = 0;
+
+      if( *key != 0 )
+      {
+        output_fmt("#%s.%s: %s\n", prefix, key, strip(row));
+      }
+    }
+  }
+
+  if( text != emergency_status )
+  {
+    free(text);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_header  --  system context at start of capture
+ * ------------------------------------------------------------------------- */
+
+static void output_header(void)
+{
+  struct utsname un;
+
+  output_fmt("==> header <==\n");
+  output_fmt("#Format: %d\n", CAPTURE_FORMAT);
+  output_fmt("#Tool: %s %s\n", TOOL_NAME, TOOL_VERS);
+
+  if( uname(&un) == 0 )
+  {
+    output_fmt("#Kernel: %s\n", un.release);
+    output_fmt("#Machine: %s\n", un.machine);
+  }
+
+  output_fmt("#PageSize: %ld\n", sysconf(_SC_PAGESIZE));
+  output_fmt("#StartTime: %.3f\n", monotonic_msecs());
+
+  output_sysfile("meminfo", "meminfo");
+  output_sysfile("vmstat",  "vmstat");
+  output_raw("\n", 1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * output_trailer  --  end of capture
+ * ------------------------------------------------------------------------- */
+
+static void output_trailer(int processes)
+{
+  output_fmt("==> trailer <==\n");
+  output_fmt("#EndTime: %.3f\n", monotonic_msecs());
+  output_fmt("#Processes: %d\n", processes);
+}
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_select_tree  --  exclude processes outside selected tree
+ * ------------------------------------------------------------------------- */
+
+static snapjob_t *snapjob_find(snapjob_t *jobs, int count, int pid)
+{
+  for( int lo = 0, hi = count; lo < hi; )
+  {
+    int i = (lo + hi) / 2;
+    int p = atoi(jobs[i].pid);
+    if( p < pid ) { lo = i + 1; continue; }
+    if( p > pid ) { hi = i + 0; continue; }
+    return &jobs[i];
+  }
+  return 0;
+}
+
+static void snapjob_select_tree(snapjob_t *jobs, int count)
+{
+  char   *text  = 0;
+  size_t  size  = 0;
+  int    *ppid  = 0;
+  char   *state = 0; /* 0=?, 1=in, 2=out */
+  char    path[PATH_MAX];
+
+  if( emergency_mode )
+  {
+    text  = emergency_status;
+    size  = EMERGENCY_INPUT;
+    ppid  = emergency_pidtab;
+    state = emergency_state;
+    memset(state, 0, count);
+  }
+  else
+  {
+    ppid  = calloc(count ? count : 1, sizeof *ppid);
+    state = calloc(count ? count : 1, 1);
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * parent pids from status files; these
+   * are read again for selected processes
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int i = 0; i < count; ++i )
+  {
+    proc_pid_status_t status;
+
+    snprintf(path, sizeof path, "%s/%s/status", proc_root, jobs[i].pid);
+    input_file(path, &text, &size);
+    proc_pid_status_parse(&status, text);
+    ppid[i] = strtol(status.PPid, 0, 10);
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * walk up the parent chain until state
+   * is known, then mark the whole chain
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int i = 0; i < count; ++i )
+  {
+    int cur = i;
+    int res = 2;
+
+    for( int steps = 0; steps < count; ++steps )
+    {
+      if( state[cur] != 0 )
+      {
+        res = state[cur];
+        break;
+      }
+      if( atoi(jobs[cur].pid) == select_tree )
+      {
+        res = 1;
+        break;
+      }
+
+      snapjob_t *par = snapjob_find(jobs, count, ppid[cur]);
+      if( par == 0 )
+      {
+        break;
+      }
+      cur = par - jobs;
+    }
+
+    for( cur = i; state[cur] == 0; )
+    {
+      state[cur] = res;
+
+      snapjob_t *par = snapjob_find(jobs, count, ppid[cur]);
+      if( par == 0 || atoi(jobs[cur].pid) == select_tree )
+      {
+        break;
+      }
+      cur = par - jobs;
+    }
+  }
+
+  for( int i = 0; i < count; ++i )
+  {
+    if( state[i] != 1 )
+    {
+      jobs[i].excluded = 1;
+    }
+  }
+
+  if( text != emergency_status )
+  {
+    free(text);
+  }
+  if( state != emergency_state )
+  {
+    free(state);
+    free(ppid);
+  }
+}
+
+/* ========================================================================= *
+ * Parallel capture
+ * ========================================================================= */
+
+static pthread_mutex_t snapjob_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  snapjob_cond  = PTHREAD_COND_INITIALIZER;
+
+static snapjob_t      *snapjob_tab   = 0;  /* jobs in pid order */
+static int            *snapjob_order = 0;  /* job indices, largest first */
+static int             snapjob_count = 0;
+static int             snapjob_next  = 0;  /* next snapjob_order slot */
+static int             snapjob_head  = 0;  /* next job to be written */
+static size_t          snapjob_pending = 0; /* bytes done but not written */
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_order_cb  --  qsort callback: largest estimate first
+ * ------------------------------------------------------------------------- */
+
+static int snapjob_order_cb(const void *a1, const void *a2)
+{
+  const snapjob_t *j1 = &snapjob_tab[*(const int *)a1];
+  const snapjob_t *j2 = &snapjob_tab[*(const int *)a2];
+
+  if( j1->estimate != j2->estimate )
+  {
+    return (j1->estimate < j2->estimate) ? 1 : -1;
+  }
+  return *(const int *)a1 - *(const int *)a2;
+}
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_take  --  pick next job for a worker, NULL when all are taken
+ *
+ * Largest remaining job is taken while the records pending output fit
+ * in the capture window. Once the window is full, only the job that
+ * output is waiting for gets taken, otherwise the worker waits until
+ * output has caught up. This bounds the buffered data to the window
+ * plus the records being captured.
+ * ------------------------------------------------------------------------- */
+
+static snapjob_t *snapjob_take(void)
+{
+  snapjob_t *job = 0;
+
+  pthread_mutex_lock(&snapjob_mutex);
+
+  for( ;; )
+  {
+    if( snapjob_pending < capture_window )
+    {
+      while( snapjob_next < snapjob_count &&
+             snapjob_tab[snapjob_order[snapjob_next]].claimed )
+      {
+        ++snapjob_next;
+      }
+      if( snapjob_next < snapjob_count )
+      {
+        job = &snapjob_tab[snapjob_order[snapjob_next++]];
+      }
+      break;
+    }
+
+    if( snapjob_head >= snapjob_count )
+    {
+      break;
+    }
+    if( !snapjob_tab[snapjob_head].claimed )
+    {
+      job = &snapjob_tab[snapjob_head];
+      break;
+    }
+    pthread_cond_wait(&snapjob_cond, &snapjob_mutex);
+  }
+
+  if( job != 0 )
+  {
+    job->claimed = 1;
+  }
+
+  pthread_mutex_unlock(&snapjob_mutex);
+
+  return job;
+}
+
+/* ------------------------------------------------------------------------- *
+ * snapjob_worker  --  capture thread
+ * ------------------------------------------------------------------------- */
+
+static void *snapjob_worker(void *aptr)
+{
+  snapjob_t *job;
 
-  for( ;; )
+  while( (job = snapjob_take()) != 0 )
   {
-    if( bc(*src) )
+    if( !job->excluded )
     {
-      *dst++ = *src++;
-      continue;
+      capture_to = &job->text;
+      snapjob_capture(job);
+      capture_to = 0;
     }
 
-    while( wc(*src) ) ++src;
-
-    if( *src == 0 ) break;
-
-    *dst++ = ' ';
+    pthread_mutex_lock(&snapjob_mutex);
+    job->done = 1;
+    snapjob_pending += job->text.used;
+    pthread_cond_broadcast(&snapjob_cond);
+    pthread_mutex_unlock(&snapjob_mutex);
   }
-  *dst = 0;
-  return str;
+  return 0;
 }
 
-static char *token(char **ppos, int sep)
+/* ------------------------------------------------------------------------- *
+ * emergency_list_pids  --  fill preallocated process table in pid order
+ * ------------------------------------------------------------------------- */
+
+static int emergency_list_pids(snapjob_t *jobs)
 {
-  char *beg = *ppos;
+  struct dirent *de;
+  int            cnt = 0;
+  int           *pid = emergency_pidtab;
 
-  if( sep < 0 )
+  rewinddir(emergency_procdir);
+
+  while( (de = readdir(emergency_procdir)) != 0 )
   {
-    while( wc(*beg) ) ++beg;
+    if( !pid_filter_cb(de) )
+    {
+      continue;
+    }
+    if( cnt == EMERGENCY_PIDS )
+    {
+      msg_warning("more than %d processes, rest are skipped\n", cnt);
+      break;
+    }
+    pid[cnt++] = strtol(de->d_name, 0, 10);
   }
 
-  char *end = beg;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * /proc lists processes in pid order,
+   * synthetic trees need sorting; qsort()
+   * may allocate, so use shell sort
+   * - - - - - - - - - - - - - - - - - - - */
 
-  for( ; *end; ++end )
+  for( int gap = cnt / 2; gap > 0; gap /= 2 )
   {
-    //printf("??? '%c' vs '%c'\n", (sep<0) ? '?' : sep, *end);
-    if( ((sep<0) && wc(*end)) || (uc(*end) == uc(sep)) )
+    for( int i = gap; i < cnt; ++i )
     {
-      *end++ = 0; break;
+      int k = pid[i], j = i;
+      for( ; j >= gap && pid[j-gap] > k; j -= gap )
+      {
+        pid[j] = pid[j-gap];
+      }
+      pid[j] = k;
     }
   }
-  *ppos = end;
-  return strip(beg);
-}
 
-typedef struct proc_pid_status_t {
-  char *Name;
-  char *Pid;
-  char *PPid;
-  char *Threads;
-  char *FDSize;
-  char *VmPeak;
-  char *VmSize;
-  char *VmLck;
-  char *VmHWM;
-  char *VmRSS;
-  char *VmData;
-  char *VmStk;
-  char *VmExe;
-  char *VmLib;
-  char *VmPTE;
+  memset(jobs, 0, cnt * sizeof *jobs);
 
-} proc_pid_status_t;
+  for( int i = 0; i < cnt; ++i )
+  {
+    char *str = emergency_pidstr + i * EMERGENCY_PIDLEN;
+    snprintf(str, EMERGENCY_PIDLEN, "%d", pid[i]);
+    jobs[i].pid = str;
+  }
+  return cnt;
+}
 
-static void
-proc_pid_status_parse(proc_pid_status_t *self, char *data)
+/* ------------------------------------------------------------------------- *
+ * snapshot_all  -- retrieve snapshot of information for all processes
+ * ------------------------------------------------------------------------- */
+
+static int snapshot_all(void)
 {
-  static char empty[1] = "";
+  const char *root = proc_root;
 
-  memset(self, 0, sizeof *self);
+  int  err = -1;
+  int  cnt = 0;  /* processes captured */
 
-  self->Name    = empty;
-  self->Pid     = "0";
-  self->PPid    = "0";
-  self->Threads = "0";
+  struct dirent **namelist = 0;
+  int             npids = 0;
+  snapjob_t      *jobs  = 0;
+  pthread_t      *tids  = 0;
+  int             nthreads = 0;
 
-  while( *data )
+  output_header();
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * /proc lists processes in pid order,
+   * but synthetic trees need to be sorted
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( emergency_mode )
   {
-    char *row = token(&data, '\n');
-    char *key = token(&row, ':');
+    jobs  = emergency_jobs;
+    npids = emergency_list_pids(jobs);
+  }
+  else
+  {
+    if( (npids = scandir(root, &namelist, pid_filter_cb, pid_compare_cb)) < 0 )
+    {
+      perror(root);
+      npids = 0;
+      goto cleanup;
+    }
 
-    if( !strcmp(key, "Name") )
+    jobs = calloc(npids ? npids : 1, sizeof *jobs);
+
+    for( int i = 0; i < npids; ++i )
     {
-      self->Name = strip(row);
+      jobs[i].pid = namelist[i]->d_name;
     }
-#define X(v) else if( !strcmp(key, #v) ) { self->v = token(&row, -1); }
-    X(Pid)
-    X(PPid)
-    X(Threads)
-    X(FDSize)
-    X(VmPeak)
-    X(VmSize)
-    X(VmLck)
-    X(VmHWM)
-    X(VmRSS)
-    X(VmData)
-    X(VmStk)
-    X(VmExe)
-    X(VmLib)
-    X(VmPTE)
-#undef X
   }
-}
 
-/* ========================================================================= *
- * Snapshot from /proc/pid/smaps information
- * ========================================================================= */
+  if( select_tree > 0 )
+  {
+    snapjob_select_tree(jobs, npids);
+  }
 
-static char *kthreadd_pid;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * sequential capture: straight to output
+   * - - - - - - - - - - - - - - - - - - - */
 
-static int is_kthreadd(const proc_pid_status_t *status)
-{
-  if (status->Name == NULL)
-    return 0;
-  if (status->PPid == NULL)
-    return 0;
-  return strcmp(status->Name, "kthreadd") == 0
-         && strcmp(status->PPid, "0") == 0;
-}
+  if( capture_jobs <= 1 || emergency_mode )
+  {
+    for( int i = 0; i < npids; ++i )
+    {
+      if( !jobs[i].excluded )
+      {
+        snapjob_capture(&jobs[i]);
+      }
+      cnt += !jobs[i].excluded;
+      snapjob_finish(&jobs[i]);
+    }
+    goto finish;
+  }
 
-static int is_kernel_thread(const proc_pid_status_t *status)
-{
-  if (kthreadd_pid == NULL)
-    return 0;
-  if (status->PPid == NULL)
-    return 0;
-  return strcmp(status->PPid, kthreadd_pid) == 0;
-}
+  /* - - - - - - - - - - - - - - - - - - - *
+   * parallel capture: schedule largest
+   * processes first so that no worker is
+   * left with a huge one at the end
+   * - - - - - - - - - - - - - - - - - - - */
 
-static void check_kthreadd(const proc_pid_status_t *status)
-{
-  if (kthreadd_pid)
-    return;
-  if (status->Pid == NULL)
-    return;
-  if (is_kthreadd(status))
-    kthreadd_pid = strdup(status->Pid);
-}
+  for( int i = 0; i < npids; ++i )
+  {
+    if( !jobs[i].excluded )
+    {
+      jobs[i].estimate = snapjob_estimate(jobs[i].pid);
+    }
+  }
+  if( size_hints != 0 )
+  {
+    load_size_hints(jobs, npids, size_hints);
+  }
 
-/* ------------------------------------------------------------------------- *
- * snapshot_all  -- retrieve snapshot of information for one process
- * ------------------------------------------------------------------------- */
+  snapjob_tab     = jobs;
+  snapjob_count   = npids;
+  snapjob_next    = 0;
+  snapjob_head    = 0;
+  snapjob_pending = 0;
+  snapjob_order = calloc(npids ? npids : 1, sizeof *snapjob_order);
 
-static int snapshot_all(void)
-{
-  char   *status_text = 0;
-  size_t  status_size = 0;
-  char   *cmdline_text = 0;
-  size_t  cmdline_size = 0;
+  for( int i = 0; i < npids; ++i )
+  {
+    snapjob_order[i] = i;
+  }
+  qsort(snapjob_order, npids, sizeof *snapjob_order, snapjob_order_cb);
 
-  static const char root[] = "/proc";
+  tids = calloc(capture_jobs, sizeof *tids);
 
-  int  err = -1;
-  DIR *dir = 0;
-  int  cnt = 0;
+  for( nthreads = 0; nthreads < capture_jobs; ++nthreads )
+  {
+    if( pthread_create(&tids[nthreads], 0, snapjob_worker, 0) != 0 )
+    {
+      msg_error("unable to create capture thread\n");
+      break;
+    }
+  }
+  if( nthreads == 0 )
+  {
+    /* no workers -> do the work ourselves, output waits until done */
+    capture_window = SIZE_MAX;
+    snapjob_worker(0);
+  }
 
-  struct dirent *de;
+  /* - - - - - - - - - - - - - - - - - - - *
+   * output in canonical pid order as the
+   * records become available
+   * - - - - - - - - - - - - - - - - - - - */
 
-  if( (dir = opendir(root)) == 0 )
+  for( int i = 0; i < npids; ++i )
   {
-    perror(root);
-    goto cleanup;
+    snapjob_t *job = &jobs[i];
+
+    pthread_mutex_lock(&snapjob_mutex);
+    while( !job->done )
+    {
+      pthread_cond_wait(&snapjob_cond, &snapjob_mutex);
+    }
+    pthread_mutex_unlock(&snapjob_mutex);
+
+    output_raw(job->text.data, job->text.used);
+    cnt += !job->excluded;
+
+    pthread_mutex_lock(&snapjob_mutex);
+    snapjob_pending -= job->text.used;
+    snapjob_head = i + 1;
+    pthread_cond_broadcast(&snapjob_cond);
+    pthread_mutex_unlock(&snapjob_mutex);
+    snapjob_finish(job);
   }
 
-  while( (de = readdir(dir)) != 0 )
+  for( int i = 0; i < nthreads; ++i )
   {
-    if( '1' <= de->d_name[0] && de->d_name[0] <= '9' )
-    {
-      char exe[256];
-      char path[256];
-      proc_pid_status_t status;
-      size_t smaps_bytes;
-      char *name = NULL;
+    pthread_join(tids[i], 0);
+  }
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * /proc/pid/exe -> link to executable
-       * - - - - - - - - - - - - - - - - - - - */
+  finish:
 
-      snprintf(path, sizeof path, "%s/%s/%s", root, de->d_name,"exe");
-      int n = readlink(path, exe, sizeof exe - 1);
-      exe[n>0?n:0] = 0;
+  output_trailer(cnt);
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * /proc/pid/cmdline -> argv[] data
-       * - - - - - - - - - - - - - - - - - - - */
+  err = 0;
 
-      snprintf(path, sizeof path, "%s/%s/%s", root, de->d_name,"cmdline");
-      input_file(path, &cmdline_text, &cmdline_size);
+  cleanup:
 
-      /* - - - - - - - - - - - - - - - - - - - *
-       * /proc/pid/status -> name, pid, ...
-       * - - - - - - - - - - - - - - - - - - - */
+  free(tids);
+  free(snapjob_order);
+  snapjob_order = 0;
+  snapjob_tab   = 0;
 
-      snprintf(path, sizeof path, "%s/%s/%s", root, de->d_name,"status");
-      input_file(path, &status_text, &status_size);
-      proc_pid_status_parse(&status, status_text);
+  if( jobs != emergency_jobs )
+  {
+    free(jobs);
+  }
 
-      check_kthreadd(&status);
+  for( int i = 0; namelist != 0 && i < npids; ++i )
+  {
+    free(namelist[i]);
+  }
+  free(namelist);
 
-      if( cnt++ != 0 )
-      {
-        output_raw("\n",1);
-      }
+  output_close();
 
-      snprintf(path, sizeof path, "%s/%s/smaps", root, de->d_name);
-      output_fmt("==> %s <==\n", path);
+  return err;
+}
 
-      name = strip(cmdline_text);
+/* ========================================================================= *
+ * Emergency Mode
+ * ========================================================================= */
 
-      if( name == NULL || *name == 0 )
-      {
-        name = strip(exe);
-      }
-      if( name == NULL || *name == 0 )
-      {
-        name = strip(status.Name);
-      }
-      if( name == NULL || *name == 0 )
-      {
-        name = "unknown";
-      }
+/* ------------------------------------------------------------------------- *
+ * prefault_stack  --  make sure stack pages are present before capture
+ * ------------------------------------------------------------------------- */
 
-      output_fmt("#Name: %s\n", name);
-
-#define X(v) if( status.v ) output_fmt("#%s: %s\n",#v,status.v);
-      X(Pid)
-      X(PPid)
-      X(Threads)
-      X(FDSize)
-      X(VmPeak)
-      X(VmSize)
-      X(VmLck)
-      X(VmHWM)
-      X(VmRSS)
-      X(VmData)
-      X(VmStk)
-      X(VmExe)
-      X(VmLib)
-      X(VmPTE)
-#undef X
+static void __attribute__((noinline)) prefault_stack(void)
+{
+  volatile char temp[EMERGENCY_STACK];
 
-      smaps_bytes = output_file(path);
-      if (smaps_bytes == 0
-          && !is_kthreadd(&status)
-          && !is_kernel_thread(&status))
-      {
-        msg_warning("`%s' is empty for process named '%s'!\n", path, name);
-      }
-    }
+  for( size_t i = 0; i < sizeof temp; i += ALIGNMENT )
+  {
+    temp[i] = 0;
   }
+}
 
-  err = 0;
+/* ------------------------------------------------------------------------- *
+ * emergency_setup  --  lock memory and preallocate buffers
+ * ------------------------------------------------------------------------- */
 
-  cleanup:
+static void emergency_setup(void)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * buffers are allocated and touched
+   * before locking, so that the capture
+   * itself does not need to allocate or
+   * fault in pages
+   * - - - - - - - - - - - - - - - - - - - */
 
-  if( dir != 0 ) closedir(dir);
+  emergency_cmdline = calloc(1, EMERGENCY_INPUT);
+  emergency_status  = calloc(1, EMERGENCY_INPUT);
+  emergency_format  = calloc(1, EMERGENCY_FORMAT);
+  emergency_name    = calloc(1, EMERGENCY_INPUT);
+  emergency_jobs    = calloc(EMERGENCY_PIDS, sizeof *emergency_jobs);
+  emergency_pidstr  = calloc(EMERGENCY_PIDS, EMERGENCY_PIDLEN);
+  emergency_pidtab  = calloc(EMERGENCY_PIDS, sizeof *emergency_pidtab);
+  emergency_state   = calloc(EMERGENCY_PIDS, 1);
+
+  if( !emergency_cmdline || !emergency_status || !emergency_format ||
+      !emergency_name || !emergency_jobs || !emergency_pidstr ||
+      !emergency_pidtab || !emergency_state )
+  {
+    msg_fatal("emergency buffers: %s\n", strerror(errno));
+  }
 
-  output_space(1);
+  memset(emergency_cmdline, 0, EMERGENCY_INPUT);
+  memset(emergency_status,  0, EMERGENCY_INPUT);
+  memset(emergency_format,  0, EMERGENCY_FORMAT);
+  memset(emergency_name,    0, EMERGENCY_INPUT);
+  memset(emergency_jobs,    0, EMERGENCY_PIDS * sizeof *emergency_jobs);
+  memset(emergency_pidstr,  0, EMERGENCY_PIDS * EMERGENCY_PIDLEN);
+  memset(emergency_pidtab,  0, EMERGENCY_PIDS * sizeof *emergency_pidtab);
+  memset(emergency_state,   0, EMERGENCY_PIDS);
+
+  /* directory stream buffer is allocated on open */
+  if( (emergency_procdir = opendir(proc_root)) == 0 )
+  {
+    msg_fatal("%s: %s\n", proc_root, strerror(errno));
+  }
+  memset(output_bank,       0, sizeof output_bank);
 
-  free(cmdline_text);
-  free(status_text);
+  if( mlockall(MCL_CURRENT | MCL_FUTURE) == -1 )
+  {
+    msg_warning("mlockall: %s\n", strerror(errno));
+  }
 
-  return err;
+  prefault_stack();
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * open output file (and reserve space)
+   * before starting to capture
+   * - - - - - - - - - - - - - - - - - - - */
+
+  output_open();
 }
 
 /* ========================================================================= *
@@ -833,6 +2728,62 @@ int main(int ac, char **av)
     case opt_output:
       outfile = par;
       break;
+    case opt_compress:
+      compress_output = 1;
+      break;
+    case opt_proc_root:
+      proc_root = par;
+      break;
+
+    case opt_time_limit:
+      limit_msecs = strtol(par, 0, 0);
+      break;
+    case opt_max_mappings:
+      limit_mappings = strtol(par, 0, 0);
+      break;
+    case opt_rate_limit:
+      limit_rate = strtoul(par, 0, 0);
+      break;
+    case opt_pause:
+      pause_msecs = strtol(par, 0, 0);
+      break;
+
+    case opt_jobs:
+      capture_jobs = strtol(par, 0, 0);
+      break;
+    case opt_size_hints:
+      size_hints = par;
+      break;
+    case opt_window:
+      capture_window = strtoul(par, 0, 0);
+      break;
+
+    case opt_emergency:
+      emergency_mode = 1;
+      break;
+    case opt_reserve:
+      output_reserve = strtoll(par, 0, 0);
+      break;
+    case opt_direct:
+      output_direct = 1;
+      break;
+
+    case opt_select_pid:
+      select_add_pids(par);
+      break;
+    case opt_select_tree:
+      select_tree = strtol(par, 0, 10);
+      break;
+    case opt_select_name:
+      select_set_name(par);
+      break;
+    case opt_select_cgroup:
+      select_cgroup = par;
+      break;
+    case opt_select_uid:
+      select_set_uid(par);
+      break;
+
     case opt_realtime:
       if( geteuid() == 0 )
       {
@@ -850,5 +2801,16 @@ int main(int ac, char **av)
 
   argvec_delete(args);
 
+  if( select_pid_cnt != 0 )
+  {
+    qsort(select_pid_tab, select_pid_cnt, sizeof *select_pid_tab,
+          select_pid_cb);
+  }
+
+  if( emergency_mode )
+  {
+    emergency_setup();
+  }
+
   return snapshot_all() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
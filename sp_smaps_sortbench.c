@@ -0,0 +1,445 @@
+/* This program measures record sorting strategies used by sp_smaps_filter.
+ * This file is part of sp-smaps.
+ *
+ * Copyright (C) 2004-2007,2009,2011 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * Include files
+ * ========================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libsysperf/msg.h>
+#include <libsysperf/argvec.h>
+
+#include "spsmaps.h"
+
+/* ========================================================================= *
+ * Configuration
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * Tool Version
+ * ------------------------------------------------------------------------- */
+
+#define TOOL_NAME "sp_smaps_sortbench"
+#include "release.h"
+
+/* ------------------------------------------------------------------------- *
+ * Runtime Manual
+ * ------------------------------------------------------------------------- */
+
+static const manual_t app_man[]=
+{
+  MAN_ADD("NAME",
+          TOOL_NAME"  --  compare qsort and radix sort on mapping tables\n"
+          )
+  MAN_ADD("SYNOPSIS",
+          ""TOOL_NAME" [options]\n"
+          )
+  MAN_ADD("DESCRIPTION",
+          "This tool fills a table with synthetic mapping records and\n"
+          "orders it the ways sp_smaps_filter does: by library, app,\n"
+          "type and descending Rss for the library pages, by app and\n"
+          "library first for the application pages, and processes by\n"
+          "app and pid. Each ordering is done both with qsort and a\n"
+          "comparison callback and with smaps_radix_sort(), the\n"
+          "results are checked to agree and the best time of all\n"
+          "rounds is shown.\n"
+          )
+  MAN_ADD("OPTIONS", 0)
+
+  MAN_ADD("EXAMPLES",
+          "% "TOOL_NAME" -n 5000000 -r 3\n"
+          "\n"
+          "  Times sorting of five million mappings, best of three.\n"
+          )
+  MAN_ADD("COPYRIGHT",
+          "Copyright (C) 2004-2007,2009,2011 Nokia Corporation.\n\n"
+          "This is free software.  You may redistribute copies of it under the\n"
+          "terms of the GNU General Public License v2 included with the software.\n"
+          "There is NO WARRANTY, to the extent permitted by law.\n"
+          )
+  MAN_ADD("SEE ALSO",
+          "sp_smaps_filter (1), sp_smaps_fakeproc (1)\n"
+          "\n"
+          )
+  MAN_END
+};
+
+/* ------------------------------------------------------------------------- *
+ * Commandline Arguments
+ * ------------------------------------------------------------------------- */
+
+enum
+{
+  opt_noswitch = -1,
+  opt_help,
+  opt_vers,
+
+  opt_verbose,
+  opt_quiet,
+  opt_silent,
+
+  opt_records,
+  opt_apps,
+  opt_libraries,
+  opt_rounds,
+  opt_seed,
+};
+
+static const option_t app_opt[] =
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * usage, version & verbosity
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_help,
+          "h", "help", 0,
+          "This help text\n"),
+
+  OPT_ADD(opt_vers,
+          "V", "version", 0,
+          "Tool version\n"),
+
+  OPT_ADD(opt_verbose,
+          "v", "verbose", 0,
+          "Enable diagnostic messages\n"),
+
+  OPT_ADD(opt_quiet,
+          "q", "quiet", 0,
+          "Disable warning messages\n"),
+
+  OPT_ADD(opt_silent,
+          "s", "silent", 0,
+          "Disable all messages\n"),
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * application options
+   * - - - - - - - - - - - - - - - - - - - */
+
+  OPT_ADD(opt_records,
+          "n", "records", "<count>",
+          "Number of mapping records (default: 1000000).\n" ),
+
+  OPT_ADD(opt_apps,
+          "a", "apps", "<count>",
+          "Number of distinct applications (default: 20000).\n" ),
+
+  OPT_ADD(opt_libraries,
+          "l", "libraries", "<count>",
+          "Number of distinct mapping paths (default: 2000).\n" ),
+
+  OPT_ADD(opt_rounds,
+          "r", "rounds", "<count>",
+          "Timing rounds, best one is reported (default: 5).\n" ),
+
+  OPT_ADD(opt_seed,
+          "S", "seed", "<number>",
+          "Random number generator seed (default: 1).\n" ),
+
+  OPT_END
+};
+
+/* ------------------------------------------------------------------------- *
+ * Benchmark parameters
+ * ------------------------------------------------------------------------- */
+
+static int      records   = 1000000;
+static int      apps      = 20000;
+static int      libraries = 2000;
+static int      rounds    = 5;
+static unsigned seed      = 1;
+
+/* ========================================================================= *
+ * Utility functions
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * rnd  --  xorshift prng, same sequence on every platform
+ * ------------------------------------------------------------------------- */
+
+static unsigned rnd_state = 1;
+
+static unsigned rnd(void)
+{
+  unsigned x = rnd_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return rnd_state = x;
+}
+
+/* ------------------------------------------------------------------------- *
+ * now_ms  --  monotonic time stamp
+ * ------------------------------------------------------------------------- */
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/* ========================================================================= *
+ * Orderings
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * comparison callbacks, as used with array_sort()
+ * ------------------------------------------------------------------------- */
+
+static int cmp_lib_app(const void *a1, const void *a2)
+{
+  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
+  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
+  int r;
+  if( (r = m1->smapsmapp_LID - m2->smapsmapp_LID) != 0 ) return r;
+  if( (r = m1->smapsmapp_AID - m2->smapsmapp_AID) != 0 ) return r;
+  if( (r = m1->smapsmapp_TID - m2->smapsmapp_TID) != 0 ) return r;
+  if( (r = m2->smapsmapp_mem.Rss - m1->smapsmapp_mem.Rss) ) return r;
+  return 0;
+}
+
+static int cmp_app_lib(const void *a1, const void *a2)
+{
+  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
+  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
+  int r;
+  if( (r = m1->smapsmapp_AID - m2->smapsmapp_AID) != 0 ) return r;
+  if( (r = m1->smapsmapp_LID - m2->smapsmapp_LID) != 0 ) return r;
+  if( (r = m1->smapsmapp_TID - m2->smapsmapp_TID) != 0 ) return r;
+  if( (r = m2->smapsmapp_mem.Rss - m1->smapsmapp_mem.Rss) ) return r;
+  return 0;
+}
+
+static int cmp_app_pid(const void *a1, const void *a2)
+{
+  const smapsmapp_t *m1 = *(const smapsmapp_t **)a1;
+  const smapsmapp_t *m2 = *(const smapsmapp_t **)a2;
+  int r;
+  if( (r = m1->smapsmapp_AID - m2->smapsmapp_AID) != 0 ) return r;
+  if( (r = m1->smapsmapp_PID - m2->smapsmapp_PID) != 0 ) return r;
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * radix sort keys
+ * ------------------------------------------------------------------------- */
+
+static unsigned key_aid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_AID;
+}
+
+static unsigned key_lid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_LID;
+}
+
+static unsigned key_tid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_TID;
+}
+
+static unsigned key_pid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_PID;
+}
+
+static unsigned key_rss_desc(const void *rec)
+{
+  return ~((const smapsmapp_t *)rec)->smapsmapp_mem.Rss;
+}
+
+static const smaps_radixkey_t keys_lib_app[] =
+{
+  key_lid, key_aid, key_tid, key_rss_desc
+};
+static const smaps_radixkey_t keys_app_lib[] =
+{
+  key_aid, key_lid, key_tid, key_rss_desc
+};
+static const smaps_radixkey_t keys_app_pid[] = { key_aid, key_pid };
+
+/* ------------------------------------------------------------------------- *
+ * ordering table
+ * ------------------------------------------------------------------------- */
+
+static const struct
+{
+  const char       *name;
+  int             (*cmp)(const void *, const void *);
+  const smaps_radixkey_t *keys;
+  int               nkeys;
+} orderings[] =
+{
+  { "lib,app,type,-rss", cmp_lib_app, keys_lib_app, 4 },
+  { "app,lib,type,-rss", cmp_app_lib, keys_app_lib, 4 },
+  { "app,pid",           cmp_app_pid, keys_app_pid, 2 },
+};
+
+/* ========================================================================= *
+ * Benchmark
+ * ========================================================================= */
+
+static void bench_all(void)
+{
+  smapsmapp_t  *recs = calloc(records, sizeof *recs);
+  void        **orig = calloc(records, sizeof *orig);
+  void        **qtab = calloc(records, sizeof *qtab);
+  void        **rtab = calloc(records, sizeof *rtab);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * synthetic records in capture order:
+   * grouped by process, paths scattered
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int i = 0; i < records; ++i )
+  {
+    smapsmapp_t *m = &recs[i];
+
+    m->smapsmapp_AID = (int)((long long)i * apps / records);
+    m->smapsmapp_PID = 100 + 3 * m->smapsmapp_AID + (int)(rnd() % 3);
+    m->smapsmapp_LID = (int)(rnd() % libraries);
+    m->smapsmapp_TID = 1 + (int)(rnd() % 5);
+    m->smapsmapp_mem.Rss = (rnd() % 8) ? rnd() % 4096 : rnd() % (1u << 20);
+
+    orig[i] = m;
+  }
+
+  printf("%-20s %10s %10s %10s %8s\n",
+         "ordering", "records", "qsort/ms", "radix/ms", "speedup");
+
+  for( size_t o = 0; o < sizeof orderings / sizeof *orderings; ++o )
+  {
+    double qbest = 0, rbest = 0;
+
+    for( int r = 0; r < rounds; ++r )
+    {
+      double t0, t1;
+
+      memcpy(qtab, orig, records * sizeof *qtab);
+      t0 = now_ms();
+      qsort(qtab, records, sizeof *qtab, orderings[o].cmp);
+      t1 = now_ms();
+      if( r == 0 || qbest > t1 - t0 ) qbest = t1 - t0;
+
+      memcpy(rtab, orig, records * sizeof *rtab);
+      t0 = now_ms();
+      smaps_radix_sort(rtab, records, orderings[o].keys, orderings[o].nkeys);
+      t1 = now_ms();
+      if( r == 0 || rbest > t1 - t0 ) rbest = t1 - t0;
+
+      /* qsort is not stable, so only the
+       * keys are required to be in sync */
+      for( int i = 0; i < records; ++i )
+      {
+        if( orderings[o].cmp(&qtab[i], &rtab[i]) != 0 )
+        {
+          msg_fatal("%s: orderings differ at %d\n", orderings[o].name, i);
+        }
+      }
+    }
+
+    printf("%-20s %10d %10.1f %10.1f %7.1fx\n",
+           orderings[o].name, records, qbest, rbest,
+           rbest > 0 ? qbest / rbest : 0.0);
+  }
+
+  free(rtab);
+  free(qtab);
+  free(orig);
+  free(recs);
+}
+
+/* ========================================================================= *
+ * Main Entry Point
+ * ========================================================================= */
+
+int main(int ac, char **av)
+{
+  argvec_t *args = argvec_create(ac, av, app_opt, app_man);
+
+  while( !argvec_done(args) )
+  {
+    int       tag  = 0;
+    char     *par  = 0;
+
+    if( !argvec_next(args, &tag, &par) )
+    {
+      msg_error("(use --help for usage)\n");
+      exit(1);
+    }
+
+    switch( tag )
+    {
+    case opt_help:
+      argvec_usage(args);
+      exit(EXIT_SUCCESS);
+
+    case opt_vers:
+      printf("%s\n", TOOL_VERS);
+      exit(EXIT_SUCCESS);
+
+    case opt_verbose:
+      msg_incverbosity();
+      break;
+    case opt_quiet:
+      msg_decverbosity();
+      break;
+    case opt_silent:
+      msg_setsilent();
+      break;
+
+    case opt_records:
+      records = strtol(par, 0, 0);
+      break;
+    case opt_apps:
+      apps = strtol(par, 0, 0);
+      break;
+    case opt_libraries:
+      libraries = strtol(par, 0, 0);
+      break;
+    case opt_rounds:
+      rounds = strtol(par, 0, 0);
+      break;
+    case opt_seed:
+      seed = strtoul(par, 0, 0);
+      break;
+    }
+  }
+
+  argvec_delete(args);
+
+  if( records < 1 || apps < 1 || libraries < 1 || rounds < 1 )
+  {
+    msg_fatal("invalid parameters\n");
+  }
+
+  rnd_state = seed ? seed : 1;
+  bench_all();
+
+  return EXIT_SUCCESS;
+}
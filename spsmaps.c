@@ -0,0 +1,4526 @@
+/*
+ * This file is part of sp-smaps
+ *
+ * Copyright (C) 2004-2007 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * File: spsmaps.c
+ *
+ * Capture data model, parser and memory usage accumulation shared by
+ * sp_smaps_filter and other programs linking against libspsmaps.
+ * ========================================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <zlib.h>
+#include <argz.h>
+
+#include <libsysperf/array.h>
+#include <libsysperf/str_array.h>
+
+#include "spsmaps.h"
+#include "strpool.h"
+#include "symtab.h"
+
+#if 0
+# define INLINE static inline
+# define STATIC static
+#else
+# define INLINE static
+# define STATIC static
+#endif
+
+typedef struct unknown_t unknown_t;
+
+/* ------------------------------------------------------------------------- *
+ * unknown_t
+ * ------------------------------------------------------------------------- */
+
+struct unknown_t
+{
+  char  *un_data;
+  size_t un_size;
+};
+
+#define UNKNOWN_INIT { 0, 0 }
+
+/* parsers run concurrently when several captures are loaded at once */
+static pthread_mutex_t unknown_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* ========================================================================= *
+ * unknown_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * unknown_add
+ * ------------------------------------------------------------------------- */
+
+static int
+unknown_add(unknown_t *self, const char *txt)
+{
+  char *entry = 0;
+  while( (entry = argz_next(self->un_data, self->un_size, entry)) != 0 )
+  {
+    if( !strcmp(entry, txt) )
+    {
+      return 0;
+    }
+  }
+  argz_add(&self->un_data, &self->un_size, txt);
+  return 1;
+}
+
+/* ========================================================================= *
+ * utilities
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * smaps_path_basename  --  file name part of path
+ * ------------------------------------------------------------------------- */
+
+char *
+smaps_path_basename(const char *path)
+{
+  char *r = strrchr(path, '/');
+  return r ? (r+1) : (char *)path;
+}
+
+INLINE void pusum(unsigned *a, unsigned b)
+{
+  *a += b;
+}
+INLINE void pumax(unsigned *a, unsigned b)
+{
+  if( *a < b ) *a=b;
+}
+
+
+/* ------------------------------------------------------------------------- *
+ * array_move  --  TODO: this should be in libsysperf
+ * ------------------------------------------------------------------------- */
+
+INLINE void
+array_move(array_t *self, array_t *from)
+{
+  array_minsize(self, self->size + from->size);
+  for( size_t i = 0; i < from->size; ++i )
+  {
+    self->data[self->size++] = from->data[i];
+  }
+  from->size = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smaps_radix_sort  --  stable LSD radix sort of records by integer keys
+ *
+ * Keys are listed most significant first and extract an unsigned value
+ * from a record; descending order is had by complementing the value.
+ * Each key takes one counting pass when the spread of its values fits
+ * in 16 bits and two passes otherwise. Keys with the same value in all
+ * records are skipped. Records with equal keys keep their order.
+ * ------------------------------------------------------------------------- */
+
+#define RADIX_BITS 16
+#define RADIX_MASK ((1u << RADIX_BITS) - 1)
+
+void
+smaps_radix_sort(void **data, size_t cnt,
+                 const smaps_radixkey_t *keys, int nkeys)
+{
+  void    **src  = data;
+  void    **dst  = malloc(cnt * sizeof *dst);
+  unsigned *ksrc = malloc(cnt * sizeof *ksrc);
+  unsigned *kdst = malloc(cnt * sizeof *kdst);
+  size_t   *offs = 0;
+  size_t    size = 0;
+
+  for( int k = nkeys; k-- > 0; )
+  {
+    unsigned lo = ~0u, hi = 0;
+
+    for( size_t i = 0; i < cnt; ++i )
+    {
+      unsigned v = keys[k](src[i]);
+      if( lo > v ) lo = v;
+      if( hi < v ) hi = v;
+      ksrc[i] = v;
+    }
+    if( lo >= hi )
+    {
+      continue;
+    }
+
+    for( int shift = 0; shift < 32 && ((hi - lo) >> shift) != 0; shift += RADIX_BITS )
+    {
+      unsigned top  = (hi - lo) >> shift;
+      size_t   nbkt = (top > RADIX_MASK ? RADIX_MASK : top) + 1;
+
+      if( size < nbkt + 1 )
+      {
+        free(offs), offs = malloc((size = nbkt + 1) * sizeof *offs);
+      }
+      memset(offs, 0, (nbkt + 1) * sizeof *offs);
+
+      for( size_t i = 0; i < cnt; ++i )
+      {
+        offs[(((ksrc[i] - lo) >> shift) & RADIX_MASK) + 1] += 1;
+      }
+      for( size_t b = 0; b < nbkt; ++b )
+      {
+        offs[b+1] += offs[b];
+      }
+      for( size_t i = 0; i < cnt; ++i )
+      {
+        size_t j = offs[((ksrc[i] - lo) >> shift) & RADIX_MASK]++;
+        dst[j]  = src[i];
+        kdst[j] = ksrc[i];
+      }
+
+      void     **t = src;  src  = dst;  dst  = t;
+      unsigned  *u = ksrc; ksrc = kdst; kdst = u;
+    }
+  }
+
+  if( src != data )
+  {
+    memcpy(data, src, cnt * sizeof *data);
+    dst = src;
+  }
+
+  free(dst);
+  free(ksrc);
+  free(kdst);
+  free(offs);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smaps_xstrfmt  --  sprintf to dynamically allocated buffer
+ * ------------------------------------------------------------------------- */
+
+char *
+smaps_xstrfmt(char **pstr, const char *fmt, ...)
+{
+  char *res = 0;
+  char tmp[256];
+  va_list va;
+  int nc;
+
+  va_start(va, fmt);
+  nc = vsnprintf(tmp, sizeof tmp, fmt, va);
+  va_end(va);
+
+  if( nc >= 0 )
+  {
+    if( nc < sizeof tmp )
+    {
+      res = strdup(tmp);
+    }
+    else
+    {
+      res = malloc(nc + 1);
+      va_start(va, fmt);
+      vsnprintf(res, nc+1, fmt, va);
+      va_end(va);
+    }
+  }
+
+  free(*pstr);
+  return *pstr = res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * temp_path  --  unique name for writing a file that is then renamed
+ * ------------------------------------------------------------------------- */
+
+static char *
+temp_path(const char *path)
+{
+  static int serial = 0;
+  char *temp = 0;
+
+  smaps_xstrfmt(&temp, "%s.%d.%d", path, (int)getpid(),
+                __sync_fetch_and_add(&serial, 1));
+  return temp;
+}
+
+/* ------------------------------------------------------------------------- *
+ * slice  --  split string at separator char
+ * ------------------------------------------------------------------------- */
+
+static char *
+slice(char **ppos, int sep)
+{
+  char *pos = *ppos;
+
+  while( (*pos > 0) && (*pos <= 32) )
+  {
+    ++pos;
+  }
+  char *res = pos;
+
+  if( sep < 0 )
+  {
+    for( ; *pos; ++pos )
+    {
+      if( *(unsigned char *)pos <= 32 )
+      {
+        *pos++ = 0; break;
+      }
+    }
+  }
+  else
+  {
+    for( ; *pos; ++pos )
+    {
+      if( *(unsigned char *)pos == sep )
+      {
+        *pos++ = 0; break;
+      }
+    }
+  }
+
+  *ppos = pos;
+  return res;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smaps_intern  --  strings shared by all loaded captures
+ *
+ * Mapping attributes repeat a lot both within and across captures, so
+ * they are stored once in a pool that lives until the program exits.
+ * In server mode this keeps the pool warm from one request to the next,
+ * until smaps_intern_trim() finds it has grown past the given limit.
+ * The pool is shared by all threads, so access is serialized.
+ * ------------------------------------------------------------------------- */
+
+static strpool_t      *smaps_strings = 0;
+static pthread_mutex_t smaps_strings_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *
+smaps_intern(const char *str)
+{
+  const char *res;
+
+  pthread_mutex_lock(&smaps_strings_mutex);
+  if( smaps_strings == 0 )
+  {
+    smaps_strings = strpool_create();
+  }
+  res = strpool_intern(smaps_strings, str);
+  pthread_mutex_unlock(&smaps_strings_mutex);
+
+  return res;
+}
+
+size_t
+smaps_intern_count(void)
+{
+  size_t count = 0;
+
+  pthread_mutex_lock(&smaps_strings_mutex);
+  if( smaps_strings != 0 )
+  {
+    count = smaps_strings->strpool_count;
+  }
+  pthread_mutex_unlock(&smaps_strings_mutex);
+
+  return count;
+}
+
+void
+smaps_intern_release(void)
+{
+  pthread_mutex_lock(&smaps_strings_mutex);
+  strpool_delete(smaps_strings), smaps_strings = 0;
+  pthread_mutex_unlock(&smaps_strings_mutex);
+}
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * release the pool if it holds more than
+ * limit strings; only allowed while no
+ * loaded capture refers to the strings
+ * - - - - - - - - - - - - - - - - - - - */
+
+int
+smaps_intern_trim(size_t limit)
+{
+  int released = 0;
+
+  pthread_mutex_lock(&smaps_strings_mutex);
+  if( smaps_strings != 0 && smaps_strings->strpool_count > limit )
+  {
+    strpool_delete(smaps_strings), smaps_strings = 0;
+    released = 1;
+  }
+  pthread_mutex_unlock(&smaps_strings_mutex);
+
+  return released;
+}
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * path ordering: "[...]" pseudo paths
+ * first, then ".cache" files, then by
+ * basename and full path ignoring case
+ *
+ * Paths must be interned: the rank and
+ * basename offset are computed once per
+ * distinct path and cached in the pool
+ * entry; threads racing to fill in the
+ * key store the same value
+ *
+ *   bit 31     : key is valid
+ *   bits 29-30 : not "[...]", has ".cache"
+ *   bits 0-28  : basename offset
+ * - - - - - - - - - - - - - - - - - - - */
+
+#define PATHKEY_VALID   (1u<<31)
+#define PATHKEY_RANK(k) (((k) >> 29) & 3)
+#define PATHKEY_BASE(k) ((k) & ((1u<<29)-1))
+
+static unsigned
+path_sortkey(const char *path)
+{
+  unsigned *aux = strpool_aux(path);
+  unsigned  key = __atomic_load_n(aux, __ATOMIC_RELAXED);
+
+  if( key == 0 )
+  {
+    unsigned rank = ((*path != '[') << 1) | (strstr(path, ".cache") != 0);
+    size_t   base = smaps_path_basename(path) - path;
+
+    key = PATHKEY_VALID | (rank << 29) | (unsigned)base;
+    __atomic_store_n(aux, key, __ATOMIC_RELAXED);
+  }
+  return key;
+}
+
+static int
+path_compare(const char *p1, const char *p2)
+{
+  unsigned k1, k2;
+  int      r;
+
+  if( p1 == p2 )
+  {
+    return 0;
+  }
+
+  k1 = path_sortkey(p1);
+  k2 = path_sortkey(p2);
+
+  if( (r = (int)PATHKEY_RANK(k1) - (int)PATHKEY_RANK(k2)) != 0 )
+  {
+    return r;
+  }
+  if( (r = strcasecmp(p1 + PATHKEY_BASE(k1), p2 + PATHKEY_BASE(k2))) != 0 )
+  {
+    return r;
+  }
+  return strcasecmp(p1, p2);
+}
+
+/* ========================================================================= *
+ * meminfo_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_ctor(meminfo_t *self)
+{
+  memset(self, 0, sizeof(*self));
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_dtor(meminfo_t *self)
+{
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_parse
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_parse(meminfo_t *self, char *line)
+{
+  char *key = slice(&line, ':');
+  char *val = slice(&line,  -1);
+
+  if( !strcmp(key, "Size") )
+  {
+    self->Size  = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Rss") )
+  {
+    self->Rss   = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Shared_Clean") )
+  {
+    self->Shared_Clean  = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Shared_Dirty") )
+  {
+    self->Shared_Dirty  = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Private_Clean") )
+  {
+    self->Private_Clean = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Private_Dirty") )
+  {
+    self->Private_Dirty = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Pss") )
+  {
+    self->Pss   = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Swap") )
+  {
+    self->Swap   = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Referenced") )
+  {
+    self->Referenced   = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Anonymous") )
+  {
+    self->Anonymous = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "Locked") )
+  {
+    self->Locked = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "KernelPageSize")
+        || !strcmp(key, "MMUPageSize")
+      )
+  {
+  }
+  else
+  {
+    static unknown_t unkn = UNKNOWN_INIT;
+    int fresh;
+
+    pthread_mutex_lock(&unknown_mutex);
+    fresh = unknown_add(&unkn, key);
+    pthread_mutex_unlock(&unknown_mutex);
+
+    if( fresh )
+    {
+      fprintf(stderr, "%s: Unknown key: '%s' = '%s'\n", __FUNCTION__, key, val);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_parse_fields  --  parse line, skipping fields not asked for
+ * ------------------------------------------------------------------------- */
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * known keys, roughly in the order the
+ * kernel lists them; zero bit = ignored
+ * - - - - - - - - - - - - - - - - - - - */
+
+static const struct
+{
+  const char *key;
+  size_t      len;
+  unsigned    bit;
+  size_t      offs;
+} meminfo_keys[] =
+{
+#define K(v,b) { #v, sizeof #v - 1, b, offsetof(meminfo_t, v) }
+  K(Size,          SMAPSFIELD_SIZE),
+  { "KernelPageSize", 14, 0, 0 },
+  { "MMUPageSize",    11, 0, 0 },
+  K(Rss,           SMAPSFIELD_RSS),
+  K(Pss,           SMAPSFIELD_PSS),
+  K(Shared_Clean,  SMAPSFIELD_SHARED_CLEAN),
+  K(Shared_Dirty,  SMAPSFIELD_SHARED_DIRTY),
+  K(Private_Clean, SMAPSFIELD_PRIVATE_CLEAN),
+  K(Private_Dirty, SMAPSFIELD_PRIVATE_DIRTY),
+  K(Referenced,    SMAPSFIELD_REFERENCED),
+  K(Anonymous,     SMAPSFIELD_ANONYMOUS),
+  K(Swap,          SMAPSFIELD_SWAP),
+  K(Locked,        SMAPSFIELD_LOCKED),
+#undef K
+};
+
+void
+meminfo_parse_fields(meminfo_t *self, char *line, unsigned fields)
+{
+  size_t len = strcspn(line, ":");
+
+  if( line[len] == ':' )
+  {
+    for( size_t i = 0; i < sizeof meminfo_keys / sizeof *meminfo_keys; ++i )
+    {
+      if( meminfo_keys[i].len != len || memcmp(meminfo_keys[i].key, line, len) )
+      {
+        continue;
+      }
+      if( fields & meminfo_keys[i].bit )
+      {
+        unsigned *val = (unsigned *)((char *)self + meminfo_keys[i].offs);
+        *val = strtoul(line + len + 1, 0, 10);
+      }
+      return;
+    }
+  }
+
+  // unknown keys get reported
+  meminfo_parse(self, line);
+}
+
+int
+meminfo_all_zeroes(const meminfo_t *self)
+{
+  return self->Size == 0
+    && self->Rss == 0
+    && self->Shared_Clean == 0
+    && self->Shared_Dirty == 0
+    && self->Private_Clean == 0
+    && self->Private_Dirty == 0
+    && self->Pss == 0
+    && self->Swap == 0
+    && self->Referenced == 0
+    && self->Anonymous == 0
+    && self->Locked == 0
+    ;
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_accumulate_appdata
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_accumulate_appdata(meminfo_t *self, const meminfo_t *that)
+{
+  pusum(&self->Size,          that->Size);
+  pusum(&self->Rss,           that->Rss);
+  pusum(&self->Shared_Clean,  that->Shared_Clean);
+  pusum(&self->Shared_Dirty,  that->Shared_Dirty);
+  pusum(&self->Private_Clean, that->Private_Clean);
+  pusum(&self->Private_Dirty, that->Private_Dirty);
+  pusum(&self->Pss,           that->Pss);
+  pusum(&self->Swap,          that->Swap);
+  pusum(&self->Referenced,    that->Referenced);
+  pusum(&self->Anonymous,     that->Anonymous);
+  pusum(&self->Locked,        that->Locked);
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_accumulate_libdata
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_accumulate_libdata(meminfo_t *self, const meminfo_t *that)
+{
+  pumax(&self->Size,          that->Size);
+  pumax(&self->Rss,           that->Rss);
+  pumax(&self->Shared_Clean,  that->Shared_Clean);
+  pumax(&self->Shared_Dirty,  that->Shared_Dirty);
+  pusum(&self->Private_Clean, that->Private_Clean);
+  pusum(&self->Private_Dirty, that->Private_Dirty);
+  pusum(&self->Pss,           that->Pss);
+  pumax(&self->Swap,          that->Swap);
+  pumax(&self->Referenced,    that->Referenced);
+  pusum(&self->Anonymous,     that->Anonymous);
+  pusum(&self->Locked,        that->Locked);
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_accumulate_maxdata
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_accumulate_maxdata(meminfo_t *self, const meminfo_t *that)
+{
+  pumax(&self->Size,          that->Size);
+  pumax(&self->Rss,           that->Rss);
+  pumax(&self->Shared_Clean,  that->Shared_Clean);
+  pumax(&self->Shared_Dirty,  that->Shared_Dirty);
+  pumax(&self->Private_Clean, that->Private_Clean);
+  pumax(&self->Private_Dirty, that->Private_Dirty);
+  pumax(&self->Pss,           that->Pss);
+  pumax(&self->Swap,          that->Swap);
+  pumax(&self->Referenced,    that->Referenced);
+  pumax(&self->Anonymous,     that->Anonymous);
+  pumax(&self->Locked,        that->Locked);
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_create
+ * ------------------------------------------------------------------------- */
+
+meminfo_t *
+meminfo_create(void)
+{
+  meminfo_t *self = calloc(1, sizeof *self);
+  meminfo_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_delete
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_delete(meminfo_t *self)
+{
+  if( self != 0 )
+  {
+    meminfo_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+meminfo_delete_cb(void *self)
+{
+  meminfo_delete(self);
+}
+
+/* ========================================================================= *
+ * mapinfo_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+mapinfo_ctor(mapinfo_t *self)
+{
+  self->head    = 0;
+  self->tail    = 0;
+  self->prot    = 0;
+  self->offs    = 0;
+  self->node    = 0;
+  self->flgs    = 0;
+  self->path    = 0;
+  self->type    = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+mapinfo_dtor(mapinfo_t *self)
+{
+  /* strings belong to the intern pool */
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_create
+ * ------------------------------------------------------------------------- */
+
+mapinfo_t *
+mapinfo_create(void)
+{
+  mapinfo_t *self = calloc(1, sizeof *self);
+  mapinfo_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_delete
+ * ------------------------------------------------------------------------- */
+
+void
+mapinfo_delete(mapinfo_t *self)
+{
+  if( self != 0 )
+  {
+    mapinfo_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+mapinfo_delete_cb(void *self)
+{
+  mapinfo_delete(self);
+}
+
+/* ========================================================================= *
+ * pidinfo_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+pidinfo_ctor(pidinfo_t *self)
+{
+  memset(self, 0, sizeof(*self));
+  self->Name = strdup("<noname>");
+}
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+pidinfo_dtor(pidinfo_t *self)
+{
+  free(self->Name);
+  free(self->Truncated);
+  free(self->ReadTime);
+  free(self->ReadDuration);
+}
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_parse
+ * ------------------------------------------------------------------------- */
+
+void
+pidinfo_parse(pidinfo_t *self, char *line)
+{
+  char *key = slice(&line, ':');
+  char *val = slice(&line,  -1);
+
+  if( !strcmp(key, "Name") )
+  {
+    while( *val == '-' ) ++val;
+    xstrset(&self->Name, val);
+  }
+  else if( !strcmp(key, "Tgid") )
+  {
+    self->Tgid  = strtol(val, 0, 10);
+  }
+  else if( !strcmp(key, "Pid") )
+  {
+    self->Pid   = strtol(val, 0, 10);
+  }
+  else if( !strcmp(key, "PPid") )
+  {
+    self->PPid  = strtol(val, 0, 10);
+  }
+  else if( !strcmp(key, "Threads") )
+  {
+    self->Threads       = strtol(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmPeak") )
+  {
+    self->VmPeak        = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmSize") )
+  {
+    self->VmSize        = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmLck") )
+  {
+    self->VmLck = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmHWM") )
+  {
+    self->VmHWM = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmRSS") )
+  {
+    self->VmRSS = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmData") )
+  {
+    self->VmData        = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmStk") )
+  {
+    self->VmStk = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmExe") )
+  {
+    self->VmExe = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmLib") )
+  {
+    self->VmLib = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "VmPTE") )
+  {
+    self->VmPTE = strtoul(val, 0, 10);
+  }
+  else if( !strcmp(key, "ReadTime") )
+  {
+    xstrset(&self->ReadTime, val);
+  }
+  else if( !strcmp(key, "ReadDuration") )
+  {
+    xstrset(&self->ReadDuration, val);
+  }
+  else if( !strcmp(key, "Truncated") )
+  {
+    xstrset(&self->Truncated, val);
+    fprintf(stderr, "Warning: pid %d: smaps data truncated at capture (%s limit)\n",
+            self->Pid, val);
+  }
+  else if( !strcmp(key, "State")
+        || !strcmp(key, "TracerPid")
+        || !strcmp(key, "Uid")
+        || !strcmp(key, "Gid")
+        || !strcmp(key, "FDSize")
+        || !strcmp(key, "Groups")
+        || !strcmp(key, "SigQ")
+        || !strcmp(key, "SigPnd")
+        || !strcmp(key, "ShdPnd")
+        || !strcmp(key, "SigBlk")
+        || !strcmp(key, "SigCgt")
+        || !strcmp(key, "SigIgn")
+        || !strcmp(key, "CapInh")
+        || !strcmp(key, "CapPrm")
+        || !strcmp(key, "CapEff")
+        || !strcmp(key, "CapBnd")
+        || !strcmp(key, "voluntary_ctxt_switches")
+        || !strcmp(key, "nonvoluntary_ctxt_switches")
+      )
+  {
+  }
+  else
+  {
+    static unknown_t unkn = UNKNOWN_INIT;
+    int fresh;
+
+    pthread_mutex_lock(&unknown_mutex);
+    fresh = unknown_add(&unkn, key);
+    pthread_mutex_unlock(&unknown_mutex);
+
+    if( fresh )
+    {
+      fprintf(stderr, "%s: Unknown key: '%s' = '%s'\n", __FUNCTION__, key, val);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_create
+ * ------------------------------------------------------------------------- */
+
+pidinfo_t *
+pidinfo_create(void)
+{
+  pidinfo_t *self = calloc(1, sizeof *self);
+  pidinfo_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_delete
+ * ------------------------------------------------------------------------- */
+
+void
+pidinfo_delete(pidinfo_t *self)
+{
+  if( self != 0 )
+  {
+    pidinfo_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+pidinfo_delete_cb(void *self)
+{
+  pidinfo_delete(self);
+}
+
+/* ========================================================================= *
+ * smapsmapp_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsmapp_ctor(smapsmapp_t *self)
+{
+  static int uid = 0;
+  self->smapsmapp_uid = __sync_fetch_and_add(&uid, 1);
+
+  self->smapsmapp_AID = -1;
+  self->smapsmapp_PID = -1;
+  self->smapsmapp_LID = -1;
+  self->smapsmapp_TID = -1;
+  self->smapsmapp_EID = -1;
+
+  mapinfo_ctor(&self->smapsmapp_map);
+  meminfo_ctor(&self->smapsmapp_mem);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsmapp_dtor(smapsmapp_t *self)
+{
+  mapinfo_dtor(&self->smapsmapp_map);
+  meminfo_dtor(&self->smapsmapp_mem);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_create
+ * ------------------------------------------------------------------------- */
+
+smapsmapp_t *
+smapsmapp_create(void)
+{
+  smapsmapp_t *self = calloc(1, sizeof *self);
+  smapsmapp_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_delete
+ * ------------------------------------------------------------------------- */
+
+void
+smapsmapp_delete(smapsmapp_t *self)
+{
+  if( self != 0 )
+  {
+    smapsmapp_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+smapsmapp_delete_cb(void *self)
+{
+  smapsmapp_delete(self);
+}
+
+/* ========================================================================= *
+ * smapsproc_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsproc_ctor(smapsproc_t *self)
+{
+  static int uid = 0;
+  self->smapsproc_uid = __sync_fetch_and_add(&uid, 1);
+
+  self->smapsproc_AID = -1;
+  self->smapsproc_PID = -1;
+
+  pidinfo_ctor(&self->smapsproc_pid);
+  array_ctor(&self->smapsproc_mapplist, smapsmapp_delete_cb);
+
+  self->smapsproc_parent = 0;
+  array_ctor(&self->smapsproc_children, 0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsproc_dtor(smapsproc_t *self)
+{
+  pidinfo_dtor(&self->smapsproc_pid);
+  array_dtor(&self->smapsproc_mapplist);
+  array_dtor(&self->smapsproc_children);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_are_same
+ * ------------------------------------------------------------------------- */
+
+int
+smapsproc_are_same(smapsproc_t *self, smapsproc_t *that)
+{
+  if( strcmp(self->smapsproc_pid.Name, that->smapsproc_pid.Name) ) return 0;
+
+#if 01
+# define cp(v) if( self->smapsproc_pid.v != that->smapsproc_pid.v ) return 0;
+  cp(VmPeak)
+  cp(VmSize)
+  cp(VmLck)
+  cp(VmHWM)
+  cp(VmRSS)
+  cp(VmData)
+  cp(VmStk)
+  cp(VmExe)
+  cp(VmLib)
+  cp(VmPTE)
+# undef cp
+#endif
+
+  return 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_adopt_children
+ * ------------------------------------------------------------------------- */
+
+void
+smapsproc_adopt_children(smapsproc_t *self, smapsproc_t *that)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * fix parent pointers
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < that->smapsproc_children.size; ++i )
+  {
+    smapsproc_t *child = that->smapsproc_children.data[i];
+    child->smapsproc_parent = self;
+    child->smapsproc_pid.PPid = self->smapsproc_pid.Pid;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * move children to new parent
+   * - - - - - - - - - - - - - - - - - - - */
+
+  array_move(&self->smapsproc_children, &that->smapsproc_children);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_collapse_threads
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  smapsproc_t *proc;
+  size_t       next;
+} procwalk_t;
+
+static void
+smapsproc_collapse_node(smapsproc_t *self)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * heuristic: children that are similar
+   * enough to parent are actually threads
+   *
+   * kept children are packed in place;
+   * adopted grandchildren get appended to
+   * the end and are checked in turn
+   * - - - - - - - - - - - - - - - - - - - */
+
+  array_t *kids = &self->smapsproc_children;
+  size_t   keep = 0;
+
+  for( size_t i = 0; i < kids->size; ++i )
+  {
+    smapsproc_t *that = kids->data[i];
+
+    if( !smapsproc_are_same(self, that) )
+    {
+      kids->data[keep++] = that;
+      continue;
+    }
+
+    fprintf(stderr, "REPARENT: %d\n", that->smapsproc_pid.Pid);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * adopt grandchildren
+     * - - - - - - - - - - - - - - - - - - - */
+
+    smapsproc_adopt_children(self, that);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * disassosiate parent & child
+     * - - - - - - - - - - - - - - - - - - - */
+
+    self->smapsproc_pid.Threads += that->smapsproc_pid.Threads;
+    that->smapsproc_parent = 0;
+  }
+  kids->size = keep;
+}
+
+void
+smapsproc_collapse_threads(smapsproc_t *self)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * depth first, children before parent,
+   * using an explicit stack so that deep
+   * process chains do not exhaust the
+   * call stack
+   * - - - - - - - - - - - - - - - - - - - */
+
+  size_t      size  = 64;
+  size_t      depth = 0;
+  procwalk_t *stack = malloc(size * sizeof *stack);
+
+  stack[depth++] = (procwalk_t){ self, 0 };
+
+  while( depth > 0 )
+  {
+    procwalk_t *top = &stack[depth-1];
+
+    if( top->next < top->proc->smapsproc_children.size )
+    {
+      smapsproc_t *sub = top->proc->smapsproc_children.data[top->next++];
+
+      if( depth == size )
+      {
+        size *= 2;
+        stack = realloc(stack, size * sizeof *stack);
+      }
+      stack[depth++] = (procwalk_t){ sub, 0 };
+      continue;
+    }
+
+    smapsproc_collapse_node(top->proc);
+    --depth;
+  }
+
+  free(stack);
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapping_type  --  "[heap]" -> "heap", else "code" or "data"
+ * ------------------------------------------------------------------------- */
+
+static const char *
+mapping_type(const char *prot, const char *path, char *temp, size_t size)
+{
+  if( *path == '[' )
+  {
+    ++path;
+    snprintf(temp, size, "%.*s", (int)strcspn(path,"]"), path);
+    return temp;
+  }
+  return strchr(prot, 'x') ? "code" : "data";
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_add_mapping
+ * ------------------------------------------------------------------------- */
+
+smapsmapp_t  *
+smapsproc_add_mapping(smapsproc_t *self,
+                      unsigned head,
+                      unsigned tail,
+                      const char *prot,
+                      unsigned offs,
+                      const char *node,
+                      unsigned flgs,
+                      const char *path)
+{
+  char         temp[32];
+  smapsmapp_t *mapp = smapsmapp_create();
+
+  mapp->smapsmapp_map.head = head;
+  mapp->smapsmapp_map.tail = tail;
+  mapp->smapsmapp_map.offs = offs;
+  mapp->smapsmapp_map.flgs = flgs;
+
+  if( path == 0 || *path == 0 )
+  {
+    path = "[anon]";
+  }
+
+  mapp->smapsmapp_map.prot = smaps_intern(prot);
+  mapp->smapsmapp_map.node = smaps_intern(node);
+  mapp->smapsmapp_map.path = smaps_intern(path);
+  mapp->smapsmapp_map.type = smaps_intern(mapping_type(prot, path, temp,
+                                                       sizeof temp));
+
+  array_add(&self->smapsproc_mapplist, mapp);
+  return mapp;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_create
+ * ------------------------------------------------------------------------- */
+
+smapsproc_t *
+smapsproc_create(void)
+{
+  smapsproc_t *self = calloc(1, sizeof *self);
+  smapsproc_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_delete
+ * ------------------------------------------------------------------------- */
+
+void
+smapsproc_delete(smapsproc_t *self)
+{
+  if( self != 0 )
+  {
+    smapsproc_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+smapsproc_delete_cb(void *self)
+{
+  smapsproc_delete(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_compare_pid_cb
+ * ------------------------------------------------------------------------- */
+
+int smapsproc_compare_pid_cb(const void *a1, const void *a2)
+{
+  const smapsproc_t *p1 = *(const smapsproc_t **)a1;
+  const smapsproc_t *p2 = *(const smapsproc_t **)a2;
+  return p1->smapsproc_pid.Pid - p2->smapsproc_pid.Pid;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_compare_name_pid_cb
+ * ------------------------------------------------------------------------- */
+
+int smapsproc_compare_name_pid_cb(const void *a1, const void *a2)
+{
+  const smapsproc_t *p1 = *(const smapsproc_t **)a1;
+  const smapsproc_t *p2 = *(const smapsproc_t **)a2;
+  int r = strcasecmp(p1->smapsproc_pid.Name, p2->smapsproc_pid.Name);
+  return r ? r : (p1->smapsproc_pid.Pid - p2->smapsproc_pid.Pid);
+}
+
+/* ========================================================================= *
+ * smapssnap_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_sort_pid  --  order process list by pid
+ * ------------------------------------------------------------------------- */
+
+static unsigned
+smapsproc_key_pid(const void *rec)
+{
+  // bias so that the unsigned key orders like the signed pid
+  return (unsigned)((const smapsproc_t *)rec)->smapsproc_pid.Pid + 0x80000000u;
+}
+
+static void
+smapssnap_sort_pid(smapssnap_t *self)
+{
+  static const smaps_radixkey_t keys[] = { smapsproc_key_pid };
+
+  smaps_radix_sort(self->smapssnap_proclist.data,
+                   self->smapssnap_proclist.size, keys, 1);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_ctor(smapssnap_t *self)
+{
+  self->smapssnap_source = strdup("<unset>");
+  self->smapssnap_format = SNAPFORMAT_OLD;
+  self->smapssnap_pagesize = 0;
+
+  array_ctor(&self->smapssnap_proclist, smapsproc_delete_cb);
+  smapsproc_ctor(&self->smapssnap_rootproc);
+  self->smapssnap_fields = SMAPSFIELD_ALL;
+
+  array_ctor(&self->smapssnap_header,  free);
+  array_ctor(&self->smapssnap_trailer, free);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_dtor(smapssnap_t *self)
+{
+  free(self->smapssnap_source);
+  array_dtor(&self->smapssnap_proclist);
+  smapsproc_dtor(&self->smapssnap_rootproc);
+
+  array_dtor(&self->smapssnap_header);
+  array_dtor(&self->smapssnap_trailer);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_get_source
+ * ------------------------------------------------------------------------- */
+
+const char *
+smapssnap_get_source(smapssnap_t *self)
+{
+  return self->smapssnap_source;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_set_source
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_set_source(smapssnap_t *self, const char *path)
+{
+  xstrset(&self->smapssnap_source, path);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_set_fields  --  limit data loaded from capture
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_set_fields(smapssnap_t *self, unsigned fields)
+{
+  self->smapssnap_fields = fields & SMAPSFIELD_ALL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_create_hierarchy
+ * ------------------------------------------------------------------------- */
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * binsearch utility function
+ * - - - - - - - - - - - - - - - - - - - */
+
+static smapsproc_t *
+proc_find(smapssnap_t *self, int pid)
+{
+  int lo = 0, hi = self->smapssnap_proclist.size;
+  while( lo < hi )
+  {
+    int i = (lo + hi) / 2;
+    smapsproc_t *p = self->smapssnap_proclist.data[i];
+
+    if( p->smapsproc_pid.Pid > pid ) { hi = i+0; continue; }
+    if( p->smapsproc_pid.Pid < pid ) { lo = i+1; continue; }
+    return p;
+  }
+  return 0;
+}
+
+void
+smapssnap_create_hierarchy(smapssnap_t *self)
+{
+  /* - - - - - - - - - - - - - - - - - - - *
+   * sort processes by PID
+   * - - - - - - - - - - - - - - - - - - - */
+
+  smapssnap_sort_pid(self);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * find parent for every process
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
+  {
+    smapsproc_t *cur = self->smapssnap_proclist.data[i];
+    smapsproc_t *par = proc_find(self, cur->smapsproc_pid.PPid);
+
+    assert( cur->smapsproc_parent == 0 );
+
+    if( par == 0 || par == cur )
+    {
+      if( cur->smapsproc_pid.PPid != 0 )
+      {
+        fprintf(stderr, "PPID %d not found\n", cur->smapsproc_pid.PPid);
+      }
+      par = &self->smapssnap_rootproc;
+    }
+
+    cur->smapsproc_parent = par;
+    array_add(&par->smapsproc_children, cur);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_group_threads
+ * ------------------------------------------------------------------------- */
+
+static int
+smapsproc_is_thread(const smapsproc_t *self)
+{
+  const pidinfo_t *pi = &self->smapsproc_pid;
+  return pi->Tgid != 0 && pi->Tgid != pi->Pid;
+}
+
+typedef struct
+{
+  int tid;   // zero = free slot
+  int tgid;
+} tidslot_t;
+
+static tidslot_t *
+tidslot_find(tidslot_t *slot, size_t mask, int tid)
+{
+  size_t i = (size_t)(unsigned)tid * 2654435761u;
+
+  for( ;; ++i )
+  {
+    tidslot_t *s = &slot[i & mask];
+    if( s->tid == 0 || s->tid == tid ) return s;
+  }
+}
+
+int
+smapssnap_group_threads(smapssnap_t *self)
+{
+  array_t   *list = &self->smapssnap_proclist;
+  int        have_tgid = 0;
+  size_t     nthreads  = 0;
+  size_t     keep      = 0;
+  size_t     mask      = 0;
+  tidslot_t *slot      = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * captures without Tgid information
+   * need to use the heuristic approach
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < list->size; ++i )
+  {
+    smapsproc_t *cur = list->data[i];
+    have_tgid |= (cur->smapsproc_pid.Tgid != 0);
+    nthreads  += smapsproc_is_thread(cur);
+  }
+
+  if( !have_tgid )
+  {
+    return 0;
+  }
+
+  if( nthreads == 0 )
+  {
+    return 1;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * thread id -> thread group id table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( mask = 64; mask < nthreads * 2; mask <<= 1 ) {}
+  slot = calloc(mask, sizeof *slot), --mask;
+
+  for( size_t i = 0; i < list->size; ++i )
+  {
+    smapsproc_t *cur = list->data[i];
+
+    if( smapsproc_is_thread(cur) )
+    {
+      tidslot_t *s = tidslot_find(slot, mask, cur->smapsproc_pid.Pid);
+      s->tid  = cur->smapsproc_pid.Pid;
+      s->tgid = cur->smapsproc_pid.Tgid;
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * children of non-leader threads belong
+   * to the thread group leader; the
+   * non-leader tasks are dropped, the
+   * leader status already includes the
+   * thread count
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < list->size; ++i )
+  {
+    smapsproc_t *cur = list->data[i];
+
+    if( smapsproc_is_thread(cur) )
+    {
+      smapsproc_delete(cur);
+      continue;
+    }
+
+    tidslot_t *s = tidslot_find(slot, mask, cur->smapsproc_pid.PPid);
+    if( s->tid != 0 )
+    {
+      cur->smapsproc_pid.PPid = s->tgid;
+    }
+    list->data[keep++] = cur;
+  }
+  list->size = keep;
+
+  free(slot);
+
+  return 1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_collapse_threads
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_collapse_threads(smapssnap_t *self)
+{
+  smapsproc_collapse_threads(&self->smapssnap_rootproc);
+
+  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
+  {
+    smapsproc_t *cur = self->smapssnap_proclist.data[i];
+
+    if( cur->smapsproc_parent == 0 )
+    {
+      self->smapssnap_proclist.data[i] = 0;
+      smapsproc_delete(cur);
+    }
+  }
+  array_compact(&self->smapssnap_proclist);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_prepare  --  merge threads & build process hierarchy
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_prepare(smapssnap_t *self)
+{
+  const char *path = self->smapssnap_source;
+
+  if( smapssnap_group_threads(self) ) {
+    smapssnap_create_hierarchy(self);
+  } else {
+    smapssnap_create_hierarchy(self);
+    if (self->smapssnap_format == SNAPFORMAT_OLD) {
+      fprintf(stderr, "Warning: %s: oldstyle capture file, not removing threads.\n", path);
+    } else {
+      smapssnap_collapse_threads(self);
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_add_process
+ * ------------------------------------------------------------------------- */
+
+smapsproc_t *
+smapssnap_add_process(smapssnap_t *self, int pid)
+{
+  smapsproc_t *proc;
+
+  for( int i = self->smapssnap_proclist.size; i-- > 0; )
+  {
+    proc = self->smapssnap_proclist.data[i];
+    if( proc->smapsproc_pid.Pid == pid )
+    {
+      return proc;
+    }
+  }
+  proc = smapsproc_create();
+  proc->smapsproc_pid.Pid = pid;
+  array_add(&self->smapssnap_proclist, proc);
+  return proc;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_load_cap
+ * ------------------------------------------------------------------------- */
+
+static int
+hexterm(const char *s)
+{
+  while( isxdigit(*s) )
+  {
+    ++s;
+  }
+  return *s;
+}
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * capture files may be gzip compressed:
+ * zlib reads plain files as is, and is
+ * wrapped in stdio stream for getline()
+ * - - - - - - - - - - - - - - - - - - - */
+
+static ssize_t
+gzip_read_cb(void *cookie, char *buf, size_t size)
+{
+  return gzread(cookie, buf, size);
+}
+
+static int
+gzip_close_cb(void *cookie)
+{
+  return (gzclose(cookie) == Z_OK) ? 0 : EOF;
+}
+
+static FILE *
+gzip_stream(gzFile gz)
+{
+  cookie_io_functions_t io =
+  {
+    .read  = gzip_read_cb,
+    .close = gzip_close_cb,
+  };
+
+  FILE  *file = 0;
+
+  if( gz != 0 )
+  {
+    gzbuffer(gz, 64<<10);
+
+    if( (file = fopencookie(gz, "r", io)) == 0 )
+    {
+      gzclose(gz);
+    }
+  }
+  return file;
+}
+
+static FILE *
+gzip_fopen(const char *path)
+{
+  return gzip_stream(gzopen(path, "rb"));
+}
+
+FILE *
+smaps_gzip_fdopen(int fd)
+{
+  return gzip_stream(gzdopen(fd, "rb"));
+}
+
+int
+smapssnap_load_cap(smapssnap_t *self, const char *path)
+{
+  int          error = -1;
+  FILE        *file  = 0;
+
+  smapssnap_set_source(self, path);
+
+  if( (file = gzip_fopen(path)) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
+
+  error = smapssnap_load_stream(self, file);
+
+  cleanup:
+
+  if( file ) fclose(file);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsparse_stream  --  parse capture data line by line as it arrives
+ * ------------------------------------------------------------------------- */
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * classify "==> ... <==" line, the line
+ * is modified in the process
+ * - - - - - - - - - - - - - - - - - - - */
+
+static int
+smapsparse_section_kind(char *data, int framed, int *ppid)
+{
+  int kind = SMAPSSECT_NONE;
+  int pid  = 0;
+
+  if( framed && !strncmp(data, "==> /proc/", 10)
+      && (pid = strtol(data + 10, 0, 10)) > 0 )
+  {
+    // declared format: no need to look for the proc component
+    kind = SMAPSSECT_PROCESS;
+  }
+  else if( !strcmp(data, "==> header <==") )
+  {
+    kind = SMAPSSECT_HEADER;
+  }
+  else if( !strcmp(data, "==> trailer <==") )
+  {
+    kind = SMAPSSECT_TRAILER;
+  }
+  else
+  {
+    char *backup = strdup(data); // save a copy for good error messages
+    char *pos = data;
+
+    while( *pos && strcmp(slice(&pos, '/'), "proc") ) { }
+    pid = strtol(slice(&pos, '/'), 0, 10);
+    if( pid > 0 && !strcmp(slice(&pos, -1), "smaps") )
+    {
+      kind = SMAPSSECT_PROCESS;
+    }
+    else
+    {
+      fprintf(stderr, "%s(): ignoring: %s\n", __FUNCTION__, backup);
+    }
+
+    free(backup);
+  }
+
+  *ppid = (kind == SMAPSSECT_PROCESS) ? pid : 0;
+  return kind;
+}
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * report the mapping that was collecting
+ * memory usage lines, if any
+ * - - - - - - - - - - - - - - - - - - - */
+
+static int
+smapsparse_flush(const smapsparse_t *self, int *pending,
+                 const mapinfo_t *map, const meminfo_t *mem)
+{
+  int error = 0;
+
+  if( *pending && self->smapsparse_mapping != 0 )
+  {
+    error = self->smapsparse_mapping(self->smapsparse_user, map, mem);
+  }
+  *pending = 0;
+  return error;
+}
+
+int
+smapsparse_stream(const smapsparse_t *self, FILE *file)
+{
+  int          error   = 0;
+  int          framed  = 0;
+  int          kind    = SMAPSSECT_NONE;
+  int          pending = 0;
+  unsigned     fields  = self->smapsparse_fields ?: SMAPSFIELD_ALL;
+  mapinfo_t    map;
+  meminfo_t    mem;
+  char         type[32];
+  char        *data    = 0;
+  size_t       size    = 0;
+  char        *copy    = 0;
+  size_t       room    = 0;
+  ssize_t      len;
+
+  mapinfo_ctor(&map);
+  meminfo_ctor(&mem);
+
+  while( (len = getline(&data, &size, file)) >= 0 )
+  {
+    data[strcspn(data, "\r\n")] = 0;
+
+    if( *data == 0 )
+    {
+      // ignore empty lines
+    }
+    else if( !strncmp(data, "==>", 3) )
+    {
+      // ==> /proc/1/smaps <==
+
+      int pid = 0;
+
+      if( (error = smapsparse_flush(self, &pending, &map, &mem)) != 0 )
+      {
+        break;
+      }
+
+      kind = smapsparse_section_kind(data, framed, &pid);
+
+      if( kind != SMAPSSECT_NONE && self->smapsparse_section != 0 )
+      {
+        error = self->smapsparse_section(self->smapsparse_user, kind, pid);
+        if( error ) break;
+      }
+    }
+    else if( *data == '#' )
+    {
+      // #Name: init__2_
+      // #Pid: 1
+      // #Format: 2
+
+      if( kind == SMAPSSECT_HEADER
+          && !strncmp(data, "#Format:", 8) && atoi(data+8) >= 2 )
+      {
+        framed = 1;
+      }
+
+      if( kind != SMAPSSECT_NONE && self->smapsparse_attribute != 0 )
+      {
+        error = self->smapsparse_attribute(self->smapsparse_user,
+                                           kind, data+1);
+        if( error ) break;
+      }
+    }
+    else if( hexterm(data) == '-' )
+    {
+      // 08048000-08051000 r-xp 00000000 03:03 2060370    /sbin/init
+
+      if( (error = smapsparse_flush(self, &pending, &map, &mem)) != 0 )
+      {
+        break;
+      }
+
+      if( kind == SMAPSSECT_PROCESS )
+      {
+        /* the line buffer is reused while the
+         * memory usage lines are collected */
+        if( room < (size_t)len + 1 )
+        {
+          room = len + 1;
+          copy = realloc(copy, room);
+        }
+        memcpy(copy, data, len + 1);
+
+        char *pos  = copy;
+        char *head = slice(&pos, '-');
+        char *tail = slice(&pos,  -1);
+        char *prot = slice(&pos,  -1);
+        char *offs = slice(&pos,  -1);
+        char *node = slice(&pos,  -1);
+        char *flgs = slice(&pos,  -1);
+
+        /* fields that were not asked for are
+         * left zero, or empty for strings */
+        mapinfo_ctor(&map);
+        map.prot = prot;
+        map.path = slice(&pos,  0);
+        map.node = (fields & SMAPSFIELD_NODE) ? node : "";
+
+        if( fields & SMAPSFIELD_HEAD )
+        {
+          map.head = strtoul(head, 0, 16);
+          map.tail = strtoul(tail, 0, 16);
+        }
+        if( fields & SMAPSFIELD_OFFS )
+        {
+          map.offs = strtoul(offs, 0, 16);
+        }
+        if( fields & SMAPSFIELD_FLGS )
+        {
+          map.flgs = strtoul(flgs, 0, 10);
+        }
+
+        if( *map.path == 0 )
+        {
+          map.path = "[anon]";
+        }
+        map.type = mapping_type(map.prot, map.path, type, sizeof type);
+
+        meminfo_ctor(&mem);
+        pending = 1;
+      }
+    }
+    else
+    {
+      // Size:                36 kB
+      // Rss:                 36 kB
+      // Shared_Clean:         0 kB
+
+      if( pending )
+      {
+        meminfo_parse_fields(&mem, data, fields);
+      }
+    }
+  }
+
+  if( error == 0 )
+  {
+    error = smapsparse_flush(self, &pending, &map, &mem);
+  }
+
+  free(copy);
+  free(data);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_load_stream  --  build snapshot from capture data
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  smapssnap_t *snap;
+  smapsproc_t *proc;
+} smapssnap_loader_t;
+
+static int
+smapssnap_load_section_cb(void *user, int kind, int pid)
+{
+  smapssnap_loader_t *ld = user;
+
+  ld->proc = 0;
+  if( kind == SMAPSSECT_PROCESS )
+  {
+    ld->proc = smapssnap_add_process(ld->snap, pid);
+  }
+  return 0;
+}
+
+static int
+smapssnap_load_attribute_cb(void *user, int kind, char *line)
+{
+  smapssnap_loader_t *ld   = user;
+  smapssnap_t        *snap = ld->snap;
+
+  if( kind == SMAPSSECT_PROCESS )
+  {
+    // #Name: init__2_
+    // #Pid: 1
+    // #PPid: 0
+    // #Threads: 1
+
+    pidinfo_parse(&ld->proc->smapsproc_pid, line);
+    if( snap->smapssnap_format == SNAPFORMAT_OLD )
+    {
+      snap->smapssnap_format = SNAPFORMAT_NEW;
+    }
+  }
+  else
+  {
+    // #Format: 2
+    // #PageSize: 4096
+    // #meminfo.MemTotal: 1024 kB
+
+    array_add(kind == SMAPSSECT_HEADER ?
+              &snap->smapssnap_header : &snap->smapssnap_trailer,
+              strdup(line));
+
+    if( !strncmp(line, "Format:", 7) && atoi(line+7) >= 2 )
+    {
+      snap->smapssnap_format = SNAPFORMAT_FRAMED;
+    }
+    else if( !strncmp(line, "PageSize:", 9) )
+    {
+      snap->smapssnap_pagesize = strtoul(line+9, 0, 10);
+    }
+  }
+  return 0;
+}
+
+static int
+smapssnap_load_mapping_cb(void *user, const mapinfo_t *map,
+                          const meminfo_t *mem)
+{
+  smapssnap_loader_t *ld   = user;
+  smapsmapp_t        *mapp = 0;
+
+  mapp = smapsproc_add_mapping(ld->proc, map->head, map->tail, map->prot,
+                               map->offs, map->node, map->flgs, map->path);
+  mapp->smapsmapp_mem = *mem;
+  return 0;
+}
+
+int
+smapssnap_load_stream(smapssnap_t *self, FILE *file)
+{
+  smapssnap_loader_t ld =
+  {
+    .snap = self,
+    .proc = 0,
+  };
+  smapsparse_t parser =
+  {
+    .smapsparse_user      = &ld,
+    .smapsparse_section   = smapssnap_load_section_cb,
+    .smapsparse_attribute = smapssnap_load_attribute_cb,
+    .smapsparse_mapping   = smapssnap_load_mapping_cb,
+    .smapsparse_fields    = self->smapssnap_fields,
+  };
+
+  return smapsparse_stream(&parser, file);
+}
+
+/* ========================================================================= *
+ * smapsindx_t  --  sidecar index for random access into capture files
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * smapssect_create
+ * ------------------------------------------------------------------------- */
+
+smapssect_t *
+smapssect_create(int kind, off_t offs, int pid)
+{
+  smapssect_t *self = calloc(1, sizeof *self);
+
+  self->smapssect_kind = kind;
+  self->smapssect_offs = offs;
+  self->smapssect_size = 0;
+  self->smapssect_pid  = pid;
+  self->smapssect_name = strdup("<noname>");
+  self->smapssect_rss  = 0;
+  self->smapssect_pss  = 0;
+  self->smapssect_swap = 0;
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssect_delete
+ * ------------------------------------------------------------------------- */
+
+void
+smapssect_delete(smapssect_t *self)
+{
+  if( self != 0 )
+  {
+    free(self->smapssect_name);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssect_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+smapssect_delete_cb(void *self)
+{
+  smapssect_delete(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsindx_ctor(smapsindx_t *self)
+{
+  self->smapsindx_capsize  = 0;
+  self->smapsindx_capmtime = 0;
+  array_ctor(&self->smapsindx_sections, smapssect_delete_cb);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+smapsindx_dtor(smapsindx_t *self)
+{
+  array_dtor(&self->smapsindx_sections);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_scan  --  locate sections in uncompressed capture data
+ * ------------------------------------------------------------------------- */
+
+int
+smapsindx_scan(smapsindx_t *self, FILE *file)
+{
+  int          framed = 0;
+  off_t        offs   = 0;
+  smapssect_t *sect   = 0;
+  char        *data   = 0;
+  size_t       size   = 0;
+  ssize_t      len;
+
+  array_clear(&self->smapsindx_sections);
+
+  while( (len = getline(&data, &size, file)) >= 0 )
+  {
+    off_t line = offs;
+
+    offs += len;
+    data[strcspn(data, "\r\n")] = 0;
+
+    if( !strncmp(data, "==>", 3) )
+    {
+      int kind, pid;
+
+      if( sect != 0 )
+      {
+        sect->smapssect_size = line - sect->smapssect_offs;
+        sect = 0;
+      }
+
+      if( (kind = smapsparse_section_kind(data, framed, &pid)) != SMAPSSECT_NONE )
+      {
+        sect = smapssect_create(kind, line, pid);
+        array_add(&self->smapsindx_sections, sect);
+      }
+    }
+    else if( sect == 0 )
+    {
+      // unrecognized section
+    }
+    else if( sect->smapssect_kind == SMAPSSECT_HEADER )
+    {
+      if( !strncmp(data, "#Format:", 8) && atoi(data+8) >= 2 )
+      {
+        framed = 1;
+      }
+    }
+    else if( sect->smapssect_kind != SMAPSSECT_PROCESS )
+    {
+      // trailer
+    }
+    else if( !strncmp(data, "#Name:", 6) )
+    {
+      // same normalization as the loader
+      pidinfo_t pi;
+      pidinfo_ctor(&pi);
+      pidinfo_parse(&pi, data+1);
+      xstrset(&sect->smapssect_name, pi.Name);
+      pidinfo_dtor(&pi);
+    }
+    else if( !strncmp(data, "Rss:", 4) )
+    {
+      sect->smapssect_rss += strtoul(data+4, 0, 10);
+    }
+    else if( !strncmp(data, "Pss:", 4) )
+    {
+      sect->smapssect_pss += strtoul(data+4, 0, 10);
+    }
+    else if( !strncmp(data, "Swap:", 5) )
+    {
+      sect->smapssect_swap += strtoul(data+5, 0, 10);
+    }
+  }
+
+  if( sect != 0 )
+  {
+    sect->smapssect_size = offs - sect->smapssect_offs;
+  }
+
+  free(data);
+
+  return ferror(file) ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_load  --  read index file
+ * ------------------------------------------------------------------------- */
+
+int
+smapsindx_load(smapsindx_t *self, const char *path)
+{
+  int     error = -1;
+  int     valid = 0;
+  FILE   *file  = 0;
+  char   *data  = 0;
+  size_t  size  = 0;
+
+  array_clear(&self->smapsindx_sections);
+
+  if( (file = fopen(path, "r")) == 0 )
+  {
+    goto cleanup;
+  }
+
+  while( getline(&data, &size, file) >= 0 )
+  {
+    // #Index: 1
+    // #CaptureSize: 123456
+    // #CaptureTime: 1234567890123456789
+    // 2 4096 1234 1 20 12 0 init
+
+    long long offs, len;
+    int       kind, pid, pos = 0;
+    unsigned  rss, pss, swap;
+
+    data[strcspn(data, "\r\n")] = 0;
+
+    if( !strncmp(data, "#Index:", 7) )
+    {
+      valid = (atoi(data+7) == 1);
+    }
+    else if( !strncmp(data, "#CaptureSize:", 13) )
+    {
+      self->smapsindx_capsize = strtoll(data+13, 0, 10);
+    }
+    else if( !strncmp(data, "#CaptureTime:", 13) )
+    {
+      self->smapsindx_capmtime = strtoll(data+13, 0, 10);
+    }
+    else if( valid && sscanf(data, "%d %lld %lld %d %u %u %u %n",
+                             &kind, &offs, &len, &pid,
+                             &rss, &pss, &swap, &pos) == 7 && pos > 0 )
+    {
+      smapssect_t *sect = smapssect_create(kind, offs, pid);
+
+      sect->smapssect_size = len;
+      sect->smapssect_rss  = rss;
+      sect->smapssect_pss  = pss;
+      sect->smapssect_swap = swap;
+      xstrset(&sect->smapssect_name, data + pos);
+      array_add(&self->smapsindx_sections, sect);
+    }
+    else
+    {
+      goto cleanup;
+    }
+  }
+
+  if( valid )
+  {
+    error = 0;
+  }
+
+  cleanup:
+
+  if( file ) fclose(file);
+  free(data);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_save  --  write index file
+ * ------------------------------------------------------------------------- */
+
+int
+smapsindx_save(smapsindx_t *self, const char *path)
+{
+  int   error = -1;
+  FILE *file  = 0;
+  char *temp  = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * write to temporary file and rename so
+   * that readers never see partial index
+   * - - - - - - - - - - - - - - - - - - - */
+
+  temp = temp_path(path);
+
+  if( (file = fopen(temp, "w")) == 0 )
+  {
+    goto cleanup;
+  }
+
+  fprintf(file, "#Index: 1\n");
+  fprintf(file, "#CaptureSize: %lld\n", (long long)self->smapsindx_capsize);
+  fprintf(file, "#CaptureTime: %lld\n", self->smapsindx_capmtime);
+
+  for( size_t i = 0; i < self->smapsindx_sections.size; ++i )
+  {
+    const smapssect_t *sect = self->smapsindx_sections.data[i];
+
+    fprintf(file, "%d %lld %lld %d %u %u %u %s\n",
+            sect->smapssect_kind,
+            (long long)sect->smapssect_offs,
+            (long long)sect->smapssect_size,
+            sect->smapssect_pid,
+            sect->smapssect_rss,
+            sect->smapssect_pss,
+            sect->smapssect_swap,
+            sect->smapssect_name);
+  }
+
+  if( fclose(file) != 0 )
+  {
+    file = 0; goto cleanup;
+  }
+  file = 0;
+
+  if( rename(temp, path) == 0 )
+  {
+    error = 0;
+  }
+
+  cleanup:
+
+  if( file ) fclose(file);
+  if( error && temp ) unlink(temp);
+  free(temp);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_open  --  load index for capture, rebuilding it if stale
+ * ------------------------------------------------------------------------- */
+
+static int
+capture_is_compressed(FILE *file)
+{
+  unsigned char magic[2];
+  int res = (fread(magic, 1, 2, file) == 2
+             && magic[0] == 0x1f && magic[1] == 0x8b);
+  rewind(file);
+  return res;
+}
+
+smapsindx_t *
+smapsindx_open(const char *capture)
+{
+  smapsindx_t *self  = 0;
+  FILE        *file  = 0;
+  char        *path  = 0;
+  long long    mtime = 0;
+  struct stat  st;
+
+  if( (file = fopen(capture, "r")) == 0 || fstat(fileno(file), &st) == -1 )
+  {
+    goto cleanup;
+  }
+
+  if( capture_is_compressed(file) )
+  {
+    goto cleanup;
+  }
+
+  mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+  self  = smapsindx_create();
+  smaps_xstrfmt(&path, "%s.idx", capture);
+
+  if( smapsindx_load(self, path) == 0
+      && self->smapsindx_capsize  == st.st_size
+      && self->smapsindx_capmtime == mtime )
+  {
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * missing or stale: rebuild, failing to
+   * save is not an error (read only media)
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( smapsindx_scan(self, file) != 0 )
+  {
+    smapsindx_delete(self), self = 0;
+    goto cleanup;
+  }
+
+  self->smapsindx_capsize  = st.st_size;
+  self->smapsindx_capmtime = mtime;
+  smapsindx_save(self, path);
+
+  cleanup:
+
+  if( file ) fclose(file);
+  free(path);
+
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_create
+ * ------------------------------------------------------------------------- */
+
+smapsindx_t *
+smapsindx_create(void)
+{
+  smapsindx_t *self = calloc(1, sizeof *self);
+  smapsindx_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_delete
+ * ------------------------------------------------------------------------- */
+
+void
+smapsindx_delete(smapsindx_t *self)
+{
+  if( self != 0 )
+  {
+    smapsindx_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+smapsindx_delete_cb(void *self)
+{
+  smapsindx_delete(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_load_select  --  load only selected processes from capture
+ * ------------------------------------------------------------------------- */
+
+static int
+smapssnap_load_indexed(smapssnap_t *self, const char *path,
+                       smapsindx_t *indx,
+                       int (*select)(void *user, int pid, const char *name),
+                       void *user)
+{
+  int     error = -1;
+  FILE   *file  = 0;
+  FILE   *data  = 0;
+  char   *buff  = 0;
+  size_t  size  = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * gather header, selected processes and
+   * trailer into one buffer, in file order
+   * so that the format is detected as is
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < indx->smapsindx_sections.size; ++i )
+  {
+    const smapssect_t *sect = indx->smapsindx_sections.data[i];
+
+    if( sect->smapssect_kind != SMAPSSECT_PROCESS
+        || select(user, sect->smapssect_pid, sect->smapssect_name) )
+    {
+      size += sect->smapssect_size;
+    }
+  }
+
+  if( (file = fopen(path, "r")) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
+
+  buff = malloc(size + 1);
+  size = 0;
+
+  for( size_t i = 0; i < indx->smapsindx_sections.size; ++i )
+  {
+    const smapssect_t *sect = indx->smapsindx_sections.data[i];
+
+    if( sect->smapssect_kind == SMAPSSECT_PROCESS
+        && !select(user, sect->smapssect_pid, sect->smapssect_name) )
+    {
+      continue;
+    }
+
+    if( fseeko(file, sect->smapssect_offs, SEEK_SET) == -1
+        || fread(buff + size, 1, sect->smapssect_size, file)
+           != (size_t)sect->smapssect_size )
+    {
+      fprintf(stderr, "%s: index does not match capture\n", path);
+      goto cleanup;
+    }
+    size += sect->smapssect_size;
+  }
+
+  if( (data = fmemopen(buff, size + 1, "r")) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
+  buff[size] = 0;
+
+  error = smapssnap_load_stream(self, data);
+
+  cleanup:
+
+  if( data ) fclose(data);
+  if( file ) fclose(file);
+  free(buff);
+
+  return error;
+}
+
+int
+smapssnap_load_select(smapssnap_t *self, const char *path,
+                      int (*select)(void *user, int pid, const char *name),
+                      void *user)
+{
+  int          error = -1;
+  smapsindx_t *indx  = smapsindx_open(path);
+
+  if( indx != 0 )
+  {
+    smapssnap_set_source(self, path);
+    error = smapssnap_load_indexed(self, path, indx, select, user);
+    smapsindx_delete(indx);
+    return error;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * compressed captures can not be seeked
+   * into: load everything, drop unselected
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( (error = smapssnap_load_cap(self, path)) != 0 )
+  {
+    return error;
+  }
+
+  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
+  {
+    smapsproc_t *cur = self->smapssnap_proclist.data[i];
+
+    if( !select(user, cur->smapsproc_pid.Pid, cur->smapsproc_pid.Name) )
+    {
+      self->smapssnap_proclist.data[i] = 0;
+      smapsproc_delete(cur);
+    }
+  }
+  array_compact(&self->smapssnap_proclist);
+
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_save_cap
+ * ------------------------------------------------------------------------- */
+
+int
+smapssnap_save_cap(smapssnap_t *self, const char *path)
+{
+  int          error = -1;
+  FILE        *file  = 0;
+
+  if( (file = fopen(path, "w")) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
+
+  smapssnap_sort_pid(self);
+
+  if( self->smapssnap_header.size != 0 )
+  {
+    fprintf(file, "==> header <==\n");
+    for( size_t i = 0; i < self->smapssnap_header.size; ++i )
+    {
+      fprintf(file, "#%s\n", (char *)self->smapssnap_header.data[i]);
+    }
+    fprintf(file, "\n");
+  }
+
+  for( int p = 0; p < self->smapssnap_proclist.size; ++p )
+  {
+    const smapsproc_t *proc = self->smapssnap_proclist.data[p];
+    const pidinfo_t   *pi = &proc->smapsproc_pid;
+
+    fprintf(file, "==> /proc/%d/smaps <==\n", pi->Pid);
+
+#define Ps(v) fprintf(file, "#%s: %s\n", #v, pi->v)
+#define Pi(v) fprintf(file, "#%s: %d\n", #v, pi->v)
+#define Pu(v) fprintf(file, "#%s: %u\n", #v, pi->v)
+
+    Ps(Name);
+    if( pi->Tgid ) Pi(Tgid);
+    Pi(Pid);
+    Pi(PPid);
+    Pi(Threads);
+
+    if( pi->VmPeak
+     || pi->VmSize
+     || pi->VmLck
+     || pi->VmHWM
+     || pi->VmRSS
+     || pi->VmData
+     || pi->VmStk
+     || pi->VmExe
+     || pi->VmLib
+     || pi->VmPTE
+     )
+    {
+      Pu(VmPeak);
+      Pu(VmSize);
+      Pu(VmLck);
+      Pu(VmHWM);
+      Pu(VmRSS);
+      Pu(VmData);
+      Pu(VmStk);
+      Pu(VmExe);
+      Pu(VmLib);
+      Pu(VmPTE);
+    }
+    if( pi->Truncated )
+    {
+      Ps(Truncated);
+    }
+    if( pi->ReadTime )
+    {
+      Ps(ReadTime);
+    }
+    if( pi->ReadDuration )
+    {
+      Ps(ReadDuration);
+    }
+#undef Pu
+#undef Pi
+#undef Ps
+
+    for( int m = 0; m < proc->smapsproc_mapplist.size; ++m )
+    {
+      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[m];
+      const mapinfo_t   *map  = &mapp->smapsmapp_map;
+      const meminfo_t   *mem  = &mapp->smapsmapp_mem;
+
+      fprintf(file, "%08x-%08x %s %08x %s %-10u %s\n",
+              map->head, map->tail, map->prot,
+              map->offs, map->node, map->flgs,
+              map->path);
+
+#define Pu(v) fprintf(file, "%-14s %8u kB\n", #v":", mem->v)
+
+      Pu(Size);
+      Pu(Rss);
+      Pu(Shared_Clean);
+      Pu(Shared_Dirty);
+      Pu(Private_Clean);
+      Pu(Private_Dirty);
+      Pu(Pss);
+      Pu(Swap);
+      Pu(Referenced);
+      Pu(Anonymous);
+      Pu(Locked);
+
+#undef Pu
+    }
+    fprintf(file, "\n");
+  }
+
+  if( self->smapssnap_trailer.size != 0 )
+  {
+    fprintf(file, "==> trailer <==\n");
+    for( size_t i = 0; i < self->smapssnap_trailer.size; ++i )
+    {
+      fprintf(file, "#%s\n", (char *)self->smapssnap_trailer.data[i]);
+    }
+  }
+
+  error = 0;
+
+  cleanup:
+
+  if( file ) fclose(file);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_save_csv
+ * ------------------------------------------------------------------------- */
+
+int
+smapssnap_save_csv(smapssnap_t *self, const char *path)
+{
+  int   error = -1;
+  FILE *file  = 0;
+
+  if( (file = fopen(path, "w")) == 0 )
+  {
+    perror(path); goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * arrange data by process name & pid
+   * - - - - - - - - - - - - - - - - - - - */
+
+  smapssnap_sort_pid(self);
+
+// QUARANTINE   array_sort(&self->snapshot_process_list,
+// QUARANTINE        smapsproc_compare_name_pid_cb);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * output csv header
+   * - - - - - - - - - - - - - - - - - - - */
+
+  fprintf(file, "generator=%s %s\n", "PROGNAME", "PROGVERS");
+  fprintf(file, "\n");
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * output csv labels
+   * - - - - - - - - - - - - - - - - - - - */
+
+  fprintf(file,
+          "name,pid,ppid,threads,"
+          "head,tail,prot,offs,node,flag,path,"
+          "size,rss,shacln,shadty,pricln,pridty,"
+          "pss,swap,referenced,anonymous,locked,"
+          "pri,sha,cln\n");
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * output csv table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < self->smapssnap_proclist.size; ++i )
+  {
+    const smapsproc_t *proc = self->smapssnap_proclist.data[i];
+    const pidinfo_t   *pid  = &proc->smapsproc_pid;
+
+    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    {
+      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+      const mapinfo_t   *map  = &mapp->smapsmapp_map;
+      const meminfo_t   *mem  = &mapp->smapsmapp_mem;
+
+      fprintf(file, "%s,%d,%d,%d,",
+              pid->Name,
+              pid->Pid,
+              pid->PPid,
+              pid->Threads);
+
+      fprintf(file, "%u,%u,%s,%u,%s,%u,%s,",
+              map->head, map->tail, map->prot,
+              map->offs, map->node, map->flgs,
+              map->path);
+
+      fprintf(file, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+              mem->Size,
+              mem->Rss,
+              mem->Shared_Clean,
+              mem->Shared_Dirty,
+              mem->Private_Clean,
+              mem->Private_Dirty,
+              mem->Pss,
+              mem->Swap,
+              mem->Referenced,
+              mem->Anonymous,
+              mem->Locked);
+
+      fprintf(file, "%u,%u,%u\n",
+              mem->Private_Dirty,
+              mem->Shared_Dirty,
+              mem->Private_Clean + mem->Shared_Clean);
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * terminate csv table
+   * - - - - - - - - - - - - - - - - - - - */
+
+  fprintf(file, "\n");
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * success
+   * - - - - - - - - - - - - - - - - - - - */
+
+  error = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * cleanup & return
+   * - - - - - - - - - - - - - - - - - - - */
+
+  cleanup:
+
+  if( file )
+  {
+    fclose(file);
+  }
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_save_html
+ * ------------------------------------------------------------------------- */
+
+// QUARANTINE int
+// QUARANTINE smapssnap_save_html(smapssnap_t *self, const char *path)
+// QUARANTINE {
+// QUARANTINE   int       error = -1;
+// QUARANTINE   analyze_t *az   = analyze_create();
+// QUARANTINE
+// QUARANTINE   /* - - - - - - - - - - - - - - - - - - - *
+// QUARANTINE    * enumerate & accumulate data
+// QUARANTINE    * - - - - - - - - - - - - - - - - - - - */
+// QUARANTINE
+// QUARANTINE   analyze_enumerate_data(az, self);
+// QUARANTINE
+// QUARANTINE   analyze_accumulate_data(az);
+// QUARANTINE
+// QUARANTINE   /* - - - - - - - - - - - - - - - - - - - *
+// QUARANTINE    * output html pages
+// QUARANTINE    * - - - - - - - - - - - - - - - - - - - */
+// QUARANTINE
+// QUARANTINE   error = analyze_emit_main_page(az, self, path);
+// QUARANTINE
+// QUARANTINE
+// QUARANTINE   analyze_delete(az);
+// QUARANTINE   return error;
+// QUARANTINE }
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_create
+ * ------------------------------------------------------------------------- */
+
+smapssnap_t *
+smapssnap_create(void)
+{
+  smapssnap_t *self = calloc(1, sizeof *self);
+  smapssnap_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_delete
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_delete(smapssnap_t *self)
+{
+  if( self != 0 )
+  {
+    smapssnap_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+smapssnap_delete_cb(void *self)
+{
+  smapssnap_delete(self);
+}
+
+/* ========================================================================= *
+ * smapscache  --  binary cache of prepared snapshots
+ *
+ * The cache is written next to the capture as "<capture>.cache" after
+ * the capture has been parsed and prepared, and mapped into memory on
+ * later runs instead of parsing the text again.
+ *
+ * Layout: smapscache_head_t, string offsets, string data, header and
+ * trailer line ids, smapscache_proc_t records, smapscache_mapp_t
+ * records and child process indices. String id 0 stands for NULL.
+ * Process index -1 is the hierarchy root.
+ * ========================================================================= */
+
+#define SMAPSCACHE_MAGIC   "SPSMAPC"
+#define SMAPSCACHE_VERSION 2
+#define SMAPSCACHE_ENDIAN  0x01020304u
+#define SMAPSCACHE_SAMPLE  (64<<10)
+#define SMAPSCACHE_HASH_INIT 14695981039346656037ull
+
+typedef struct
+{
+  int64_t   size;   // capture size
+  int64_t   mtime;  // capture mtime, nsec
+  uint64_t  hash;   // hash of capture head & tail
+} smapscache_key_t;
+
+typedef struct
+{
+  char             magic[8];
+  uint32_t         version;
+  uint32_t         endian;
+  smapscache_key_t key;
+  uint64_t         sum;     // hash of everything after the header
+
+  uint32_t         format;
+  uint32_t         pagesize;
+  uint32_t         fields;  // SMAPSFIELD_xxx that were loaded
+  uint32_t         nstrings;
+  uint32_t         strbytes;
+  uint32_t         nheader;
+  uint32_t         ntrailer;
+  uint32_t         nprocs;
+  uint32_t         nmapps;
+  uint32_t         nlinks;
+  uint32_t         rootkids;
+} smapscache_head_t;
+
+typedef struct
+{
+  uint32_t Name;
+  int32_t  Tgid;
+  int32_t  Pid;
+  int32_t  PPid;
+  int32_t  Threads;
+  uint32_t VmPeak;
+  uint32_t VmSize;
+  uint32_t VmLck;
+  uint32_t VmHWM;
+  uint32_t VmRSS;
+  uint32_t VmData;
+  uint32_t VmStk;
+  uint32_t VmExe;
+  uint32_t VmLib;
+  uint32_t VmPTE;
+  uint32_t Truncated;
+  uint32_t ReadTime;
+  uint32_t ReadDuration;
+
+  uint32_t nmapps;
+  uint32_t nkids;
+} smapscache_proc_t;
+
+typedef struct
+{
+  uint32_t  head;
+  uint32_t  tail;
+  uint32_t  offs;
+  uint32_t  flgs;
+  uint32_t  prot;
+  uint32_t  node;
+  uint32_t  path;
+  uint32_t  type;
+  meminfo_t mem;
+} smapscache_mapp_t;
+
+/* ------------------------------------------------------------------------- *
+ * smapscache_keyof  --  identify capture file contents
+ * ------------------------------------------------------------------------- */
+
+static uint64_t
+smapscache_hash(uint64_t h, const unsigned char *data, size_t size)
+{
+  // FNV-1a
+  while( size-- )
+  {
+    h ^= *data++;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static int
+smapscache_keyof(const char *capture, smapscache_key_t *key)
+{
+  int           error = -1;
+  int           fd    = -1;
+  unsigned char buff[SMAPSCACHE_SAMPLE];
+  ssize_t       n;
+  struct stat   st;
+
+  if( (fd = open(capture, O_RDONLY)) == -1 || fstat(fd, &st) == -1 )
+  {
+    goto cleanup;
+  }
+
+  if( !S_ISREG(st.st_mode) )
+  {
+    goto cleanup;
+  }
+
+  memset(key, 0, sizeof *key);
+  key->size  = st.st_size;
+  key->mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+  key->hash  = SMAPSCACHE_HASH_INIT;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * hashing the whole capture would cost
+   * as much as parsing it: sample the head
+   * and the tail, size & mtime do the rest
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( (n = pread(fd, buff, sizeof buff, 0)) < 0 )
+  {
+    goto cleanup;
+  }
+  key->hash = smapscache_hash(key->hash, buff, n);
+
+  if( st.st_size > SMAPSCACHE_SAMPLE )
+  {
+    if( (n = pread(fd, buff, sizeof buff, st.st_size - SMAPSCACHE_SAMPLE)) < 0 )
+    {
+      goto cleanup;
+    }
+    key->hash = smapscache_hash(key->hash, buff, n);
+  }
+
+  error = 0;
+
+  cleanup:
+
+  if( fd != -1 ) close(fd);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapscache_save
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  const smapsproc_t *proc;
+  uint32_t           indx;
+} smapscache_link_t;
+
+static int
+smapscache_link_cmp(const void *a1, const void *a2)
+{
+  const smapscache_link_t *l1 = a1;
+  const smapscache_link_t *l2 = a2;
+  return (l1->proc > l2->proc) - (l1->proc < l2->proc);
+}
+
+static uint32_t
+smapscache_link_find(const smapscache_link_t *tab, size_t cnt,
+                     const smapsproc_t *proc)
+{
+  smapscache_link_t key = { proc, 0 };
+  smapscache_link_t *hit = bsearch(&key, tab, cnt, sizeof *tab,
+                                   smapscache_link_cmp);
+  return hit ? hit->indx : UINT32_MAX;
+}
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * strings are collected into a private
+ * pool, aux slot holds the string id
+ * - - - - - - - - - - - - - - - - - - - */
+
+static uint32_t
+smapscache_string(strpool_t *pool, array_t *list, const char *str)
+{
+  unsigned *aux;
+
+  if( str == 0 )
+  {
+    return 0;
+  }
+
+  str = strpool_intern(pool, str);
+  aux = strpool_aux(str);
+
+  if( *aux == 0 )
+  {
+    array_add(list, (void *)str);
+    *aux = list->size;
+  }
+  return *aux;
+}
+
+static void
+smapscache_write(FILE *file, uint64_t *sum, const void *data, size_t size)
+{
+  *sum = smapscache_hash(*sum, data, size);
+  fwrite(data, size, 1, file);
+}
+
+static int
+smapscache_save(smapssnap_t *self, const char *path,
+                const smapscache_key_t *key)
+{
+  int                error = -1;
+  FILE              *file  = 0;
+  char              *temp  = 0;
+  strpool_t         *pool  = strpool_create();
+  array_t            strs;
+  smapscache_link_t *link  = 0;
+  size_t             nproc = self->smapssnap_proclist.size;
+  smapscache_head_t  head;
+
+  array_ctor(&strs, 0);
+  memset(&head, 0, sizeof head);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * process -> index lookup for hierarchy
+   * - - - - - - - - - - - - - - - - - - - */
+
+  link = calloc(nproc + 1, sizeof *link);
+  for( size_t i = 0; i < nproc; ++i )
+  {
+    link[i].proc = self->smapssnap_proclist.data[i];
+    link[i].indx = i;
+  }
+  qsort(link, nproc, sizeof *link, smapscache_link_cmp);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * assign string ids & count records
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t i = 0; i < self->smapssnap_header.size; ++i )
+  {
+    smapscache_string(pool, &strs, self->smapssnap_header.data[i]);
+  }
+  for( size_t i = 0; i < self->smapssnap_trailer.size; ++i )
+  {
+    smapscache_string(pool, &strs, self->smapssnap_trailer.data[i]);
+  }
+
+  head.rootkids = self->smapssnap_rootproc.smapsproc_children.size;
+  head.nlinks   = head.rootkids;
+
+  for( size_t i = 0; i < nproc; ++i )
+  {
+    const smapsproc_t *proc = self->smapssnap_proclist.data[i];
+    const pidinfo_t   *pi   = &proc->smapsproc_pid;
+
+    smapscache_string(pool, &strs, pi->Name);
+    smapscache_string(pool, &strs, pi->Truncated);
+    smapscache_string(pool, &strs, pi->ReadTime);
+    smapscache_string(pool, &strs, pi->ReadDuration);
+
+    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    {
+      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+      const mapinfo_t   *map  = &mapp->smapsmapp_map;
+
+      smapscache_string(pool, &strs, map->prot);
+      smapscache_string(pool, &strs, map->node);
+      smapscache_string(pool, &strs, map->path);
+      smapscache_string(pool, &strs, map->type);
+    }
+
+    head.nmapps += proc->smapsproc_mapplist.size;
+    head.nlinks += proc->smapsproc_children.size;
+  }
+
+  memcpy(head.magic, SMAPSCACHE_MAGIC, sizeof head.magic);
+  head.version  = SMAPSCACHE_VERSION;
+  head.endian   = SMAPSCACHE_ENDIAN;
+  head.key      = *key;
+  head.format   = self->smapssnap_format;
+  head.pagesize = self->smapssnap_pagesize;
+  head.fields   = self->smapssnap_fields;
+  head.nstrings = strs.size + 1;
+  head.nheader  = self->smapssnap_header.size;
+  head.ntrailer = self->smapssnap_trailer.size;
+  head.nprocs   = nproc;
+  head.sum      = SMAPSCACHE_HASH_INIT;
+
+  for( size_t i = 0; i < strs.size; ++i )
+  {
+    head.strbytes += strlen(strs.data[i]) + 1;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * write to temporary file and rename so
+   * that readers never see partial cache
+   * - - - - - - - - - - - - - - - - - - - */
+
+  temp = temp_path(path);
+
+  if( (file = fopen(temp, "w")) == 0 )
+  {
+    goto cleanup;
+  }
+
+  fwrite(&head, sizeof head, 1, file); // rewritten with sum below
+
+  {
+    uint32_t offs = 0;
+
+    smapscache_write(file, &head.sum, &offs, sizeof offs); // id 0 = NULL
+    for( size_t i = 0; i < strs.size; ++i )
+    {
+      smapscache_write(file, &head.sum, &offs, sizeof offs);
+      offs += strlen(strs.data[i]) + 1;
+    }
+    for( size_t i = 0; i < strs.size; ++i )
+    {
+      smapscache_write(file, &head.sum, strs.data[i],
+                       strlen(strs.data[i]) + 1);
+    }
+    // keep the records 4 byte aligned
+    for( offs = head.strbytes; offs & 3; ++offs )
+    {
+      smapscache_write(file, &head.sum, "", 1);
+    }
+  }
+
+  for( size_t i = 0; i < self->smapssnap_header.size; ++i )
+  {
+    uint32_t id = smapscache_string(pool, &strs, self->smapssnap_header.data[i]);
+    smapscache_write(file, &head.sum, &id, sizeof id);
+  }
+  for( size_t i = 0; i < self->smapssnap_trailer.size; ++i )
+  {
+    uint32_t id = smapscache_string(pool, &strs, self->smapssnap_trailer.data[i]);
+    smapscache_write(file, &head.sum, &id, sizeof id);
+  }
+
+  for( size_t i = 0; i < nproc; ++i )
+  {
+    const smapsproc_t *proc = self->smapssnap_proclist.data[i];
+    const pidinfo_t   *pi   = &proc->smapsproc_pid;
+    smapscache_proc_t  rec;
+
+    memset(&rec, 0, sizeof rec);
+    rec.Name         = smapscache_string(pool, &strs, pi->Name);
+    rec.Tgid         = pi->Tgid;
+    rec.Pid          = pi->Pid;
+    rec.PPid         = pi->PPid;
+    rec.Threads      = pi->Threads;
+    rec.VmPeak       = pi->VmPeak;
+    rec.VmSize       = pi->VmSize;
+    rec.VmLck        = pi->VmLck;
+    rec.VmHWM        = pi->VmHWM;
+    rec.VmRSS        = pi->VmRSS;
+    rec.VmData       = pi->VmData;
+    rec.VmStk        = pi->VmStk;
+    rec.VmExe        = pi->VmExe;
+    rec.VmLib        = pi->VmLib;
+    rec.VmPTE        = pi->VmPTE;
+    rec.Truncated    = smapscache_string(pool, &strs, pi->Truncated);
+    rec.ReadTime     = smapscache_string(pool, &strs, pi->ReadTime);
+    rec.ReadDuration = smapscache_string(pool, &strs, pi->ReadDuration);
+    rec.nmapps       = proc->smapsproc_mapplist.size;
+    rec.nkids        = proc->smapsproc_children.size;
+    smapscache_write(file, &head.sum, &rec, sizeof rec);
+  }
+
+  for( size_t i = 0; i < nproc; ++i )
+  {
+    const smapsproc_t *proc = self->smapssnap_proclist.data[i];
+
+    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    {
+      const smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+      const mapinfo_t   *map  = &mapp->smapsmapp_map;
+      smapscache_mapp_t  rec;
+
+      memset(&rec, 0, sizeof rec);
+      rec.head = map->head;
+      rec.tail = map->tail;
+      rec.offs = map->offs;
+      rec.flgs = map->flgs;
+      rec.prot = smapscache_string(pool, &strs, map->prot);
+      rec.node = smapscache_string(pool, &strs, map->node);
+      rec.path = smapscache_string(pool, &strs, map->path);
+      rec.type = smapscache_string(pool, &strs, map->type);
+      rec.mem  = mapp->smapsmapp_mem;
+      smapscache_write(file, &head.sum, &rec, sizeof rec);
+    }
+  }
+
+  for( size_t i = 0; i <= nproc; ++i )
+  {
+    const smapsproc_t *proc = (i == 0) ? &self->smapssnap_rootproc
+                                       : self->smapssnap_proclist.data[i-1];
+
+    for( size_t k = 0; k < proc->smapsproc_children.size; ++k )
+    {
+      uint32_t id = smapscache_link_find(link, nproc,
+                                         proc->smapsproc_children.data[k]);
+      if( id == UINT32_MAX )
+      {
+        // child not owned by the snapshot
+        goto cleanup;
+      }
+      smapscache_write(file, &head.sum, &id, sizeof id);
+    }
+  }
+
+  fseek(file, 0, SEEK_SET);
+  fwrite(&head, sizeof head, 1, file);
+
+  if( ferror(file) )
+  {
+    goto cleanup;
+  }
+  if( fclose(file) != 0 )
+  {
+    file = 0; goto cleanup;
+  }
+  file = 0;
+
+  if( rename(temp, path) == 0 )
+  {
+    error = 0;
+  }
+
+  cleanup:
+
+  if( file ) fclose(file);
+  if( error && temp ) unlink(temp);
+  free(temp);
+  free(link);
+  array_dtor(&strs);
+  strpool_delete(pool);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapscache_load
+ * ------------------------------------------------------------------------- */
+
+static const char *
+smapscache_str(const smapscache_head_t *head, const uint32_t *soff,
+               const char *sdat, uint32_t id)
+{
+  return (id != 0 && id < head->nstrings) ? sdat + soff[id] : 0;
+}
+
+static int
+smapscache_load(smapssnap_t *self, const char *path,
+                const smapscache_key_t *key)
+{
+  int                      error = -1;
+  int                      fd    = -1;
+  void                    *base  = MAP_FAILED;
+  size_t                   size  = 0;
+  const smapscache_head_t *head  = 0;
+  const uint32_t          *soff  = 0;
+  const char              *sdat  = 0;
+  const uint32_t          *hids  = 0;
+  const uint32_t          *tids  = 0;
+  const smapscache_proc_t *prec  = 0;
+  const smapscache_mapp_t *mrec  = 0;
+  const uint32_t          *kids  = 0;
+  smapsproc_t            **proc  = 0;
+  size_t                   need  = 0;
+  size_t                   mapps = 0;
+  size_t                   links = 0;
+  struct stat              st;
+
+  if( (fd = open(path, O_RDONLY)) == -1 || fstat(fd, &st) == -1 )
+  {
+    goto cleanup;
+  }
+
+  if( (size_t)st.st_size < sizeof *head )
+  {
+    goto cleanup;
+  }
+  size = st.st_size;
+
+  if( (base = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED )
+  {
+    goto cleanup;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * validate header & section sizes
+   * - - - - - - - - - - - - - - - - - - - */
+
+  head = base;
+
+  if( memcmp(head->magic, SMAPSCACHE_MAGIC, sizeof head->magic)
+      || head->version != SMAPSCACHE_VERSION
+      || head->endian  != SMAPSCACHE_ENDIAN
+      || memcmp(&head->key, key, sizeof *key)
+      || (head->fields & self->smapssnap_fields) != self->smapssnap_fields
+      || head->nstrings == 0 )
+  {
+    goto cleanup;
+  }
+
+  need = sizeof *head;
+  soff = (const uint32_t *)((const char *)base + need);
+  need += (size_t)head->nstrings * sizeof *soff;
+  sdat = (const char *)base + need;
+  need += (head->strbytes + 3) & ~3u;
+  hids = (const uint32_t *)((const char *)base + need);
+  need += (size_t)head->nheader * sizeof *hids;
+  tids = (const uint32_t *)((const char *)base + need);
+  need += (size_t)head->ntrailer * sizeof *tids;
+  prec = (const smapscache_proc_t *)((const char *)base + need);
+  need += (size_t)head->nprocs * sizeof *prec;
+  mrec = (const smapscache_mapp_t *)((const char *)base + need);
+  need += (size_t)head->nmapps * sizeof *mrec;
+  kids = (const uint32_t *)((const char *)base + need);
+  need += (size_t)head->nlinks * sizeof *kids;
+
+  if( need != size
+      || (head->strbytes && sdat[head->strbytes - 1] != 0) )
+  {
+    goto cleanup;
+  }
+
+  if( smapscache_hash(SMAPSCACHE_HASH_INIT, (const unsigned char *)(head + 1),
+                      size - sizeof *head) != head->sum )
+  {
+    goto cleanup;
+  }
+
+  for( uint32_t i = 0; i < head->nstrings; ++i )
+  {
+    if( soff[i] >= head->strbytes && i != 0 ) goto cleanup;
+  }
+
+#define STR(id) smapscache_str(head, soff, sdat, id)
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * header & trailer
+   * - - - - - - - - - - - - - - - - - - - */
+
+  self->smapssnap_format   = head->format;
+  self->smapssnap_pagesize = head->pagesize;
+  self->smapssnap_fields   = head->fields;
+
+  for( uint32_t i = 0; i < head->nheader; ++i )
+  {
+    if( !STR(hids[i]) ) goto cleanup;
+    array_add(&self->smapssnap_header, strdup(STR(hids[i])));
+  }
+  for( uint32_t i = 0; i < head->ntrailer; ++i )
+  {
+    if( !STR(tids[i]) ) goto cleanup;
+    array_add(&self->smapssnap_trailer, strdup(STR(tids[i])));
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * processes & mappings
+   * - - - - - - - - - - - - - - - - - - - */
+
+  proc = calloc(head->nprocs + 1, sizeof *proc);
+
+  for( uint32_t i = 0; i < head->nprocs; ++i )
+  {
+    const smapscache_proc_t *rec = &prec[i];
+    smapsproc_t             *cur = smapsproc_create();
+    pidinfo_t               *pi  = &cur->smapsproc_pid;
+
+    proc[i] = cur;
+    array_add(&self->smapssnap_proclist, cur);
+
+    if( !STR(rec->Name) ) goto cleanup;
+    xstrset(&pi->Name, STR(rec->Name));
+    pi->Tgid    = rec->Tgid;
+    pi->Pid     = rec->Pid;
+    pi->PPid    = rec->PPid;
+    pi->Threads = rec->Threads;
+    pi->VmPeak  = rec->VmPeak;
+    pi->VmSize  = rec->VmSize;
+    pi->VmLck   = rec->VmLck;
+    pi->VmHWM   = rec->VmHWM;
+    pi->VmRSS   = rec->VmRSS;
+    pi->VmData  = rec->VmData;
+    pi->VmStk   = rec->VmStk;
+    pi->VmExe   = rec->VmExe;
+    pi->VmLib   = rec->VmLib;
+    pi->VmPTE   = rec->VmPTE;
+    if( STR(rec->Truncated) )    pi->Truncated    = strdup(STR(rec->Truncated));
+    if( STR(rec->ReadTime) )     pi->ReadTime     = strdup(STR(rec->ReadTime));
+    if( STR(rec->ReadDuration) ) pi->ReadDuration = strdup(STR(rec->ReadDuration));
+
+    if( rec->nmapps > head->nmapps - mapps ) goto cleanup;
+
+    for( uint32_t k = 0; k < rec->nmapps; ++k )
+    {
+      const smapscache_mapp_t *mr   = &mrec[mapps++];
+      smapsmapp_t             *mapp = smapsmapp_create();
+      mapinfo_t               *map  = &mapp->smapsmapp_map;
+
+      array_add(&cur->smapsproc_mapplist, mapp);
+
+      if( !STR(mr->prot) || !STR(mr->node) || !STR(mr->path) || !STR(mr->type) )
+      {
+        goto cleanup;
+      }
+      map->head = mr->head;
+      map->tail = mr->tail;
+      map->offs = mr->offs;
+      map->flgs = mr->flgs;
+      map->prot = smaps_intern(STR(mr->prot));
+      map->node = smaps_intern(STR(mr->node));
+      map->path = smaps_intern(STR(mr->path));
+      map->type = smaps_intern(STR(mr->type));
+      mapp->smapsmapp_mem = mr->mem;
+    }
+  }
+
+#undef STR
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * hierarchy, root first
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( uint32_t i = 0; i <= head->nprocs; ++i )
+  {
+    smapsproc_t *par = i ? proc[i-1] : &self->smapssnap_rootproc;
+    uint32_t     cnt = i ? prec[i-1].nkids : head->rootkids;
+
+    if( cnt > head->nlinks - links ) goto cleanup;
+
+    for( uint32_t k = 0; k < cnt; ++k )
+    {
+      uint32_t id = kids[links++];
+
+      if( id >= head->nprocs || proc[id]->smapsproc_parent != 0 )
+      {
+        goto cleanup;
+      }
+      proc[id]->smapsproc_parent = par;
+      array_add(&par->smapsproc_children, proc[id]);
+    }
+  }
+
+  if( mapps != head->nmapps || links != head->nlinks )
+  {
+    goto cleanup;
+  }
+
+  error = 0;
+
+  cleanup:
+
+  if( base != MAP_FAILED ) munmap(base, size);
+  if( fd != -1 ) close(fd);
+  free(proc);
+
+  return error;
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_load_cached  --  load & prepare, via cache when possible
+ * ------------------------------------------------------------------------- */
+
+int
+smapssnap_load_cached(smapssnap_t *self, const char *path)
+{
+  int               error = -1;
+  int               keyed = 0;
+  char             *cache = 0;
+  smapscache_key_t  key;
+
+  smaps_xstrfmt(&cache, "%s.cache", path);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * key is taken before parsing, so that
+   * changes made meanwhile invalidate it
+   * - - - - - - - - - - - - - - - - - - - */
+
+  keyed = (smapscache_keyof(path, &key) == 0);
+
+  if( keyed )
+  {
+    unsigned fields = self->smapssnap_fields;
+
+    smapssnap_set_source(self, path);
+    if( smapscache_load(self, cache, &key) == 0 )
+    {
+      error = 0;
+      goto cleanup;
+    }
+
+    // partially loaded: start over
+    smapssnap_dtor(self);
+    smapssnap_ctor(self);
+    smapssnap_set_fields(self, fields);
+  }
+
+  if( (error = smapssnap_load_cap(self, path)) != 0 )
+  {
+    goto cleanup;
+  }
+
+  smapssnap_prepare(self);
+
+  if( keyed )
+  {
+    // failing to write the cache is not an error
+    smapscache_save(self, cache, &key);
+  }
+
+  cleanup:
+
+  free(cache);
+
+  return error;
+}
+
+/* ========================================================================= *
+ * analyze_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * analyze_ctor
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_ctor(analyze_t *self)
+{
+  self->mapp_tab = array_create(0); /* ownership of data not taken */
+
+  self->appl_tab = symtab_create();
+  self->type_tab = symtab_create();
+  self->path_tab = symtab_create();
+  self->summ_tab = symtab_create();
+
+  self->ntypes = 0;
+  self->nappls = 0;
+  self->npaths = 0;
+  self->groups = 0;
+
+  self->stype  = 0;
+  self->sappl  = 0;
+  self->spath  = 0;
+
+  self->grp_app = 0;
+  self->grp_lib = 0;
+
+  self->app_proc = 0;
+
+  self->grp_cell  = 0;
+  self->grp_cells = 0;
+
+  self->jobs = 1;
+
+  self->lib_xref = 0;
+  self->lib_off  = 0;
+  self->app_xref = 0;
+  self->app_off  = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_dtor
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_dtor(analyze_t *self)
+{
+  array_delete(self->mapp_tab);
+
+  symtab_delete(self->appl_tab);
+  symtab_delete(self->type_tab);
+  symtab_delete(self->path_tab);
+  symtab_delete(self->summ_tab);
+
+  free(self->stype);
+  free(self->sappl);
+  free(self->spath);
+
+  free(self->grp_app);
+  free(self->grp_lib);
+
+  free(self->app_proc);
+
+  free(self->app_mem);
+  free(self->grp_cell);
+  free(self->lib_mem);
+  free(self->sysest);
+  free(self->sysmax);
+  free(self->appmax);
+
+  free(self->lib_xref);
+  free(self->lib_off);
+  free(self->app_xref);
+  free(self->app_off);
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_create
+ * ------------------------------------------------------------------------- */
+
+analyze_t *
+analyze_create(void)
+{
+  analyze_t *self = calloc(1, sizeof *self);
+  analyze_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_delete
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_delete(analyze_t *self)
+{
+  if( self != 0 )
+  {
+    analyze_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_delete_cb
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_delete_cb(void *self)
+{
+  analyze_delete(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_set_jobs
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_set_jobs(analyze_t *self, int jobs)
+{
+  self->jobs = (jobs < 1) ? 1 : jobs;
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapping sort keys for smaps_radix_sort()
+ * ------------------------------------------------------------------------- */
+
+static unsigned
+mapp_key_aid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_AID;
+}
+
+static unsigned
+mapp_key_lid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_LID;
+}
+
+static unsigned
+mapp_key_eid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_EID;
+}
+
+static unsigned
+mapp_key_tid(const void *rec)
+{
+  return ((const smapsmapp_t *)rec)->smapsmapp_TID;
+}
+
+static unsigned
+mapp_key_rss_desc(const void *rec)
+{
+  return ~((const smapsmapp_t *)rec)->smapsmapp_mem.Rss;
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_sort_paths  --  order mappings by path
+ *
+ * Mapping paths are interned, so the distinct paths can be collected
+ * by address. Only those are sorted with path_compare(), the resulting
+ * rank is stored in smapsmapp_LID (paths comparing equal share it) and
+ * the mappings are then radix sorted by rank, keeping the original
+ * order within each path.
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  const char *path;
+  int         rank;
+} pathslot_t;
+
+static pathslot_t *
+pathslot_find(pathslot_t *slot, size_t mask, const char *path)
+{
+  size_t i = (size_t)((uintptr_t)path >> 3) * 2654435761u;
+
+  for( ;; ++i )
+  {
+    pathslot_t *s = &slot[i & mask];
+    if( s->path == 0 || s->path == path ) return s;
+  }
+}
+
+static int
+local_compare_path(const void *a1, const void *a2)
+{
+  return path_compare(*(const char **)a1, *(const char **)a2);
+}
+
+static void
+analyze_sort_paths(analyze_t *self)
+{
+  size_t        cnt  = self->mapp_tab->size;
+  size_t        mask = 255;
+  pathslot_t   *slot = calloc(mask + 1, sizeof *slot);
+  array_t      *uniq = array_create(0);
+  int           rank = -1;
+
+  static const smaps_radixkey_t keys[] = { mapp_key_lid };
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * distinct paths by address
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t k = 0; k < cnt; ++k )
+  {
+    smapsmapp_t *mapp = self->mapp_tab->data[k];
+    pathslot_t  *s    = pathslot_find(slot, mask, mapp->smapsmapp_map.path);
+
+    if( s->path != 0 ) continue;
+
+    s->path = mapp->smapsmapp_map.path;
+    array_add(uniq, (void *)s->path);
+
+    if( 2 * uniq->size > mask )
+    {
+      size_t      size = 2 * (mask + 1);
+      pathslot_t *grow = calloc(size, sizeof *grow);
+
+      for( size_t i = 0; i <= mask; ++i )
+      {
+        if( slot[i].path != 0 )
+        {
+          *pathslot_find(grow, size - 1, slot[i].path) = slot[i];
+        }
+      }
+      free(slot), slot = grow, mask = size - 1;
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * rank the distinct paths
+   * - - - - - - - - - - - - - - - - - - - */
+
+  array_sort(uniq, local_compare_path);
+
+  for( size_t i = 0; i < uniq->size; ++i )
+  {
+    const char *path = uniq->data[i];
+
+    if( i == 0 || path_compare(uniq->data[i-1], path) != 0 )
+    {
+      ++rank;
+    }
+    pathslot_find(slot, mask, path)->rank = rank;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * tag mappings with the path rank
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t k = 0; k < cnt; ++k )
+  {
+    smapsmapp_t *mapp = self->mapp_tab->data[k];
+    mapp->smapsmapp_LID = pathslot_find(slot, mask, mapp->smapsmapp_map.path)->rank;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * order mappings by path rank
+   * - - - - - - - - - - - - - - - - - - - */
+
+  smaps_radix_sort(self->mapp_tab->data, cnt, keys, 1);
+
+  array_delete(uniq);
+  free(slot);
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_enumerate_data
+ * ------------------------------------------------------------------------- */
+
+void
+analyze_enumerate_data(analyze_t *self, smapssnap_t *snap)
+{
+  char temp[512];
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * sort process list by: app name & pid
+   * - - - - - - - - - - - - - - - - - - - */
+
+  array_sort(&snap->smapssnap_proclist, smapsproc_compare_name_pid_cb);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * Enumerate:
+   * - application names
+   * - application instances
+   * - mapping types
+   *
+   * Collect all smaps data to one array
+   * while at it.
+   * - - - - - - - - - - - - - - - - - - - */
+
+  symtab_enumerate(self->type_tab, "total");
+  symtab_enumerate(self->type_tab, "code");
+  symtab_enumerate(self->type_tab, "data");
+  symtab_enumerate(self->type_tab, "heap");
+  symtab_enumerate(self->type_tab, "anon");
+  symtab_enumerate(self->type_tab, "stack");
+
+  for( size_t i = 0; i < snap->smapssnap_proclist.size; ++i )
+  {
+    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * application <- app name
+     * - - - - - - - - - - - - - - - - - - - */
+
+    // QUARANTINE     proc->smapsproc_AID = symtab_enumerate(self->appl_tab, proc->smapsproc_pid.Name);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * app instance <- app name + PID
+     * - - - - - - - - - - - - - - - - - - - */
+
+    snprintf(temp, sizeof temp, "%s (%d)",
+             proc->smapsproc_pid.Name,
+             proc->smapsproc_pid.Pid);
+
+    proc->smapsproc_PID = symtab_enumerate(self->appl_tab, temp);
+
+    // FIXME: use PID, not AID
+    proc->smapsproc_AID = proc->smapsproc_PID;
+
+    for( size_t k = 0; k < proc->smapsproc_mapplist.size; ++k )
+    {
+      smapsmapp_t *mapp = proc->smapsproc_mapplist.data[k];
+
+      mapp->smapsmapp_AID = proc->smapsproc_AID;
+      mapp->smapsmapp_PID = proc->smapsproc_PID;
+      mapp->smapsmapp_TID = symtab_enumerate(self->type_tab, mapp->smapsmapp_map.type);
+      array_add(self->mapp_tab, mapp);
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * sort smaps data by file path
+   * - - - - - - - - - - - - - - - - - - - */
+
+  analyze_sort_paths(self);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * Enumerate:
+   * - mapping paths
+   * - application instance + path pairs
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( size_t k = 0; k < self->mapp_tab->size; ++k )
+  {
+    smapsmapp_t *mapp = self->mapp_tab->data[k];
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * mapping path
+     * - - - - - - - - - - - - - - - - - - - */
+
+    mapp->smapsmapp_LID = symtab_enumerate(self->path_tab, mapp->smapsmapp_map.path);
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * application + mapping path
+     * - - - - - - - - - - - - - - - - - - - */
+
+    snprintf(temp, sizeof temp, "app%03d::lib%03d",
+             mapp->smapsmapp_AID,
+             mapp->smapsmapp_LID);
+    mapp->smapsmapp_EID = symtab_enumerate(self->summ_tab, temp);
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * reverse lookup tables for enums
+   * - - - - - - - - - - - - - - - - - - - */
+
+  self->ntypes = self->type_tab->symtab_count;
+  self->nappls = self->appl_tab->symtab_count;
+  self->npaths = self->path_tab->symtab_count;
+  self->groups = self->summ_tab->symtab_count;
+
+  self->stype  = calloc(self->ntypes, sizeof *self->stype);
+  self->sappl  = calloc(self->nappls, sizeof *self->sappl);
+  self->spath  = calloc(self->npaths, sizeof *self->spath);
+
+  for( int i = 0; i < self->ntypes; ++i )
+  {
+    symbol_t *s = &self->type_tab->symtab_entry[i];
+    self->stype[s->symbol_val] = s->symbol_key;
+  }
+  for( int i = 0; i < self->nappls; ++i )
+  {
+    symbol_t *s = &self->appl_tab->symtab_entry[i];
+    self->sappl[s->symbol_val] = s->symbol_key;
+  }
+  for( int i = 0; i < self->npaths; ++i )
+  {
+    symbol_t *s = &self->path_tab->symtab_entry[i];
+    self->spath[s->symbol_val] = s->symbol_key;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * app instance -> process, the first
+   * one in the list if labels repeat
+   * - - - - - - - - - - - - - - - - - - - */
+
+  self->app_proc = calloc(self->nappls, sizeof *self->app_proc);
+
+  for( size_t i = snap->smapssnap_proclist.size; i-- > 0; )
+  {
+    smapsproc_t *proc = snap->smapssnap_proclist.data[i];
+    self->app_proc[proc->smapsproc_AID] = proc;
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * group -> appl and/or path mapping
+   * - - - - - - - - - - - - - - - - - - - */
+
+  self->grp_app = calloc(self->groups, sizeof *self->grp_app);
+  self->grp_lib = calloc(self->groups, sizeof *self->grp_lib);
+
+  for( int g = 0; g < self->groups; ++g )
+  {
+    self->grp_app[g] = self->grp_lib[g] = -1;
+  }
+
+  for( size_t k = 0; k < self->mapp_tab->size; ++k )
+  {
+    smapsmapp_t *mapp = self->mapp_tab->data[k];
+    int g = mapp->smapsmapp_EID;
+    int a = mapp->smapsmapp_AID;
+    int p = mapp->smapsmapp_LID;
+
+    // QUARANTINE     printf("G:%d -> A:%d, L:%d\n", g, a, p);
+
+    assert( self->grp_app[g] == -1 || self->grp_app[g] == a );
+    assert( self->grp_lib[g] == -1 || self->grp_lib[g] == p );
+
+    self->grp_app[g] = a;
+    self->grp_lib[g] = p;
+  }
+
+  for( int g = 0; g < self->groups; ++g )
+  {
+    assert( self->grp_app[g] != -1 );
+    assert( self->grp_lib[g] != -1 );
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_run_tasks  --  call func for tasks 0 ... count-1 on a thread pool
+ * ------------------------------------------------------------------------- */
+
+typedef struct
+{
+  analyze_t *az;
+  void     (*func)(analyze_t *self, int task, void *data);
+  void      *data;
+  int        count;
+  int        next;  // next task to run
+} analyze_tasks_t;
+
+static void *
+analyze_tasks_worker(void *aptr)
+{
+  analyze_tasks_t *tasks = aptr;
+  int              task;
+
+  while( (task = __sync_fetch_and_add(&tasks->next, 1)) < tasks->count )
+  {
+    tasks->func(tasks->az, task, tasks->data);
+  }
+  return 0;
+}
+
+static void
+analyze_run_tasks(analyze_t *self, int count,
+                  void (*func)(analyze_t *self, int task, void *data),
+                  void *data)
+{
+  analyze_tasks_t tasks    = { self, func, data, count, 0 };
+  int             threads  = self->jobs < count ? self->jobs : count;
+  int             started  = 0;
+  pthread_t      *tids     = 0;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * the calling thread is one of the jobs,
+   * if threads can't be started it does
+   * all of the work
+   * - - - - - - - - - - - - - - - - - - - */
+
+  if( threads > 1 )
+  {
+    tids = calloc(threads - 1, sizeof *tids);
+  }
+
+  while( started < threads - 1 )
+  {
+    if( pthread_create(&tids[started], 0, analyze_tasks_worker, &tasks) != 0 )
+    {
+      break;
+    }
+    ++started;
+  }
+
+  analyze_tasks_worker(&tasks);
+
+  while( started > 0 )
+  {
+    pthread_join(tids[--started], 0);
+  }
+  free(tids);
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_split  --  task boundaries aligned to an offset table
+ *
+ * Splits ids 0 ... nids-1 into at most ntasks ranges holding roughly
+ * the same number of items. off[id] ... off[id+1]-1 are the items of an
+ * id, bnd[task] ... bnd[task+1]-1 are the ids of a task.
+ * ------------------------------------------------------------------------- */
+
+static int
+analyze_split(int *bnd, int ntasks, const int *off, int nids)
+{
+  int total = off[nids];
+  int count = 0;
+
+  bnd[0] = 0;
+  for( int id = 0; id < nids; )
+  {
+    long long want = (long long)total * (count + 1) / ntasks;
+
+    if( count == ntasks - 1 )
+    {
+      id = nids;
+    }
+    else
+    {
+      while( ++id < nids && off[id] < want ) {}
+    }
+    bnd[++count] = id;
+  }
+  return count;
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_accumulate_data
+ *
+ * The passes are split into tasks that write disjoint parts of the
+ * accumulation tables: mappings are summed to (group, type) cells by
+ * cell ranges, cells to application and library rows by app and lib
+ * ranges. The per type maxima and estimates over all apps and libs
+ * are collected to per task partial tables that are merged in task
+ * order afterwards. All accumulation is integer sums and maxima, so
+ * the result does not depend on the number of jobs.
+ * ------------------------------------------------------------------------- */
+
+static unsigned
+cell_key_lib(const void *rec)
+{
+  return ((const grpcell_t *)rec)->grpcell_lid;
+}
+
+typedef struct
+{
+  smapsmapp_t **mapp;      // mappings by app, group & type
+  int          *mapp_off;  // [grp_cells + 1]: cell -> mappings
+  int          *app_off;   // [nappls + 1]: app -> cells
+  grpcell_t   **lib_cell;  // cells by library
+  int          *lib_off;   // [npaths + 1]: lib -> lib_cell
+  int          *bnd;       // task -> ids
+  meminfo_t    *appmax;    // [tasks * ntypes] partial tables
+  meminfo_t    *sysmax;
+  meminfo_t    *sysest;
+} analyze_accu_t;
+
+static void
+analyze_sum_cells_task(analyze_t *self, int task, void *data)
+{
+  analyze_accu_t *accu = data;
+
+  for( int c = accu->bnd[task]; c < accu->bnd[task+1]; ++c )
+  {
+    meminfo_t *dest = &self->grp_cell[c].grpcell_mem;
+
+    for( int k = accu->mapp_off[c]; k < accu->mapp_off[c+1]; ++k )
+    {
+      meminfo_accumulate_appdata(dest, &accu->mapp[k]->smapsmapp_mem);
+    }
+  }
+}
+
+static void
+analyze_sum_apps_task(analyze_t *self, int task, void *data)
+{
+  analyze_accu_t *accu   = data;
+  meminfo_t      *appmax = &accu->appmax[task * self->ntypes];
+  meminfo_t      *sysmax = &accu->sysmax[task * self->ntypes];
+
+  for( int a = accu->bnd[task]; a < accu->bnd[task+1]; ++a )
+  {
+    /* - - - - - - - - - - - - - - - - - - - *
+     * process+library/type -> process/type
+     * - - - - - - - - - - - - - - - - - - - */
+
+    for( int c = accu->app_off[a]; c < accu->app_off[a+1]; ++c )
+    {
+      grpcell_t *cell = &self->grp_cell[c];
+
+      // Note: t=0 -> "total"
+      if( cell->grpcell_tid == 0 ) continue;
+
+      meminfo_accumulate_appdata(analyze_app_mem(self, a, cell->grpcell_tid),
+                                 &cell->grpcell_mem);
+    }
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * application instance totals and
+     * application data -> appl estimates
+     * - - - - - - - - - - - - - - - - - - - */
+
+    for( int t = 1; t < self->ntypes; ++t )
+    {
+      meminfo_t *srce = analyze_app_mem(self, a, t);
+
+      meminfo_accumulate_appdata(analyze_app_mem(self, a, 0), srce);
+      meminfo_accumulate_maxdata(&appmax[t], srce);
+      meminfo_accumulate_appdata(&sysmax[t], srce);
+    }
+  }
+}
+
+static void
+analyze_sum_libs_task(analyze_t *self, int task, void *data)
+{
+  analyze_accu_t *accu   = data;
+  meminfo_t      *sysest = &accu->sysest[task * self->ntypes];
+
+  for( int l = accu->bnd[task]; l < accu->bnd[task+1]; ++l )
+  {
+    /* - - - - - - - - - - - - - - - - - - - *
+     * process+library/type -> library/type
+     * - - - - - - - - - - - - - - - - - - - */
+
+    for( int c = accu->lib_off[l]; c < accu->lib_off[l+1]; ++c )
+    {
+      grpcell_t *cell = accu->lib_cell[c];
+
+      // Note: t=0 -> "total"
+      if( cell->grpcell_tid == 0 ) continue;
+
+      meminfo_accumulate_libdata(analyze_lib_mem(self, l, cell->grpcell_tid),
+                                 &cell->grpcell_mem);
+    }
+
+    /* - - - - - - - - - - - - - - - - - - - *
+     * library path totals and
+     * library data -> system estimates
+     * - - - - - - - - - - - - - - - - - - - */
+
+    for( int t = 1; t < self->ntypes; ++t )
+    {
+      meminfo_t *srce = analyze_lib_mem(self, l, t);
+
+      meminfo_accumulate_appdata(analyze_lib_mem(self, l, 0), srce);
+      meminfo_accumulate_appdata(&sysest[t], srce);
+    }
+  }
+}
+
+void
+analyze_accumulate_data(analyze_t *self)
+{
+  static const smaps_radixkey_t keys[] =
+  {
+    mapp_key_aid, mapp_key_eid, mapp_key_tid
+  };
+  static const smaps_radixkey_t lib_keys[] = { cell_key_lib };
+
+  size_t         cnt    = self->mapp_tab->size;
+  int            ntasks = self->jobs > 1 ? 4 * self->jobs : 1;
+  int            used   = 0;
+  analyze_accu_t accu;
+
+  memset(&accu, 0, sizeof accu);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * allocate accumulation tables
+   * - - - - - - - - - - - - - - - - - - - */
+
+  self->app_mem = calloc(self->nappls * self->ntypes, sizeof *self->app_mem);
+  self->lib_mem = calloc(self->npaths * self->ntypes, sizeof *self->lib_mem);
+
+  self->sysest  = calloc(self->ntypes, sizeof *self->sysest);
+  self->sysmax  = calloc(self->ntypes, sizeof *self->sysmax);
+  self->appmax  = calloc(self->ntypes, sizeof *self->appmax);
+
+  accu.bnd      = calloc(ntasks + 1, sizeof *accu.bnd);
+  accu.appmax   = calloc(ntasks * self->ntypes, sizeof *accu.appmax);
+  accu.sysmax   = calloc(ntasks * self->ntypes, sizeof *accu.sysmax);
+  accu.sysest   = calloc(ntasks * self->ntypes, sizeof *accu.sysest);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * a group is one app instance + path
+   * and typically has mappings of just
+   * one or two types, so instead of a
+   * dense groups x types table only the
+   * populated cells are stored, ordered
+   * by app, group and type
+   * - - - - - - - - - - - - - - - - - - - */
+
+  accu.mapp = malloc(cnt * sizeof *accu.mapp);
+  memcpy(accu.mapp, self->mapp_tab->data, cnt * sizeof *accu.mapp);
+  smaps_radix_sort((void **)accu.mapp, cnt, keys, 3);
+
+  for( size_t k = 0; k < cnt; ++k )
+  {
+    if( k == 0 ||
+        accu.mapp[k]->smapsmapp_EID != accu.mapp[k-1]->smapsmapp_EID ||
+        accu.mapp[k]->smapsmapp_TID != accu.mapp[k-1]->smapsmapp_TID )
+    {
+      ++used;
+    }
+  }
+
+  free(self->grp_cell);
+  self->grp_cell  = calloc(used, sizeof *self->grp_cell);
+  self->grp_cells = used;
+  accu.mapp_off   = calloc(used + 1, sizeof *accu.mapp_off);
+  accu.app_off    = calloc(self->nappls + 1, sizeof *accu.app_off);
+  accu.lib_off    = calloc(self->npaths + 1, sizeof *accu.lib_off);
+  accu.lib_cell   = malloc(used * sizeof *accu.lib_cell);
+
+  for( size_t k = 0, c = 0; k < cnt; ++k )
+  {
+    smapsmapp_t *mapp = accu.mapp[k];
+    grpcell_t   *cell = &self->grp_cell[c];
+
+    if( k == 0 ||
+        cell->grpcell_gid != mapp->smapsmapp_EID ||
+        cell->grpcell_tid != mapp->smapsmapp_TID )
+    {
+      if( k != 0 ) cell = &self->grp_cell[++c];
+      cell->grpcell_gid = mapp->smapsmapp_EID;
+      cell->grpcell_tid = mapp->smapsmapp_TID;
+      cell->grpcell_aid = self->grp_app[mapp->smapsmapp_EID];
+      cell->grpcell_lid = self->grp_lib[mapp->smapsmapp_EID];
+      accu.mapp_off[c] = k;
+      accu.app_off[cell->grpcell_aid + 1] += 1;
+      accu.lib_off[cell->grpcell_lid + 1] += 1;
+      accu.lib_cell[c] = cell;
+    }
+  }
+  accu.mapp_off[used] = cnt;
+
+  for( int a = 0; a < self->nappls; ++a )
+  {
+    accu.app_off[a+1] += accu.app_off[a];
+  }
+  for( int l = 0; l < self->npaths; ++l )
+  {
+    accu.lib_off[l+1] += accu.lib_off[l];
+  }
+  smaps_radix_sort((void **)accu.lib_cell, used, lib_keys, 1);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * accumulate raw smaps data by
+   * process + map path by type grouping
+   * - - - - - - - - - - - - - - - - - - - */
+
+  analyze_run_tasks(self, analyze_split(accu.bnd, ntasks, accu.mapp_off, used),
+                    analyze_sum_cells_task, &accu);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * accumulate grouped smaps data to
+   * application instance & library
+   * - - - - - - - - - - - - - - - - - - - */
+
+  analyze_run_tasks(self, analyze_split(accu.bnd, ntasks, accu.app_off, self->nappls),
+                    analyze_sum_apps_task, &accu);
+
+  analyze_run_tasks(self, analyze_split(accu.bnd, ntasks, accu.lib_off, self->npaths),
+                    analyze_sum_libs_task, &accu);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * merge partial estimates
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int task = 0; task < ntasks; ++task )
+  {
+    for( int t = 1; t < self->ntypes; ++t )
+    {
+      int i = task * self->ntypes + t;
+
+      meminfo_accumulate_maxdata(analyze_appmax(self, t), &accu.appmax[i]);
+      meminfo_accumulate_appdata(analyze_sysmax(self, t), &accu.sysmax[i]);
+      meminfo_accumulate_appdata(analyze_sysest(self, t), &accu.sysest[i]);
+    }
+  }
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * system estimate totals
+   * - - - - - - - - - - - - - - - - - - - */
+
+  for( int t = 1; t < self->ntypes; ++t )
+  {
+    meminfo_t *dest, *srce;
+
+    srce = analyze_sysest(self, t);
+    dest = analyze_sysest(self, 0);
+    meminfo_accumulate_appdata(dest, srce);
+
+    srce = analyze_sysmax(self, t);
+    dest = analyze_sysmax(self, 0);
+    meminfo_accumulate_appdata(dest, srce);
+
+    srce = analyze_appmax(self, t);
+    dest = analyze_appmax(self, 0);
+    meminfo_accumulate_appdata(dest, srce);
+  }
+
+  free(accu.sysest);
+  free(accu.sysmax);
+  free(accu.appmax);
+  free(accu.bnd);
+  free(accu.lib_cell);
+  free(accu.lib_off);
+  free(accu.app_off);
+  free(accu.mapp_off);
+  free(accu.mapp);
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_index_data
+ * ------------------------------------------------------------------------- */
+
+static void
+analyze_xref_offsets(int *off, int nids, smapsmapp_t **xref, size_t cnt,
+                     smaps_radixkey_t key)
+{
+  memset(off, 0, (nids + 1) * sizeof *off);
+
+  for( size_t i = 0; i < cnt; ++i )
+  {
+    off[key(xref[i]) + 1] += 1;
+  }
+  for( int i = 0; i < nids; ++i )
+  {
+    off[i+1] += off[i];
+  }
+}
+
+void
+analyze_index_data(analyze_t *self)
+{
+  static const smaps_radixkey_t base_keys[] =
+  {
+    mapp_key_tid, mapp_key_rss_desc
+  };
+  static const smaps_radixkey_t lib_keys[]  = { mapp_key_lid, mapp_key_aid };
+  static const smaps_radixkey_t app_keys[]  = { mapp_key_aid, mapp_key_lid };
+
+  size_t        cnt  = self->mapp_tab->size;
+  smapsmapp_t **base = malloc(cnt * sizeof *base);
+
+  free(self->lib_xref), self->lib_xref = malloc(cnt * sizeof *self->lib_xref);
+  free(self->app_xref), self->app_xref = malloc(cnt * sizeof *self->app_xref);
+  free(self->lib_off),  self->lib_off  = malloc((self->npaths + 1) * sizeof *self->lib_off);
+  free(self->app_off),  self->app_off  = malloc((self->nappls + 1) * sizeof *self->app_off);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * common secondary order: TID, then
+   * descending Rss
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memcpy(base, self->mapp_tab->data, cnt * sizeof *base);
+  smaps_radix_sort((void **)base, cnt, base_keys, 2);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * library -> mappings by application
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memcpy(self->lib_xref, base, cnt * sizeof *base);
+  smaps_radix_sort((void **)self->lib_xref, cnt, lib_keys, 2);
+  analyze_xref_offsets(self->lib_off, self->npaths,
+                       self->lib_xref, cnt, mapp_key_lid);
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * application -> mappings by library
+   * - - - - - - - - - - - - - - - - - - - */
+
+  memcpy(self->app_xref, base, cnt * sizeof *base);
+  smaps_radix_sort((void **)self->app_xref, cnt, app_keys, 2);
+  analyze_xref_offsets(self->app_off, self->nappls,
+                       self->app_xref, cnt, mapp_key_aid);
+
+  free(base);
+}
+
@@ -0,0 +1,636 @@
+/*
+ * This file is part of sp-smaps
+ *
+ * Copyright (C) 2004-2007 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * File: spsmaps.h
+ *
+ * Capture data model, streaming capture parser and memory usage
+ * accumulation used by sp_smaps_filter, for use in other programs.
+ *
+ * Typical in-process use:
+ *
+ *   smapssnap_t *snap = smapssnap_create();
+ *   smapssnap_load_cap(snap, "smaps.cap");
+ *   smapssnap_prepare(snap);
+ *
+ *   analyze_t *az = analyze_create();
+ *   analyze_enumerate_data(az, snap);
+ *   analyze_accumulate_data(az);
+ *   analyze_index_data(az);
+ *   ... analyze_app_mem(az, aid, tid) ...
+ *   analyze_delete(az);
+ *   smapssnap_delete(snap);
+ *
+ * Programs that do not need the whole capture in memory can instead
+ * receive it record by record via smapsparse_stream(), or load only
+ * some processes with smapssnap_load_select(), which uses a sidecar
+ * index file to seek directly to the wanted sections.
+ *
+ * smapssnap_load_cached() returns an already prepared snapshot and keeps
+ * a binary copy of it in "<capture>.cache", which is used instead of
+ * parsing the capture as long as the capture does not change.
+ *
+ * Separate snapshots can be loaded, prepared and analyzed in separate
+ * threads concurrently. A snapshot or analyze_t object must not be used
+ * from more than one thread at a time.
+ * ========================================================================= */
+
+#ifndef SPSMAPS_H_
+#define SPSMAPS_H_
+
+#include <stdio.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#include <libsysperf/array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#elif 0
+} /* fool JED indentation ... */
+#endif
+
+/* ========================================================================= *
+ * Custom Objects
+ * ========================================================================= */
+
+typedef struct analyze_t analyze_t;
+typedef struct grpcell_t grpcell_t;
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * container classes
+ * - - - - - - - - - - - - - - - - - - - */
+
+typedef struct smapssnap_t smapssnap_t;
+typedef struct smapsproc_t smapsproc_t;
+typedef struct smapsmapp_t smapsmapp_t;
+
+/* - - - - - - - - - - - - - - - - - - - *
+ * rawdata classes
+ * - - - - - - - - - - - - - - - - - - - */
+
+typedef struct pidinfo_t pidinfo_t; // Name,Pid,PPid, ...
+typedef struct mapinfo_t mapinfo_t; // head,tail,prot, ...
+typedef struct meminfo_t meminfo_t; // Size,RSS,Shared_Clean, ...
+
+/* ------------------------------------------------------------------------- *
+ * SMAPSFIELD_xxx  --  mapping data the loader should fill in
+ *
+ * Fields left out of the mask are neither converted nor stored: numbers
+ * stay zero and strings are empty. Protection bits and path are always
+ * loaded as they define the mapping type.
+ * ------------------------------------------------------------------------- */
+
+enum
+{
+  SMAPSFIELD_HEAD          = 1u << 0,  // head & tail addresses
+  SMAPSFIELD_OFFS          = 1u << 1,
+  SMAPSFIELD_NODE          = 1u << 2,
+  SMAPSFIELD_FLGS          = 1u << 3,  // inode
+
+  SMAPSFIELD_SIZE          = 1u << 4,
+  SMAPSFIELD_RSS           = 1u << 5,
+  SMAPSFIELD_SHARED_CLEAN  = 1u << 6,
+  SMAPSFIELD_SHARED_DIRTY  = 1u << 7,
+  SMAPSFIELD_PRIVATE_CLEAN = 1u << 8,
+  SMAPSFIELD_PRIVATE_DIRTY = 1u << 9,
+  SMAPSFIELD_PSS           = 1u << 10,
+  SMAPSFIELD_SWAP          = 1u << 11,
+  SMAPSFIELD_REFERENCED    = 1u << 12,
+  SMAPSFIELD_ANONYMOUS     = 1u << 13,
+  SMAPSFIELD_LOCKED        = 1u << 14,
+
+  SMAPSFIELD_MAPPING       = (1u << 4) - 1,
+  SMAPSFIELD_MEMORY        = ((1u << 15) - 1) & ~SMAPSFIELD_MAPPING,
+  SMAPSFIELD_ALL           = SMAPSFIELD_MAPPING | SMAPSFIELD_MEMORY,
+};
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_t
+ * ------------------------------------------------------------------------- */
+
+struct meminfo_t
+{
+  unsigned Size;
+  unsigned Rss;
+  unsigned Shared_Clean;
+  unsigned Shared_Dirty;
+  unsigned Private_Clean;
+  unsigned Private_Dirty;
+  unsigned Pss;
+  unsigned Swap;
+  unsigned Referenced;
+  unsigned Anonymous;
+  unsigned Locked;
+};
+
+void       meminfo_ctor              (meminfo_t *self);
+void       meminfo_dtor              (meminfo_t *self);
+void       meminfo_accumulate_appdata(meminfo_t *self, const meminfo_t *that);
+void       meminfo_accumulate_libdata(meminfo_t *self, const meminfo_t *that);
+void       meminfo_accumulate_maxdata(meminfo_t *self, const meminfo_t *that);
+void       meminfo_parse             (meminfo_t *self, char *line);
+void       meminfo_parse_fields      (meminfo_t *self, char *line,
+                                      unsigned fields);
+int        meminfo_all_zeroes        (const meminfo_t *self);
+
+meminfo_t *meminfo_create            (void);
+void       meminfo_delete            (meminfo_t *self);
+void       meminfo_delete_cb         (void *self);
+
+/* ------------------------------------------------------------------------- *
+ * meminfo_total
+ * ------------------------------------------------------------------------- */
+
+static inline unsigned
+meminfo_total(const meminfo_t *self)
+{
+  return (self->Shared_Clean  +
+          self->Shared_Dirty  +
+          self->Private_Clean +
+          self->Private_Dirty);
+}
+
+/* ------------------------------------------------------------------------- *
+ * mapinfo_t
+ * ------------------------------------------------------------------------- */
+
+struct mapinfo_t
+{
+  unsigned    head;
+  unsigned    tail;
+  const char *prot; // interned, shared by all captures
+  unsigned    offs;
+  const char *node;
+  unsigned    flgs;
+  const char *path;
+  const char *type;
+};
+
+void       mapinfo_ctor     (mapinfo_t *self);
+void       mapinfo_dtor     (mapinfo_t *self);
+
+mapinfo_t *mapinfo_create   (void);
+void       mapinfo_delete   (mapinfo_t *self);
+void       mapinfo_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * pidinfo_t
+ * ------------------------------------------------------------------------- */
+
+struct pidinfo_t
+{
+  char    *Name;
+  int      Tgid;    // thread group id, zero if not in capture
+  int      Pid;
+  int      PPid;
+  int      Threads;
+  unsigned VmPeak;
+  unsigned VmSize;
+  unsigned VmLck;
+  unsigned VmHWM;
+  unsigned VmRSS;
+  unsigned VmData;
+  unsigned VmStk;
+  unsigned VmExe;
+  unsigned VmLib;
+  unsigned VmPTE;
+  char    *Truncated; // capture limit that cut smaps data short, if any
+  char    *ReadTime;     // monotonic msec when capture of process started
+  char    *ReadDuration; // msec spent capturing the process
+};
+
+void       pidinfo_ctor     (pidinfo_t *self);
+void       pidinfo_dtor     (pidinfo_t *self);
+void       pidinfo_parse    (pidinfo_t *self, char *line);
+
+pidinfo_t *pidinfo_create   (void);
+void       pidinfo_delete   (pidinfo_t *self);
+void       pidinfo_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * smapsmapp_t
+ * ------------------------------------------------------------------------- */
+
+struct smapsmapp_t
+{
+  int       smapsmapp_uid; // create -> load order enumeration
+
+  mapinfo_t smapsmapp_map;
+  meminfo_t smapsmapp_mem;
+
+  int       smapsmapp_AID;
+  int       smapsmapp_PID;
+  int       smapsmapp_LID;
+  int       smapsmapp_TID;
+  int       smapsmapp_EID;
+};
+
+void         smapsmapp_ctor     (smapsmapp_t *self);
+void         smapsmapp_dtor     (smapsmapp_t *self);
+
+smapsmapp_t *smapsmapp_create   (void);
+void         smapsmapp_delete   (smapsmapp_t *self);
+void         smapsmapp_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * smapsproc_t
+ * ------------------------------------------------------------------------- */
+
+struct smapsproc_t
+{
+  int          smapsproc_uid;
+
+  int          smapsproc_AID;
+  int          smapsproc_PID;
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * smaps data & hierarchy
+   * - - - - - - - - - - - - - - - - - - - */
+
+  pidinfo_t    smapsproc_pid;
+  array_t      smapsproc_mapplist; // -> smapsmapp_t *
+
+  /* - - - - - - - - - - - - - - - - - - - *
+   * process hierarchy info
+   *
+   * Note: Owenership of childprocess data
+   *       remains with smapssnap_t!
+   * - - - - - - - - - - - - - - - - - - - */
+
+  smapsproc_t *smapsproc_parent;
+  array_t      smapsproc_children; // -> smapsproc_t *
+};
+
+void         smapsproc_ctor     (smapsproc_t *self);
+void         smapsproc_dtor     (smapsproc_t *self);
+int          smapsproc_are_same (smapsproc_t *self, smapsproc_t *that);
+void         smapsproc_adopt_children(smapsproc_t *self, smapsproc_t *that);
+void         smapsproc_collapse_threads(smapsproc_t *self);
+smapsmapp_t *smapsproc_add_mapping(smapsproc_t *self,
+                                   unsigned head, unsigned tail,
+                                   const char *prot, unsigned offs,
+                                   const char *node, unsigned flgs,
+                                   const char *path);
+int          smapsproc_compare_pid_cb(const void *a1, const void *a2);
+int          smapsproc_compare_name_pid_cb(const void *a1, const void *a2);
+
+smapsproc_t *smapsproc_create   (void);
+void         smapsproc_delete   (smapsproc_t *self);
+void         smapsproc_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * smapssnap_t
+ * ------------------------------------------------------------------------- */
+
+struct smapssnap_t
+{
+  char       *smapssnap_source;
+  int         smapssnap_format;
+  array_t     smapssnap_proclist; // -> smapsproc_t *
+  smapsproc_t smapssnap_rootproc;
+  unsigned    smapssnap_fields;   // SMAPSFIELD_xxx loaded from capture
+
+  array_t     smapssnap_header;   // -> char *, "key: value" from header
+  array_t     smapssnap_trailer;  // -> char *, "key: value" from trailer
+  unsigned    smapssnap_pagesize; // from header, zero if not known
+};
+
+enum {
+  SNAPFORMAT_OLD,    // head /proc/[1-9]*/smaps > snapshot.cap
+  SNAPFORMAT_NEW,    // sp_smaps_snapshot -o snapshot.cap
+  SNAPFORMAT_FRAMED, // as above, with header & trailer ("#Format: 2")
+};
+
+const char  *smapssnap_get_source(smapssnap_t *self);
+void         smapssnap_set_source(smapssnap_t *self, const char *path);
+void         smapssnap_set_fields(smapssnap_t *self, unsigned fields);
+smapsproc_t *smapssnap_add_process(smapssnap_t *self, int pid);
+void         smapssnap_create_hierarchy(smapssnap_t *self);
+int          smapssnap_group_threads(smapssnap_t *self);
+void         smapssnap_collapse_threads(smapssnap_t *self);
+void         smapssnap_prepare  (smapssnap_t *self);
+int          smapssnap_load_cap (smapssnap_t *self, const char *path);
+int          smapssnap_load_stream(smapssnap_t *self, FILE *file);
+int          smapssnap_load_cached(smapssnap_t *self, const char *path);
+int          smapssnap_load_select(smapssnap_t *self, const char *path,
+                                   int (*select)(void *user, int pid,
+                                                 const char *name),
+                                   void *user);
+int          smapssnap_save_cap (smapssnap_t *self, const char *path);
+int          smapssnap_save_csv (smapssnap_t *self, const char *path);
+
+void         smapssnap_ctor     (smapssnap_t *self);
+void         smapssnap_dtor     (smapssnap_t *self);
+
+smapssnap_t *smapssnap_create   (void);
+void         smapssnap_delete   (smapssnap_t *self);
+void         smapssnap_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * grpcell_t  --  memory usage of one group (app + path) and mapping type
+ * ------------------------------------------------------------------------- */
+
+struct grpcell_t
+{
+  int       grpcell_gid;
+  int       grpcell_tid;
+  int       grpcell_aid; // app and library of the group
+  int       grpcell_lid;
+  meminfo_t grpcell_mem;
+};
+
+/* ------------------------------------------------------------------------- *
+ * analyze_t  --  temporary book keeping structure for smaps snapshot analysis
+ * ------------------------------------------------------------------------- */
+
+struct analyze_t
+{
+  // smaps data for all processes will be collected here
+
+  array_t  *mapp_tab;
+
+  // enumeration tables, internal to the library
+
+  struct symtab_t *appl_tab;  // application names
+  struct symtab_t *type_tab;  // mapping types: code, data, anon, ...
+  struct symtab_t *path_tab;  // mapping paths
+  struct symtab_t *summ_tab;  // app instance + mapping path
+
+  int jobs;            // threads used for accumulation
+
+  int ntypes;          // enumeration counts
+  int nappls;
+  int npaths;
+  int groups;
+
+  const char **stype;  // enumeration -> string lookup tables
+  const char **sappl;
+  const char **spath;
+
+  int *grp_app;        // group enum -> appid / libid lookup tables
+  int *grp_lib;
+
+  smapsproc_t **app_proc; // appid -> process lookup table
+
+  // memory usage accumulation tables
+
+  grpcell_t *grp_cell; // [grp_cells], populated cells by group & type
+  int        grp_cells;
+  meminfo_t *app_mem; // [nappls * ntypes];
+  meminfo_t *lib_mem; // [npaths * ntypes];
+  meminfo_t *sysest;  // [ntypes]
+  meminfo_t *sysmax;  // [ntypes]
+  meminfo_t *appmax;  // [ntypes]
+
+  // mapping cross reference indexes: mappings of library l are
+  // lib_xref[lib_off[l] ... lib_off[l+1]-1] ordered by AID, TID
+  // and descending Rss, app_xref/app_off likewise by LID, TID, Rss
+
+  smapsmapp_t **lib_xref; // [mapp_tab->size]
+  int          *lib_off;  // [npaths + 1]
+  smapsmapp_t **app_xref; // [mapp_tab->size]
+  int          *app_off;  // [nappls + 1]
+};
+
+void       analyze_ctor                  (analyze_t *self);
+void       analyze_dtor                  (analyze_t *self);
+analyze_t *analyze_create                (void);
+void       analyze_delete                (analyze_t *self);
+void       analyze_delete_cb             (void *self);
+void       analyze_set_jobs              (analyze_t *self, int jobs);
+void       analyze_enumerate_data        (analyze_t *self, smapssnap_t *snap);
+void       analyze_accumulate_data       (analyze_t *self);
+void       analyze_index_data            (analyze_t *self);
+
+/* ------------------------------------------------------------------------- *
+ * analyze_app_proc
+ * ------------------------------------------------------------------------- */
+
+static inline smapsproc_t *
+analyze_app_proc(analyze_t *self, int aid)
+{
+  assert( 0 <= aid && aid < self->nappls );
+  return self->app_proc[aid];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_lib_mem
+ * ------------------------------------------------------------------------- */
+
+static inline meminfo_t *
+analyze_lib_mem(analyze_t *self, int lid, int tid)
+{
+  assert( 0 <= lid && lid < self->npaths );
+  assert( 0 <= tid && tid < self->ntypes );
+  return &self->lib_mem[tid + lid * self->ntypes];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_app_mem
+ * ------------------------------------------------------------------------- */
+
+static inline meminfo_t *
+analyze_app_mem(analyze_t *self, int aid, int tid)
+{
+  assert( 0 <= aid && aid < self->nappls );
+  assert( 0 <= tid && tid < self->ntypes );
+  return &self->app_mem[tid + aid * self->ntypes];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_sysest
+ * ------------------------------------------------------------------------- */
+
+static inline meminfo_t *
+analyze_sysest(analyze_t *self, int tid)
+{
+  assert( 0 <= tid && tid < self->ntypes );
+  return &self->sysest[tid];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_sysmax
+ * ------------------------------------------------------------------------- */
+
+static inline meminfo_t *
+analyze_sysmax(analyze_t *self, int tid)
+{
+  assert( 0 <= tid && tid < self->ntypes );
+  return &self->sysmax[tid];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_appmax
+ * ------------------------------------------------------------------------- */
+
+static inline meminfo_t *
+analyze_appmax(analyze_t *self, int tid)
+{
+  assert( 0 <= tid && tid < self->ntypes );
+  return &self->appmax[tid];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_lib_xref
+ * ------------------------------------------------------------------------- */
+
+static inline smapsmapp_t **
+analyze_lib_xref(analyze_t *self, int lid, int *pcnt)
+{
+  assert( 0 <= lid && lid < self->npaths );
+  *pcnt = self->lib_off[lid+1] - self->lib_off[lid];
+  return &self->lib_xref[self->lib_off[lid]];
+}
+
+/* ------------------------------------------------------------------------- *
+ * analyze_app_xref
+ * ------------------------------------------------------------------------- */
+
+static inline smapsmapp_t **
+analyze_app_xref(analyze_t *self, int aid, int *pcnt)
+{
+  assert( 0 <= aid && aid < self->nappls );
+  *pcnt = self->app_off[aid+1] - self->app_off[aid];
+  return &self->app_xref[self->app_off[aid]];
+}
+
+/* ------------------------------------------------------------------------- *
+ * smapsparse_t  --  callbacks for streaming capture parser
+ *
+ * Any of the callbacks can be left NULL. A non-zero return value from
+ * a callback stops parsing and is returned from smapsparse_stream().
+ *
+ * A mapping is reported once all of its memory usage lines have been
+ * seen, i.e. when the next mapping or section starts or at the end of
+ * data. The strings in mapinfo_t are valid during the callback only.
+ * ------------------------------------------------------------------------- */
+
+enum
+{
+  SMAPSSECT_NONE,    // unrecognized section, contents are skipped
+  SMAPSSECT_HEADER,  // ==> header <==
+  SMAPSSECT_PROCESS, // ==> /proc/<pid>/smaps <==
+  SMAPSSECT_TRAILER, // ==> trailer <==
+};
+
+typedef struct smapsparse_t smapsparse_t;
+
+struct smapsparse_t
+{
+  void *smapsparse_user; // passed to all callbacks
+
+  // section starts, pid is zero for header & trailer
+  int (*smapsparse_section)(void *user, int kind, int pid);
+
+  // "#Key: value" line with the '#' removed, may be modified
+  int (*smapsparse_attribute)(void *user, int kind, char *line);
+
+  // mapping & memory usage of the current process
+  int (*smapsparse_mapping)(void *user, const mapinfo_t *map,
+                            const meminfo_t *mem);
+
+  // SMAPSFIELD_xxx to parse, zero means all
+  unsigned smapsparse_fields;
+};
+
+int smapsparse_stream(const smapsparse_t *self, FILE *file);
+
+/* ------------------------------------------------------------------------- *
+ * smapsindx_t  --  sidecar index of capture file sections
+ *
+ * Stored next to the capture as "<capture>.idx" and rebuilt whenever
+ * the size or modification time of the capture no longer matches.
+ * Compressed captures can not be seeked into and are not indexed.
+ * ------------------------------------------------------------------------- */
+
+typedef struct smapssect_t smapssect_t;
+typedef struct smapsindx_t smapsindx_t;
+
+struct smapssect_t
+{
+  int       smapssect_kind;  // SMAPSSECT_xxx
+  off_t     smapssect_offs;  // byte offset of the "==>" line
+  off_t     smapssect_size;  // bytes up to the next section
+  int       smapssect_pid;   // zero for header & trailer
+  char     *smapssect_name;  // from #Name, "<noname>" if not known
+  unsigned  smapssect_rss;   // sum of mapping Rss, kB
+  unsigned  smapssect_pss;   // sum of mapping Pss, kB
+  unsigned  smapssect_swap;  // sum of mapping Swap, kB
+};
+
+smapssect_t *smapssect_create   (int kind, off_t offs, int pid);
+void         smapssect_delete   (smapssect_t *self);
+void         smapssect_delete_cb(void *self);
+
+struct smapsindx_t
+{
+  off_t     smapsindx_capsize;  // capture size when indexed
+  long long smapsindx_capmtime; // capture mtime when indexed, nsec
+  array_t   smapsindx_sections; // -> smapssect_t *
+};
+
+int          smapsindx_scan     (smapsindx_t *self, FILE *file);
+int          smapsindx_load     (smapsindx_t *self, const char *path);
+int          smapsindx_save     (smapsindx_t *self, const char *path);
+smapsindx_t *smapsindx_open     (const char *capture);
+
+void         smapsindx_ctor     (smapsindx_t *self);
+void         smapsindx_dtor     (smapsindx_t *self);
+
+smapsindx_t *smapsindx_create   (void);
+void         smapsindx_delete   (smapsindx_t *self);
+void         smapsindx_delete_cb(void *self);
+
+/* ------------------------------------------------------------------------- *
+ * capture input  --  plain or gzip compressed
+ * ------------------------------------------------------------------------- */
+
+FILE *smaps_gzip_fdopen(int fd);
+
+/* ------------------------------------------------------------------------- *
+ * utilities
+ * ------------------------------------------------------------------------- */
+
+typedef unsigned (*smaps_radixkey_t)(const void *rec);
+
+/* Mapping attributes of all loaded captures point into one shared string
+ * pool. smaps_intern_release() frees it unconditionally and
+ * smaps_intern_trim() frees it when it holds more than limit strings
+ * (returning 1 if it did). Both may only be called once every capture
+ * loaded so far has been deleted; nothing checks this. */
+
+size_t smaps_intern_count  (void);
+void   smaps_intern_release(void);
+int    smaps_intern_trim   (size_t limit);
+
+char *smaps_path_basename(const char *path);
+char *smaps_xstrfmt(char **pstr, const char *fmt, ...);
+void  smaps_radix_sort(void **data, size_t cnt,
+                       const smaps_radixkey_t *keys, int nkeys);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* SPSMAPS_H_ */
@@ -0,0 +1,219 @@
+/*
+ * This file is part of sp-smaps
+ *
+ * Copyright (C) 2004-2007 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * File: strpool.c
+ *
+ * Hash table of interned strings. Strings are never removed while the
+ * pool exists: the pool lives as long as the data that refers to it.
+ * ========================================================================= */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "strpool.h"
+
+#define STRPOOL_MIN_SIZE 1024
+
+/* ========================================================================= *
+ * strpool_entry_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * strpool_entry_create  --  allocate entry with string copy
+ * ------------------------------------------------------------------------- */
+
+static strpool_entry_t *
+strpool_entry_create(const char *str, size_t len, unsigned hash)
+{
+  strpool_entry_t *self = malloc(sizeof *self + len + 1);
+  self->strpool_next = 0;
+  self->strpool_hash = hash;
+  self->strpool_aux  = 0;
+  memcpy(self->strpool_text, str, len + 1);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_hash_string  --  FNV-1a
+ * ------------------------------------------------------------------------- */
+
+static unsigned
+strpool_hash_string(const char *str, size_t *plen)
+{
+  const unsigned char *s = (const unsigned char *)str;
+  unsigned             h = 2166136261u;
+
+  for( ; *s; ++s )
+  {
+    h ^= *s;
+    h *= 16777619u;
+  }
+  *plen = (const char *)s - str;
+  return h;
+}
+
+/* ========================================================================= *
+ * strpool_t  --  methods
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * strpool_ctor  --  constructor
+ * ------------------------------------------------------------------------- */
+
+void
+strpool_ctor(strpool_t *self)
+{
+  self->strpool_size  = STRPOOL_MIN_SIZE;
+  self->strpool_count = 0;
+  self->strpool_slot  = calloc(self->strpool_size, sizeof *self->strpool_slot);
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_dtor  --  destructor
+ * ------------------------------------------------------------------------- */
+
+void
+strpool_dtor(strpool_t *self)
+{
+  for( size_t i = 0; i < self->strpool_size; ++i )
+  {
+    strpool_entry_t *e;
+    while( (e = self->strpool_slot[i]) != 0 )
+    {
+      self->strpool_slot[i] = e->strpool_next;
+      free(e);
+    }
+  }
+  free(self->strpool_slot);
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_create  --  create method
+ * ------------------------------------------------------------------------- */
+
+strpool_t *
+strpool_create(void)
+{
+  strpool_t *self = calloc(1, sizeof *self);
+  strpool_ctor(self);
+  return self;
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_delete  --  delete method
+ * ------------------------------------------------------------------------- */
+
+void
+strpool_delete(strpool_t *self)
+{
+  if( self != 0 )
+  {
+    strpool_dtor(self);
+    free(self);
+  }
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_delete_cb  --  delete callback
+ * ------------------------------------------------------------------------- */
+
+void
+strpool_delete_cb(void *self)
+{
+  strpool_delete(self);
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_rehash  --  double the bucket count
+ * ------------------------------------------------------------------------- */
+
+static void
+strpool_rehash(strpool_t *self)
+{
+  size_t            size = self->strpool_size * 2;
+  strpool_entry_t **slot = calloc(size, sizeof *slot);
+
+  for( size_t i = 0; i < self->strpool_size; ++i )
+  {
+    strpool_entry_t *e;
+    while( (e = self->strpool_slot[i]) != 0 )
+    {
+      self->strpool_slot[i] = e->strpool_next;
+      e->strpool_next = slot[e->strpool_hash & (size - 1)];
+      slot[e->strpool_hash & (size - 1)] = e;
+    }
+  }
+
+  free(self->strpool_slot);
+  self->strpool_slot = slot;
+  self->strpool_size = size;
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_intern  --  return the pooled copy of a string
+ * ------------------------------------------------------------------------- */
+
+const char *
+strpool_intern(strpool_t *self, const char *str)
+{
+  size_t           len  = 0;
+  unsigned         hash = strpool_hash_string(str, &len);
+  strpool_entry_t *e;
+
+  for( e = self->strpool_slot[hash & (self->strpool_size - 1)];
+       e != 0; e = e->strpool_next )
+  {
+    if( e->strpool_hash == hash && !strcmp(e->strpool_text, str) )
+    {
+      return e->strpool_text;
+    }
+  }
+
+  if( self->strpool_count >= self->strpool_size )
+  {
+    strpool_rehash(self);
+  }
+
+  e = strpool_entry_create(str, len, hash);
+  e->strpool_next = self->strpool_slot[hash & (self->strpool_size - 1)];
+  self->strpool_slot[hash & (self->strpool_size - 1)] = e;
+  self->strpool_count += 1;
+
+  return e->strpool_text;
+}
+
+/* ------------------------------------------------------------------------- *
+ * strpool_aux  --  owner data slot of an interned string
+ *
+ * The argument must be a pointer returned by strpool_intern().
+ * ------------------------------------------------------------------------- */
+
+unsigned *
+strpool_aux(const char *str)
+{
+  strpool_entry_t *e = (strpool_entry_t *)(str - offsetof(strpool_entry_t,
+                                                          strpool_text));
+  return &e->strpool_aux;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of sp-smaps
+ *
+ * Copyright (C) 2004-2007 Nokia Corporation.
+ *
+ * Contact: Eero Tamminen <eero.tamminen@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/* ========================================================================= *
+ * File: strpool.h
+ *
+ * Interned strings: each distinct string is stored once and identified
+ * by its address, so equality checks are pointer compares and the
+ * storage survives from one capture to the next.
+ * ========================================================================= */
+
+#ifndef STRPOOL_H_
+#define STRPOOL_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#elif 0
+} /* fool JED indentation ... */
+#endif
+
+/* ========================================================================= *
+ * Custom Object Classes
+ * ========================================================================= */
+
+typedef struct strpool_t strpool_t;
+typedef struct strpool_entry_t strpool_entry_t;
+
+/* ------------------------------------------------------------------------- *
+ * strpool_entry_t
+ * ------------------------------------------------------------------------- */
+
+struct strpool_entry_t
+{
+  strpool_entry_t *strpool_next;   // hash chain
+  unsigned         strpool_hash;   // full hash value
+  unsigned         strpool_aux;    // owner data, zero until set
+  char             strpool_text[]; // the string itself
+};
+
+/* ------------------------------------------------------------------------- *
+ * strpool_t
+ * ------------------------------------------------------------------------- */
+
+struct strpool_t
+{
+  strpool_entry_t **strpool_slot;  // hash buckets
+  size_t            strpool_size;  // number of buckets, power of two
+  size_t            strpool_count; // number of strings
+};
+
+void        strpool_ctor     (strpool_t *self);
+void        strpool_dtor     (strpool_t *self);
+strpool_t  *strpool_create   (void);
+void        strpool_delete   (strpool_t *self);
+void        strpool_delete_cb(void *self);
+const char *strpool_intern   (strpool_t *self, const char *str);
+unsigned   *strpool_aux      (const char *str);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* STRPOOL_H_ */